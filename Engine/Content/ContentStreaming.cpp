@@ -0,0 +1,522 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "ContentStreaming.h"
+#include <condition_variable>
+#include <unordered_map>
+
+namespace primal::content::streaming {
+namespace {
+
+struct load_request
+{
+    request_info				info;
+    mapped_file					file;
+    std::unique_ptr<u8[]>		decoded;			// decoded data or a decompressed pack entry
+    const u8*					data{ nullptr };	// points into file, decoded or the pack's mapping
+    u64							size{ 0 };
+    u64							memory{ 0 };		// bytes counted against the memory budget
+    streaming::status::type		status{ streaming::status::queued };
+    bool						in_worker{ false };	// a worker thread owns data until this is cleared
+};
+
+std::unordered_map<id::id_type, load_request>	requests;
+utl::deque<id::id_type>							io_queues[priority::count];
+utl::deque<id::id_type>							decode_queues[priority::count];
+utl::vector<id::id_type>						ready_requests;
+utl::vector<id::id_type>						cancelled_requests;
+utl::vector<std::thread>						workers;
+std::mutex										request_mutex;
+std::condition_variable							io_cv;
+std::condition_variable							decode_cv;
+std::condition_variable							budget_cv;
+init_info										settings{};
+stats											streaming_stats{};
+id::id_type										next_request_id{ 0 };
+bool											is_shutting_down{ false };
+
+// Pops the most important request in queues that is still waiting in the given status. Requests are
+// removed lazily, so queues may hold ids of cancelled or re-prioritized requests, which are skipped.
+id::id_type
+pop_request(utl::deque<id::id_type>* const queues, status::type waiting_status)
+{
+    for (u32 p{ 0 }; p < priority::count; ++p)
+    {
+        utl::deque<id::id_type>& queue{ queues[p] };
+        while (!queue.empty())
+        {
+            const id::id_type id{ queue.front() };
+            queue.pop_front();
+
+            auto it{ requests.find(id) };
+            if (it == requests.end()) continue;
+            load_request& request{ it->second };
+            if (request.status == waiting_status && !request.in_worker && request.info.priority == p) return id;
+        }
+    }
+
+    return id::invalid_id;
+}
+
+bool
+has_work(const utl::deque<id::id_type>* const queues)
+{
+    for (u32 p{ 0 }; p < priority::count; ++p)
+    {
+        if (!queues[p].empty()) return true;
+    }
+    return false;
+}
+
+void
+release_memory(load_request& request)
+{
+    assert(streaming_stats.bytes_in_flight >= request.memory);
+    streaming_stats.bytes_in_flight -= request.memory;
+    request.memory = 0;
+    request.file.close();
+    request.decoded.reset();
+    request.data = nullptr;
+    budget_cv.notify_all();
+}
+
+void
+fail_request(load_request& request)
+{
+    release_memory(request);
+    request.status = status::failed;
+    request.in_worker = false;
+}
+
+// Where the data of a request comes from: a file of its own or an entry of a pack.
+struct request_source
+{
+    mapped_file		file;
+    const pack_file*	pack{ nullptr };
+    u32				entry{ u32_invalid_id };
+
+    [[nodiscard]] bool is_valid() const { return pack ? entry != u32_invalid_id : file.is_open(); }
+    // Bytes that are in memory once the data is read, i.e. the uncompressed size of pack entries.
+    [[nodiscard]] u64 size() const { return pack ? (is_valid() ? pack->entry(entry).size : 0) : file.size(); }
+};
+
+request_source
+open_source(const std::filesystem::path& path, const pack_file* const pack)
+{
+    request_source source{};
+    if (pack)
+    {
+        source.pack = pack;
+        source.entry = pack->find(path.generic_string());
+    }
+    else
+    {
+        // Mapping only reserves address space. The pages are read in by read_source().
+        source.file.open(path);
+    }
+    return source;
+}
+
+// Reads the pages in and decompresses pack entries. Returns a pointer to the data or nullptr if it's corrupt.
+const u8*
+read_source(request_source& source, std::unique_ptr<u8[]>& scratch)
+{
+    if (!source.pack)
+    {
+        source.file.prefetch(0, source.file.size());
+        return source.file.data();
+    }
+
+    const pack::toc_entry& e{ source.pack->entry(source.entry) };
+    source.pack->file().prefetch(e.offset, e.stored_size);
+    return source.pack->data(source.entry, scratch);
+}
+
+void
+io_worker()
+{
+    while (true)
+    {
+        std::unique_lock lock{ request_mutex };
+        io_cv.wait(lock, [] { return is_shutting_down || has_work(io_queues); });
+        if (is_shutting_down) break;
+
+        const id::id_type id{ pop_request(io_queues, status::queued) };
+        if (!id::is_valid(id)) continue;
+
+        load_request& request{ requests[id] };
+        request.status = status::reading;
+        request.in_worker = true;
+        const std::filesystem::path path{ request.info.path };
+        const pack_file* const pack{ request.info.pack };
+        lock.unlock();
+
+        request_source source{ open_source(path, pack) };
+        const u64 size{ source.size() };
+
+        lock.lock();
+        if (request.status == status::cancelled)
+        {
+            request.in_worker = false;
+            continue;
+        }
+
+        if (!source.is_valid())
+        {
+            fail_request(request);
+            ready_requests.emplace_back(id);
+            continue;
+        }
+
+        // Wait until the file fits in the memory budget. A file larger than the whole budget is still
+        // loaded once nothing else is in flight.
+        budget_cv.wait(lock, [&request, size] {
+            return is_shutting_down || request.status == status::cancelled || !streaming_stats.bytes_in_flight ||
+                streaming_stats.bytes_in_flight + size <= settings.memory_budget;
+        });
+
+        if (is_shutting_down || request.status == status::cancelled)
+        {
+            request.in_worker = false;
+            continue;
+        }
+
+        request.memory = size;
+        streaming_stats.bytes_in_flight += size;
+        streaming_stats.peak_bytes_in_flight = std::max(streaming_stats.peak_bytes_in_flight, streaming_stats.bytes_in_flight);
+        lock.unlock();
+
+        std::unique_ptr<u8[]> scratch{};
+        const u8* const data{ read_source(source, scratch) };
+
+        lock.lock();
+        request.in_worker = false;
+        if (request.status == status::cancelled)
+        {
+            release_memory(request);
+            continue;
+        }
+
+        if (!data)
+        {
+            fail_request(request);
+            ready_requests.emplace_back(id);
+            continue;
+        }
+
+        if (source.pack && request.info.type == asset_type::unknown)
+        {
+            request.info.type = (asset_type::type)source.pack->entry(source.entry).type;
+        }
+
+        request.file = std::move(source.file);
+        request.decoded = std::move(scratch);
+        request.data = data;
+        request.size = size;
+        if (request.info.decode)
+        {
+            request.status = status::decoding;
+            decode_queues[request.info.priority].emplace_back(id);
+            decode_cv.notify_one();
+        }
+        else
+        {
+            request.status = status::ready;
+            ready_requests.emplace_back(id);
+        }
+    }
+}
+
+void
+decode_worker()
+{
+    while (true)
+    {
+        std::unique_lock lock{ request_mutex };
+        decode_cv.wait(lock, [] { return is_shutting_down || has_work(decode_queues); });
+        if (is_shutting_down) break;
+
+        const id::id_type id{ pop_request(decode_queues, status::decoding) };
+        if (!id::is_valid(id)) continue;
+
+        load_request& request{ requests[id] };
+        request.in_worker = true;
+        const decode_function decode{ request.info.decode };
+        lock.unlock();
+
+        std::unique_ptr<u8[]> decoded{};
+        u64 decoded_size{ 0 };
+        const bool result{ decode(request.data, request.size, decoded, decoded_size) };
+
+        lock.lock();
+        request.in_worker = false;
+        if (request.status == status::cancelled)
+        {
+            release_memory(request);
+            continue;
+        }
+
+        if (!result || !decoded)
+        {
+            fail_request(request);
+            ready_requests.emplace_back(id);
+            continue;
+        }
+
+        // NOTE: decoded data may push the total over budget for a moment. The readers wait until it's back under.
+        streaming_stats.bytes_in_flight += decoded_size;
+        streaming_stats.bytes_in_flight -= request.memory;
+        streaming_stats.peak_bytes_in_flight = std::max(streaming_stats.peak_bytes_in_flight, streaming_stats.bytes_in_flight);
+        request.memory = decoded_size;
+        request.file.close();
+        request.decoded = std::move(decoded);
+        request.data = request.decoded.get();
+        request.size = decoded_size;
+        request.status = status::ready;
+        ready_requests.emplace_back(id);
+    }
+}
+
+void
+complete(id::id_type id, id::id_type asset_id, status::type result)
+{
+    completion_callback callback{};
+    {
+        std::lock_guard lock{ request_mutex };
+        auto it{ requests.find(id) };
+        assert(it != requests.end());
+        load_request& request{ it->second };
+        release_memory(request);
+        callback = std::move(request.info.on_completed);
+        requests.erase(it);
+
+        switch (result)
+        {
+        case status::completed: ++streaming_stats.completed_count; break;
+        case status::cancelled: ++streaming_stats.cancelled_count; break;
+        default: ++streaming_stats.failed_count; break;
+        }
+    }
+
+    if (callback) callback(id, asset_id, result);
+}
+
+} // anonymous namespace
+
+bool
+initialize(const init_info& info)
+{
+    assert(workers.empty() && info.io_thread_count && info.decode_thread_count);
+    settings = info;
+    streaming_stats = {};
+    is_shutting_down = false;
+
+    for (u32 i{ 0 }; i < info.io_thread_count; ++i) workers.emplace_back(io_worker);
+    for (u32 i{ 0 }; i < info.decode_thread_count; ++i) workers.emplace_back(decode_worker);
+    return true;
+}
+
+void
+shutdown()
+{
+    {
+        std::lock_guard lock{ request_mutex };
+        is_shutting_down = true;
+    }
+
+    io_cv.notify_all();
+    decode_cv.notify_all();
+    budget_cv.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    // Report everything that didn't finish as cancelled, so futures don't wait forever.
+    utl::vector<id::id_type> ids;
+    for (const auto& [id, request] : requests) ids.emplace_back(id);
+    for (id::id_type id : ids) complete(id, id::invalid_id, status::cancelled);
+
+    for (u32 p{ 0 }; p < priority::count; ++p)
+    {
+        io_queues[p].clear();
+        decode_queues[p].clear();
+    }
+    ready_requests.clear();
+    cancelled_requests.clear();
+}
+
+id::id_type
+request(request_info info)
+{
+    assert(!workers.empty() && !info.path.empty() && info.priority < priority::count);
+    std::lock_guard lock{ request_mutex };
+
+    id::id_type id{ next_request_id };
+    ++next_request_id;
+    if (!id::is_valid(next_request_id)) next_request_id = 0;
+
+    const priority::type p{ info.priority };
+    load_request& request{ requests[id] };
+    request.info = std::move(info);
+    io_queues[p].emplace_back(id);
+    io_cv.notify_one();
+    return id;
+}
+
+std::future<id::id_type>
+request_future(request_info info)
+{
+    auto promise{ std::make_shared<std::promise<id::id_type>>() };
+    std::future<id::id_type> future{ promise->get_future() };
+
+    completion_callback callback{ std::move(info.on_completed) };
+    info.on_completed = [promise, callback](id::id_type request_id, id::id_type asset_id, status::type result)
+    {
+        if (callback) callback(request_id, asset_id, result);
+        promise->set_value(asset_id);
+    };
+
+    [[maybe_unused]] const id::id_type id{ request(std::move(info)) };
+    return future;
+}
+
+bool
+cancel(id::id_type request_id)
+{
+    std::lock_guard lock{ request_mutex };
+    auto it{ requests.find(request_id) };
+    if (it == requests.end()) return false;
+
+    load_request& request{ it->second };
+    if (request.status > status::ready) return false;
+
+    request.status = status::cancelled;
+    cancelled_requests.emplace_back(request_id);
+    budget_cv.notify_all();
+    return true;
+}
+
+void
+set_priority(id::id_type request_id, priority::type priority)
+{
+    assert(priority < priority::count);
+    std::lock_guard lock{ request_mutex };
+    auto it{ requests.find(request_id) };
+    if (it == requests.end()) return;
+
+    load_request& request{ it->second };
+    if (request.info.priority == priority) return;
+    request.info.priority = priority;
+
+    // The id stays in its old queue too, but it's skipped there because the priority doesn't match anymore.
+    if (request.status == status::queued) io_queues[priority].emplace_back(request_id);
+    else if (request.status == status::decoding) decode_queues[priority].emplace_back(request_id);
+}
+
+status::type
+get_status(id::id_type request_id)
+{
+    std::lock_guard lock{ request_mutex };
+    auto it{ requests.find(request_id) };
+    // NOTE: requests are forgotten once their completion was reported.
+    return it != requests.end() ? it->second.status : status::completed;
+}
+
+void
+update()
+{
+    struct ready_asset
+    {
+        id::id_type				id;
+        asset_type::type		type;
+        mapped_file				file;
+        std::unique_ptr<u8[]>	decoded;
+        const u8*				data;
+        bool					has_failed;
+    };
+
+    utl::vector<ready_asset> assets;
+    utl::vector<id::id_type> cancelled;
+    {
+        std::lock_guard lock{ request_mutex };
+
+        // Cancelled requests that a worker is still holding on to are reported in a later update.
+        for (u32 i{ 0 }; i < cancelled_requests.size();)
+        {
+            const id::id_type id{ cancelled_requests[i] };
+            if (requests[id].in_worker)
+            {
+                ++i;
+                continue;
+            }
+
+            cancelled.emplace_back(id);
+            utl::erase_unordered(cancelled_requests, i);
+        }
+
+        for (u32 i{ 0 }; i < ready_requests.size();)
+        {
+            if (requests[ready_requests[i]].status == status::cancelled) ready_requests.erase(ready_requests.begin() + i);
+            else ++i;
+        }
+
+        std::stable_sort(ready_requests.begin(), ready_requests.end(),
+            [](id::id_type a, id::id_type b) { return requests[a].info.priority < requests[b].info.priority; });
+
+        u64 uploaded{ 0 };
+        u32 taken{ 0 };
+        for (id::id_type id : ready_requests)
+        {
+            const load_request& request{ requests[id] };
+            // Always upload at least one asset, so large ones don't get stuck.
+            if (uploaded && uploaded + request.size > settings.upload_budget) break;
+
+            uploaded += request.size;
+            load_request& ready{ requests[id] };
+            assets.emplace_back(ready_asset{ id, request.info.type, std::move(ready.file), std::move(ready.decoded), ready.data, request.status == status::failed });
+            ++taken;
+        }
+
+        ready_requests.erase(ready_requests.begin(), ready_requests.begin() + taken);
+        streaming_stats.bytes_uploaded_last_update = uploaded;
+    }
+
+    for (id::id_type id : cancelled) complete(id, id::invalid_id, status::cancelled);
+
+    for (ready_asset& asset : assets)
+    {
+        if (asset.has_failed)
+        {
+            complete(asset.id, id::invalid_id, status::failed);
+            continue;
+        }
+
+        // Assets that don't need decoding are created straight from the mapped file or pack.
+        const id::id_type asset_id{ create_resource(asset.data, asset.type) };
+        asset.file.close();
+        asset.decoded.reset();
+        complete(asset.id, asset_id, id::is_valid(asset_id) ? status::completed : status::failed);
+    }
+}
+
+void
+flush()
+{
+    while (true)
+    {
+        update();
+        {
+            std::lock_guard lock{ request_mutex };
+            if (requests.empty()) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+stats
+get_stats()
+{
+    std::lock_guard lock{ request_mutex };
+    stats s{ streaming_stats };
+    s.pending_count = (u32)requests.size();
+    return s;
+}
+}
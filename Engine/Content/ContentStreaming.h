@@ -0,0 +1,97 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "ContentToEngine.h"
+#include "PackFile.h"
+#include <filesystem>
+#include <functional>
+#include <future>
+
+// Loads assets in the background while the game keeps rendering. Requests go through three stages:
+// file reads and decoding run on worker threads, and the decoded data is handed to the renderer from
+// update(), which the main loop calls once per frame, so GPU uploads are batched per frame.
+namespace primal::content::streaming {
+
+struct priority
+{
+    enum type : u32
+    {
+        immediate,		// needed for the next frame
+        high,
+        normal,
+        background,
+
+        count
+    };
+};
+
+struct status
+{
+    enum type : u32
+    {
+        queued,
+        reading,
+        decoding,
+        ready,			// decoded and waiting to be uploaded by update()
+        completed,
+        cancelled,
+        failed,
+    };
+};
+
+// Turns the file contents into the engine format that create_resource() expects (e.g. decompression).
+// Returns false if the data couldn't be decoded.
+using decode_function = bool(*)(const u8* const data, u64 size, std::unique_ptr<u8[]>& decoded, u64& decoded_size);
+// Called from update() on the thread that calls it. asset_id is invalid unless the request completed.
+using completion_callback = std::function<void(id::id_type request_id, id::id_type asset_id, status::type status)>;
+
+struct request_info
+{
+    std::filesystem::path	path;					// file path, or the entry name if pack is set
+    const pack_file*		pack{ nullptr };		// must stay open until the request reports its result
+    asset_type::type		type{ asset_type::unknown };	// unknown takes the type from the pack entry
+    streaming::priority::type	priority{ streaming::priority::normal };
+    decode_function			decode{ nullptr };
+    completion_callback		on_completed{};
+};
+
+struct init_info
+{
+    u32		io_thread_count{ 2 };
+    u32		decode_thread_count{ 2 };
+    u64		memory_budget{ 256 * 1024 * 1024 };		// file and decoded data that may be in memory at the same time
+    u64		upload_budget{ 64 * 1024 * 1024 };		// bytes handed to the renderer per update()
+};
+
+struct stats
+{
+    u64		bytes_in_flight;
+    u64		peak_bytes_in_flight;
+    u64		bytes_uploaded_last_update;
+    u32		pending_count;
+    u32		completed_count;
+    u32		cancelled_count;
+    u32		failed_count;
+};
+
+bool initialize(const init_info& info);
+// Cancels all pending requests and reports them as cancelled to their callbacks.
+void shutdown();
+
+[[nodiscard]] id::id_type request(request_info info);
+// Same as request(), but the result is reported through a future instead of (or as well as) a callback.
+// The future holds an invalid id if the request was cancelled or failed.
+[[nodiscard]] std::future<id::id_type> request_future(request_info info);
+// Returns true if the request was cancelled before its asset was created.
+bool cancel(id::id_type request_id);
+void set_priority(id::id_type request_id, priority::type priority);
+// Requests that already reported their result are no longer tracked and show up as completed.
+[[nodiscard]] status::type get_status(id::id_type request_id);
+
+// Creates the ready assets within the upload budget and calls their completion callbacks.
+void update();
+// Blocks until all requests made so far have finished, calling update() in the meantime.
+void flush();
+[[nodiscard]] stats get_stats();
+}
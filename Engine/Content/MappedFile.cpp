@@ -0,0 +1,131 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "MappedFile.h"
+
+#ifdef _WIN64
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#elif __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace primal::content {
+namespace {
+
+u64
+page_size()
+{
+#ifdef _WIN64
+    SYSTEM_INFO info{};
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#elif __linux__
+    return (u64)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+const u64 os_page_size{ page_size() };
+
+} // anonymous namespace
+
+bool
+mapped_file::open(const std::filesystem::path& path, file_access::type access)
+{
+    close();
+    std::error_code error{};
+    const u64 size{ std::filesystem::file_size(path, error) };
+    // NOTE: empty files can't be mapped, and there's nothing to load from them anyway.
+    if (error || !size) return false;
+
+#ifdef _WIN64
+    const DWORD flags{ access == file_access::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS };
+    HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr) };
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    HANDLE mapping{ CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    // The view keeps the mapping alive, so neither handle is needed after this.
+    void* const data{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+    CloseHandle(mapping);
+    if (!data) return false;
+
+    if (access == file_access::sequential)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range{ data, (SIZE_T)size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#elif __linux__
+    const s32 fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd == -1) return false;
+
+    void* const data{ mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) };
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    if (access == file_access::sequential)
+    {
+        madvise(data, size, MADV_SEQUENTIAL);
+        madvise(data, size, MADV_WILLNEED);
+    }
+    else
+    {
+        madvise(data, size, MADV_RANDOM);
+    }
+#endif
+
+    _data = (const u8*)data;
+    _size = size;
+    return true;
+}
+
+void
+mapped_file::close()
+{
+    if (!_data) return;
+
+#ifdef _WIN64
+    UnmapViewOfFile(_data);
+#elif __linux__
+    munmap((void*)_data, _size);
+#endif
+
+    reset();
+}
+
+void
+mapped_file::prefetch(u64 offset, u64 size) const
+{
+    assert(_data && offset + size <= _size);
+    if (!size) return;
+
+    // Reading one byte per page is enough to fault the whole page in.
+    volatile u8 sink{ 0 };
+    const u8* const end{ _data + offset + size };
+    for (const u8* p{ _data + offset }; p < end; p += os_page_size) sink = sink + *p;
+    sink = sink + *(end - 1);
+}
+
+void
+mapped_file::release(u64 offset, u64 size) const
+{
+    assert(_data && offset + size <= _size);
+    // Only whole pages inside the range can be released.
+    const u64 first{ math::align_size_up(offset, os_page_size) };
+    const u64 last{ math::align_size_down(offset + size, os_page_size) };
+    if (last <= first) return;
+
+    void* const address{ (void*)(_data + first) };
+#ifdef _WIN64
+    // NOTE: unlocking pages that aren't locked removes them from the working set.
+    VirtualUnlock(address, last - first);
+#elif __linux__
+    madvise(address, last - first, MADV_DONTNEED);
+#endif
+}
+}
@@ -0,0 +1,79 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "Utilities/IOStream.h"
+#include <filesystem>
+
+namespace primal::content {
+
+struct file_access
+{
+    enum type : u32
+    {
+        sequential,		// read front to back once, e.g. assets parsed by create_resource()
+        random,			// e.g. a pack file whose entries are read in any order
+    };
+};
+
+// Read-only view of a whole file mapped into memory. Assets can be parsed straight from the
+// page cache instead of being copied into a heap buffer first.
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    DISABLE_COPY(mapped_file);
+    explicit mapped_file(const std::filesystem::path& path, file_access::type access = file_access::sequential) { open(path, access); }
+    constexpr mapped_file(mapped_file&& o) noexcept
+        : _data{ o._data }, _size{ o._size }
+    {
+        o.reset();
+    }
+
+    constexpr mapped_file& operator=(mapped_file&& o) noexcept
+    {
+        assert(this != &o);
+        if (this != &o)
+        {
+            close();
+            move(o);
+        }
+        return *this;
+    }
+
+    ~mapped_file() { close(); }
+
+    // Maps the file and tells the OS how it'll be read, so it can start reading ahead right away.
+    bool open(const std::filesystem::path& path, file_access::type access = file_access::sequential);
+    void close();
+
+    // Touches every page in the range so that later reads don't stall on page faults.
+    // Meant for loader threads, so that the thread that parses the data doesn't do the I/O.
+    void prefetch(u64 offset, u64 size) const;
+    // Lets the OS drop pages that were already consumed from the working set. They stay in the page cache.
+    void release(u64 offset, u64 size) const;
+
+    [[nodiscard]] constexpr const u8* const data() const { return _data; }
+    [[nodiscard]] constexpr u64 size() const { return _size; }
+    [[nodiscard]] constexpr bool is_open() const { return _data != nullptr; }
+    // NOTE: offset == size() is valid and gives a reader at the end of the data, e.g. for an empty file.
+    [[nodiscard]] utl::blob_stream_reader reader(u64 offset = 0) const { assert(offset <= _size); return utl::blob_stream_reader{ _data + offset }; }
+
+private:
+    constexpr void move(mapped_file& o)
+    {
+        _data = o._data;
+        _size = o._size;
+        o.reset();
+    }
+
+    constexpr void reset()
+    {
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const u8*		_data{ nullptr };
+    u64				_size{ 0 };
+};
+}
@@ -0,0 +1,112 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "PackFile.h"
+#include <algorithm>
+
+namespace primal::content {
+
+bool
+pack_file::open(const std::filesystem::path& path)
+{
+    close();
+    // Entries are read in whatever order the game asks for them.
+    if (!_file.open(path, file_access::random)) return false;
+
+    const u64 size{ _file.size() };
+    const pack::header* const header{ (const pack::header*)_file.data() };
+    if (size < sizeof(pack::header) || header->magic != pack::magic || header->version != pack::version)
+    {
+        close();
+        return false;
+    }
+
+    const u64 toc_size{ (u64)header->entry_count * sizeof(pack::toc_entry) };
+    if (header->toc_offset % pack::toc_alignment || header->toc_offset + toc_size > size ||
+        header->names_offset + header->names_size > size)
+    {
+        close();
+        return false;
+    }
+
+    _header = header;
+    _toc = (const pack::toc_entry*)(_file.data() + header->toc_offset);
+    _names = (const char*)(_file.data() + header->names_offset);
+
+    for (u32 i{ 0 }; i < header->entry_count; ++i)
+    {
+        const pack::toc_entry& e{ _toc[i] };
+        if (e.offset + e.stored_size > size || (u64)e.name_offset + e.name_length > header->names_size ||
+            e.compression >= pack::compression::count)
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+pack_file::close()
+{
+    _file.close();
+    _header = nullptr;
+    _toc = nullptr;
+    _names = nullptr;
+}
+
+u32
+pack_file::find(std::string_view name) const
+{
+    if (!_header) return u32_invalid_id;
+
+    const u64 hash{ pack::name_hash(name) };
+    const pack::toc_entry* const end{ _toc + _header->entry_count };
+    const pack::toc_entry* const it{ std::lower_bound(_toc, end, hash,
+        [](const pack::toc_entry& e, u64 h) { return e.name_hash < h; }) };
+
+    return (it != end && it->name_hash == hash) ? (u32)(it - _toc) : u32_invalid_id;
+}
+
+const u8* const
+pack_file::data(u32 index, std::unique_ptr<u8[]>& scratch) const
+{
+    const pack::toc_entry& e{ entry(index) };
+    const u8* const stored{ _file.data() + e.offset };
+
+    switch (e.compression)
+    {
+    case pack::compression::none:
+        return stored;
+    case pack::compression::lz4:
+        scratch = std::make_unique<u8[]>(e.size);
+        if (!pack::lz4_decompress(stored, e.stored_size, scratch.get(), e.size))
+        {
+            scratch.reset();
+            return nullptr;
+        }
+        return scratch.get();
+    default:
+        return nullptr;
+    }
+}
+
+bool
+pack_file::verify(u32 index) const
+{
+    std::unique_ptr<u8[]> scratch{};
+    const u8* const entry_data{ data(index, scratch) };
+    return entry_data && pack::hash(entry_data, entry(index).size) == entry(index).content_hash;
+}
+
+id::id_type
+pack_file::create_resource(u32 index) const
+{
+    std::unique_ptr<u8[]> scratch{};
+    const u8* const entry_data{ data(index, scratch) };
+    assert(entry_data);
+    if (!entry_data) return id::invalid_id;
+
+    return content::create_resource(entry_data, (asset_type::type)entry(index).type);
+}
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "ContentToEngine.h"
+#include "MappedFile.h"
+#include "PackFormat.h"
+
+namespace primal::content {
+
+// Runtime view of an asset pack. The whole pack is mapped once when it's opened and entries are
+// read straight from the mapping, so loading an asset doesn't open or stat any file.
+// A pack is read-only after open(), so it can be used from several threads at once.
+class pack_file
+{
+public:
+    pack_file() = default;
+    DISABLE_COPY(pack_file);
+    explicit pack_file(const std::filesystem::path& path) { open(path); }
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    // Returns the index of the entry or u32_invalid_id if the pack doesn't have it.
+    [[nodiscard]] u32 find(std::string_view name) const;
+    // Returns the uncompressed data of the entry. Compressed entries are decompressed into scratch,
+    // uncompressed ones point into the mapped pack and don't touch scratch.
+    [[nodiscard]] const u8* const data(u32 index, std::unique_ptr<u8[]>& scratch) const;
+    // Checks the entry's content hash. Meant for tools and debug builds, since it reads the whole entry.
+    [[nodiscard]] bool verify(u32 index) const;
+    [[nodiscard]] id::id_type create_resource(u32 index) const;
+
+    [[nodiscard]] constexpr u32 entry_count() const { return _header ? _header->entry_count : 0; }
+    [[nodiscard]] constexpr const pack::toc_entry& entry(u32 index) const { assert(index < entry_count()); return _toc[index]; }
+    [[nodiscard]] constexpr std::string_view name(u32 index) const
+    {
+        const pack::toc_entry& e{ entry(index) };
+        return { _names + e.name_offset, e.name_length };
+    }
+    [[nodiscard]] constexpr bool is_open() const { return _header != nullptr; }
+    [[nodiscard]] constexpr const mapped_file& file() const { return _file; }
+
+private:
+    mapped_file					_file;
+    const pack::header*			_header{ nullptr };
+    const pack::toc_entry*		_toc{ nullptr };
+    const char*					_names{ nullptr };
+};
+}
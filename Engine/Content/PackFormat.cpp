@@ -0,0 +1,288 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "PackFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace primal::content::pack {
+namespace {
+
+constexpr u64 fnv_offset_basis{ 0xcbf29ce484222325ull };
+constexpr u64 fnv_prime{ 0x100000001b3ull };
+
+// LZ4 block format constants. The last match has to start at least 12 bytes before the end
+// and the last 5 bytes are always literals.
+constexpr u32 lz4_min_match{ 4 };
+constexpr u32 lz4_last_literals{ 5 };
+constexpr u32 lz4_match_limit{ 12 };
+constexpr u32 lz4_max_offset{ 65535 };
+constexpr u32 lz4_hash_bits{ 16 };
+
+u32
+read_u32(const u8* const p)
+{
+    u32 value;
+    memcpy(&value, p, sizeof(u32));
+    return value;
+}
+
+constexpr u32
+lz4_hash(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - lz4_hash_bits);
+}
+
+// Writes the 255-continuation bytes of a literal or match length. Returns nullptr if there's no room.
+u8*
+write_length(u8* dst, const u8* const dst_end, u64 length)
+{
+    while (length >= 255)
+    {
+        if (dst >= dst_end) return nullptr;
+        *dst++ = 255;
+        length -= 255;
+    }
+
+    if (dst >= dst_end) return nullptr;
+    *dst++ = (u8)length;
+    return dst;
+}
+
+u8*
+write_sequence(u8* dst, const u8* const dst_end, const u8* const literals, u64 literal_count, u32 offset, u64 match_length)
+{
+    if (dst >= dst_end) return nullptr;
+    u8* const token{ dst++ };
+    *token = (u8)(std::min<u64>(literal_count, 15) << 4);
+    if (literal_count >= 15 && !(dst = write_length(dst, dst_end, literal_count - 15))) return nullptr;
+
+    if ((u64)(dst_end - dst) < literal_count) return nullptr;
+    memcpy(dst, literals, literal_count);
+    dst += literal_count;
+
+    // NOTE: the last sequence of a block only has literals.
+    if (!match_length) return dst;
+
+    if (dst_end - dst < 2) return nullptr;
+    *dst++ = (u8)(offset & 0xff);
+    *dst++ = (u8)(offset >> 8);
+
+    const u64 length{ match_length - lz4_min_match };
+    *token |= (u8)std::min<u64>(length, 15);
+    if (length >= 15 && !(dst = write_length(dst, dst_end, length - 15))) return nullptr;
+    return dst;
+}
+
+void
+align_stream(std::ofstream& file, u64& position, u32 alignment)
+{
+    constexpr u8 zeros[toc_alignment]{};
+    const u64 aligned{ math::align_size_up(position, alignment) };
+    assert(aligned - position <= sizeof(zeros));
+    file.write((const char*)zeros, aligned - position);
+    position = aligned;
+}
+
+} // anonymous namespace
+
+u64
+hash(const void* const data, u64 size)
+{
+    const u8* const bytes{ (const u8*)data };
+    u64 result{ fnv_offset_basis };
+    for (u64 i{ 0 }; i < size; ++i)
+    {
+        result = (result ^ bytes[i]) * fnv_prime;
+    }
+    return result;
+}
+
+u64
+name_hash(std::string_view name)
+{
+    u64 result{ fnv_offset_basis };
+    for (char c : name)
+    {
+        if (c == '\\') c = '/';
+        else if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        result = (result ^ (u8)c) * fnv_prime;
+    }
+    return result;
+}
+
+u64
+lz4_compress(const u8* const src, u64 src_size, u8* const dst, u64 dst_capacity)
+{
+    const u8* const src_end{ src + src_size };
+    const u8* const dst_end{ dst + dst_capacity };
+    const u8* anchor{ src };
+    u8* out{ dst };
+
+    if (src_size > lz4_match_limit)
+    {
+        // Positions + 1 of the last occurrence of each hashed 4-byte sequence, 0 means none.
+        utl::vector<u32> table(1u << lz4_hash_bits, 0);
+        const u8* const match_limit{ src_end - lz4_match_limit };
+        const u8* const match_end_limit{ src_end - lz4_last_literals };
+        const u8* ip{ src };
+
+        while (ip < match_limit)
+        {
+            const u32 sequence{ read_u32(ip) };
+            u32& entry{ table[lz4_hash(sequence)] };
+            const u8* const match{ entry ? src + entry - 1 : nullptr };
+            entry = (u32)(ip - src) + 1;
+
+            if (!match || (u64)(ip - match) > lz4_max_offset || read_u32(match) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            u64 length{ lz4_min_match };
+            while (ip + length < match_end_limit && match[length] == ip[length]) ++length;
+
+            out = write_sequence(out, dst_end, anchor, ip - anchor, (u32)(ip - match), length);
+            if (!out) return 0;
+
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    out = write_sequence(out, dst_end, anchor, src_end - anchor, 0, 0);
+    return out ? out - dst : 0;
+}
+
+bool
+lz4_decompress(const u8* const src, u64 src_size, u8* const dst, u64 dst_size)
+{
+    const u8* ip{ src };
+    const u8* const ip_end{ src + src_size };
+    u8* op{ dst };
+    u8* const op_end{ dst + dst_size };
+
+    auto read_length = [&ip, ip_end](u64& length)
+    {
+        u8 byte{ 255 };
+        while (byte == 255)
+        {
+            if (ip >= ip_end) return false;
+            byte = *ip++;
+            length += byte;
+        }
+        return true;
+    };
+
+    while (ip < ip_end)
+    {
+        const u8 token{ *ip++ };
+        u64 literal_count{ (u64)(token >> 4) };
+        if (literal_count == 15 && !read_length(literal_count)) return false;
+        if ((u64)(ip_end - ip) < literal_count || (u64)(op_end - op) < literal_count) return false;
+
+        memcpy(op, ip, literal_count);
+        ip += literal_count;
+        op += literal_count;
+        if (ip == ip_end) break;
+
+        if (ip_end - ip < 2) return false;
+        const u64 offset{ (u64)ip[0] | ((u64)ip[1] << 8) };
+        ip += 2;
+        if (!offset || offset > (u64)(op - dst)) return false;
+
+        u64 length{ (u64)(token & 0xf) };
+        if (length == 15 && !read_length(length)) return false;
+        length += lz4_min_match;
+        if ((u64)(op_end - op) < length) return false;
+
+        // NOTE: matches may overlap the bytes they produce, so copy one byte at a time.
+        const u8* match{ op - offset };
+        for (u64 i{ 0 }; i < length; ++i) *op++ = *match++;
+    }
+
+    return op == op_end;
+}
+
+bool
+write(const std::filesystem::path& path, const source* const sources, u32 count)
+{
+    utl::vector<toc_entry> toc(count);
+    std::string names;
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const source& s{ sources[i] };
+        toc_entry& entry{ toc[i] };
+        entry = {};
+        entry.name_hash = name_hash(s.name);
+        entry.content_hash = hash(s.data, s.size);
+        entry.size = s.size;
+        entry.type = s.type;
+        entry.name_offset = (u32)names.size();
+        entry.name_length = (u32)s.name.size();
+        names += s.name;
+    }
+
+    {
+        utl::vector<u64> hashes(count);
+        for (u32 i{ 0 }; i < count; ++i) hashes[i] = toc[i].name_hash;
+        std::sort(hashes.begin(), hashes.end());
+        if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end()) return false;
+    }
+
+    std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+    if (!file) return false;
+
+    header pack_header{};
+    file.write((const char*)&pack_header, sizeof(header));
+    u64 position{ sizeof(header) };
+
+    utl::vector<u8> compressed;
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const source& s{ sources[i] };
+        toc_entry& entry{ toc[i] };
+        const u8* data{ s.data };
+        u64 stored_size{ s.size };
+
+        if (s.compression == compression::lz4 && s.size)
+        {
+            compressed.resize(lz4_compress_bound(s.size));
+            const u64 compressed_size{ lz4_compress(s.data, s.size, compressed.data(), compressed.size()) };
+            // Keep the entry uncompressed if it doesn't save at least an eighth, it's not worth decompressing.
+            if (compressed_size && compressed_size < s.size - s.size / 8)
+            {
+                data = compressed.data();
+                stored_size = compressed_size;
+                entry.compression = compression::lz4;
+            }
+        }
+
+        align_stream(file, position, data_alignment);
+        entry.offset = position;
+        entry.stored_size = stored_size;
+        file.write((const char*)data, stored_size);
+        position += stored_size;
+    }
+
+    pack_header.names_offset = position;
+    pack_header.names_size = names.size();
+    file.write(names.data(), names.size());
+    position += names.size();
+
+    std::sort(toc.begin(), toc.end(), [](const toc_entry& a, const toc_entry& b) { return a.name_hash < b.name_hash; });
+
+    align_stream(file, position, toc_alignment);
+    pack_header.toc_offset = position;
+    file.write((const char*)toc.data(), count * sizeof(toc_entry));
+
+    pack_header.magic = magic;
+    pack_header.version = version;
+    pack_header.entry_count = count;
+    pack_header.data_alignment = data_alignment;
+    file.seekp(0);
+    file.write((const char*)&pack_header, sizeof(header));
+    return (bool)file;
+}
+}
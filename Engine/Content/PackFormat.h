@@ -0,0 +1,85 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// On-disk layout of asset packs. This header has no dependencies on the rest of the engine,
+// so that tools can write packs without linking the renderer.
+//
+//   header | entry data (each entry aligned to data_alignment) | names | toc (aligned to toc_alignment)
+//
+// The table of contents is sorted by name hash, so entries can be found with a binary search
+// straight in the mapped file.
+namespace primal::content::pack {
+
+constexpr u32 magic{ 'P' | ('P' << 8) | ('A' << 16) | ('K' << 24) };
+constexpr u32 version{ 1 };
+constexpr u32 toc_alignment{ 64 };
+constexpr u32 data_alignment{ 64 };
+
+struct compression
+{
+    enum type : u32
+    {
+        none,
+        lz4,			// LZ4 block format
+
+        count
+    };
+};
+
+struct header
+{
+    u32		magic;
+    u32		version;
+    u32		entry_count;
+    u32		data_alignment;
+    u64		toc_offset;
+    u64		names_offset;
+    u64		names_size;
+    u64		reserved[3];
+};
+
+struct toc_entry
+{
+    u64		name_hash;
+    u64		content_hash;		// hash of the uncompressed data
+    u64		offset;				// from the start of the pack
+    u64		stored_size;		// size in the pack, i.e. compressed size
+    u64		size;				// uncompressed size
+    u32		type;				// asset_type::type
+    u32		compression;		// compression::type
+    u32		name_offset;		// from names_offset
+    u32		name_length;
+    u64		reserved;
+};
+
+static_assert(sizeof(header) == 64);
+static_assert(sizeof(toc_entry) == 64 && toc_alignment % sizeof(toc_entry) == 0);
+
+// 64-bit FNV-1a. Names are hashed case-insensitively with '\' and '/' treated as the same character.
+[[nodiscard]] u64 hash(const void* const data, u64 size);
+[[nodiscard]] u64 name_hash(std::string_view name);
+
+[[nodiscard]] constexpr u64 lz4_compress_bound(u64 size) { return size + size / 255 + 16; }
+// Returns the compressed size or 0 if dst is too small.
+[[nodiscard]] u64 lz4_compress(const u8* const src, u64 src_size, u8* const dst, u64 dst_capacity);
+// Returns false if the data is corrupt or doesn't decompress to exactly dst_size bytes.
+[[nodiscard]] bool lz4_decompress(const u8* const src, u64 src_size, u8* const dst, u64 dst_size);
+
+struct source
+{
+    std::string			name;
+    u32					type{ 0 };			// asset_type::type
+    const u8*			data{ nullptr };
+    u64					size{ 0 };
+    pack::compression::type	compression{ pack::compression::none };
+};
+
+// Writes a pack with the given entries. Compressed entries are stored uncompressed if compression doesn't pay off.
+// Fails if two entries have the same name hash.
+bool write(const std::filesystem::path& path, const source* const sources, u32 count);
+}
@@ -0,0 +1,546 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "BlockCompression.h"
+#include <cstring>
+
+namespace primal::graphics::block_compression {
+namespace {
+
+// BC7 subset of each pixel for the 2-subset partitions, one bit per pixel.
+constexpr u16 partitions2[64]{
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+
+// BC7 subset of each pixel for the 3-subset partitions.
+constexpr u8 partitions3[64][16]{
+    { 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 }, { 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+    { 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 }, { 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+    { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+    { 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 }, { 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+    { 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 }, { 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+    { 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 }, { 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+    { 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 }, { 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+    { 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 }, { 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+    { 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 }, { 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+    { 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 }, { 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+    { 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+    { 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 }, { 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+    { 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 }, { 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+    { 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 }, { 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+    { 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 }, { 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+    { 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 }, { 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 },
+};
+
+// Pixels whose index is stored with one bit less: the second subset's anchor in 2-subset partitions...
+constexpr u8 anchors2[64]{
+    15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15, 15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+    15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,  6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+};
+
+// ...and the second and third subsets' anchors in 3-subset partitions. Pixel 0 is always the first subset's anchor.
+constexpr u8 anchors3_second[64]{
+     3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,  3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+     8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,  3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+};
+
+constexpr u8 anchors3_third[64]{
+    15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8, 15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+    15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8, 15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+};
+
+constexpr u8 weights2[4]{ 0, 21, 43, 64 };
+constexpr u8 weights3[8]{ 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr u8 weights4[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct bc7_mode
+{
+    u8 subset_count;
+    u8 partition_bits;
+    u8 rotation_bits;
+    u8 index_selection_bits;
+    u8 color_bits;
+    u8 alpha_bits;
+    u8 endpoint_pbits;		// one p-bit per endpoint
+    u8 shared_pbits;		// one p-bit per subset
+    u8 index_bits;
+    u8 index_bits2;
+};
+
+constexpr bc7_mode bc7_modes[8]{
+    { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+    { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+    { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+    { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+    { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+    { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+    { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+    { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+};
+
+// BC6H stores its endpoints as 12 fields whose bits are scattered over the block differently in every mode.
+namespace bc6h {
+
+// Endpoints w, x, y and z of channels r, g and b, in this order, followed by the partition index.
+enum field : u8 { rw, gw, bw, rx, gx, bx, ry, gy, by, rz, gz, bz, d, count };
+
+// A run of bits of one field, in the order they're stored: from bit first to bit last.
+// NOTE: modes 13 and 14 store the high bits of w in reverse, so their runs go down.
+struct bits
+{
+    u8 field;
+    u8 first;
+    u8 last;
+};
+
+struct mode
+{
+    u8		value;				// the first 2 bits of the block for the first two modes, 5 bits for the others
+    u8		subset_count;
+    bool	is_transformed;		// x, y and z are stored as deltas from w
+    u8		endpoint_bits;
+    u8		delta_bits[3];		// per channel, for transformed modes
+    u8		layout_count;
+    bits	layout[24];
+};
+
+constexpr mode modes[14]{
+    { 0x00, 2, true, 10, { 5, 5, 5 }, 20, { { gy, 4, 4 }, { by, 4, 4 }, { bz, 4, 4 }, { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 4 }, { gz, 4, 4 }, { gy, 0, 3 }, { gx, 0, 4 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 4 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 4 }, { bz, 2, 2 }, { rz, 0, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x01, 2, true, 7, { 6, 6, 6 }, 24, { { gy, 5, 5 }, { gz, 4, 4 }, { gz, 5, 5 }, { rw, 0, 6 }, { bz, 0, 0 }, { bz, 1, 1 }, { by, 4, 4 }, { gw, 0, 6 }, { by, 5, 5 }, { bz, 2, 2 }, { gy, 4, 4 }, { bw, 0, 6 }, { bz, 3, 3 }, { bz, 5, 5 }, { bz, 4, 4 }, { rx, 0, 5 }, { gy, 0, 3 }, { gx, 0, 5 }, { gz, 0, 3 }, { bx, 0, 5 }, { by, 0, 3 }, { ry, 0, 5 }, { rz, 0, 5 }, { d, 0, 4 } } },
+    { 0x02, 2, true, 11, { 5, 4, 4 }, 19, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 4 }, { rw, 10, 10 }, { gy, 0, 3 }, { gx, 0, 3 }, { gw, 10, 10 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 3 }, { bw, 10, 10 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 4 }, { bz, 2, 2 }, { rz, 0, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x06, 2, true, 11, { 4, 5, 4 }, 21, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 3 }, { rw, 10, 10 }, { gz, 4, 4 }, { gy, 0, 3 }, { gx, 0, 4 }, { gw, 10, 10 }, { gz, 0, 3 }, { bx, 0, 3 }, { bw, 10, 10 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 3 }, { bz, 0, 0 }, { bz, 2, 2 }, { rz, 0, 3 }, { gy, 4, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x0a, 2, true, 11, { 4, 4, 5 }, 21, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 3 }, { rw, 10, 10 }, { by, 4, 4 }, { gy, 0, 3 }, { gx, 0, 3 }, { gw, 10, 10 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 4 }, { bw, 10, 10 }, { by, 0, 3 }, { ry, 0, 3 }, { bz, 1, 1 }, { bz, 2, 2 }, { rz, 0, 3 }, { bz, 4, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x0e, 2, true, 9, { 5, 5, 5 }, 20, { { rw, 0, 8 }, { by, 4, 4 }, { gw, 0, 8 }, { gy, 4, 4 }, { bw, 0, 8 }, { bz, 4, 4 }, { rx, 0, 4 }, { gz, 4, 4 }, { gy, 0, 3 }, { gx, 0, 4 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 4 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 4 }, { bz, 2, 2 }, { rz, 0, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x12, 2, true, 8, { 6, 5, 5 }, 20, { { rw, 0, 7 }, { gz, 4, 4 }, { by, 4, 4 }, { gw, 0, 7 }, { bz, 2, 2 }, { gy, 4, 4 }, { bw, 0, 7 }, { bz, 3, 3 }, { bz, 4, 4 }, { rx, 0, 5 }, { gy, 0, 3 }, { gx, 0, 4 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 4 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 5 }, { rz, 0, 5 }, { d, 0, 4 } } },
+    { 0x16, 2, true, 8, { 5, 6, 5 }, 22, { { rw, 0, 7 }, { bz, 0, 0 }, { by, 4, 4 }, { gw, 0, 7 }, { gy, 5, 5 }, { gy, 4, 4 }, { bw, 0, 7 }, { gz, 5, 5 }, { bz, 4, 4 }, { rx, 0, 4 }, { gz, 4, 4 }, { gy, 0, 3 }, { gx, 0, 5 }, { gz, 0, 3 }, { bx, 0, 4 }, { bz, 1, 1 }, { by, 0, 3 }, { ry, 0, 4 }, { bz, 2, 2 }, { rz, 0, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x1a, 2, true, 8, { 5, 5, 6 }, 22, { { rw, 0, 7 }, { bz, 1, 1 }, { by, 4, 4 }, { gw, 0, 7 }, { by, 5, 5 }, { gy, 4, 4 }, { bw, 0, 7 }, { bz, 5, 5 }, { bz, 4, 4 }, { rx, 0, 4 }, { gz, 4, 4 }, { gy, 0, 3 }, { gx, 0, 4 }, { bz, 0, 0 }, { gz, 0, 3 }, { bx, 0, 5 }, { by, 0, 3 }, { ry, 0, 4 }, { bz, 2, 2 }, { rz, 0, 4 }, { bz, 3, 3 }, { d, 0, 4 } } },
+    { 0x1e, 2, false, 6, { 6, 6, 6 }, 24, { { rw, 0, 5 }, { gz, 4, 4 }, { bz, 0, 0 }, { bz, 1, 1 }, { by, 4, 4 }, { gw, 0, 5 }, { gy, 5, 5 }, { by, 5, 5 }, { bz, 2, 2 }, { gy, 4, 4 }, { bw, 0, 5 }, { gz, 5, 5 }, { bz, 3, 3 }, { bz, 5, 5 }, { bz, 4, 4 }, { rx, 0, 5 }, { gy, 0, 3 }, { gx, 0, 5 }, { gz, 0, 3 }, { bx, 0, 5 }, { by, 0, 3 }, { ry, 0, 5 }, { rz, 0, 5 }, { d, 0, 4 } } },
+    { 0x03, 1, false, 10, { 10, 10, 10 }, 6, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 9 }, { gx, 0, 9 }, { bx, 0, 9 } } },
+    { 0x07, 1, true, 11, { 9, 9, 9 }, 9, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 8 }, { rw, 10, 10 }, { gx, 0, 8 }, { gw, 10, 10 }, { bx, 0, 8 }, { bw, 10, 10 } } },
+    { 0x0b, 1, true, 12, { 8, 8, 8 }, 9, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 7 }, { rw, 11, 10 }, { gx, 0, 7 }, { gw, 11, 10 }, { bx, 0, 7 }, { bw, 11, 10 } } },
+    { 0x0f, 1, true, 16, { 4, 4, 4 }, 9, { { rw, 0, 9 }, { gw, 0, 9 }, { bw, 0, 9 }, { rx, 0, 3 }, { rw, 15, 10 }, { gx, 0, 3 }, { gw, 15, 10 }, { bx, 0, 3 }, { bw, 15, 10 } } },
+};
+
+} // namespace bc6h
+
+class bit_reader
+{
+public:
+    explicit bit_reader(const u8* const block) { memcpy(_bits, block, sizeof(_bits)); }
+
+    u32 read(u32 count)
+    {
+        u32 value{ 0 };
+        for (u32 i{ 0 }; i < count; ++i, ++_position)
+        {
+            value |= (u32)((_bits[_position >> 6] >> (_position & 63)) & 1) << i;
+        }
+        return value;
+    }
+
+private:
+    u64 _bits[2];
+    u32 _position{ 0 };
+};
+
+constexpr u8
+expand_bits(u32 value, u32 bit_count)
+{
+    value <<= (8 - bit_count);
+    return (u8)(value | (value >> bit_count));
+}
+
+constexpr u8
+interpolate(u32 e0, u32 e1, u32 weight)
+{
+    return (u8)(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+void
+decode_bc1_color(const u8* const block, u8* const rgba, bool has_alpha)
+{
+    const u16 c0{ (u16)(block[0] | (block[1] << 8)) };
+    const u16 c1{ (u16)(block[2] | (block[3] << 8)) };
+
+    u8 colors[4][4];
+    for (u32 i{ 0 }; i < 2; ++i)
+    {
+        const u16 c{ i ? c1 : c0 };
+        colors[i][0] = expand_bits((c >> 11) & 0x1f, 5);
+        colors[i][1] = expand_bits((c >> 5) & 0x3f, 6);
+        colors[i][2] = expand_bits(c & 0x1f, 5);
+        colors[i][3] = 255;
+    }
+
+    for (u32 j{ 0 }; j < 3; ++j)
+    {
+        if (c0 > c1 || !has_alpha)
+        {
+            colors[2][j] = (u8)((2 * colors[0][j] + colors[1][j]) / 3);
+            colors[3][j] = (u8)((colors[0][j] + 2 * colors[1][j]) / 3);
+        }
+        else
+        {
+            colors[2][j] = (u8)((colors[0][j] + colors[1][j]) / 2);
+            colors[3][j] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = (c0 > c1 || !has_alpha) ? 255 : 0;
+
+    const u32 indices{ (u32)block[4] | ((u32)block[5] << 8) | ((u32)block[6] << 16) | ((u32)block[7] << 24) };
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        memcpy(&rgba[i * 4], colors[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+// BC3 alpha and BC4/BC5 channels. stride is the distance between two pixels of the output channel.
+void
+decode_bc4_channel(const u8* const block, u8* const channel, u32 stride, bool is_signed)
+{
+    s32 values[8];
+    if (is_signed)
+    {
+        values[0] = std::max((s32)(s8)block[0], -127);
+        values[1] = std::max((s32)(s8)block[1], -127);
+    }
+    else
+    {
+        values[0] = block[0];
+        values[1] = block[1];
+    }
+
+    if (values[0] > values[1])
+    {
+        for (s32 i{ 1 }; i < 7; ++i) values[i + 1] = ((7 - i) * values[0] + i * values[1]) / 7;
+    }
+    else
+    {
+        for (s32 i{ 1 }; i < 5; ++i) values[i + 1] = ((5 - i) * values[0] + i * values[1]) / 5;
+        values[6] = is_signed ? -127 : 0;
+        values[7] = is_signed ? 127 : 255;
+    }
+
+    u64 indices{ 0 };
+    for (u32 i{ 0 }; i < 6; ++i) indices |= (u64)block[2 + i] << (i * 8);
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        channel[i * stride] = (u8)values[(indices >> (i * 3)) & 7];
+    }
+}
+
+void
+decode_bc7(const u8* const block, u8* const rgba)
+{
+    u32 mode_index{ 0 };
+    while (mode_index < 8 && !(block[0] & (1 << mode_index))) ++mode_index;
+
+    // NOTE: blocks with a reserved mode decode to transparent black.
+    if (mode_index == 8)
+    {
+        memset(rgba, 0, 16 * 4);
+        return;
+    }
+
+    const bc7_mode& mode{ bc7_modes[mode_index] };
+    bit_reader bits{ block };
+    bits.read(mode_index + 1);
+
+    const u32 partition{ bits.read(mode.partition_bits) };
+    const u32 rotation{ bits.read(mode.rotation_bits) };
+    const u32 index_selection{ bits.read(mode.index_selection_bits) };
+
+    // endpoints[subset * 2 + endpoint][channel]
+    u32 endpoints[6][4]{};
+    const u32 endpoint_count{ mode.subset_count * 2u };
+    for (u32 c{ 0 }; c < 3; ++c)
+    {
+        for (u32 e{ 0 }; e < endpoint_count; ++e) endpoints[e][c] = bits.read(mode.color_bits);
+    }
+
+    for (u32 e{ 0 }; e < endpoint_count; ++e) endpoints[e][3] = mode.alpha_bits ? bits.read(mode.alpha_bits) : 255;
+
+    u32 color_bits{ mode.color_bits };
+    u32 alpha_bits{ mode.alpha_bits };
+    if (mode.endpoint_pbits || mode.shared_pbits)
+    {
+        u32 pbits[6];
+        if (mode.endpoint_pbits)
+        {
+            for (u32 e{ 0 }; e < endpoint_count; ++e) pbits[e] = bits.read(1);
+        }
+        else
+        {
+            for (u32 s{ 0 }; s < mode.subset_count; ++s) pbits[s * 2] = pbits[s * 2 + 1] = bits.read(1);
+        }
+
+        for (u32 e{ 0 }; e < endpoint_count; ++e)
+        {
+            for (u32 c{ 0 }; c < 3; ++c) endpoints[e][c] = (endpoints[e][c] << 1) | pbits[e];
+            if (mode.alpha_bits) endpoints[e][3] = (endpoints[e][3] << 1) | pbits[e];
+        }
+
+        ++color_bits;
+        if (alpha_bits) ++alpha_bits;
+    }
+
+    for (u32 e{ 0 }; e < endpoint_count; ++e)
+    {
+        for (u32 c{ 0 }; c < 3; ++c) endpoints[e][c] = expand_bits(endpoints[e][c], color_bits);
+        if (alpha_bits) endpoints[e][3] = expand_bits(endpoints[e][3], alpha_bits);
+    }
+
+    u8 subsets[16]{};
+    u8 anchors[3]{ 0, 0, 0 };
+    if (mode.subset_count == 2)
+    {
+        for (u32 i{ 0 }; i < 16; ++i) subsets[i] = (partitions2[partition] >> i) & 1;
+        anchors[1] = anchors2[partition];
+    }
+    else if (mode.subset_count == 3)
+    {
+        memcpy(subsets, partitions3[partition], 16);
+        anchors[1] = anchors3_second[partition];
+        anchors[2] = anchors3_third[partition];
+    }
+
+    // Anchor pixels have an implicit 0 in the most significant index bit.
+    u32 indices[16];
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        const bool is_anchor{ i == anchors[subsets[i]] };
+        indices[i] = bits.read(mode.index_bits - (is_anchor ? 1 : 0));
+    }
+
+    u32 indices2[16]{};
+    if (mode.index_bits2)
+    {
+        for (u32 i{ 0 }; i < 16; ++i) indices2[i] = bits.read(mode.index_bits2 - (i == 0 ? 1 : 0));
+    }
+
+    auto weight = [](u32 index_bits, u32 index)
+    {
+        return index_bits == 2 ? weights2[index] : index_bits == 3 ? weights3[index] : weights4[index];
+    };
+
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        const u32* const e0{ endpoints[subsets[i] * 2] };
+        const u32* const e1{ endpoints[subsets[i] * 2 + 1] };
+        u8* const pixel{ &rgba[i * 4] };
+
+        // Mode 4 and 5 have separate color and alpha indices, mode 4 can swap which is which.
+        u32 color_weight{ weight(mode.index_bits, indices[i]) };
+        u32 alpha_weight{ color_weight };
+        if (mode.index_bits2)
+        {
+            alpha_weight = weight(mode.index_bits2, indices2[i]);
+            if (index_selection) std::swap(color_weight, alpha_weight);
+        }
+
+        for (u32 c{ 0 }; c < 3; ++c) pixel[c] = interpolate(e0[c], e1[c], color_weight);
+        pixel[3] = interpolate(e0[3], e1[3], alpha_weight);
+
+        if (rotation) std::swap(pixel[3], pixel[rotation - 1]);
+    }
+}
+
+constexpr s32
+sign_extend(u32 value, u32 bit_count)
+{
+    const u32 sign{ 1u << (bit_count - 1) };
+    return (s32)((value ^ sign) - sign);
+}
+
+// Spreads an endpoint of bit_count bits over the 16-bit range the interpolation runs in.
+constexpr s32
+bc6h_unquantize(s32 value, u32 bit_count, bool is_signed)
+{
+    if (!is_signed)
+    {
+        if (bit_count >= 15 || !value) return value;
+        if (value == (1 << bit_count) - 1) return 0xffff;
+        return ((value << 16) + 0x8000) >> bit_count;
+    }
+
+    if (bit_count >= 16) return value;
+
+    const bool is_negative{ value < 0 };
+    if (is_negative) value = -value;
+
+    s32 unquantized{ 0 };
+    if (value >= (1 << (bit_count - 1)) - 1) unquantized = 0x7fff;
+    else if (value) unquantized = ((value << 15) + 0x4000) >> (bit_count - 1);
+
+    return is_negative ? -unquantized : unquantized;
+}
+
+// Scales an interpolated value to the bits of a half float. Signed halfs are sign and magnitude.
+constexpr u16
+bc6h_to_half(s32 value, bool is_signed)
+{
+    if (!is_signed) return (u16)((value * 31) >> 6);
+    return value < 0 ? (u16)((((-value) * 31) >> 5) | 0x8000) : (u16)((value * 31) >> 5);
+}
+
+// Writes 16 RGBA16F pixels. Alpha is always 1.
+void
+decode_bc6h(const u8* const block, u8* const rgba, bool is_signed)
+{
+    constexpr u16 half_one{ 0x3c00 };
+    u16* const pixels{ (u16*)rgba };
+
+    bit_reader bits{ block };
+    u32 mode_value{ bits.read(2) };
+    if (mode_value > 1) mode_value |= bits.read(3) << 2;
+
+    const bc6h::mode* mode{ nullptr };
+    for (const bc6h::mode& m : bc6h::modes)
+    {
+        if (m.value == mode_value) mode = &m;
+    }
+
+    // NOTE: blocks with a reserved mode decode to black.
+    if (!mode)
+    {
+        for (u32 i{ 0 }; i < 16; ++i)
+        {
+            pixels[i * 4 + 0] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = 0;
+            pixels[i * 4 + 3] = half_one;
+        }
+        return;
+    }
+
+    u32 fields[bc6h::count]{};
+    for (u32 i{ 0 }; i < mode->layout_count; ++i)
+    {
+        const bc6h::bits& run{ mode->layout[i] };
+        const s32 step{ run.first <= run.last ? 1 : -1 };
+        for (s32 bit{ run.first };; bit += step)
+        {
+            fields[run.field] |= bits.read(1) << bit;
+            if (bit == run.last) break;
+        }
+    }
+
+    // endpoints[subset * 2 + endpoint][channel]
+    s32 endpoints[4][3];
+    const u32 endpoint_count{ mode->subset_count * 2u };
+    const u32 endpoint_bits{ mode->endpoint_bits };
+    const u32 endpoint_mask{ (1u << endpoint_bits) - 1 };
+    for (u32 c{ 0 }; c < 3; ++c)
+    {
+        const u32 base{ fields[c] };
+        endpoints[0][c] = is_signed ? sign_extend(base, endpoint_bits) : (s32)base;
+
+        for (u32 e{ 1 }; e < endpoint_count; ++e)
+        {
+            u32 value{ fields[e * 3 + c] };
+            // Deltas are always signed, whatever the format. Their sum wraps around at the endpoint precision.
+            if (mode->is_transformed) value = (base + (u32)sign_extend(value, mode->delta_bits[c])) & endpoint_mask;
+            endpoints[e][c] = is_signed ? sign_extend(value, endpoint_bits) : (s32)value;
+        }
+    }
+
+    for (u32 e{ 0 }; e < endpoint_count; ++e)
+    {
+        for (u32 c{ 0 }; c < 3; ++c) endpoints[e][c] = bc6h_unquantize(endpoints[e][c], endpoint_bits, is_signed);
+    }
+
+    // Indices start right after the header: 3 bits per pixel with 2 subsets, 4 bits with 1 subset.
+    // Anchor pixels have an implicit 0 in the most significant index bit.
+    const u32 partition{ fields[bc6h::d] };
+    const u32 index_bits{ mode->subset_count == 2 ? 3u : 4u };
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        const u32 subset{ mode->subset_count == 2 ? (partitions2[partition] >> i) & 1u : 0u };
+        const bool is_anchor{ i == 0 || (subset && i == anchors2[partition]) };
+        const u32 index{ bits.read(index_bits - (is_anchor ? 1 : 0)) };
+        const s32 weight{ index_bits == 3 ? weights3[index] : weights4[index] };
+
+        const s32* const e0{ endpoints[subset * 2] };
+        const s32* const e1{ endpoints[subset * 2 + 1] };
+        for (u32 c{ 0 }; c < 3; ++c)
+        {
+            pixels[i * 4 + c] = bc6h_to_half(((64 - weight) * e0[c] + weight * e1[c] + 32) >> 6, is_signed);
+        }
+        pixels[i * 4 + 3] = half_one;
+    }
+}
+
+void
+decode_block(format::type f, const u8* const block, u8* const pixels)
+{
+    switch (f)
+    {
+    case format::bc1:
+        decode_bc1_color(block, pixels, true);
+        break;
+    case format::bc2:
+        decode_bc1_color(block + 8, pixels, false);
+        for (u32 i{ 0 }; i < 16; ++i)
+        {
+            const u32 alpha{ (u32)(block[i / 2] >> ((i & 1) * 4)) & 0xf };
+            pixels[i * 4 + 3] = (u8)(alpha * 17);
+        }
+        break;
+    case format::bc3:
+        decode_bc1_color(block + 8, pixels, false);
+        decode_bc4_channel(block, pixels + 3, 4, false);
+        break;
+    case format::bc4:
+    case format::bc4_snorm:
+        decode_bc4_channel(block, pixels, 1, f == format::bc4_snorm);
+        break;
+    case format::bc5:
+    case format::bc5_snorm:
+        decode_bc4_channel(block, pixels, 2, f == format::bc5_snorm);
+        decode_bc4_channel(block + 8, pixels + 1, 2, f == format::bc5_snorm);
+        break;
+    case format::bc6h:
+    case format::bc6h_sf:
+        decode_bc6h(block, pixels, f == format::bc6h_sf);
+        break;
+    case format::bc7:
+        decode_bc7(block, pixels);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+} // anonymous namespace
+
+void
+decode(format::type f, const u8* const blocks, u32 row_pitch, u32 width, u32 height, u8* const pixels)
+{
+    assert(f < format::count && blocks && pixels && width && height);
+    const u32 size{ block_size(f) };
+    const u32 bytes_per_pixel{ pixel_size(f) };
+    const u32 block_columns{ (width + 3) >> 2 };
+    const u32 block_rows{ (height + 3) >> 2 };
+    u8 decoded[16 * 8];
+
+    for (u32 by{ 0 }; by < block_rows; ++by)
+    {
+        const u8* const row{ blocks + (u64)by * row_pitch };
+        for (u32 bx{ 0 }; bx < block_columns; ++bx)
+        {
+            decode_block(f, row + bx * size, decoded);
+
+            // Blocks at the right and bottom edges of mips that aren't a multiple of 4 are clipped.
+            const u32 columns{ std::min(4u, width - bx * 4) };
+            const u32 rows{ std::min(4u, height - by * 4) };
+            for (u32 y{ 0 }; y < rows; ++y)
+            {
+                u8* const dst{ pixels + ((u64)(by * 4 + y) * width + bx * 4) * bytes_per_pixel };
+                memcpy(dst, &decoded[y * 4 * bytes_per_pixel], columns * bytes_per_pixel);
+            }
+        }
+    }
+}
+}
@@ -0,0 +1,48 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+// CPU decoder for block compressed textures. Renderers use it when the GPU can't sample a
+// compressed format (e.g. software rasterizers), at the cost of 4-8 times the texture memory.
+// BC6H decodes to half floats, the other formats to 8 bits per channel.
+namespace primal::graphics::block_compression {
+
+struct format
+{
+    enum type : u32
+    {
+        bc1,		// RGBA8, 1-bit alpha
+        bc2,		// RGBA8, explicit 4-bit alpha
+        bc3,		// RGBA8, interpolated alpha
+        bc4,		// R8
+        bc4_snorm,	// R8 signed
+        bc5,		// RG8
+        bc5_snorm,	// RG8 signed
+        bc6h,		// RGBA16F, HDR with unsigned values. Alpha is always 1.
+        bc6h_sf,	// RGBA16F, HDR with signed values. Alpha is always 1.
+        bc7,		// RGBA8
+
+        count
+    };
+};
+
+[[nodiscard]] constexpr u32 block_size(format::type f) { return (f == format::bc1 || f == format::bc4 || f == format::bc4_snorm) ? 8 : 16; }
+[[nodiscard]] constexpr u32 pixel_size(format::type f)
+{
+    switch (f)
+    {
+    case format::bc4:
+    case format::bc4_snorm: return 1;
+    case format::bc5:
+    case format::bc5_snorm: return 2;
+    case format::bc6h:
+    case format::bc6h_sf: return 8;
+    default: return 4;
+    }
+}
+
+// Decodes one mip level of width x height pixels. Rows of blocks are row_pitch bytes apart in the source;
+// pixels are written tightly packed, pixel_size(f) bytes each.
+void decode(format::type f, const u8* const blocks, u32 row_pitch, u32 width, u32 height, u8* const pixels);
+}
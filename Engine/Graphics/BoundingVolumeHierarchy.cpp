@@ -0,0 +1,486 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "BoundingVolumeHierarchy.h"
+
+namespace primal::graphics {
+namespace {
+
+using namespace DirectX;
+
+constexpr u32 bin_count{ 16 };
+constexpr u32 max_leaf_items{ 4 };
+// Cost of visiting a node relative to testing an item. Both are a box test, so about the same.
+constexpr f32 traversal_cost{ 1.f };
+// From this depth on, nodes are split at the median instead, which bounds the depth of the tree by
+// balanced_split_depth + log2(item count) and lets queries keep their stack on the stack.
+constexpr u32 balanced_split_depth{ 40 };
+constexpr u32 max_depth{ 64 };
+// Rebuild once refits have made the summed node areas, and so the expected query cost, this much larger.
+constexpr f32 rebuild_cost_ratio{ 1.5f };
+
+struct bounds
+{
+    XMVECTOR	min{ XMVectorReplicate(std::numeric_limits<f32>::max()) };
+    XMVECTOR	max{ XMVectorReplicate(-std::numeric_limits<f32>::max()) };
+
+    void grow(FXMVECTOR point_min, FXMVECTOR point_max)
+    {
+        min = XMVectorMin(min, point_min);
+        max = XMVectorMax(max, point_max);
+    }
+
+    void grow(const bounds& b) { grow(b.min, b.max); }
+
+    [[nodiscard]] f32 area() const
+    {
+        const XMVECTOR size{ XMVectorMax(XMVectorSubtract(max, min), XMVectorZero()) };
+        return 2.f * XMVectorGetX(XMVector3Dot(size, XMVectorSwizzle<1, 2, 0, 3>(size)));
+    }
+};
+
+[[nodiscard]] f32
+area(const BoundingBox& box)
+{
+    return 8.f * (box.Extents.x * box.Extents.y + box.Extents.y * box.Extents.z + box.Extents.z * box.Extents.x);
+}
+
+[[nodiscard]] BoundingBox
+to_box(const bounds& b)
+{
+    BoundingBox box;
+    BoundingBox::CreateFromPoints(box, b.min, b.max);
+    return box;
+}
+
+struct bin
+{
+    bounds		box;
+    u32			count{ 0 };
+};
+
+struct build_task
+{
+    u32			node;
+    u32			begin;
+    u32			end;
+    u32			depth;
+};
+
+} // anonymous namespace
+
+BoundingFrustum
+make_bounding_frustum(const math::m4x4& view, const math::m4x4& projection)
+{
+    BoundingFrustum frustum{ XMLoadFloat4x4(&projection), true };
+    // NOTE: with reversed depth, the depth planes come out of the projection the other way around.
+    if (frustum.Near > frustum.Far) std::swap(frustum.Near, frustum.Far);
+    frustum.Transform(frustum, XMMatrixInverse(nullptr, XMLoadFloat4x4(&view)));
+    return frustum;
+}
+
+BoundingFrustum
+make_bounding_frustum(const camera& camera)
+{
+    return make_bounding_frustum(camera.view(), camera.projection());
+}
+
+u32
+bounding_volume_hierarchy::add(const BoundingBox& box, id::id_type render_item_id)
+{
+    assert(id::is_valid(render_item_id));
+    u32 id{ u32_invalid_id };
+    if (!_free_ids.empty())
+    {
+        id = _free_ids.back();
+        _free_ids.pop_back();
+        _boxes[id] = box;
+        _render_item_ids[id] = render_item_id;
+    }
+    else
+    {
+        id = (u32)_boxes.size();
+        _boxes.emplace_back(box);
+        _render_item_ids.emplace_back(render_item_id);
+        _leaves.emplace_back(u32_invalid_id);
+    }
+
+    ++_item_count;
+    _needs_build = true;
+    return id;
+}
+
+void
+bounding_volume_hierarchy::remove(u32 id)
+{
+    assert(id < _render_item_ids.size() && id::is_valid(_render_item_ids[id]));
+    _render_item_ids[id] = id::invalid_id;
+    _free_ids.emplace_back(id);
+    --_item_count;
+    _needs_build = true;
+}
+
+void
+bounding_volume_hierarchy::update(u32 id, const BoundingBox& box)
+{
+    assert(id < _render_item_ids.size() && id::is_valid(_render_item_ids[id]));
+    _boxes[id] = box;
+    // NOTE: a build fits all boxes anyway.
+    if (!_needs_build) _moved_items.emplace_back(id);
+}
+
+void
+bounding_volume_hierarchy::commit()
+{
+    if (!_needs_build && !_moved_items.empty())
+    {
+        refit();
+        _needs_build = _cost > rebuild_cost_ratio * _built_cost;
+    }
+
+    _moved_items.clear();
+    if (_needs_build) build();
+}
+
+void
+bounding_volume_hierarchy::build()
+{
+    _needs_build = false;
+    _nodes.clear();
+    _item_order.clear();
+    _depth = 0;
+    _built_cost = _cost = 0.f;
+    if (!_item_count) return;
+
+    const u32 id_count{ (u32)_boxes.size() };
+    for (u32 i{ 0 }; i < id_count; ++i)
+    {
+        if (id::is_valid(_render_item_ids[i])) _item_order.emplace_back(i);
+    }
+    assert(_item_order.size() == _item_count);
+
+    // Corners and centers of the boxes, so splitting doesn't convert them over and over.
+    utl::vector<XMFLOAT3A> mins(id_count);
+    utl::vector<XMFLOAT3A> maxs(id_count);
+    utl::vector<XMFLOAT3A> centers(id_count);
+    for (u32 id : _item_order)
+    {
+        const XMVECTOR center{ XMLoadFloat3(&_boxes[id].Center) };
+        const XMVECTOR extents{ XMLoadFloat3(&_boxes[id].Extents) };
+        XMStoreFloat3A(&mins[id], XMVectorSubtract(center, extents));
+        XMStoreFloat3A(&maxs[id], XMVectorAdd(center, extents));
+        XMStoreFloat3A(&centers[id], center);
+    }
+
+    const auto axis_of{ [](const XMFLOAT3A& v, u32 axis) { return (&v.x)[axis]; } };
+
+    _nodes.reserve(2 * _item_count);
+    _nodes.emplace_back(node{ {}, 0, _item_count, u32_invalid_id, u32_invalid_id });
+    utl::vector<build_task> tasks;
+    tasks.emplace_back(build_task{ 0, 0, _item_count, 0 });
+
+    while (!tasks.empty())
+    {
+        const build_task task{ tasks.back() };
+        tasks.pop_back();
+        u32* const order{ _item_order.data() };
+        const u32 count{ task.end - task.begin };
+
+        bounds node_bounds{};
+        bounds center_bounds{};
+        for (u32 i{ task.begin }; i < task.end; ++i)
+        {
+            const u32 id{ order[i] };
+            node_bounds.grow(XMLoadFloat3A(&mins[id]), XMLoadFloat3A(&maxs[id]));
+            const XMVECTOR center{ XMLoadFloat3A(&centers[id]) };
+            center_bounds.grow(center, center);
+        }
+
+        _nodes[task.node].box = to_box(node_bounds);
+        _depth = std::max(_depth, task.depth + 1);
+        if (count == 1) continue;
+
+        XMFLOAT3A center_size;
+        XMStoreFloat3A(&center_size, XMVectorSubtract(center_bounds.max, center_bounds.min));
+        const u32 axis{ center_size.x >= center_size.y && center_size.x >= center_size.z ? 0u : center_size.y >= center_size.z ? 1u : 2u };
+        const f32 axis_size{ axis_of(center_size, axis) };
+        XMFLOAT3A center_min;
+        XMStoreFloat3A(&center_min, center_bounds.min);
+        const f32 axis_min{ axis_of(center_min, axis) };
+
+        u32 split{ task.begin + count / 2 };
+        if (axis_size <= 0.f)
+        {
+            // NOTE: all centers are the same, so any split is as good as any other.
+            if (count <= max_leaf_items) continue;
+        }
+        else if (task.depth >= balanced_split_depth)
+        {
+            std::nth_element(order + task.begin, order + split, order + task.end,
+                [&](u32 a, u32 b) { return axis_of(centers[a], axis) < axis_of(centers[b], axis); });
+        }
+        else
+        {
+            const f32 scale{ bin_count / axis_size };
+            const auto bin_of{ [&](u32 id) { return std::min(bin_count - 1, (u32)((axis_of(centers[id], axis) - axis_min) * scale)); } };
+
+            bin bins[bin_count]{};
+            for (u32 i{ task.begin }; i < task.end; ++i)
+            {
+                const u32 id{ order[i] };
+                bin& b{ bins[bin_of(id)] };
+                b.box.grow(XMLoadFloat3A(&mins[id]), XMLoadFloat3A(&maxs[id]));
+                ++b.count;
+            }
+
+            // The cost of splitting after bin i is the area of each side times the items on that side.
+            f32 right_costs[bin_count]{};
+            bounds right{};
+            u32 right_count{ 0 };
+            for (u32 i{ bin_count - 1 }; i > 0; --i)
+            {
+                right.grow(bins[i].box);
+                right_count += bins[i].count;
+                right_costs[i - 1] = right.area() * right_count;
+            }
+
+            f32 best_cost{ std::numeric_limits<f32>::max() };
+            u32 best_bin{ u32_invalid_id };
+            bounds left{};
+            u32 left_count{ 0 };
+            for (u32 i{ 0 }; i < bin_count - 1; ++i)
+            {
+                left.grow(bins[i].box);
+                left_count += bins[i].count;
+                if (!left_count || left_count == count) continue;
+                const f32 cost{ left.area() * left_count + right_costs[i] };
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_bin = i;
+                }
+            }
+
+            const f32 node_area{ node_bounds.area() };
+            if (count <= max_leaf_items && count * node_area <= traversal_cost * node_area + best_cost) continue;
+
+            // NOTE: the centers span more than one bin, so there's always a split with items on both sides.
+            assert(best_bin != u32_invalid_id);
+            split = (u32)(std::partition(order + task.begin, order + task.end, [&](u32 id) { return bin_of(id) <= best_bin; }) - order);
+        }
+
+        assert(split > task.begin && split < task.end);
+        const u32 left{ (u32)_nodes.size() };
+        _nodes[task.node].left = left;
+        _nodes.emplace_back(node{ {}, task.begin, split - task.begin, u32_invalid_id, task.node });
+        _nodes.emplace_back(node{ {}, split, task.end - split, u32_invalid_id, task.node });
+        tasks.emplace_back(build_task{ left + 1, split, task.end, task.depth + 1 });
+        tasks.emplace_back(build_task{ left, task.begin, split, task.depth + 1 });
+    }
+
+    assert(_depth <= max_depth);
+
+    const u32 node_count{ (u32)_nodes.size() };
+    for (u32 i{ 0 }; i < node_count; ++i)
+    {
+        const node& n{ _nodes[i] };
+        _built_cost += area(n.box);
+        if (n.left != u32_invalid_id) continue;
+        for (u32 j{ n.first_item }; j < n.first_item + n.item_count; ++j) _leaves[_item_order[j]] = i;
+    }
+
+    _cost = _built_cost;
+    _is_node_dirty.assign(node_count, 0);
+}
+
+void
+bounding_volume_hierarchy::fit_node(u32 index)
+{
+    node& n{ _nodes[index] };
+    const f32 old_area{ area(n.box) };
+    if (n.left == u32_invalid_id)
+    {
+        n.box = _boxes[_item_order[n.first_item]];
+        for (u32 i{ n.first_item + 1 }; i < n.first_item + n.item_count; ++i)
+        {
+            BoundingBox::CreateMerged(n.box, n.box, _boxes[_item_order[i]]);
+        }
+    }
+    else
+    {
+        BoundingBox::CreateMerged(n.box, _nodes[n.left].box, _nodes[n.left + 1].box);
+    }
+
+    _cost += area(n.box) - old_area;
+}
+
+void
+bounding_volume_hierarchy::refit()
+{
+    assert(!_needs_build && !_nodes.empty());
+
+    // Mark the leaves of the moved items and everything above them, stopping at nodes that are marked already.
+    _dirty_nodes.clear();
+    for (u32 id : _moved_items)
+    {
+        for (u32 n{ _leaves[id] }; n != u32_invalid_id && !_is_node_dirty[n]; n = _nodes[n].parent)
+        {
+            _is_node_dirty[n] = 1;
+            _dirty_nodes.emplace_back(n);
+        }
+    }
+
+    const u32 node_count{ (u32)_nodes.size() };
+    if (_dirty_nodes.size() > node_count / 8)
+    {
+        // NOTE: when much of the scene moved, one pass over all nodes is cheaper than sorting the marked ones.
+        for (u32 i{ node_count }; i > 0; --i) fit_node(i - 1);
+        memset(_is_node_dirty.data(), 0, node_count);
+        return;
+    }
+
+    // Children have larger indices than their parents, so fitting in decreasing order does children first.
+    std::sort(_dirty_nodes.begin(), _dirty_nodes.end(), std::greater<u32>{});
+    for (u32 n : _dirty_nodes)
+    {
+        fit_node(n);
+        _is_node_dirty[n] = 0;
+    }
+}
+
+void
+bounding_volume_hierarchy::query(const BoundingFrustum* const frustums, u32 frustum_count, utl::vector<id::id_type>* const visible) const
+{
+    assert(frustums && visible && frustum_count && frustum_count <= max_frustums);
+    assert(!_needs_build && _moved_items.empty());
+    if (_nodes.empty()) return;
+
+    XMVECTOR planes[max_frustums][6];
+    for (u32 i{ 0 }; i < frustum_count; ++i)
+    {
+        XMVECTOR* const p{ planes[i] };
+        frustums[i].GetPlanes(&p[0], &p[1], &p[2], &p[3], &p[4], &p[5]);
+    }
+
+    const auto contained_by{ [&planes](const BoundingBox& box, u32 i) {
+        const XMVECTOR* const p{ planes[i] };
+        return box.ContainedBy(p[0], p[1], p[2], p[3], p[4], p[5]);
+        } };
+
+    // Each entry has the frustums that still need to test the node: the ones it intersects but isn't inside of.
+    struct entry
+    {
+        u32		node;
+        u32		frustum_mask;
+    };
+
+    entry stack[max_depth + 1];
+    u32 stack_size{ 0 };
+    stack[stack_size++] = { 0, (1u << frustum_count) - 1 };
+
+    while (stack_size)
+    {
+        const entry e{ stack[--stack_size] };
+        const node& n{ _nodes[e.node] };
+
+        u32 mask{ e.frustum_mask };
+        for (u32 i{ 0 }; i < frustum_count; ++i)
+        {
+            if (!(e.frustum_mask & (1u << i))) continue;
+            const ContainmentType containment{ contained_by(n.box, i) };
+            if (containment == INTERSECTS) continue;
+
+            mask &= ~(1u << i);
+            if (containment == CONTAINS)
+            {
+                utl::vector<id::id_type>& out{ visible[i] };
+                for (u32 j{ n.first_item }; j < n.first_item + n.item_count; ++j) out.emplace_back(_render_item_ids[_item_order[j]]);
+            }
+        }
+
+        if (!mask) continue;
+
+        if (n.left == u32_invalid_id)
+        {
+            for (u32 j{ n.first_item }; j < n.first_item + n.item_count; ++j)
+            {
+                const u32 id{ _item_order[j] };
+                for (u32 i{ 0 }; i < frustum_count; ++i)
+                {
+                    if ((mask & (1u << i)) && contained_by(_boxes[id], i) != DISJOINT) visible[i].emplace_back(_render_item_ids[id]);
+                }
+            }
+            continue;
+        }
+
+        assert(stack_size + 2 <= _countof(stack));
+        stack[stack_size++] = { n.left + 1, mask };
+        stack[stack_size++] = { n.left, mask };
+    }
+}
+
+void
+bounding_volume_hierarchy::query(const BoundingFrustum& frustum, utl::vector<id::id_type>& visible) const
+{
+    query(&frustum, 1, &visible);
+}
+
+bool
+bounding_volume_hierarchy::raycast(FXMVECTOR origin, FXMVECTOR direction, f32 max_distance, ray_hit& hit) const
+{
+    assert(!_needs_build && _moved_items.empty());
+    f32 closest{ max_distance };
+    hit.render_item_id = id::invalid_id;
+    if (_nodes.empty()) return false;
+
+    struct entry
+    {
+        u32		node;
+        f32		distance;		// where the ray enters the node's box
+    };
+
+    entry stack[max_depth + 1];
+    u32 stack_size{ 0 };
+    f32 distance;
+    if (!_nodes[0].box.Intersects(origin, direction, distance) || distance > closest) return false;
+    stack[stack_size++] = { 0, distance };
+
+    while (stack_size)
+    {
+        const entry e{ stack[--stack_size] };
+        // NOTE: a closer hit may have been found since this node was pushed.
+        if (e.distance > closest) continue;
+        const node& n{ _nodes[e.node] };
+
+        if (n.left == u32_invalid_id)
+        {
+            for (u32 j{ n.first_item }; j < n.first_item + n.item_count; ++j)
+            {
+                const u32 id{ _item_order[j] };
+                if (_boxes[id].Intersects(origin, direction, distance) && distance <= closest)
+                {
+                    closest = distance;
+                    hit.render_item_id = _render_item_ids[id];
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so hits in it can skip the other one.
+        f32 distances[2];
+        bool hits[2];
+        for (u32 i{ 0 }; i < 2; ++i)
+        {
+            hits[i] = _nodes[n.left + i].box.Intersects(origin, direction, distances[i]) && distances[i] <= closest;
+        }
+
+        const u32 nearer{ hits[0] && hits[1] ? (distances[1] < distances[0] ? 1u : 0u) : (hits[1] ? 1u : 0u) };
+        const u32 farther{ nearer ^ 1 };
+        assert(stack_size + 2 <= _countof(stack));
+        if (hits[farther]) stack[stack_size++] = { n.left + farther, distances[farther] };
+        if (hits[nearer]) stack[stack_size++] = { n.left + nearer, distances[nearer] };
+    }
+
+    hit.distance = closest;
+    return id::is_valid(hit.render_item_id);
+}
+}
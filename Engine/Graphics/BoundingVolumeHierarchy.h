@@ -0,0 +1,86 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "Graphics/Renderer.h"
+#include <DirectXCollision.h>
+
+namespace primal::graphics {
+
+// A world space frustum for a camera's view and projection, reversed depth or not.
+[[nodiscard]] DirectX::BoundingFrustum make_bounding_frustum(const math::m4x4& view, const math::m4x4& projection);
+[[nodiscard]] DirectX::BoundingFrustum make_bounding_frustum(const camera& camera);
+
+// Bounding volume hierarchy over the boxes of render items, for culling and picking without testing every
+// item. It's built top-down with the binned surface area heuristic. Items that move are refit in place:
+// their leaves and the nodes above them grow or shrink to fit. That keeps queries correct, but the tree gets
+// slower as the boxes drift away from where they were built, so commit() rebuilds it once the refits have
+// made it too much more expensive to traverse.
+//
+// Each item stores a render item id, which is what the queries return. Queries don't change the tree, so
+// several threads can query at once, but not while it's being changed or committed.
+class bounding_volume_hierarchy
+{
+public:
+    constexpr static u32 max_frustums{ 8 };		// frustums a single query() can test
+
+    struct ray_hit
+    {
+        id::id_type		render_item_id;
+        f32				distance;
+    };
+
+    // Returns an id for the item, which stays valid until it's removed. Adding and removing items takes
+    // effect on the next commit(), which then rebuilds the tree.
+    [[nodiscard]] u32 add(const DirectX::BoundingBox& box, id::id_type render_item_id);
+    void remove(u32 id);
+    // For items that moved. Takes effect on the next commit().
+    void update(u32 id, const DirectX::BoundingBox& box);
+    // Applies the changes made since the last call. Call it once a frame, before querying.
+    void commit();
+
+    // Appends the render item ids of the items that intersect frustums[i] to visible[i], for all frustums in
+    // one traversal of the tree: a node is only visited once however many frustums want it, and a node that's
+    // completely inside a frustum adds all its items for that frustum without testing them.
+    void query(const DirectX::BoundingFrustum* const frustums, u32 frustum_count, utl::vector<id::id_type>* const visible) const;
+    void query(const DirectX::BoundingFrustum& frustum, utl::vector<id::id_type>& visible) const;
+
+    // The closest item whose box the ray hits within max_distance. direction must be normalized.
+    [[nodiscard]] bool raycast(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, f32 max_distance, ray_hit& hit) const;
+
+    [[nodiscard]] constexpr u32 item_count() const { return _item_count; }
+    [[nodiscard]] u32 node_count() const { return (u32)_nodes.size(); }
+    [[nodiscard]] constexpr u32 depth() const { return _depth; }
+
+private:
+    // Children are stored next to each other after their parent, so going through the nodes backwards
+    // reaches all children before their parents. The items of a node are a contiguous range of _item_order.
+    struct node
+    {
+        DirectX::BoundingBox	box;
+        u32						first_item;
+        u32						item_count;
+        u32						left;			// the right child is left + 1. u32_invalid_id for leaves.
+        u32						parent;
+    };
+
+    void build();
+    void refit();
+    void fit_node(u32 index);
+
+    utl::vector<node>						_nodes;
+    utl::vector<u32>						_item_order;		// item ids in the order the leaves reference them
+    utl::vector<DirectX::BoundingBox>		_boxes;				// per item id
+    utl::vector<id::id_type>				_render_item_ids;	// per item id. id::invalid_id for removed items.
+    utl::vector<u32>						_leaves;			// per item id, the leaf that has it
+    utl::vector<u32>						_free_ids;
+    utl::vector<u32>						_moved_items;
+    utl::vector<u32>						_dirty_nodes;		// scratch for refit()
+    utl::vector<u8>							_is_node_dirty;
+    f32										_built_cost{ 0.f };	// sum of the node surface areas after the last build
+    f32										_cost{ 0.f };		// the same sum after the refits since then
+    u32										_item_count{ 0 };
+    u32										_depth{ 0 };
+    bool									_needs_build{ false };
+};
+}
@@ -1,31 +1,159 @@
 #include "D3D11Content.h"
 #include "D3D11Core.h"
+#include "D3D11Shaders.h"
 #include "Content/ContentToEngine.h"
 #include "Utilities/IOStream.h"
+#include "Graphics/RangeAllocator.h"
+#include "Graphics/PipelineStateCache.h"
+#include "Graphics/StableArray.h"
+#include "Utilities/JobSystem.h"
 
 #if PRIMAL_BUILD_D3D11
 
 namespace primal::graphics::d3d11::content {
 namespace {
+// Large buffers that many submeshes share. A vertex pool holds the positions and elements of all submeshes
+// with the same element size, so both streams are addressed with the same base vertex. The index pool holds
+// the 16 and 32 bit indices of every submesh.
+class d3d11_geometry_pool
+{
+public:
+    constexpr static u32 max_stream_count{ 2 };
+
+    void initialize(const u32* const strides, u32 stream_count, bool is_index_pool, u32 capacity)
+    {
+        assert(strides && stream_count && stream_count <= max_stream_count && capacity);
+        _stream_count = stream_count;
+        _is_index_pool = is_index_pool;
+        for (u32 i{ 0 }; i < stream_count; ++i) _strides[i] = strides[i];
+        _ranges.initialize(capacity);
+    }
+
+    void release()
+    {
+        for (u32 i{ 0 }; i < _stream_count; ++i)
+        {
+            core::release(_views[i]);
+            core::release(_buffers[i]);
+        }
+    }
+
+    // Returns a handle to count elements (vertices or index bytes). The data is in the pool after the next update().
+    [[nodiscard]] u32 allocate(u32 count, u32 alignment) { return _ranges.allocate(count, alignment); }
+    void free(u32 handle) { _ranges.free(handle); }
+
+    // Recreates the buffers after the pool was compacted or grew, and moves the data of resident ranges.
+    void update(ID3D11DeviceContext4* const ctx)
+    {
+        if (!_ranges.needs_rebuild()) return;
+
+        ID3D11Buffer* old_buffers[max_stream_count]{};
+        for (u32 i{ 0 }; i < _stream_count; ++i)
+        {
+            old_buffers[i] = _buffers[i];
+            _buffers[i] = nullptr;
+            core::deferred_release(_views[i]);
+            create_buffer(i);
+        }
+
+        _ranges.rebuild([&](u64 old_offset, u64 new_offset, u64 size) {
+            for (u32 i{ 0 }; i < _stream_count; ++i)
+            {
+                const D3D11_BOX box{ (u32)(old_offset * _strides[i]), 0, 0, (u32)((old_offset + size) * _strides[i]), 1, 1 };
+                ctx->CopySubresourceRegion(_buffers[i], 0, (u32)(new_offset * _strides[i]), 0, 0, old_buffers[i], 0, &box);
+            }
+            });
+
+        for (u32 i{ 0 }; i < _stream_count; ++i) core::deferred_release(old_buffers[i]);
+    }
+
+    // Writes the data of a newly added range straight into its place in the pool. The streams are expected
+    // one after the other in data. Returns the end of the data that was read. Call after update().
+    const u8* upload(ID3D11DeviceContext4* const ctx, u32 handle, const u8* data)
+    {
+        assert(data);
+        const u64 offset{ _ranges.make_resident(handle) };
+        const u64 size{ _ranges.size(handle) };
+        for (u32 i{ 0 }; i < _stream_count; ++i)
+        {
+            const D3D11_BOX box{ (u32)(offset * _strides[i]), 0, 0, (u32)((offset + size) * _strides[i]), 1, 1 };
+            ctx->UpdateSubresource(_buffers[i], 0, &box, data, 0, 0);
+            data += size * _strides[i];
+        }
+        return data;
+    }
+
+    [[nodiscard]] constexpr bool is_resident(u32 handle) const { return _ranges.is_resident(handle); }
+    // Offset of the range in the buffers that are currently bound for rendering.
+    [[nodiscard]] constexpr u32 offset(u32 handle) const { return (u32)_ranges.offset(handle); }
+    [[nodiscard]] constexpr ID3D11Buffer* const buffer(u32 stream) const { return _buffers[stream]; }
+    [[nodiscard]] constexpr ID3D11ShaderResourceView* const view(u32 stream) const { return _views[stream]; }
+    [[nodiscard]] constexpr u32 stride(u32 stream) const { return _strides[stream]; }
+    [[nodiscard]] constexpr u32 stream_count() const { return _stream_count; }
+
+private:
+    void create_buffer(u32 stream)
+    {
+        const u32 capacity{ (u32)_ranges.capacity() };
+        D3D11_BUFFER_DESC desc{};
+        desc.ByteWidth = capacity * _strides[stream];
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = _is_index_pool ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_SHADER_RESOURCE;
+        if (!_is_index_pool)
+        {
+            desc.StructureByteStride = _strides[stream];
+            desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        }
+
+        DXCall(core::device()->CreateBuffer(&desc, nullptr, &_buffers[stream]));
+        assert(_buffers[stream]);
+        NAME_D3D11_OBJECT(_buffers[stream], _is_index_pool ? L"Index Pool Buffer" : L"Vertex Pool Buffer");
+
+        if (!_is_index_pool)
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvdesc{};
+            srvdesc.Format = DXGI_FORMAT_UNKNOWN;
+            srvdesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+            srvdesc.Buffer.FirstElement = 0;
+            srvdesc.Buffer.NumElements = capacity;
+
+            DXCall(core::device()->CreateShaderResourceView(_buffers[stream], &srvdesc, &_views[stream]));
+        }
+    }
+
+    resident_range_allocator		_ranges{};
+    ID3D11Buffer*					_buffers[max_stream_count]{};
+    ID3D11ShaderResourceView*		_views[max_stream_count]{};
+    u32								_strides[max_stream_count]{};
+    u32								_stream_count{ 0 };
+    bool							_is_index_pool{ false };
+};
+
 struct submesh_view
 {
-    ID3D11Buffer*									index_buffer;
-    ID3D11Buffer*									position_buffer;
-    ID3D11Buffer*									element_buffer;
-    ID3D11ShaderResourceView*						position_view;
-    ID3D11ShaderResourceView*						element_view;
+    u32												vertex_pool_index;
+    u32												vertex_range;
+    u32												index_range;
     D3D_PRIMITIVE_TOPOLOGY							primitive_topology;
     DXGI_FORMAT										index_format{};
     u32												elements_type{};
     u32												index_count{};
 };
 
+// Submesh data waiting to be written into the pools by the render thread.
+struct pending_submesh
+{
+    id::id_type										submesh_id;
+    std::unique_ptr<u8[]>							data;		// positions, elements and indices, tightly packed
+};
+
 struct d3d11_render_item
 {
     id::id_type			entity_id;
     id::id_type			submesh_gpu_id;
     id::id_type			material_id;
     id::id_type			pso_id;
+    id::id_type			depth_pso_id;
 };
 
 struct d3d11_pso_storage
@@ -41,7 +169,12 @@ struct d3d11_pso_storage
 };
 
 utl::free_list<submesh_view>						submesh_views{};
+utl::vector<d3d11_geometry_pool>					vertex_pools;
+utl::vector<u32>									vertex_pool_element_sizes;
+d3d11_geometry_pool									index_pool{};
+utl::vector<pending_submesh>						pending_submeshes;
 std::mutex											submesh_mutex{};
+thread_local submesh::load_stats					thread_stats{};
 
 utl::free_list<d3d11_texture>						textures;
 utl::free_list<ID3D11ShaderResourceView*>			texture_pointers;
@@ -50,38 +183,47 @@ std::mutex											texture_mutex{};
 utl::free_list<std::unique_ptr<u8[]>>				materials;
 std::mutex											material_mutex{};
 
-utl::free_list<d3d11_render_item>					render_items;
-utl::free_list<std::unique_ptr<id::id_type[]>>		render_item_ids;
+//NOTE: render items are added and removed by loading threads and read by the render thread every frame.
+//      Elements of stable free lists never move, so the render thread reads them without locks. The mutex
+//      only serializes the writers. Removed items are only freed when their frame index comes around again,
+//      so no frame that may still be gathering them sees their memory freed or their slots reused.
+stable_free_list<d3d11_render_item>					render_items;
+stable_free_list<id::id_type*>						render_item_ids;	// geometry content id, item ids, invalid_id
+utl::vector<id::id_type>							removed_render_items[frame_buffer_count];
 std::mutex											render_item_mutex{};
 
-utl::vector<d3d11_pipeline_state>					pipeline_states;
-utl::vector<d3d11_pso_storage>						pso_storages;
-utl::vector<ID3D11VertexShader*>					vertex_shaders;
-std::unordered_map<u64, id::id_type>				vs_map;
-utl::vector<ID3D11HullShader*>						hull_shaders;
-std::unordered_map<u64, id::id_type>				hs_map;
-utl::vector<ID3D11DomainShader*>					domain_shaders;
-std::unordered_map<u64, id::id_type>				ds_map;
-utl::vector<ID3D11GeometryShader*>					geometry_shaders;
-std::unordered_map<u64, id::id_type>				gs_map;
-utl::vector<ID3D11PixelShader*>						pixel_shaders;
-std::unordered_map<u64, id::id_type>				ps_map;
+//NOTE: lookups in these caches are lock free, so the render thread can read pipeline states every frame
+//      while loading threads add render items that create new ones.
+pipeline_state_cache<d3d11_pipeline_state>			pipeline_states;
+pipeline_state_cache<d3d11_pipeline_state>			depth_pipeline_states;	// keyed by shader pointers, not ids
+pipeline_state_cache<ID3D11VertexShader*>			vertex_shaders;
+pipeline_state_cache<ID3D11HullShader*>				hull_shaders;
+pipeline_state_cache<ID3D11DomainShader*>			domain_shaders;
+pipeline_state_cache<ID3D11GeometryShader*>			geometry_shaders;
+pipeline_state_cache<ID3D11PixelShader*>			pixel_shaders;
 
 //Maybe, just maybe, we might not even be needing this stuff
-utl::vector<ID3D11BlendState1*>						blend_states;
-std::unordered_map<u64, id::id_type>				blend_state_map;
-utl::vector<ID3D11RasterizerState2*>				rasterizer_states;
-std::unordered_map<u64, id::id_type>				rasterizer_state_map;
-utl::vector<ID3D11SamplerState*>					sampler_states;
-std::unordered_map<u64, id::id_type>				sampler_state_map;
+pipeline_state_cache<ID3D11BlendState1*>			blend_states;
+pipeline_state_cache<ID3D11RasterizerState2*>		rasterizer_states;
+pipeline_state_cache<ID3D11SamplerState*>			sampler_states;
 
-std::mutex											pso_mutex{};
+// Render items per job when gathering a frame's items.
+constexpr u32 gather_chunk_size{ 2048 };
 
+//NOTE: these buffers only grow, so gathering doesn't allocate once they fit the largest frame.
 struct {
-    utl::vector<primal::content::lod_offset>		lod_offsets;
-    utl::vector<id::id_type>						geometry_ids;
+    utl::vector<utl::vector<primal::content::lod_offset>>	lod_offsets;	// one vector per chunk
+    utl::vector<id::id_type>								geometry_ids;
+    utl::vector<u32>										chunk_offsets;	// first output index of each chunk
 } frame_cache;
 
+struct material_flags {
+    enum flags : u32 {
+        none = 0x00,
+        position_only_depth = 0x01,
+    };
+};
+
 class d3d11_material_stream
 {
 public:
@@ -113,6 +255,7 @@ public:
             sizeof(material_type::type) +								                    //material type
             sizeof(shader_flags::flags) +								                    //shader flags
             sizeof(u32) +												                    //texture count
+            sizeof(u32) +												                    //material flags
             sizeof(material_surface) +                                                      //explains it already
             sizeof(id::id_type) * shader_count +						                    //shader ids
             (sizeof(id::id_type) + sizeof(ID3D11ShaderResourceView*)) * info.texture_count  //shader views
@@ -125,6 +268,7 @@ public:
         *(material_type::type*)buffer = info.type;
         *(shader_flags::flags*)(&buffer[shader_flags_index]) = (shader_flags::flags)flags;
         *(u32*)(&buffer[texture_count_index]) = info.texture_count;
+        *(u32*)(&buffer[material_flags_index]) = 0;
         *(material_surface*)&buffer[material_surface_index] = info.surface;
 
         initialize();
@@ -155,6 +299,8 @@ public:
     [[nodiscard]] constexpr ID3D11ShaderResourceView** shader_views() const { return _shader_views; }
     [[nodiscard]] constexpr id::id_type* shader_ids() const { return _shader_ids; }
     [[nodiscard]] constexpr material_surface* surface() const { return _material_surface; }
+    [[nodiscard]] constexpr u32 flags() const { return *_material_flags; }
+    constexpr void set_flags(u32 flags) { *_material_flags = flags; }
 
 private:
     void initialize()
@@ -165,6 +311,7 @@ private:
         _type = *(material_type::type*)buffer;
         _shader_flags = *(shader_flags::flags*)(&buffer[shader_flags_index]);
         _texture_count = *(u32*)(&buffer[texture_count_index]);
+        _material_flags = (u32*)(&buffer[material_flags_index]);
         _material_surface = (material_surface*)&buffer[material_surface_index];
 
         _shader_ids = (id::id_type*)(&buffer[material_surface_index + sizeof(material_surface)]);
@@ -174,9 +321,11 @@ private:
 
     constexpr static u32	shader_flags_index{ sizeof(material_type::type) };
     constexpr static u32	texture_count_index{ shader_flags_index + sizeof(shader_flags::flags) };
-    constexpr static u32	material_surface_index{ texture_count_index + sizeof(u32) };
+    constexpr static u32	material_flags_index{ texture_count_index + sizeof(u32) };
+    constexpr static u32	material_surface_index{ material_flags_index + sizeof(u32) };
 
     u8*						    _buffer;
+    u32*						_material_flags;
     material_surface*           _material_surface;
     id::id_type*			    _texture_ids;
     ID3D11ShaderResourceView**  _shader_views;
@@ -203,6 +352,23 @@ get_d3d_primitive_topology(primitive_topology::type topology)
     return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
 }
 
+u32
+get_vertex_pool(u32 element_size)
+{
+    const u32 count{ (u32)vertex_pool_element_sizes.size() };
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        if (vertex_pool_element_sizes[i] == element_size) return i;
+    }
+
+    constexpr u32 initial_vertex_capacity{ 64 * 1024 };
+    const u32 strides[]{ sizeof(math::v3), element_size };
+    vertex_pools.emplace_back();
+    vertex_pools.back().initialize(&strides[0], element_size ? 2 : 1, false, initial_vertex_capacity);
+    vertex_pool_element_sizes.emplace_back(element_size);
+    return count;
+}
+
 #pragma intrinsic(_BitScanForward)
 shader_type::type
 get_shader_type(u32 flag)
@@ -247,128 +413,93 @@ create_pso(id::id_type material_id, u32 elements_type)
 
     if (shaders[shader_type::vertex].code)
     {
-        shader_bytecode& bytecode{ shaders[shader_type::vertex] };
-
-        auto pair = vs_map.find(bytecode.hash);
-
-        if (pair != vs_map.end())
-        {
-            assert(pair->first == bytecode.hash);
-            storage.vs_id = pair->second;
-        }
-        else
-        {
+        const shader_bytecode& bytecode{ shaders[shader_type::vertex] };
+        storage.vs_id = vertex_shaders.get_or_create(bytecode.hash, [&]() {
             ID3D11VertexShader* vs{ nullptr };
             DXCall(device->CreateVertexShader(bytecode.code, bytecode.size, nullptr, &vs));
-
-            storage.vs_id = (id::id_type)vertex_shaders.size();
-            vs_map[bytecode.hash] = storage.vs_id;
-            vertex_shaders.emplace_back(vs);
-        }
+            return vs;
+            });
     }
 
     if (shaders[shader_type::hull].code)
     {
-        shader_bytecode& bytecode{ shaders[shader_type::hull] };
-
-        auto pair = hs_map.find(bytecode.hash);
-
-        if (pair != hs_map.end())
-        {
-            assert(pair->first == bytecode.hash);
-            storage.hs_id = pair->second;
-        }
-        else
-        {
+        const shader_bytecode& bytecode{ shaders[shader_type::hull] };
+        storage.hs_id = hull_shaders.get_or_create(bytecode.hash, [&]() {
             ID3D11HullShader* hs{ nullptr };
             DXCall(device->CreateHullShader(bytecode.code, bytecode.size, nullptr, &hs));
-
-            storage.hs_id = (id::id_type)hull_shaders.size();
-            hs_map[bytecode.hash] = storage.hs_id;
-            hull_shaders.emplace_back(hs);
-        }
+            return hs;
+            });
     }
 
     if (shaders[shader_type::domain].code)
     {
-        shader_bytecode& bytecode{ shaders[shader_type::domain] };
-
-        auto pair = ds_map.find(bytecode.hash);
-
-        if (pair != ds_map.end())
-        {
-            assert(pair->first == bytecode.hash);
-            storage.ds_id = pair->second;
-        }
-        else
-        {
+        const shader_bytecode& bytecode{ shaders[shader_type::domain] };
+        storage.ds_id = domain_shaders.get_or_create(bytecode.hash, [&]() {
             ID3D11DomainShader* ds{ nullptr };
             DXCall(device->CreateDomainShader(bytecode.code, bytecode.size, nullptr, &ds));
-
-            storage.ds_id = (id::id_type)domain_shaders.size();
-            ds_map[bytecode.hash] = storage.ds_id;
-            domain_shaders.emplace_back(ds);
-        }
+            return ds;
+            });
     }
 
     if (shaders[shader_type::geometry].code)
     {
-        shader_bytecode& bytecode{ shaders[shader_type::geometry] };
-
-        auto pair = gs_map.find(bytecode.hash);
-
-        if (pair != gs_map.end())
-        {
-            assert(pair->first == bytecode.hash);
-            storage.gs_id = pair->second;
-        }
-        else
-        {
+        const shader_bytecode& bytecode{ shaders[shader_type::geometry] };
+        storage.gs_id = geometry_shaders.get_or_create(bytecode.hash, [&]() {
             ID3D11GeometryShader* gs{ nullptr };
             DXCall(device->CreateGeometryShader(bytecode.code, bytecode.size, nullptr, &gs));
-
-            storage.gs_id = (id::id_type)geometry_shaders.size();
-            gs_map[bytecode.hash] = storage.gs_id;
-            geometry_shaders.emplace_back(gs);
-        }
+            return gs;
+            });
     }
 
     if (shaders[shader_type::pixel].code)
     {
-        shader_bytecode& bytecode{ shaders[shader_type::pixel] };
-
-        auto pair = ps_map.find(bytecode.hash);
-
-        if (pair != ps_map.end())
-        {
-            assert(pair->first == bytecode.hash);
-            storage.ps_id = pair->second;
-        }
-        else
-        {
+        const shader_bytecode& bytecode{ shaders[shader_type::pixel] };
+        storage.ps_id = pixel_shaders.get_or_create(bytecode.hash, [&]() {
             ID3D11PixelShader* ps{ nullptr };
             DXCall(device->CreatePixelShader(bytecode.code, bytecode.size, nullptr, &ps));
-
-            storage.ps_id = (id::id_type)pixel_shaders.size();
-            ps_map[bytecode.hash] = storage.ps_id;
-            pixel_shaders.emplace_back(ps);
-        }
+            return ps;
+            });
     }
 
-    d3d11_pipeline_state pso{};
-    if (id::is_valid(storage.vs_id)) pso.vs = vertex_shaders[storage.vs_id];
-    if (id::is_valid(storage.hs_id)) pso.hs = hull_shaders[storage.hs_id];
-    if (id::is_valid(storage.ds_id)) pso.ds = domain_shaders[storage.ds_id];
-    if (id::is_valid(storage.gs_id)) pso.gs = geometry_shaders[storage.gs_id];
-    if (id::is_valid(storage.ps_id)) pso.ps = pixel_shaders[storage.ps_id];
+    //NOTE: render items that use the same shaders share one pipeline state.
+    const u64 key{ math::calc_crc32_u64((const u8*)&storage, sizeof(storage)) };
+    return pipeline_states.get_or_create(key, [&]() {
+        d3d11_pipeline_state pso{};
+        if (id::is_valid(storage.vs_id)) pso.vs = vertex_shaders[storage.vs_id];
+        if (id::is_valid(storage.hs_id)) pso.hs = hull_shaders[storage.hs_id];
+        if (id::is_valid(storage.ds_id)) pso.ds = domain_shaders[storage.ds_id];
+        if (id::is_valid(storage.gs_id)) pso.gs = geometry_shaders[storage.gs_id];
+        if (id::is_valid(storage.ps_id)) pso.ps = pixel_shaders[storage.ps_id];
+        return pso;
+        });
+}
 
-    pso_storages.emplace_back(storage);
-  
-    const u32 id{ (u32)pipeline_states.size() };
-    
-    pipeline_states.emplace_back(pso);
+//NOTE: the depth prepass doesn't need a pixel shader, so materials keep their shaders, minus the pixel shader.
+//      Opaque materials that opted in with material::use_position_only_depth() and have no hull, domain or
+//      geometry shaders use the engine's position only vertex shader instead, whatever their own vertex shader
+//      reads. They all share that pipeline state. It isn't the default, because a vertex shader that moves its
+//      vertices (skinning, wind, displacement) would write depth that doesn't match the main pass.
+id::id_type
+create_depth_pso(id::id_type material_id, id::id_type pso_id)
+{
+    const d3d11_material_stream material{ materials[material_id].get() };
+    const d3d11_pipeline_state& pso{ pipeline_states[pso_id] };
 
-    return id;
+    d3d11_pipeline_state depth_pso{};
+    if ((material.flags() & material_flags::position_only_depth) &&
+        material.material_type() == material_type::opaque && !pso.hs && !pso.ds && !pso.gs)
+    {
+        depth_pso.vs = (ID3D11VertexShader*)shaders::get_engine_shader(shaders::engine_shader::depth_only_vs);
+        assert(depth_pso.vs);
+    }
+    else
+    {
+        depth_pso = pso;
+        depth_pso.ps = nullptr;
+    }
+
+    const u64 key{ math::calc_crc32_u64((const u8*)&depth_pso, sizeof(depth_pso)) };
+    return depth_pipeline_states.get_or_create(key, [&]() { return depth_pso; });
 }
 
 d3d11_texture
@@ -504,27 +635,53 @@ initialize()
 void
 shutdown()
 {
-    for (auto& shader : vertex_shaders) core::release(shader);
-    for (auto& shader : hull_shaders) core::release(shader);
-    for (auto& shader : domain_shaders) core::release(shader);
-    for (auto& shader : geometry_shaders) core::release(shader);
-    for (auto& shader : pixel_shaders) core::release(shader);
+    for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+    {
+        render_item::process_deferred_removals(i);
+    }
 
-    vs_map.clear();
-    hs_map.clear();
-    ds_map.clear();
-    gs_map.clear();
-    ps_map.clear();
-    pso_storages.clear();
-    pipeline_states.clear();
+    const auto release{ [](auto& state) { core::release(state); } };
+    vertex_shaders.clear(release);
+    hull_shaders.clear(release);
+    domain_shaders.clear(release);
+    geometry_shaders.clear(release);
+    pixel_shaders.clear(release);
+    blend_states.clear(release);
+    rasterizer_states.clear(release);
+    sampler_states.clear(release);
+    pipeline_states.clear([](d3d11_pipeline_state&) {});
+    depth_pipeline_states.clear([](d3d11_pipeline_state&) {});
 
     assert(submesh_views.empty());
+    for (auto& pool : vertex_pools) pool.release();
+    vertex_pools.clear();
+    vertex_pool_element_sizes.clear();
+    index_pool.release();
+}
+
+void
+reclaim()
+{
+    vertex_shaders.reclaim();
+    hull_shaders.reclaim();
+    domain_shaders.reclaim();
+    geometry_shaders.reclaim();
+    pixel_shaders.reclaim();
+    blend_states.reclaim();
+    rasterizer_states.reclaim();
+    sampler_states.reclaim();
+    pipeline_states.reclaim();
+    depth_pipeline_states.reclaim();
 }
 
 namespace submesh {
+//NOTE: submeshes live in shared vertex and index pools. Loading threads can't use the immediate context,
+//      so the data is packed into system memory and the render thread writes it into the pool ranges
+//      with UpdateSubresource when the next frame starts. That's the only upload.
 id::id_type
 add(const u8*& data)
 {
+    const auto start{ std::chrono::steady_clock::now() };
     utl::blob_stream_reader blob((const u8*)data);
 
     const u32 element_size{ blob.read<u32>() };
@@ -542,103 +699,87 @@ add(const u8*& data)
     const u32 aligned_position_buffer_size{ (u32)math::align_size_up<alignment>(position_buffer_size) };
     const u32 aligned_element_buffer_size{ (u32)math::align_size_up<alignment>(element_buffer_size) };
 
-    submesh_view view{};
-    auto* const device{ core::device() };
+    pending_submesh pending{};
+    pending.data = std::make_unique<u8[]>(position_buffer_size + element_buffer_size + index_buffer_size);
+    u8* const packed{ pending.data.get() };
+    memcpy(packed, blob.position(), position_buffer_size);
+    blob.skip(aligned_position_buffer_size);
+    if (element_size) memcpy(&packed[position_buffer_size], blob.position(), element_buffer_size);
+    blob.skip(aligned_element_buffer_size);
+    memcpy(&packed[position_buffer_size + element_buffer_size], blob.position(), index_buffer_size);
+    blob.skip(index_buffer_size);
 
+    submesh_view view{};
     view.index_format = (index_size == sizeof(u16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     view.index_count = index_count;
     view.elements_type = elements_type;
     view.primitive_topology = get_d3d_primitive_topology((primitive_topology::type)primitive_topology);
 
-    {
-        D3D11_BUFFER_DESC desc{};
-        desc.ByteWidth = aligned_position_buffer_size;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        desc.StructureByteStride = sizeof(math::v3);
-        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-
-        std::unique_ptr<u8[]> pos_buffer = std::make_unique<u8[]>(aligned_position_buffer_size);
-
-        D3D11_SUBRESOURCE_DATA srd{};
-        srd.pSysMem = pos_buffer.get();
-        blob.read((u8*)srd.pSysMem, aligned_position_buffer_size);
-        srd.SysMemPitch = aligned_position_buffer_size;
-
-        DXCall(device->CreateBuffer(&desc, &srd, &view.position_buffer));
-
-        assert(view.position_buffer);
-        if (!view.position_buffer) return id::invalid_id;
-
-        D3D11_SHADER_RESOURCE_VIEW_DESC srvdesc{};
-        srvdesc.Format = DXGI_FORMAT_UNKNOWN;
-        srvdesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-        srvdesc.Buffer.FirstElement = 0;
-        srvdesc.Buffer.NumElements = vertex_count;
+    const u32 total_buffer_size{ position_buffer_size + element_buffer_size + index_buffer_size };
+    thread_stats.bytes_uploaded += total_buffer_size;
+    thread_stats.load_time_ms += std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++thread_stats.submesh_count;
 
-        core::device()->CreateShaderResourceView(view.position_buffer, &srvdesc, &view.position_view);
-    }
+    std::lock_guard lock{ submesh_mutex };
+    if (vertex_pools.empty())
     {
-        D3D11_BUFFER_DESC desc{};
-        desc.ByteWidth = aligned_element_buffer_size;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        desc.StructureByteStride = element_size;
-        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-
-        std::unique_ptr<u8[]> element_buffer = std::make_unique<u8[]>(aligned_element_buffer_size);
-
-        D3D11_SUBRESOURCE_DATA srd{};
-        srd.pSysMem = element_buffer.get();
-        blob.read((u8*)srd.pSysMem, aligned_element_buffer_size);
-        srd.SysMemPitch = aligned_element_buffer_size;
+        constexpr u32 initial_index_capacity{ 4 * 1024 * 1024 };
+        const u32 index_stride{ 1 };
+        index_pool.initialize(&index_stride, 1, true, initial_index_capacity);
+    }
 
-        DXCall(device->CreateBuffer(&desc, &srd, &view.element_buffer));
+    view.vertex_pool_index = get_vertex_pool(element_size);
+    view.vertex_range = vertex_pools[view.vertex_pool_index].allocate(vertex_count, 1);
+    // NOTE: index ranges are aligned to 4 bytes, so their offset divides evenly by the size of both index formats.
+    view.index_range = index_pool.allocate(index_buffer_size, sizeof(u32));
 
-        assert(view.element_buffer);
-        if (!view.element_buffer) return id::invalid_id;
+    pending.submesh_id = submesh_views.add(view);
+    const id::id_type submesh_id{ pending.submesh_id };
+    pending_submeshes.emplace_back(std::move(pending));
+    return submesh_id;
+}
 
-        D3D11_SHADER_RESOURCE_VIEW_DESC srvdesc{};
-        srvdesc.Format = DXGI_FORMAT_UNKNOWN;
-        srvdesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-        srvdesc.Buffer.FirstElement = 0;
-        srvdesc.Buffer.NumElements = vertex_count;
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ submesh_mutex };
+    submesh_view& view{ submesh_views[id] };
 
-        core::device()->CreateShaderResourceView(view.element_buffer, &srvdesc, &view.element_view);
-    }
+    const u32 pending_count{ (u32)pending_submeshes.size() };
+    for (u32 i{ 0 }; i < pending_count; ++i)
     {
-        D3D11_BUFFER_DESC desc{};
-        desc.ByteWidth = index_buffer_size;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-        std::unique_ptr<u8[]> ind_buffer = std::make_unique<u8[]>(index_buffer_size);
+        pending_submesh& pending{ pending_submeshes[i] };
+        if (pending.submesh_id != id) continue;
 
-        D3D11_SUBRESOURCE_DATA srd{};
-        srd.pSysMem = ind_buffer.get();
-        blob.read((u8*)srd.pSysMem, index_buffer_size);
-        srd.SysMemPitch = index_buffer_size;
-
-        DXCall(device->CreateBuffer(&desc, &srd, &view.index_buffer));
+        pending_submeshes.erase(pending_submeshes.begin() + i);
+        break;
     }
 
-    std::lock_guard lock{ submesh_mutex };
-    return submesh_views.add(view);
+    //NOTE: frames in flight are done with this range by the time it's reused, because the
+    //      copies that overwrite it are recorded after them.
+    vertex_pools[view.vertex_pool_index].free(view.vertex_range);
+    index_pool.free(view.index_range);
+
+    submesh_views.remove(id);
 }
 
 void
-remove(id::id_type id)
+flush_uploads(ID3D11DeviceContext4* const ctx)
 {
     std::lock_guard lock{ submesh_mutex };
-    submesh_view& view{ submesh_views[id] };
+    if (vertex_pools.empty()) return;
 
-    core::deferred_release(view.position_buffer);
-    core::deferred_release(view.element_buffer);
-    core::deferred_release(view.index_buffer);
-    core::deferred_release(view.position_view);
-    core::deferred_release(view.element_view);
+    for (auto& pool : vertex_pools) pool.update(ctx);
+    index_pool.update(ctx);
 
-    submesh_views.remove(id);
+    for (pending_submesh& pending : pending_submeshes)
+    {
+        const submesh_view& view{ submesh_views[pending.submesh_id] };
+        const u8* const indices{ vertex_pools[view.vertex_pool_index].upload(ctx, view.vertex_range, pending.data.get()) };
+        index_pool.upload(ctx, view.index_range, indices);
+    }
+
+    pending_submeshes.clear();
 }
 
 void
@@ -652,15 +793,36 @@ get_views(const id::id_type* const gpu_ids, u32 id_count, const views_cache& cac
     for (u32 i{ 0 }; i < id_count; ++i)
     {
         const submesh_view& view{ submesh_views[gpu_ids[i]] };
-        cache.index_buffers[i] = view.index_buffer;
+        const d3d11_geometry_pool& pool{ vertex_pools[view.vertex_pool_index] };
+        cache.index_buffers[i] = index_pool.buffer(0);
         cache.index_formats[i] = view.index_format;
-        cache.position_views[i] = view.position_view;
-        cache.element_views[i] = view.element_view;
+        cache.position_views[i] = pool.view(0);
+        cache.element_views[i] = pool.stream_count() > 1 ? pool.view(1) : nullptr;
         cache.primitive_topologies[i] = view.primitive_topology;
         cache.elements_types[i] = view.elements_type;
-        cache.index_counts[i] = view.index_count;
+
+        // Submeshes added after this frame's uploads were flushed are drawn from the next frame on.
+        if (pool.is_resident(view.vertex_range) && index_pool.is_resident(view.index_range))
+        {
+            cache.index_counts[i] = view.index_count;
+            cache.start_index_locations[i] = index_pool.offset(view.index_range) /
+                (view.index_format == DXGI_FORMAT_R16_UINT ? sizeof(u16) : sizeof(u32));
+            cache.base_vertex_locations[i] = pool.offset(view.vertex_range);
+        }
+        else
+        {
+            cache.index_counts[i] = 0;
+            cache.start_index_locations[i] = 0;
+            cache.base_vertex_locations[i] = 0;
+        }
     }
 }
+
+const load_stats&
+thread_load_stats()
+{
+    return thread_stats;
+}
 }//submesh namespace
 
 namespace texture {
@@ -712,6 +874,14 @@ add(material_init_info info)
     return materials.add(std::move(buffer));
 }
 
+void
+use_position_only_depth(id::id_type id)
+{
+    std::lock_guard lock{ material_mutex };
+    d3d11_material_stream stream{ materials[id].get() };
+    stream.set_flags(stream.flags() | material_flags::position_only_depth);
+}
+
 void
 remove(id::id_type id)
 {
@@ -767,7 +937,7 @@ add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count,
     if (!gpu_ids)
         return id::invalid_id;
 
-    std::unique_ptr<id::id_type[]> items{ std::make_unique<id::id_type[]>(sizeof(id::id_type) * (1 + (u64)material_count + 1)) };
+    id::id_type* const items{ new id::id_type[1 + (u64)material_count + 1] };
 
     items[0] = geometry_content_id;
     id::id_type* const items_ids{ &items[1] };
@@ -781,6 +951,7 @@ add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count,
         item.submesh_gpu_id = gpu_ids[i];
         item.material_id = material_ids[i];
         item.pso_id = create_pso(material_ids[i], views_cache.elements_types[i]);
+        item.depth_pso_id = create_depth_pso(material_ids[i], item.pso_id);
 
         assert(id::is_valid(item.submesh_gpu_id) && id::is_valid(item.material_id));
         items_ids[i] = render_items.add(item);
@@ -788,21 +959,37 @@ add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count,
 
     items_ids[material_count] = id::invalid_id;
 
-    return render_item_ids.add(std::move(items));
+    return render_item_ids.add(items);
 }
 
 void
 remove(id::id_type id)
 {
+    const u32 frame_idx{ core::current_frame_index() };
     std::lock_guard lock{ render_item_mutex };
-    const id::id_type* const item_ids{ &render_item_ids[id][1] };
+    assert(render_item_ids[id]);
+    removed_render_items[frame_idx].emplace_back(id);
+}
 
-    for (u32 i{ 0 }; item_ids[i] != id::invalid_id; ++i)
+void
+process_deferred_removals(u32 frame_idx)
+{
+    std::lock_guard lock{ render_item_mutex };
+    for (id::id_type id : removed_render_items[frame_idx])
     {
-        render_items.remove(item_ids[i]);
+        id::id_type* const items{ render_item_ids[id] };
+        const id::id_type* const item_ids{ &items[1] };
+
+        for (u32 i{ 0 }; item_ids[i] != id::invalid_id; ++i)
+        {
+            render_items.remove(item_ids[i]);
+        }
+
+        render_item_ids.remove(id);
+        delete[] items;
     }
 
-    render_item_ids.remove(id);
+    removed_render_items[frame_idx].clear();
 }
 
 void
@@ -811,41 +998,58 @@ get_d3d11_render_item_ids(const frame_info& info, utl::vector<id::id_type>& d3d1
     assert(info.render_item_ids && info.thresholds && info.render_item_count);
     assert(d3d11_render_item_ids.empty());
 
-    frame_cache.lod_offsets.clear();
-    frame_cache.geometry_ids.clear();
     const u32 count(info.render_item_count);
+    const u32 chunk_count{ jobs::chunk_count(count, gather_chunk_size) };
+    frame_cache.geometry_ids.resize(count);
+    frame_cache.chunk_offsets.resize(chunk_count + 1);
+    if (frame_cache.lod_offsets.size() < chunk_count) frame_cache.lod_offsets.resize(chunk_count);
 
-    std::lock_guard lock{ render_item_mutex };
+    //NOTE: no lock. The ids in info must stay alive until the frame is rendered.
 
-    for (u32 i{ 0 }; i < count; ++i)
-    {
-        const id::id_type* const buffer{ render_item_ids[info.render_item_ids[i]].get() };
-        frame_cache.geometry_ids.emplace_back(buffer[0]);
-    }
+    // Select LODs and count the resulting items of each chunk.
+    jobs::parallel_for(count, gather_chunk_size, [&info](u32 chunk, u32 begin, u32 end) {
+        for (u32 i{ begin }; i < end; ++i)
+        {
+            frame_cache.geometry_ids[i] = render_item_ids[info.render_item_ids[i]][0];
+        }
 
-    primal::content::get_lod_offsets(frame_cache.geometry_ids.data(), info.thresholds, count, frame_cache.lod_offsets);
-    assert(frame_cache.lod_offsets.size() == count);
+        utl::vector<primal::content::lod_offset>& lod_offsets{ frame_cache.lod_offsets[chunk] };
+        lod_offsets.clear();
+        primal::content::get_lod_offsets(&frame_cache.geometry_ids[begin], &info.thresholds[begin], end - begin, lod_offsets);
+        assert(lod_offsets.size() == end - begin);
 
-    u32 d3d11_render_item_count{ 0 };
-    for (u32 i{ 0 }; i < count; ++i)
+        u32 item_count{ 0 };
+        for (const primal::content::lod_offset& lod_offset : lod_offsets) item_count += lod_offset.count;
+        frame_cache.chunk_offsets[chunk + 1] = item_count;
+        });
+
+    // Prefix sum of the chunk counts. The per-item part of the scan runs in the jobs, so only one
+    // value per chunk is left to add up here.
+    frame_cache.chunk_offsets[0] = 0;
+    for (u32 i{ 0 }; i < chunk_count; ++i)
     {
-        d3d11_render_item_count += frame_cache.lod_offsets[i].count;
+        frame_cache.chunk_offsets[i + 1] += frame_cache.chunk_offsets[i];
     }
 
+    const u32 d3d11_render_item_count{ frame_cache.chunk_offsets[chunk_count] };
     assert(d3d11_render_item_count);
     d3d11_render_item_ids.resize(d3d11_render_item_count);
 
-    u32 item_index{ 0 };
-    for (u32 i{ 0 }; i < count; ++i)
-    {
-        const id::id_type* const item_ids{ &render_item_ids[info.render_item_ids[i]][1] };
-        const primal::content::lod_offset& lod_offset{ frame_cache.lod_offsets[i] };
-        memcpy(&d3d11_render_item_ids[item_index], &item_ids[lod_offset.offset], sizeof(id::id_type) * lod_offset.count);
-        item_index += lod_offset.count;
-        assert(item_index <= d3d11_render_item_count);
-    }
+    // Each chunk writes its items from its own offset in the output.
+    id::id_type* const output{ d3d11_render_item_ids.data() };
+    jobs::parallel_for(count, gather_chunk_size, [&info, output](u32 chunk, u32 begin, u32 end) {
+        const utl::vector<primal::content::lod_offset>& lod_offsets{ frame_cache.lod_offsets[chunk] };
+        u32 item_index{ frame_cache.chunk_offsets[chunk] };
+        for (u32 i{ begin }; i < end; ++i)
+        {
+            const id::id_type* const item_ids{ &render_item_ids[info.render_item_ids[i]][1] };
+            const primal::content::lod_offset& lod_offset{ lod_offsets[i - begin] };
+            memcpy(&output[item_index], &item_ids[lod_offset.offset], sizeof(id::id_type) * lod_offset.count);
+            item_index += lod_offset.count;
+        }
 
-    assert(item_index <= d3d11_render_item_count);
+        assert(item_index == frame_cache.chunk_offsets[chunk + 1]);
+        });
 }
 
 void
@@ -853,10 +1057,7 @@ get_items(const id::id_type* const d3d11_render_item_ids, u32 id_count, const it
 {
     assert(d3d11_render_item_ids && id_count);
     assert(cache.entity_ids && cache.submesh_gpu_ids && cache.material_ids &&
-        cache.psos);
-
-    std::lock_guard lock1{ render_item_mutex };
-    std::lock_guard lock2{ pso_mutex };
+        cache.psos && cache.pso_ids && cache.depth_psos && cache.depth_pso_ids);
 
     for (u32 i{ 0 }; i < id_count; ++i)
     {
@@ -865,6 +1066,9 @@ get_items(const id::id_type* const d3d11_render_item_ids, u32 id_count, const it
         cache.submesh_gpu_ids[i] = item.submesh_gpu_id;
         cache.material_ids[i] = item.material_id;
         cache.psos[i] = pipeline_states[item.pso_id];
+        cache.pso_ids[i] = item.pso_id;
+        cache.depth_psos[i] = depth_pipeline_states[item.depth_pso_id];
+        cache.depth_pso_ids[i] = item.depth_pso_id;
     }
 }
 }//render_item namespace
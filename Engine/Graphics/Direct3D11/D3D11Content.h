@@ -6,6 +6,8 @@
 namespace primal::graphics::d3d11::content {
 bool initialize();
 void shutdown();
+// Frees what the pipeline state caches left behind when they grew. Called once per frame by the renderer.
+void reclaim();
 
 namespace submesh {
 struct views_cache
@@ -17,11 +19,25 @@ struct views_cache
     DXGI_FORMAT* const								index_formats{};
     u32* const										elements_types{};
     u32* const										index_counts;
+    u32* const										start_index_locations;
+    u32* const										base_vertex_locations;
+};
+
+struct load_stats
+{
+    u64												bytes_uploaded;		// bytes read from the geometry blobs
+    u64												bytes_copied;		// bytes copied by the engine before handing them to the driver
+    f32												load_time_ms;
+    u32												submesh_count;
 };
 
 id::id_type add(const u8*& data);
 void remove(id::id_type id);
+// Copies the submeshes added since the last call into the geometry pools. Call before gathering views for a frame.
+void flush_uploads(ID3D11DeviceContext4* const ctx);
 void get_views(const id::id_type* const gpu_ids, u32 id_count, const views_cache& cache);
+// Stats of the submeshes added on the calling thread since it started.
+const load_stats& thread_load_stats();
 }//namespace submesh
 
 namespace texture {
@@ -36,6 +52,9 @@ struct materials_cache
 };
 
 id::id_type add(material_init_info info);
+// Lets the depth prepass draw the material with the engine's position only vertex shader. Only for materials whose
+// vertex shader places vertices with the world view projection alone. Render items added afterwards pick it up.
+void use_position_only_depth(id::id_type id);
 void remove(id::id_type id);
 void get_materials(const id::id_type* const material_ids, u32 material_count, const materials_cache& cache);
 }//namespace material
@@ -46,9 +65,15 @@ struct items_cache {
     id::id_type* const					submesh_gpu_ids;
     id::id_type* const					material_ids;
     d3d11_pipeline_state* const			psos;
+    u32* const							pso_ids;
+    d3d11_pipeline_state* const			depth_psos;			// for the depth prepass, without pixel shaders
+    u32* const							depth_pso_ids;
 };
 id::id_type add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids);
+// The item is only freed by process_deferred_removals() once the frames that may still gather it are done.
 void remove(id::id_type id);
+// Frees the items removed while frame_idx was the current frame. Call after that frame's fence wait.
+void process_deferred_removals(u32 frame_idx);
 void get_d3d11_render_item_ids(const frame_info& info, utl::vector<id::id_type>& d3d11_render_item_ids);
 void get_items(const id::id_type* const d3d11_render_item_ids, u32 id_count, const items_cache& cache);
 }//namespace render_item
@@ -7,6 +7,7 @@
 #include "D3D11Content.h"
 #include "D3D11Light.h"
 #include "D3D11LightCulling.h"
+#include "D3D11HiZ.h"
 #include "Shaders/SharedTypes.h"
 
 #include <thread>
@@ -53,14 +54,16 @@ public:
         core::release(_cmd_list);
     }
 
-    void end_frame(const d3d11_surface& surface, ID3D11DeviceContext4* imm_ctx)
+    //NOTE: the swap chains of the frame's surfaces are presented between submit() and end_frame().
+    void submit(ID3D11DeviceContext4* imm_ctx)
     {
         _context->FinishCommandList(FALSE, &_cmd_list);
         assert(_cmd_list);
         imm_ctx->ExecuteCommandList(_cmd_list, FALSE);
+    }
 
-        surface.present();
-
+    void end_frame(ID3D11DeviceContext4* imm_ctx)
+    {
         u64& fence_value{ _fence_value };
         ++fence_value;
         command_frame& frame{ _cmd_frames[_frame_index] };
@@ -235,6 +238,30 @@ get_d3d11_frame_info(const frame_info& info, const d3d11_surface& surface,
 
     return d3d11_info;
 }
+
+// The passes of one view. They're recorded after the views before it in the same command list.
+void
+render_view(ID3D11DeviceContext4* const ctx, const d3d11_surface& surface, const d3d11_frame_info& d3d11_info)
+{
+    ctx->RSSetViewports(1, &surface.viewport());
+    ctx->RSSetScissorRects(1, &surface.scissor_rect());
+
+    //Depth Pre-Pass
+    gpass::set_render_targets_for_depth_prepass(ctx);
+    gpass::depth_prepass(ctx, d3d11_info);
+    hiz::build(ctx, d3d11_info);
+
+    //Lighting Pass
+    light::set_frame_light_set(d3d11_info.info->light_set_key, d3d11_info.frame_index);
+    lightculling::cull_lights(ctx, d3d11_info);
+
+    //Render Pass
+    gpass::set_render_targets_for_gpass(ctx);
+    gpass::render(ctx, d3d11_info);
+
+    //Post-process Pass
+    fx::post_process(ctx, d3d11_info, surface.rtv());
+}
 }//anonymous namespace
 namespace detail {
 void
@@ -321,6 +348,7 @@ initialize()
     if (!(shaders::initialize() &&
         gpass::initialize() &&
         fx::initialize() &&
+        hiz::initialize() &&
         lightculling::initialize() &&
         content::initialize()))
         return failed_init();
@@ -346,6 +374,7 @@ shutdown()
 
     content::shutdown();
     lightculling::shutdown();
+    hiz::shutdown();
     fx::shutdown();
     gpass::shutdown();
     shaders::shutdown();
@@ -450,6 +479,13 @@ surface_height(surface_id id)
 void
 render_surface(surface_id id, frame_info info)
 {
+    render_surfaces(&id, &info, 1);
+}
+
+void
+render_surfaces(const surface_id* const ids, const frame_info* const infos, u32 count)
+{
+    assert(ids && infos && count);
     gfx_command.begin_frame();
 
     ID3D11DeviceContext4* ctx{ gfx_command.context() };
@@ -464,31 +500,47 @@ render_surface(surface_id id, frame_info info)
         process_deferred_releases(frame_idx);
     }
 
-    d3d11_surface& surface{ surfaces[id] };
-    d3d11_frame_info d3d11_info{ get_d3d11_frame_info(info, surface, frame_idx, 16.7f) };//TODO dt?!?!
-    gpass::set_size({ d3d11_info.surface_width, d3d11_info.surface_height });
-
-    ctx->RSSetViewports(1, &surface.viewport());
-    ctx->RSSetScissorRects(1, &surface.scissor_rect());
-
-    //Depth Pre-Pass
-    gpass::set_render_targets_for_depth_prepass(ctx);
-    gpass::depth_prepass(ctx, d3d11_info);
+    //NOTE: the previous frame's gather is done by now, so this is the quietest point to free old cache tables.
+    content::reclaim();
+    content::render_item::process_deferred_removals(frame_idx);
+    content::submesh::flush_uploads(ctx);
 
-    //Lighting Pass
-    //std::thread t = std::thread{ light::update_light_buffers, d3d11_info, ctx };
-    light::update_light_buffers(d3d11_info, ctx);
-    //t.join();
-    lightculling::cull_lights(ctx, d3d11_info);
+    //NOTE: all views share the gpass buffers, so they're grown to fit the largest surface before any view
+    //      is recorded, instead of being recreated between views.
+    math::u32v2 size{ 0, 0 };
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const d3d11_surface& surface{ surfaces[ids[i]] };
+        size = { std::max(size.x, surface.width()), std::max(size.y, surface.height()) };
+    }
+    gpass::set_size(size);
 
-    //Render Pass
-    gpass::set_render_targets_for_gpass(ctx);
-    gpass::render(ctx, d3d11_info);
+    // Each light set is uploaded once per frame, however many views use it.
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const u64 light_set_key{ infos[i].light_set_key };
+        u32 first{ 0 };
+        while (infos[first].light_set_key != light_set_key) ++first;
+        if (first == i) light::update_light_buffers(light_set_key, frame_idx, ctx);
+    }
 
-    //Post-process Pass
-    fx::post_process(ctx, d3d11_info, surface.rtv());
+    //NOTE: views are prepared and recorded one after another. They share the gpass cache, the instance buffers,
+    //      the render targets and the constant buffer, and D3D11 records everything through one context.
+    //      The heavy parts of each view (gather, culling, transforms) run on the job system inside the passes.
+    gpass::begin_frame();
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const d3d11_surface& surface{ surfaces[ids[i]] };
+        const d3d11_frame_info d3d11_info{ get_d3d11_frame_info(infos[i], surface, frame_idx, infos[i].average_frame_time) };
+        render_view(ctx, surface, d3d11_info);
+    }
 
-    gfx_command.end_frame(surface, context);
+    gfx_command.submit(context);
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        surfaces[ids[i]].present();
+    }
+    gfx_command.end_frame(context);
 }
 }
 
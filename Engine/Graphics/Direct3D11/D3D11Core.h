@@ -14,7 +14,7 @@ struct d3d11_frame_info
     u32								surface_height{ 0 };
     id::id_type						light_culling_id{ id::invalid_id };
     u32								frame_index{ 0 };
-    f32								delta_time{ 16.7f };
+    f32								delta_time{ 1.f / 60.f };	// seconds
 };
 }
 
@@ -58,6 +58,12 @@ void resize_surface(surface_id id, u32, u32);
 _NODISCARD u32 surface_width(surface_id id);
 _NODISCARD u32 surface_height(surface_id id);
 void render_surface(surface_id id, frame_info info);
+//NOTE: renders several surfaces as one frame. The work all views share, like uploads, light buffers and
+//      the item gather, is done once. Views that pass the same render item and threshold arrays also share
+//      their LOD selection and entity transforms. Culling and the passes run for each view.
+//      render_surface() renders through it with one view. The platform interface has no entry for more
+//      views yet, so applications don't call it directly.
+void render_surfaces(const surface_id* const ids, const frame_info* const infos, u32 count);
 }
 
 #endif
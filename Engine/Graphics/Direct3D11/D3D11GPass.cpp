@@ -6,6 +6,9 @@
 #include "D3D11Light.h"
 #include "D3D11LightCulling.h"
 #include "Shaders/SharedTypes.h"
+#include "Graphics/DrawKeys.h"
+#include "Graphics/FrameArena.h"
+#include "Utilities/JobSystem.h"
 #include "Components/Entity.h"
 #include "Components/Transform.h"
 
@@ -37,36 +40,72 @@ constexpr f32						clear_value[4]{ 0.f, 0.f, 0.f, 1.f };
 #define CONSTEXPR constexpr
 #endif
 
+//NOTE: a run of items with the same submesh, pipeline state and material in draw key order. It's drawn with
+//      one instanced draw. Instances are written in draw order, so a batch's instances start at its first item.
+struct draw_batch
+{
+    u32								first;						// position of the first item in draw_order
+    u32								instance_count;
+    u32								per_draw_data_offset;
+};
+
 struct gpass_cache
 {
     utl::vector<id::id_type>		d3d11_render_item_ids;
+    // The frame_info arrays the items were gathered from. nullptr once the frame is over.
+    const id::id_type*				gathered_item_ids{ nullptr };
+    const f32*						gathered_thresholds{ nullptr };
+    u32								gathered_item_count{ 0 };
     u32								shader_view_count{ 0 };
-
+    const u32*						draw_order{ nullptr };		// item indices sorted by draw key
+    draw_batch*						draw_batches{ nullptr };
+    u32								draw_batch_count{ 0 };
+    // Depth prepass draws of items whose depth only pipeline state is the position only vertex shader.
+    // They have their own order, which ignores materials, so more items end up in one instanced draw.
+    const u32*						depth_draw_order{ nullptr };	// item indices sorted by depth key
+    draw_batch*						depth_batches{ nullptr };		// first is a position in depth_draw_order
+    u32								depth_batch_count{ 0 };
+
+    // One per entity in the frame, in the order their items were gathered.
+    hlsl::PerInstanceData*			entity_data{ nullptr };		// transforms of each entity
+    id::id_type*					frame_entity_ids{ nullptr };
+    u32*							entity_depths{ nullptr };	// quantized view depth of each entity's origin
+    u32								entity_data_count{ 0 };
+
+    u64*							draw_keys{ nullptr };
+    u64*							depth_keys{ nullptr };
     id::id_type*					entity_ids{ nullptr };
     id::id_type*					submesh_gpu_ids{ nullptr };
     id::id_type*					material_ids{ nullptr };
     d3d11_pipeline_state*			pipeline_states{ nullptr };
+    u32*							pso_ids{ nullptr };
+    d3d11_pipeline_state*			depth_pipeline_states{ nullptr };
+    u32*							depth_pso_ids{ nullptr };
     material_type::type*			material_types{ nullptr };
     ID3D11ShaderResourceView***		shader_views{ nullptr };
     u32*							texture_counts{ nullptr };
     material_surface**				material_surfaces{ nullptr };
     D3D_PRIMITIVE_TOPOLOGY*			primitive_topologies{ nullptr };
     u32*							elements_types{ nullptr };
-    u32*							per_object_data_offsets{ nullptr };
+    u32*							entity_data_indices{ nullptr };
     ID3D11Buffer**					index_buffers{ nullptr };
     ID3D11ShaderResourceView**		position_views{ nullptr };
     ID3D11ShaderResourceView**		element_views{ nullptr };
     DXGI_FORMAT*					index_formats{ nullptr };
     u32*							index_counts{ nullptr };
+    u32*							start_index_locations{ nullptr };
+    u32*							base_vertex_locations{ nullptr };
+    u32*							instance_material_indices{ nullptr };	// by position in draw_order
 
     constexpr content::render_item::items_cache items_cache() const
     {
-        return { entity_ids, submesh_gpu_ids, material_ids, pipeline_states };
+        return { entity_ids, submesh_gpu_ids, material_ids, pipeline_states, pso_ids, depth_pipeline_states, depth_pso_ids };
     }
 
     constexpr content::submesh::views_cache views_cache() const
     {
-        return { index_buffers, position_views, element_views, primitive_topologies, index_formats, elements_types, index_counts };
+        return { index_buffers, position_views, element_views, primitive_topologies, index_formats, elements_types, index_counts,
+            start_index_locations, base_vertex_locations };
     }
 
     constexpr content::material::materials_cache materials_cache() const
@@ -82,64 +121,141 @@ struct gpass_cache
     CONSTEXPR void clear()
     {
         d3d11_render_item_ids.clear();
+        gathered_item_ids = nullptr;
     }
 
-    CONSTEXPR void resize()
+    constexpr bool is_gathered_for(const frame_info& info) const
     {
-        const u64 items_count{ d3d11_render_item_ids.size() };
-        const u64 new_buffer_size{ items_count * struct_size };
-        const u64 old_buffer_size{ _buffer.size() };
-        if (new_buffer_size > old_buffer_size)
-        {
-            _buffer.resize(new_buffer_size);
-        }
+        return gathered_item_ids && gathered_item_ids == info.render_item_ids && gathered_thresholds == info.thresholds &&
+            gathered_item_count == info.render_item_count;
+    }
 
-        if (new_buffer_size != old_buffer_size)
-        {
-            entity_ids = (id::id_type*)(_buffer.data());
-            submesh_gpu_ids = (id::id_type*)(&entity_ids[items_count]);
-            material_ids = (id::id_type*)(&submesh_gpu_ids[items_count]);
-            pipeline_states = (d3d11_pipeline_state*)(&material_ids[items_count]);
-            material_types = (material_type::type*)(&pipeline_states[items_count]);
-            shader_views = (ID3D11ShaderResourceView***)(&material_types[items_count]);
-            texture_counts = (u32*)(&shader_views[items_count]);
-            material_surfaces = (material_surface**)(&texture_counts[items_count]);
-            primitive_topologies = (D3D_PRIMITIVE_TOPOLOGY*)(&material_surfaces[items_count]);
-            elements_types = (u32*)(&primitive_topologies[items_count]);
-            per_object_data_offsets = (u32*)(&elements_types[items_count]);
-            index_buffers = (ID3D11Buffer**)(&per_object_data_offsets[items_count]);
-            position_views = (ID3D11ShaderResourceView**)(&index_buffers[items_count]);
-            element_views = (ID3D11ShaderResourceView**)(&position_views[items_count]);
-            index_formats = (DXGI_FORMAT*)(&element_views[items_count]);
-            index_counts = (u32*)(&index_formats[items_count]);
-        }
+    // Allocates the frame's item columns, instances and batches for size() items from the frame arena.
+    void resize()
+    {
+        const u32 items_count{ size() };
+        const u64 batches_size{ math::align_size_up<frame_arena::cache_line_size>((u64)items_count * sizeof(draw_batch)) };
+        _arena.reset();
+        _arena.reserve(item_columns::size_in_bytes(items_count) + entity_columns::size_in_bytes(items_count) + 2 * batches_size);
+
+        _items.allocate(_arena, items_count);
+        std::tie(draw_keys, depth_keys, entity_ids, submesh_gpu_ids, material_ids, pipeline_states, pso_ids, depth_pipeline_states,
+            depth_pso_ids, material_types, shader_views, texture_counts, material_surfaces, primitive_topologies, elements_types,
+            entity_data_indices, index_buffers, position_views, element_views, index_formats, index_counts, start_index_locations,
+            base_vertex_locations, instance_material_indices) = _items.data();
+
+        //NOTE: there's at most one entity and one batch per item.
+        _entities.allocate(_arena, items_count);
+        std::tie(entity_data, frame_entity_ids, entity_depths) = _entities.data();
+        draw_batches = _arena.allocate<draw_batch>(items_count);
+        depth_batches = _arena.allocate<draw_batch>(items_count);
+        entity_data_count = 0;
+        draw_batch_count = 0;
+        depth_batch_count = 0;
+        assert(draw_batches && depth_batches);
     }
 
 private:
-    constexpr static u32 struct_size{
-        sizeof(id::id_type) +									//entity_ids{ nullptr };
-            sizeof(id::id_type) +								//submesh_ids{ nullptr };
-            sizeof(id::id_type) +								//material_ids{ nullptr };
-            sizeof(d3d11_pipeline_state) +						//pipeline_states{ nullptr };
-            sizeof(material_type::type) +						//material_types{ nullptr };
-            sizeof(ID3D11ShaderResourceView***) +               //shader_views{ nullptr };
-            sizeof(u32*) +							            //texture_counts{ nullptr };
-            sizeof(material_surface**) +						//material_surfaces{ nullptr };
-            sizeof(D3D_PRIMITIVE_TOPOLOGY) +					//primitive_topologies{ nullptr }
-            sizeof(u32) +										//elements_types{ nullptr };
-            sizeof(u32) +										//per object data offsets{ nullptr };
-            sizeof(ID3D11Buffer*) +								//index_buffers{ nullptr };
-            sizeof(ID3D11ShaderResourceView*) +					//position_buffers{ nullptr };
-            sizeof(ID3D11ShaderResourceView*) +					//element_buffers{ nullptr };
-            sizeof(DXGI_FORMAT) +								//index_formats{ nullptr };
-            sizeof(u32)											//index_counts{ nullptr };
-    };
-
-    utl::vector<u8>					_buffer;
+    using item_columns = soa_array<u64, u64, id::id_type, id::id_type, id::id_type, d3d11_pipeline_state, u32,
+        d3d11_pipeline_state, u32, material_type::type,
+        ID3D11ShaderResourceView**, u32, material_surface*, D3D_PRIMITIVE_TOPOLOGY, u32, u32, ID3D11Buffer*,
+        ID3D11ShaderResourceView*, ID3D11ShaderResourceView*, DXGI_FORMAT, u32, u32, u32, u32>;
+    using entity_columns = soa_array<hlsl::PerInstanceData, id::id_type, u32>;
+
+    frame_arena						_arena;
+    item_columns					_items;
+    entity_columns					_entities;
 } frame_cache;
 
 #undef CONSTEXPR
 
+//NOTE: what's bound for the previous draw. Draws are sorted by draw key, so consecutive draws mostly share
+//      their pipeline state, material and geometry pools, and only what changes is sent to the context.
+struct bound_state
+{
+    d3d11_pipeline_state			pso{};
+    ID3D11Buffer*					index_buffer{ nullptr };
+    DXGI_FORMAT						index_format{ DXGI_FORMAT_UNKNOWN };
+    D3D_PRIMITIVE_TOPOLOGY			topology{ D3D_PRIMITIVE_TOPOLOGY_UNDEFINED };
+    ID3D11ShaderResourceView*		position_view{ nullptr };
+    ID3D11ShaderResourceView*		element_view{ nullptr };
+    ID3D11ShaderResourceView**		material_views{ nullptr };
+};
+
+//NOTE: per-frame structured buffer, rewritten with WRITE_DISCARD every time the gpass is prepared.
+//      It grows to about 1.5 times the needed size and never shrinks, so the buffer settles quickly.
+class dynamic_structured_buffer
+{
+public:
+    constexpr dynamic_structured_buffer(u32 stride, const wchar_t* const name) : _stride{ stride }, _name{ name } {}
+    DISABLE_COPY_AND_MOVE(dynamic_structured_buffer);
+    ~dynamic_structured_buffer() { release(); }
+
+    // Returns where to write count elements. The buffer must be unmapped before it's used for drawing.
+    _NODISCARD void* const map(ID3D11DeviceContext4* const ctx, u32 count)
+    {
+        assert(count);
+        reserve(count);
+        D3D11_MAPPED_SUBRESOURCE mapped{};
+        DXCall(ctx->Map(_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+        return mapped.pData;
+    }
+
+    void unmap(ID3D11DeviceContext4* const ctx)
+    {
+        ctx->Unmap(_buffer, 0);
+    }
+
+    void release()
+    {
+        core::release(_buffer);
+        core::release(_srv);
+        _capacity = 0;
+    }
+
+    _NODISCARD constexpr ID3D11ShaderResourceView* const srv() const { return _srv; }
+
+private:
+    void reserve(u32 count)
+    {
+        if (count <= _capacity) return;
+
+        core::deferred_release(_buffer);
+        core::deferred_release(_srv);
+        _capacity = (count * 3) >> 1;
+
+        D3D11_BUFFER_DESC desc{};
+        desc.ByteWidth = _capacity * _stride;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        desc.StructureByteStride = _stride;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        DXCall(core::device()->CreateBuffer(&desc, nullptr, &_buffer));
+        NAME_D3D11_OBJECT(_buffer, _name);
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvdesc{};
+        srvdesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvdesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        srvdesc.Buffer.FirstElement = 0;
+        srvdesc.Buffer.NumElements = _capacity;
+        DXCall(core::device()->CreateShaderResourceView(_buffer, &srvdesc, &_srv));
+    }
+
+    ID3D11Buffer*					_buffer{ nullptr };
+    ID3D11ShaderResourceView*		_srv{ nullptr };
+    const u32						_stride;
+    u32								_capacity{ 0 };
+    const wchar_t* const			_name;
+};
+
+radix_sorter						draw_sorter;
+radix_sorter						depth_sorter;
+frame_draw_stats					frame_stats{};
+dynamic_structured_buffer			instance_buffer{ sizeof(hlsl::PerInstanceData), L"GPass Instance Buffer" };
+dynamic_structured_buffer			depth_instance_buffer{ sizeof(hlsl::DepthInstanceData), L"GPass Depth Instance Buffer" };
+dynamic_structured_buffer			material_buffer{ sizeof(hlsl::MaterialSurfaceData), L"GPass Material Buffer" };
+
 bool
 create_buffers(math::u32v2 size)
 {
@@ -183,87 +299,317 @@ create_buffers(math::u32v2 size)
     return gpass_main_buffer.resource() && gpass_depth_buffer.resource();
 }
 
+//NOTE: fetching transforms and multiplying matrices is the heavy part, so entities go in small chunks.
+//      Draw keys and instances are cheap per item and use larger chunks.
+constexpr u32 entity_chunk_size{ 256 };
+constexpr u32 item_chunk_size{ 2048 };
+static_assert(!(entity_chunk_size % soa_array<u32>::chunk_multiple) && !(item_chunk_size % soa_array<u32>::chunk_multiple));
+
+// Fetches the transforms of each entity once, however many render items it has. Transform components are
+// only read here, and the game doesn't update them while the frame is rendered.
 void
-fill_in_per_object_buffer(const d3d11_frame_info& d3d11_info, const content::material::materials_cache& materials_cache)
+fill_in_entity_data()
 {
-    const gpass_cache& cache{ frame_cache };
+    gpass_cache& cache{ frame_cache };
     const u32 render_items_count{ (u32)cache.size() };
-    id::id_type current_entity_id{ id::invalid_id };
-    hlsl::PerObjectData* current_data_pointer{ nullptr };
 
-    constant_buffer& cbuffer{ core::cbuffer() };
-
-    using namespace DirectX;
+    //NOTE: items are gathered per entity, so all items of an entity are next to each other. Listing the
+    //      entities first gives the jobs below contiguous ids to fetch transforms for.
+    id::id_type current_entity_id{ id::invalid_id };
     for (u32 i{ 0 }; i < render_items_count; ++i)
     {
         if (current_entity_id != cache.entity_ids[i])
         {
             current_entity_id = cache.entity_ids[i];
-            hlsl::PerObjectData data{};
-            transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, data.World, data.InvWorld);
+            cache.frame_entity_ids[cache.entity_data_count++] = current_entity_id;
+        }
+
+        cache.entity_data_indices[i] = cache.entity_data_count - 1;
+    }
+
+    jobs::parallel_for(cache.entity_data_count, entity_chunk_size, [&cache](u32, u32 begin, u32 end) {
+        for (u32 e{ begin }; e < end; ++e)
+        {
+            hlsl::PerInstanceData& data{ cache.entity_data[e] };
+            transform::get_transform_matrices(game_entity::entity_id{ cache.frame_entity_ids[e] }, data.World, data.InvWorld);
+        }
+        });
+}
+
+// The part of the entity data that depends on the camera, then the draw keys.
+void
+fill_in_view_data(const d3d11_frame_info& d3d11_info)
+{
+    gpass_cache& cache{ frame_cache };
+    const u32 render_items_count{ (u32)cache.size() };
+
+    using namespace DirectX;
+    const XMMATRIX view_projection{ d3d11_info.camera->view_projection() };
+    const XMVECTOR camera_position{ d3d11_info.camera->position() };
+    const XMVECTOR camera_direction{ d3d11_info.camera->direction() };
+    jobs::parallel_for(cache.entity_data_count, entity_chunk_size, [&](u32, u32 begin, u32 end) {
+        for (u32 e{ begin }; e < end; ++e)
+        {
+            hlsl::PerInstanceData& data{ cache.entity_data[e] };
             XMMATRIX world{ XMLoadFloat4x4(&data.World) };
-            XMMATRIX exp{ XMMatrixMultiply(world, d3d11_info.camera->view_projection()) };
+            XMMATRIX exp{ XMMatrixMultiply(world, view_projection) };
             XMStoreFloat4x4(&data.WorldViewProjection, exp);
 
-            const material_surface* const surface{ materials_cache.material_surfaces[i] };
-            memcpy(&data.BaseColor, surface, sizeof(material_surface));
+            //NOTE: objects are sorted by the depth of their origin, which is good enough for front to back.
+            cache.entity_depths[e] = draw_key::quantize_depth(XMVectorGetX(XMVector3Dot(world.r[3] - camera_position, camera_direction)));
+        }
+        });
 
-            current_data_pointer = cbuffer.allocate<hlsl::PerObjectData>();
-            memcpy(current_data_pointer, &data, sizeof(hlsl::PerObjectData));
+    //NOTE: items that keep their own shaders in the depth prepass get an opaque depth key, which sorts them
+    //      after the position only ones. They're drawn with the main batches instead.
+    const ID3D11VertexShader* const depth_only_vs{ (ID3D11VertexShader*)shaders::get_engine_shader(shaders::engine_shader::depth_only_vs) };
+    jobs::parallel_for(render_items_count, item_chunk_size, [&cache, depth_only_vs](u32, u32 begin, u32 end) {
+        for (u32 i{ begin }; i < end; ++i)
+        {
+            const u32 depth{ cache.entity_depths[cache.entity_data_indices[i]] };
+            cache.draw_keys[i] = draw_key::make(draw_key::pass::opaque, cache.pso_ids[i], cache.material_ids[i],
+                cache.submesh_gpu_ids[i], depth);
+            cache.depth_keys[i] = cache.depth_pipeline_states[i].vs == depth_only_vs
+                ? draw_key::make(draw_key::pass::depth_prepass, cache.depth_pso_ids[i], 0, cache.submesh_gpu_ids[i], depth)
+                : draw_key::make(draw_key::pass::opaque, 0, 0, 0, 0);
         }
+        });
+}
+
+// Collapses the runs of sorted items with the same submesh, pipeline state and material into instanced draws.
+// Each instance gets its entity's transforms and the index of its material in the material buffer.
+void
+build_draw_batches(ID3D11DeviceContext4* const ctx)
+{
+    gpass_cache& cache{ frame_cache };
+    const u32 items_count{ cache.size() };
+
+    constant_buffer& cbuffer{ core::cbuffer() };
+    hlsl::PerInstanceData* const instances{ (hlsl::PerInstanceData* const)instance_buffer.map(ctx, items_count) };
+    hlsl::MaterialSurfaceData* const materials{ (hlsl::MaterialSurfaceData* const)material_buffer.map(ctx, items_count) };
+    u32 material_count{ 0 };
+
+    //NOTE: finding the runs only compares ids, so it stays on this thread. It also keeps the per-draw
+    //      constants in one ordered range of the constant buffer.
+    for (u32 k{ 0 }; k < items_count; ++k)
+    {
+        const u32 i{ cache.draw_order[k] };
+        const u32 prev{ k ? cache.draw_order[k - 1] : u32_invalid_id };
 
-        assert(current_data_pointer);
-        cache.per_object_data_offsets[i] = cbuffer.offset(current_data_pointer);
+        //NOTE: draws are sorted by material within a pipeline state, so each material is written once per pipeline state.
+        const bool same_material{ k && cache.material_ids[i] == cache.material_ids[prev] };
+        if (!same_material)
+        {
+            static_assert(sizeof(material_surface) <= sizeof(hlsl::MaterialSurfaceData));
+            hlsl::MaterialSurfaceData surface{};
+            memcpy(&surface, cache.material_surfaces[i], sizeof(material_surface));
+            memcpy(&materials[material_count], &surface, sizeof(hlsl::MaterialSurfaceData));
+            ++material_count;
+        }
+
+        cache.instance_material_indices[k] = material_count - 1;
+
+        if (!same_material || cache.pso_ids[i] != cache.pso_ids[prev] || cache.submesh_gpu_ids[i] != cache.submesh_gpu_ids[prev])
+        {
+            hlsl::PerDrawData* const data{ cbuffer.allocate<hlsl::PerDrawData>() };
+            assert(data);
+            data->FirstInstance = k;
+            cache.draw_batches[cache.draw_batch_count++] = { k, 0, cbuffer.offset(data) };
+        }
+
+        ++cache.draw_batches[cache.draw_batch_count - 1].instance_count;
     }
+
+    //NOTE: the instance buffer is mapped for all items up front, so every chunk writes its own contiguous range of it.
+    jobs::parallel_for(items_count, item_chunk_size, [&cache, instances](u32, u32 begin, u32 end) {
+        for (u32 k{ begin }; k < end; ++k)
+        {
+            hlsl::PerInstanceData instance{ cache.entity_data[cache.entity_data_indices[cache.draw_order[k]]] };
+            instance.MaterialIndex = cache.instance_material_indices[k];
+            memcpy(&instances[k], &instance, sizeof(hlsl::PerInstanceData));
+        }
+        });
+
+    instance_buffer.unmap(ctx);
+    material_buffer.unmap(ctx);
 }
 
+// Collapses the runs of position only depth draws with the same submesh into instanced draws. Materials don't
+// matter here, so these runs are longer than the ones in build_draw_batches().
 void
-set_data_views(ID3D11DeviceContext4* const ctx, u32 cache_index)
+build_depth_batches(ID3D11DeviceContext4* const ctx)
 {
     gpass_cache& cache{ frame_cache };
-    assert(cache_index < cache.size());
+    const u64* const sorted_keys{ depth_sorter.sorted_keys() };
+
+    constant_buffer& cbuffer{ core::cbuffer() };
+    u32 depth_item_count{ 0 };
+    for (; depth_item_count < cache.size() && draw_key::pass_of(sorted_keys[depth_item_count]) == draw_key::pass::depth_prepass; ++depth_item_count)
+    {
+        const u32 k{ depth_item_count };
+        const u32 i{ cache.depth_draw_order[k] };
+        const u32 prev{ k ? cache.depth_draw_order[k - 1] : u32_invalid_id };
+
+        if (!k || cache.depth_pso_ids[i] != cache.depth_pso_ids[prev] || cache.submesh_gpu_ids[i] != cache.submesh_gpu_ids[prev])
+        {
+            hlsl::PerDrawData* const data{ cbuffer.allocate<hlsl::PerDrawData>() };
+            assert(data);
+            data->FirstInstance = k;
+            cache.depth_batches[cache.depth_batch_count++] = { k, 0, cbuffer.offset(data) };
+        }
+
+        ++cache.depth_batches[cache.depth_batch_count - 1].instance_count;
+    }
+
+    if (!depth_item_count) return;
 
-    const material_type::type mtl_type{ cache.material_types[cache_index] };
-    switch (mtl_type)
+    hlsl::DepthInstanceData* const instances{ (hlsl::DepthInstanceData* const)depth_instance_buffer.map(ctx, depth_item_count) };
+    jobs::parallel_for(depth_item_count, item_chunk_size, [&cache, instances](u32, u32 begin, u32 end) {
+        for (u32 k{ begin }; k < end; ++k)
+        {
+            const hlsl::PerInstanceData& data{ cache.entity_data[cache.entity_data_indices[cache.depth_draw_order[k]]] };
+            memcpy(&instances[k].WorldViewProjection, &data.WorldViewProjection, sizeof(hlsl::float4x4));
+        }
+        });
+
+    depth_instance_buffer.unmap(ctx);
+}
+
+// Binds what item i needs that isn't bound yet. Without a context, it only counts the state changes.
+void
+set_draw_state(ID3D11DeviceContext4* const ctx, bound_state& bound, const d3d11_pipeline_state& state, u32 i, u32 instance_count,
+    bool use_pixel_shader, draw_stats& stats)
+{
+    const gpass_cache& cache{ frame_cache };
+    assert(i < cache.size());
+
+    ++stats.draw_count;
+    stats.instance_count += instance_count;
+    if (bound.pso.vs != state.vs)
     {
-    case material_type::opaque:
+        if (ctx) ctx->VSSetShader(state.vs, nullptr, 0);
+        bound.pso.vs = state.vs;
+        ++stats.shader_changes;
+    }
+    if (bound.pso.hs != state.hs)
     {
-        ID3D11ShaderResourceView* const srvs[]{ cache.position_views[cache_index], cache.element_views[cache_index] };
-        ctx->VSSetShaderResources(0, _countof(srvs), srvs);
+        if (ctx) ctx->HSSetShader(state.hs, nullptr, 0);
+        bound.pso.hs = state.hs;
+        ++stats.shader_changes;
+    }
+    if (bound.pso.ds != state.ds)
+    {
+        if (ctx) ctx->DSSetShader(state.ds, nullptr, 0);
+        bound.pso.ds = state.ds;
+        ++stats.shader_changes;
+    }
+    if (bound.pso.gs != state.gs)
+    {
+        if (ctx) ctx->GSSetShader(state.gs, nullptr, 0);
+        bound.pso.gs = state.gs;
+        ++stats.shader_changes;
+    }
+    if (use_pixel_shader && bound.pso.ps != state.ps)
+    {
+        if (ctx) ctx->PSSetShader(state.ps, nullptr, 0);
+        bound.pso.ps = state.ps;
+        ++stats.shader_changes;
+    }
+
+    if (cache.material_types[i] == material_type::opaque)
+    {
+        //NOTE: submeshes share the vertex pools, so most draws don't need to rebind them.
+        if (bound.position_view != cache.position_views[i] || bound.element_view != cache.element_views[i])
+        {
+            bound.position_view = cache.position_views[i];
+            bound.element_view = cache.element_views[i];
+            ID3D11ShaderResourceView* const srvs[]{ bound.position_view, bound.element_view };
+            if (ctx) ctx->VSSetShaderResources(0, _countof(srvs), srvs);
+            ++stats.view_changes;
+        }
 
-        if (cache.texture_counts[cache_index])
+        //NOTE: the views of a material live in its stream, so draws with the same material have the same pointer.
+        if (use_pixel_shader && cache.texture_counts[i] && bound.material_views != cache.shader_views[i])
         {
-            ID3D11ShaderResourceView** const view_array{ cache.shader_views[cache_index] };
+            bound.material_views = cache.shader_views[i];
+            ID3D11ShaderResourceView** const view_array{ bound.material_views };
             ID3D11ShaderResourceView* const pssrvs[]{ view_array[0], view_array[1], view_array[2], view_array[3], view_array[4] };
-            
-            ctx->PSSetShaderResources(7, _countof(pssrvs), &pssrvs[0]);
+            if (ctx) ctx->PSSetShaderResources(7, _countof(pssrvs), &pssrvs[0]);
+            ++stats.view_changes;
         }
-    } break;
+    }
+
+    if (bound.index_buffer != cache.index_buffers[i] || bound.index_format != cache.index_formats[i])
+    {
+        bound.index_buffer = cache.index_buffers[i];
+        bound.index_format = cache.index_formats[i];
+        if (ctx) ctx->IASetIndexBuffer(bound.index_buffer, bound.index_format, 0);
+        ++stats.index_buffer_changes;
+    }
+
+    if (bound.topology != cache.primitive_topologies[i])
+    {
+        bound.topology = cache.primitive_topologies[i];
+        if (ctx) ctx->IASetPrimitiveTopology(bound.topology);
+        ++stats.topology_changes;
     }
 }
 
 void
-prepare_render_frame(const d3d11_frame_info& d3d11_info)
+prepare_render_frame(ID3D11DeviceContext4* const ctx, const d3d11_frame_info& d3d11_info)
 {
     assert(d3d11_info.info && d3d11_info.camera);
     assert(d3d11_info.info->render_item_ids && d3d11_info.info->render_item_count);
     gpass_cache& cache{ frame_cache };
-    cache.clear();
+    const frame_info& info{ *d3d11_info.info };
 
-    using namespace content;
-    render_item::get_d3d11_render_item_ids(*d3d11_info.info, cache.d3d11_render_item_ids);
-    cache.resize();
-    const u32 items_count{ cache.size() };
-    const render_item::items_cache items_cache{ cache.items_cache() };
-    render_item::get_items(cache.d3d11_render_item_ids.data(), items_count, items_cache);
+    //NOTE: gathering the items, selecting their LODs and fetching the entity transforms doesn't depend on
+    //      the camera, so views of the same frame that render the same items only do it once.
+    if (cache.is_gathered_for(info))
+    {
+        cache.draw_batch_count = 0;
+        cache.depth_batch_count = 0;
+    }
+    else
+    {
+        cache.clear();
+
+        using namespace content;
+        render_item::get_d3d11_render_item_ids(info, cache.d3d11_render_item_ids);
+        cache.resize();
+        const u32 items_count{ cache.size() };
+        const render_item::items_cache items_cache{ cache.items_cache() };
+        render_item::get_items(cache.d3d11_render_item_ids.data(), items_count, items_cache);
 
-    const submesh::views_cache views_cache{ cache.views_cache() };
-    submesh::get_views(items_cache.submesh_gpu_ids, items_count, views_cache);
+        const submesh::views_cache views_cache{ cache.views_cache() };
+        submesh::get_views(items_cache.submesh_gpu_ids, items_count, views_cache);
 
-    const material::materials_cache materials_cache{ cache.materials_cache() };
-    material::get_materials(items_cache.material_ids, items_count, materials_cache, cache.shader_view_count);
+        const material::materials_cache materials_cache{ cache.materials_cache() };
+        material::get_materials(items_cache.material_ids, items_count, materials_cache, cache.shader_view_count);
 
-    fill_in_per_object_buffer(d3d11_info, materials_cache);
+        fill_in_entity_data();
+        cache.gathered_item_ids = info.render_item_ids;
+        cache.gathered_thresholds = info.thresholds;
+        cache.gathered_item_count = info.render_item_count;
+    }
+
+    const u32 items_count{ cache.size() };
+    fill_in_view_data(d3d11_info);
+    cache.draw_order = draw_sorter.sort(cache.draw_keys, items_count);
+    cache.depth_draw_order = depth_sorter.sort(cache.depth_keys, items_count);
+    build_draw_batches(ctx);
+    build_depth_batches(ctx);
+
+#if _DEBUG
+    // What the gpass would have cost in gather order without instancing, for comparison with what render() submits.
+    //NOTE: this replays every item serially, so release builds don't pay for it.
+    frame_stats.unsorted = {};
+    bound_state unsorted_state{};
+    for (u32 i{ 0 }; i < items_count; ++i)
+    {
+        set_draw_state(nullptr, unsorted_state, cache.pipeline_states[i], i, 1, true, frame_stats.unsorted);
+    }
+#endif
 }
 }//anonymous namespace
 
@@ -292,6 +638,9 @@ shutdown()
     core::release(point_sampler);
     core::release(linear_sampler);
     core::release(anisotropic_sampler);
+    instance_buffer.release();
+    depth_instance_buffer.release();
+    material_buffer.release();
 
     gpass_main_buffer.release();
     gpass_depth_buffer.release();
@@ -321,59 +670,79 @@ set_size(math::u32v2 size)
     }
 }
 
+void
+begin_frame()
+{
+    frame_cache.gathered_item_ids = nullptr;
+}
+
 void
 depth_prepass(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info)
 {
-    prepare_render_frame(d3d11_info);
+    prepare_render_frame(ctx, d3d11_info);
 
     const gpass_cache& cache{ frame_cache };
-    const u32 items_count{ cache.size() };
 
     ctx->OMSetDepthStencilState(depth_state, 0);
+    ctx->PSSetShader(nullptr, nullptr, 0);
+    ctx->RSSetState(rs_state_cull);
 
-    d3d11_pipeline_state current_state{};
-    ctx->PSSetShader(current_state.ps, nullptr, 0);
+    //NOTE: bound_state starts out with nothing bound, which has to be true for the stages it tracks.
+    ctx->HSSetShader(nullptr, nullptr, 0);
+    ctx->DSSetShader(nullptr, nullptr, 0);
+    ctx->GSSetShader(nullptr, nullptr, 0);
 
-    ctx->RSSetState(rs_state_cull);
+    const auto set_constants{ [ctx, &d3d11_info](const draw_batch& batch) {
+        ID3D11Buffer* const buffers[]{ core::cbuffer().buffer(), core::cbuffer().buffer() };
+        UINT offsets[]{ d3d11_info.global_shader_data_offset, batch.per_draw_data_offset };
+        constexpr UINT constants[]{ d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::GlobalShaderData)),
+        d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::PerDrawData)) };
 
-    for (u32 i{ 0 }; i < items_count; ++i)
+        ctx->VSSetConstantBuffers1(0, _countof(buffers), buffers, offsets, constants);
+        } };
+
+    //NOTE: the prepass only writes depth, so it doesn't bind pixel shaders or material textures. Most items
+    //      share the position only vertex shader and are drawn first, sorted by submesh.
+    bound_state bound{};
+    frame_stats.depth_prepass = {};
+    if (cache.depth_batch_count)
     {
-        set_data_views(ctx, i);
-        d3d11_pipeline_state& state{ cache.pipeline_states[i] };
+        ID3D11ShaderResourceView* const depth_instance_srv{ depth_instance_buffer.srv() };
+        ctx->VSSetShaderResources(2, 1, &depth_instance_srv);
 
+        for (u32 b{ 0 }; b < cache.depth_batch_count; ++b)
         {
-            ID3D11Buffer* const buffers[]{ core::cbuffer().buffer(), core::cbuffer().buffer() };
-            UINT offsets[]{ d3d11_info.global_shader_data_offset, cache.per_object_data_offsets[i] };
-            constexpr UINT constants[]{ d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::GlobalShaderData)),
-            d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::PerObjectData)) };
+            const draw_batch& batch{ cache.depth_batches[b] };
+            const u32 i{ cache.depth_draw_order[batch.first] };
+            set_draw_state(ctx, bound, cache.depth_pipeline_states[i], i, batch.instance_count, false, frame_stats.depth_prepass);
+            set_constants(batch);
 
-            ctx->VSSetConstantBuffers1(0, _countof(buffers), buffers, offsets, constants);
+            ctx->DrawIndexedInstanced(cache.index_counts[i], batch.instance_count, cache.start_index_locations[i],
+                (INT)cache.base_vertex_locations[i], 0);
         }
+    }
 
-        if (current_state.vs != state.vs)
-        {
-            ctx->VSSetShader(state.vs, nullptr, 0);
-            current_state.vs = state.vs;
-        }
-        if (current_state.hs != state.hs)
-        {
-            ctx->HSSetShader(state.hs, nullptr, 0);
-            current_state.hs = state.hs;
-        }
-        if (current_state.ds != state.ds)
-        {
-            ctx->DSSetShader(state.ds, nullptr, 0);
-            current_state.ds = state.ds;
-        }
-        if (current_state.gs != state.gs)
+    // The rest keep their own vertex, hull, domain and geometry shaders, which read the main instance buffer.
+    ID3D11VertexShader* const depth_only_vs{ (ID3D11VertexShader*)shaders::get_engine_shader(shaders::engine_shader::depth_only_vs) };
+    bool instances_bound{ false };
+    for (u32 b{ 0 }; b < cache.draw_batch_count; ++b)
+    {
+        const draw_batch& batch{ cache.draw_batches[b] };
+        const u32 i{ cache.draw_order[batch.first] };
+        if (cache.depth_pipeline_states[i].vs == depth_only_vs) continue;
+
+        if (!instances_bound)
         {
-            ctx->GSSetShader(state.gs, nullptr, 0);
-            current_state.gs = state.gs;
+            ID3D11ShaderResourceView* const instance_srv{ instance_buffer.srv() };
+            ctx->VSSetShaderResources(2, 1, &instance_srv);
+            instances_bound = true;
         }
 
-        ctx->IASetIndexBuffer(cache.index_buffers[i], cache.index_formats[i], 0);
-        ctx->IASetPrimitiveTopology(cache.primitive_topologies[i]);
-        ctx->DrawIndexedInstanced(cache.index_counts[i], 1, 0, 0, 0);
+        set_draw_state(ctx, bound, cache.depth_pipeline_states[i], i, batch.instance_count, false, frame_stats.depth_prepass);
+        set_constants(batch);
+
+        ctx->DrawIndexedInstanced(cache.index_counts[i], batch.instance_count, cache.start_index_locations[i],
+            (INT)cache.base_vertex_locations[i], 0);
     }
 
     //unbind output
@@ -385,13 +754,16 @@ void
 render(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info)
 {
     const gpass_cache& cache{ frame_cache };
-    const u32 items_count{ cache.size() };
+    const u32 batch_count{ cache.draw_batch_count };
     const u32 frame_idx{ d3d11_info.frame_index };
     const u32 light_culling_id{ d3d11_info.light_culling_id };
 
     ctx->OMSetDepthStencilState(readonly_depth_state, 0);
 
-    d3d11_pipeline_state current_state{ nullptr };
+    //NOTE: the depth prepass leaves its own shaders bound, and bound_state starts out with nothing bound.
+    ctx->HSSetShader(nullptr, nullptr, 0);
+    ctx->DSSetShader(nullptr, nullptr, 0);
+    ctx->GSSetShader(nullptr, nullptr, 0);
 
     ID3D11SamplerState* const samplers[]{ point_sampler, linear_sampler, anisotropic_sampler };
     ctx->PSSetSamplers(0, _countof(samplers), &samplers[0]);
@@ -401,48 +773,36 @@ render(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info)
     lightculling::light_index_list_opaque(light_culling_id, frame_idx) };
     ctx->PSSetShaderResources(3, _countof(pssrvs), pssrvs);
 
-    for (u32 i{ 0 }; i < items_count; ++i)
+    ID3D11ShaderResourceView* const instance_srv{ instance_buffer.srv() };
+    ID3D11ShaderResourceView* const material_srv{ material_buffer.srv() };
+    ctx->VSSetShaderResources(2, 1, &instance_srv);
+    ctx->PSSetShaderResources(12, 1, &material_srv);
+
+    //NOTE: pixel shaders only need the global constants. Their per-instance data comes through the material buffer.
+    {
+        ID3D11Buffer* const buffer{ core::cbuffer().buffer() };
+        const UINT offset{ d3d11_info.global_shader_data_offset };
+        constexpr UINT constants{ d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::GlobalShaderData)) };
+        ctx->PSSetConstantBuffers1(0, 1, &buffer, &offset, &constants);
+    }
+
+    bound_state bound{};
+    frame_stats.sorted = {};
+    for (u32 b{ 0 }; b < batch_count; ++b)
     {
-        set_data_views(ctx, i);
-        d3d11_pipeline_state& state{ cache.pipeline_states[i] };
+        const draw_batch& batch{ cache.draw_batches[b] };
+        const u32 i{ cache.draw_order[batch.first] };
+        set_draw_state(ctx, bound, cache.pipeline_states[i], i, batch.instance_count, true, frame_stats.sorted);
 
         ID3D11Buffer* const buffers[]{ core::cbuffer().buffer(), core::cbuffer().buffer() };
-        UINT offsets[]{ d3d11_info.global_shader_data_offset, cache.per_object_data_offsets[i] };
+        UINT offsets[]{ d3d11_info.global_shader_data_offset, batch.per_draw_data_offset };
         constexpr UINT constants[]{ d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::GlobalShaderData)),
-        d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::PerObjectData)) };
+        d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::PerDrawData)) };
 
         ctx->VSSetConstantBuffers1(0, _countof(buffers), buffers, offsets, constants);
-        ctx->PSSetConstantBuffers1(0, _countof(buffers), buffers, offsets, constants);
-
-        if (current_state.vs != state.vs)
-        {
-            ctx->VSSetShader(state.vs, nullptr, 0);
-            current_state.vs = state.vs;
-        }
-        if (current_state.hs != state.hs)
-        {
-            ctx->HSSetShader(state.hs, nullptr, 0);
-            current_state.hs = state.hs;
-        }
-        if (current_state.ds != state.ds)
-        {
-            ctx->DSSetShader(state.ds, nullptr, 0);
-            current_state.ds = state.ds;
-        }
-        if (current_state.gs != state.gs)
-        {
-            ctx->GSSetShader(state.gs, nullptr, 0);
-            current_state.gs = state.gs;
-        }
-        if (current_state.ps != state.ps)
-        {
-            ctx->PSSetShader(state.ps, nullptr, 0);
-            current_state.ps = state.ps;
-        }
 
-        ctx->IASetIndexBuffer(cache.index_buffers[i], cache.index_formats[i], 0);
-        ctx->IASetPrimitiveTopology(cache.primitive_topologies[i]);
-        ctx->DrawIndexedInstanced(cache.index_counts[i], 1, 0, 0, 0);
+        ctx->DrawIndexedInstanced(cache.index_counts[i], batch.instance_count, cache.start_index_locations[i],
+            (INT)cache.base_vertex_locations[i], 0);
     }
 
     //unbind output
@@ -450,6 +810,12 @@ render(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info)
     ctx->OMSetRenderTargets(1, &null_rtv, nullptr);
 }
 
+const frame_draw_stats&
+get_draw_stats()
+{
+    return frame_stats;
+}
+
 void
 set_render_targets_for_depth_prepass(ID3D11DeviceContext4* ctx)
 {
@@ -11,6 +11,25 @@ namespace primal::graphics::d3d11::gpass {
 constexpr DXGI_FORMAT               main_buffer_format{ DXGI_FORMAT_R16G16B16A16_FLOAT };
 constexpr DXGI_FORMAT               depth_buffer_format{ DXGI_FORMAT_D32_FLOAT };
 
+struct draw_stats
+{
+    u32		draw_count;
+    u32		instance_count;			// render items drawn. More than draw_count when draws are instanced.
+    u32		shader_changes;
+    u32		index_buffer_changes;
+    u32		topology_changes;
+    u32		view_changes;			// vertex pool and material texture bindings
+
+    _NODISCARD constexpr u32 state_changes() const { return shader_changes + index_buffer_changes + topology_changes + view_changes; }
+};
+
+struct frame_draw_stats
+{
+    draw_stats	sorted;				// what render() submitted, in draw key order
+    draw_stats	unsorted;			// what it would have submitted in the order the items were gathered (debug builds only)
+    draw_stats	depth_prepass;		// what depth_prepass() submitted
+};
+
 bool initialize();
 void shutdown();
 
@@ -18,8 +37,13 @@ _NODISCARD d3d11_render_texture& main_buffer();
 _NODISCARD d3d11_depth_buffer& depth_buffer();
 
 void set_size(math::u32v2 size);
+// Forgets the items gathered for the previous frame. Views recorded after this with the same render item
+// and threshold arrays share one gather, LOD selection and entity transform fetch.
+void begin_frame();
 void depth_prepass(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info);
 void render(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info);
+// State changes of the last depth_prepass() and render().
+_NODISCARD const frame_draw_stats& get_draw_stats();
 void set_render_targets_for_depth_prepass(ID3D11DeviceContext4* ctx);
 void set_render_targets_for_gpass(ID3D11DeviceContext4* ctx);
 }
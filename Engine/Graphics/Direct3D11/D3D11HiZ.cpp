@@ -0,0 +1,183 @@
+#include "D3D11HiZ.h"
+#include "D3D11Core.h"
+#include "D3D11GPass.h"
+#include "D3D11Shaders.h"
+#include "Shaders/SharedTypes.h"
+
+#if PRIMAL_BUILD_D3D11
+
+namespace primal::graphics::d3d11::hiz {
+namespace {
+constexpr u32                       group_size{ 8 };
+
+ID3D11ComputeShader*                from_depth_shader{ nullptr };
+ID3D11ComputeShader*                downsample_shader{ nullptr };
+
+ID3D11Texture2D*                    hiz_texture{ nullptr };
+ID3D11ShaderResourceView*           hiz_srv{ nullptr };
+ID3D11ShaderResourceView*           mip_srvs[d3d11_texture::max_mips]{};
+ID3D11UnorderedAccessView*          mip_uavs[d3d11_texture::max_mips]{};
+math::u32v2                         texture_size{};
+math::u32v2                         view_size{};
+u32                                 mip_count{ 0 };
+
+constexpr u32
+next_pow2(u32 value)
+{
+    u32 result{ 1 };
+    while (result < value) result <<= 1;
+    return result;
+}
+
+constexpr u32
+log2_pow2(u32 pow2)
+{
+    u32 result{ 0 };
+    while (pow2 >>= 1) ++result;
+    return result;
+}
+
+void
+release_texture()
+{
+    for (u32 i{ 0 }; i < mip_count; ++i)
+    {
+        core::deferred_release(mip_srvs[i]);
+        core::deferred_release(mip_uavs[i]);
+    }
+    core::deferred_release(hiz_srv);
+    core::deferred_release(hiz_texture);
+    texture_size = {};
+    mip_count = 0;
+}
+
+//NOTE: D3D11 rounds mip sizes down, but the levels have to round up so that the last texel of a level still
+//      covers the last pixels of the view. Power of two sizes make both the same.
+bool
+create_texture(math::u32v2 depth_size)
+{
+    release_texture();
+
+    const math::u32v2 size{ next_pow2(depth_size.x), next_pow2(depth_size.y) };
+    const u32 levels{ log2_pow2(std::max(size.x, size.y)) };
+    assert(levels && levels < d3d11_texture::max_mips);
+
+    D3D11_TEXTURE2D_DESC desc{};
+    desc.Format = hiz_format;
+    desc.ArraySize = 1;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    desc.Width = std::max(size.x >> 1, 1u);
+    desc.Height = std::max(size.y >> 1, 1u);
+    desc.MipLevels = levels;
+    desc.SampleDesc = { 1, 0 };
+
+    auto* const device{ core::device() };
+    HRESULT hr{ S_OK };
+    DXCall(hr = device->CreateTexture2D(&desc, nullptr, &hiz_texture));
+    if (FAILED(hr)) return false;
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc{};
+    srv_desc.Format = hiz_format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Texture2D.MipLevels = levels;
+    DXCall(device->CreateShaderResourceView(hiz_texture, &srv_desc, &hiz_srv));
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc{};
+    uav_desc.Format = hiz_format;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+    srv_desc.Texture2D.MipLevels = 1;
+
+    for (u32 i{ 0 }; i < levels; ++i)
+    {
+        srv_desc.Texture2D.MostDetailedMip = i;
+        uav_desc.Texture2D.MipSlice = i;
+        DXCall(device->CreateShaderResourceView(hiz_texture, &srv_desc, &mip_srvs[i]));
+        DXCall(device->CreateUnorderedAccessView(hiz_texture, &uav_desc, &mip_uavs[i]));
+    }
+
+    NAME_D3D11_OBJECT(hiz_texture, L"Hi-Z Pyramid");
+
+    texture_size = size;
+    mip_count = levels;
+    return true;
+}
+}//anonymous namespace
+
+bool
+initialize()
+{
+    from_depth_shader = (ID3D11ComputeShader*)shaders::get_engine_shader(shaders::engine_shader::hiz_from_depth_cs);
+    downsample_shader = (ID3D11ComputeShader*)shaders::get_engine_shader(shaders::engine_shader::hiz_downsample_cs);
+
+    return from_depth_shader && downsample_shader;
+}
+
+void
+shutdown()
+{
+    for (u32 i{ 0 }; i < mip_count; ++i)
+    {
+        core::release(mip_srvs[i]);
+        core::release(mip_uavs[i]);
+    }
+    core::release(hiz_srv);
+    core::release(hiz_texture);
+    texture_size = {};
+    mip_count = 0;
+}
+
+void
+build(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info)
+{
+    const math::u32v2 depth_size{ d3d11_info.surface_width, d3d11_info.surface_height };
+    assert(depth_size.x && depth_size.y);
+
+    if (depth_size.x > texture_size.x || depth_size.y > texture_size.y)
+    {
+        if (!create_texture(depth_size)) return;
+    }
+
+    //NOTE: the depth buffer is still bound for output after the prepass, which would make D3D11 unbind its SRV.
+    ctx->OMSetRenderTargets(0, nullptr, nullptr);
+
+    constant_buffer& cbuffer{ core::cbuffer() };
+    ID3D11Buffer* const buffers[]{ cbuffer.buffer() };
+    constexpr UINT sizes[]{ d3dx::align_size_for_constant_buffer_offset(sizeof(hlsl::HiZDispatchParameters)) };
+    ID3D11ShaderResourceView* const clear_srvs[]{ nullptr };
+    ID3D11UnorderedAccessView* const clear_uavs[]{ nullptr };
+
+    math::u32v2 source_size{ depth_size };
+    for (u32 i{ 0 }; i < mip_count; ++i)
+    {
+        const math::u32v2 destination_size{ (source_size.x + 1) >> 1, (source_size.y + 1) >> 1 };
+
+        hlsl::HiZDispatchParameters* const params{ cbuffer.allocate<hlsl::HiZDispatchParameters>() };
+        params->SourceSize = source_size;
+        params->DestinationSize = destination_size;
+        const UINT offsets[]{ cbuffer.offset(params) };
+
+        ID3D11ShaderResourceView* const srvs[]{ i ? mip_srvs[i - 1] : gpass::depth_buffer().srv() };
+
+        ctx->CSSetShader(i ? downsample_shader : from_depth_shader, nullptr, 0);
+        ctx->CSSetConstantBuffers1(0, _countof(buffers), buffers, offsets, sizes);
+        ctx->CSSetShaderResources(0, _countof(srvs), srvs);
+        ctx->CSSetUnorderedAccessViews(0, 1, &mip_uavs[i], nullptr);
+        ctx->Dispatch((destination_size.x + group_size - 1) / group_size, (destination_size.y + group_size - 1) / group_size, 1);
+
+        //NOTE: the next level reads this one, which can't be bound for reading while it's bound for writing.
+        ctx->CSSetUnorderedAccessViews(0, 1, clear_uavs, nullptr);
+        ctx->CSSetShaderResources(0, 1, clear_srvs);
+
+        if (i == 0) view_size = destination_size;
+        source_size = destination_size;
+    }
+}
+
+hiz_info
+info()
+{
+    return { hiz_srv, view_size, mip_count };
+}
+}
+
+#endif
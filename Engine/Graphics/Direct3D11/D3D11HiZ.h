@@ -0,0 +1,32 @@
+#pragma once
+#include "D3D11CommonHeaders.h"
+
+#if PRIMAL_BUILD_D3D11
+
+namespace primal::graphics::d3d11 {
+struct d3d11_frame_info;
+}
+
+// Hierarchical depth built from the depth prepass. Every texel holds the farthest and nearest depth of the
+// pixels it covers (see BuildHiZ.hlsl), so depth ranges of screen regions take one fetch at any level.
+namespace primal::graphics::d3d11::hiz {
+constexpr DXGI_FORMAT               hiz_format{ DXGI_FORMAT_R32G32_FLOAT };
+
+struct hiz_info
+{
+    ID3D11ShaderResourceView*       srv{ nullptr };        // all levels
+    math::u32v2                     size{};                // texels of level 0 that cover the view. Half the view size, rounded up.
+    u32                             mip_count{ 0 };
+};
+
+bool initialize();
+void shutdown();
+
+//NOTE: reads gpass::depth_buffer(), so this unbinds the render targets. Call it after the depth prepass
+//      and before anything that reads the pyramid.
+void build(ID3D11DeviceContext4* ctx, const d3d11_frame_info& d3d11_info);
+
+_NODISCARD hiz_info info();
+}
+
+#endif
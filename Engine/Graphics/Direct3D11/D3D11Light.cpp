@@ -1,5 +1,6 @@
 #include "D3D11Light.h"
 #include "D3D11Core.h"
+#include "Graphics/UploadRing.h"
 #include "Shaders/SharedTypes.h"
 #include "EngineAPI/GameEntity.h"
 #include "Components/Transform.h"
@@ -8,20 +9,8 @@
 
 namespace primal::graphics::d3d11::light {
 namespace {
-template<u32 n>
-struct u32_set_bits {
-    static_assert(n > 0 && n <= 32);
-    constexpr static const u32 bits{ u32_set_bits<n - 1>::bits | (1 << (n - 1)) };
-};
-
-template<>
-struct u32_set_bits<0> {
-    constexpr static const u32 bits{ 0 };
-};
-
-static_assert(u32_set_bits<frame_buffer_count>::bits < (1 << 8), "That's quite a large frame buffer count!");
-
-constexpr u8 dirty_bits_mask{ (u8)u32_set_bits<frame_buffer_count>::bits };
+//Each light set has a single GPU-resident copy, so one dirty bit is all we need.
+constexpr u8 dirty_bits_mask{ 0x01 };
 
 struct light_owner
 {
@@ -45,16 +34,13 @@ public:
         if (info.type == graphics::light::directional)
         {
             u32 index{ u32_invalid_id };
-            for (u32 i{ 0 }; i < _non_cullable_owners.size(); ++i)
+            if (!_non_cullable_free_slots.empty())
             {
-                if (!id::is_valid(_non_cullable_owners[i]))
-                {
-                    index = i;
-                    break;
-                }
+                index = _non_cullable_free_slots.back();
+                _non_cullable_free_slots.pop_back();
+                assert(!id::is_valid(_non_cullable_owners[index]));
             }
-
-            if (index == u32_invalid_id)
+            else
             {
                 index = (u32)_non_cullable_owners.size();
                 _non_cullable_owners.emplace_back();
@@ -73,31 +59,20 @@ public:
         }
         else
         {
-            u32 index{ u32_invalid_id };
-            for (u32 i{ _enabled_light_count }; i < _cullable_owners.size(); ++i)
-            {
-                if (!id::is_valid(_cullable_owners[i]))
-                {
-                    index = i;
-                    break;
-                }
-            }
-
-            if (index == u32_invalid_id)
-            {
-                index = (u32)_cullable_owners.size();
-                _cullable_lights.emplace_back();
-                _culling_info.emplace_back();
-                _bounding_spheres.emplace_back();
-                _cullable_entity_ids.emplace_back();
-                _cullable_owners.emplace_back();
-                _dirty_bits.emplace_back();
-                assert(_cullable_owners.size() == _cullable_lights.size());
-                assert(_cullable_owners.size() == _culling_info.size());
-                assert(_cullable_owners.size() == _bounding_spheres.size());
-                assert(_cullable_owners.size() == _cullable_entity_ids.size());
-                assert(_cullable_owners.size() == _dirty_bits.size());
-            }
+            //NOTE: cullable lights are kept without holes (see remove()), so a new light always goes at the end
+            //      and enable() swaps it into the enabled range if needed.
+            const u32 index{ (u32)_cullable_owners.size() };
+            _cullable_lights.emplace_back();
+            _culling_info.emplace_back();
+            _bounding_spheres.emplace_back();
+            _cullable_entity_ids.emplace_back();
+            _cullable_owners.emplace_back();
+            _dirty_bits.emplace_back();
+            assert(_cullable_owners.size() == _cullable_lights.size());
+            assert(_cullable_owners.size() == _culling_info.size());
+            assert(_cullable_owners.size() == _bounding_spheres.size());
+            assert(_cullable_owners.size() == _cullable_entity_ids.size());
+            assert(_cullable_owners.size() == _dirty_bits.size());
 
             add_cullable_light_parameters(info, index);
             add_light_culling_info(info, index);
@@ -106,31 +81,88 @@ public:
             _cullable_owners[index] = id;
             make_dirty(index);
             enable(id, info.is_enabled);
-            update_transform(index);
+            update_transform(_owners[id].data_index);
 
             return graphics::light{ id, info.light_set_key };
         }
     }
 
+    void add(const light_init_info* const infos, u32 count, graphics::light* const lights)
+    {
+        assert(infos && count && lights);
+        u32 non_cullable_count{ 0 };
+        for (u32 i{ 0 }; i < count; ++i)
+        {
+            if (infos[i].type == graphics::light::directional) ++non_cullable_count;
+        }
+
+        reserve(non_cullable_count, count - non_cullable_count);
+
+        for (u32 i{ 0 }; i < count; ++i)
+        {
+            assert(id::is_valid(infos[i].entity_id));
+            lights[i] = add(infos[i]);
+        }
+    }
+
     constexpr void remove(light_id id)
     {
         enable(id, false);
 
         const light_owner& owner{ _owners[id] };
+        const u32 index{ owner.data_index };
 
         if (owner.type == graphics::light::directional)
         {
-            _non_cullable_owners[owner.data_index] = light_id{ id::invalid_id };
+            _non_cullable_owners[index] = light_id{ id::invalid_id };
+            _non_cullable_free_slots.emplace_back(index);
         }
         else
         {
-            assert(_owners[_cullable_owners[owner.data_index]].data_index == owner.data_index);
-            _cullable_owners[owner.data_index] = light_id{ id::invalid_id };
+            //Disabled lights are always past _enabled_light_count, so moving the last light into this slot
+            //keeps both the enabled and the disabled ranges packed.
+            assert(_owners[_cullable_owners[index]].data_index == index);
+            assert(index >= _enabled_light_count);
+            _cullable_owners[index] = light_id{ id::invalid_id };
+
+            const u32 last{ (u32)_cullable_owners.size() - 1 };
+            if (index != last)
+            {
+                swap_cullable_lights(index, last);
+            }
+
+            _cullable_lights.pop_back();
+            _culling_info.pop_back();
+            _bounding_spheres.pop_back();
+            _cullable_entity_ids.pop_back();
+            _cullable_owners.pop_back();
+            _dirty_bits.pop_back();
         }
 
         _owners.remove(id);
     }
 
+    CONSTEXPR void reserve(u32 non_cullable_count, u32 cullable_count)
+    {
+        if (non_cullable_count > _non_cullable_free_slots.size())
+        {
+            const u64 new_size{ _non_cullable_owners.size() + non_cullable_count - _non_cullable_free_slots.size() };
+            _non_cullable_lights.reserve(new_size);
+            _non_cullable_owners.reserve(new_size);
+        }
+
+        if (cullable_count)
+        {
+            const u64 new_size{ _cullable_owners.size() + cullable_count };
+            _cullable_lights.reserve(new_size);
+            _culling_info.reserve(new_size);
+            _bounding_spheres.reserve(new_size);
+            _cullable_entity_ids.reserve(new_size);
+            _cullable_owners.reserve(new_size);
+            _dirty_bits.reserve(new_size);
+        }
+    }
+
     void update_transforms()
     {
         for (const auto& id : _non_cullable_owners)
@@ -204,7 +236,7 @@ public:
 
     constexpr void intensity(light_id id, f32 intensity)
     {
-        if (intensity < 0.f) intensity = 0.f;
+        intensity = valid_intensity(intensity);
 
         const light_owner& owner{ _owners[id] };
         const u32 index{ owner.data_index };
@@ -225,8 +257,7 @@ public:
 
     constexpr void color(light_id id, math::v3 color)
     {
-        assert(color.x <= 1.f && color.y <= 1.f && color.z <= 1.f);
-        assert(color.x >= 0.f && color.y >= 0.f && color.z >= 0.f);
+        validate_color(color);
 
         const light_owner& owner{ _owners[id] };
         const u32 index{ owner.data_index };
@@ -324,6 +355,80 @@ public:
         make_dirty(index);
     }
 
+    //Batched setters: values are written straight into the SoA arrays and the set is only flagged dirty once.
+    //They accept the same values as the single setters. Four lights are validated at a time with SIMD, then
+    //each value goes to wherever its light's data lives, which is a scattered store per light.
+    void intensity(const light_id* const ids, const f32* const intensities, u32 count)
+    {
+        using namespace DirectX;
+        const XMVECTOR zero{ XMVectorZero() };
+        u32 i{ 0 };
+        for (; i + 4 <= count; i += 4)
+        {
+            //NOTE: zero goes first, so a NaN intensity passes through like it does in valid_intensity().
+            XMFLOAT4A valid;
+            XMStoreFloat4A(&valid, XMVectorMax(zero, XMLoadFloat4((const XMFLOAT4*)&intensities[i])));
+            write_intensity(ids[i], valid.x);
+            write_intensity(ids[i + 1], valid.y);
+            write_intensity(ids[i + 2], valid.z);
+            write_intensity(ids[i + 3], valid.w);
+        }
+
+        for (; i < count; ++i)
+        {
+            write_intensity(ids[i], valid_intensity(intensities[i]));
+        }
+
+        _something_is_dirty = dirty_bits_mask;
+    }
+
+    void color(const light_id* const ids, const math::v3* const colors, u32 count)
+    {
+        using namespace DirectX;
+        //NOTE: four colors are twelve floats, which load as three vectors.
+        static_assert(sizeof(math::v3) * 4 == sizeof(XMFLOAT4) * 3);
+        u32 i{ 0 };
+        for (; i + 4 <= count; i += 4)
+        {
+            const XMFLOAT4* const packed{ (const XMFLOAT4*)&colors[i] };
+            [[maybe_unused]] const XMVECTOR v0{ XMLoadFloat4(&packed[0]) };
+            [[maybe_unused]] const XMVECTOR v1{ XMLoadFloat4(&packed[1]) };
+            [[maybe_unused]] const XMVECTOR v2{ XMLoadFloat4(&packed[2]) };
+            assert(XMVector4InBounds(XMVectorSubtract(v0, g_XMOneHalf), g_XMOneHalf) &&
+                XMVector4InBounds(XMVectorSubtract(v1, g_XMOneHalf), g_XMOneHalf) &&
+                XMVector4InBounds(XMVectorSubtract(v2, g_XMOneHalf), g_XMOneHalf));
+
+            write_color(ids[i], colors[i]);
+            write_color(ids[i + 1], colors[i + 1]);
+            write_color(ids[i + 2], colors[i + 2]);
+            write_color(ids[i + 3], colors[i + 3]);
+        }
+
+        for (; i < count; ++i)
+        {
+            validate_color(colors[i]);
+            write_color(ids[i], colors[i]);
+        }
+
+        _something_is_dirty = dirty_bits_mask;
+    }
+
+    void intensity(const light_id* const ids, f32* const intensities, u32 count) const
+    {
+        for (u32 i{ 0 }; i < count; ++i)
+        {
+            intensities[i] = intensity(ids[i]);
+        }
+    }
+
+    void color(const light_id* const ids, math::v3* const colors, u32 count) const
+    {
+        for (u32 i{ 0 }; i < count; ++i)
+        {
+            colors[i] = color(ids[i]);
+        }
+    }
+
     constexpr bool is_enabled(light_id id) const
     {
         return _owners[id].is_enabled;
@@ -608,6 +713,54 @@ private:
         }
     }
 
+    //NOTE: shared by the single and the batched setters, so both accept the same values.
+    _NODISCARD constexpr static f32 valid_intensity(f32 intensity)
+    {
+        return intensity < 0.f ? 0.f : intensity;
+    }
+
+    constexpr static void validate_color([[maybe_unused]] math::v3 color)
+    {
+        assert(color.x <= 1.f && color.y <= 1.f && color.z <= 1.f);
+        assert(color.x >= 0.f && color.y >= 0.f && color.z >= 0.f);
+    }
+
+    CONSTEXPR void write_intensity(light_id id, f32 intensity)
+    {
+        const light_owner& owner{ _owners[id] };
+        const u32 index{ owner.data_index };
+
+        if (owner.type == graphics::light::directional)
+        {
+            assert(index < _non_cullable_lights.size());
+            _non_cullable_lights[index].Intensity = intensity;
+        }
+        else
+        {
+            assert(index < _cullable_lights.size() && index < _dirty_bits.size());
+            _cullable_lights[index].Intensity = intensity;
+            _dirty_bits[index] = dirty_bits_mask;
+        }
+    }
+
+    CONSTEXPR void write_color(light_id id, math::v3 color)
+    {
+        const light_owner& owner{ _owners[id] };
+        const u32 index{ owner.data_index };
+
+        if (owner.type == graphics::light::directional)
+        {
+            assert(index < _non_cullable_lights.size());
+            _non_cullable_lights[index].Color = color;
+        }
+        else
+        {
+            assert(index < _cullable_lights.size() && index < _dirty_bits.size());
+            _cullable_lights[index].Color = color;
+            _dirty_bits[index] = dirty_bits_mask;
+        }
+    }
+
     CONSTEXPR void make_dirty(u32 index)
     {
         assert(index < _dirty_bits.size());
@@ -618,6 +771,7 @@ private:
     utl::free_list<light_owner>							_owners;
     utl::vector<hlsl::DirectionalLightParameters>		_non_cullable_lights;
     utl::vector<light_id>								_non_cullable_owners;
+    utl::vector<u32>									_non_cullable_free_slots;
 
     //These are tightly packed
     utl::vector<hlsl::LightParameters>					_cullable_lights;
@@ -634,92 +788,152 @@ private:
     friend class d3d11_light_buffer;
 };
 
+// Upload ring shared by all light sets. Dirty ranges are written here and then copied on the GPU
+// into the light set's own buffers, so the per-set copies persist across frames and surfaces.
+//NOTE: a mapped resource can't be the source of a copy, so every write maps only for as long as it takes
+//      to fill its range. The first map of a frame or after wrapping around discards, so the driver
+//      renames the buffer instead of stalling on copies that are still in flight. All other maps
+//      don't overwrite anything in use and can append without a stall.
+class d3d11_upload_ring
+{
+public:
+    // Allocates size bytes, calls fill(cpu_address) while the range is mapped and returns the range's offset.
+    template<typename F>
+    [[nodiscard]] u32 write(u32 size, u32 frame_index, ID3D11DeviceContext4* const ctx, F&& fill)
+    {
+        const u32 offset{ allocate(size, frame_index, ctx) };
+        const D3D11_MAP map_type{ (_discard || offset < _write_end) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE };
+
+        D3D11_MAPPED_SUBRESOURCE map{};
+        DXCall(ctx->Map(_buffer, 0, map_type, 0, &map));
+        _ring.remap((u8*)map.pData);
+        fill(_ring.cpu_address(offset));
+        ctx->Unmap(_buffer, 0);
+
+        _discard = false;
+        _write_end = offset + size;
+        return offset;
+    }
+
+    [[nodiscard]] constexpr ID3D11Buffer* const buffer() const { return _buffer; }
+
+    void release()
+    {
+        core::release(_buffer);
+        _ring.release();
+    }
+
+private:
+    constexpr static u32 default_size{ 1024 * 1024 };
+    constexpr static u32 alignment{ D3D11_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE };
+
+    [[nodiscard]] u32 allocate(u32 size, u32 frame_index, ID3D11DeviceContext4* const ctx)
+    {
+        if (frame_index != _frame_index || !_buffer)
+        {
+            if (!_buffer) create(default_size, ctx);
+            _ring.begin_frame(frame_index);
+            _frame_index = frame_index;
+            _discard = true;
+        }
+
+        u32 offset{ _ring.allocate(size, alignment) };
+        if (offset == u32_invalid_id)
+        {
+            //NOTE: previous copies out of the old buffer are still in flight, so it's released deferred.
+            create(std::max(_ring.size() * 2, (u32)math::align_size_up<alignment>(size) * 2), ctx);
+            _ring.begin_frame(frame_index);
+            offset = _ring.allocate(size, alignment);
+        }
+
+        assert(offset != u32_invalid_id);
+        return offset;
+    }
+
+    void create(u32 size, ID3D11DeviceContext4* const ctx)
+    {
+        core::deferred_release(_buffer);
+
+        D3D11_BUFFER_DESC desc{};
+        desc.ByteWidth = size;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        DXCall(core::device()->CreateBuffer(&desc, nullptr, &_buffer));
+        NAME_D3D11_OBJECT(_buffer, L"Light Upload Ring");
+
+        //NOTE: the ring wants an address to start with. It's replaced by the real one on every write.
+        D3D11_MAPPED_SUBRESOURCE map{};
+        DXCall(ctx->Map(_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map));
+        _ring.initialize((u8*)map.pData, size);
+        ctx->Unmap(_buffer, 0);
+        _discard = true;
+        _write_end = 0;
+    }
+
+    ID3D11Buffer*							_buffer{ nullptr };
+    upload_ring<frame_buffer_count>			_ring{};
+    u32										_frame_index{ u32_invalid_id };
+    u32										_write_end{ 0 };
+    bool									_discard{ true };
+};
+
+d3d11_upload_ring upload_ring_buffer;
+
+// GPU-resident copy of one light set. Only dirty ranges are uploaded, so alternating light sets
+// between surfaces doesn't cause a full re-upload.
 class d3d11_light_buffer
 {
 public:
     d3d11_light_buffer() = default;
 
-    CONSTEXPR void update_light_buffer(light_set& set, u64 light_set_key, u32 frame_index, ID3D11DeviceContext4* const ctx)
+    void update_light_buffer(light_set& set, u32 frame_index, ID3D11DeviceContext4* const ctx)
     {
         const u32 non_cullable_light_count{ set.non_cullable_light_count() };
 
+        //NOTE: the handful of directional lights get compacted every frame, so we just upload all of them.
         if (non_cullable_light_count)
         {
             const u32 needed_size{ non_cullable_light_count * sizeof(hlsl::DirectionalLightParameters) };
-            const u32 current_size{ _buffers[light_buffer::non_cullable_light].size };
-
-            if (current_size < needed_size)
-            {
-                resize_buffer(light_buffer::non_cullable_light, needed_size, frame_index, ctx);
-            }
+            const u32 upload_size{ (u32)math::align_size_up<D3D11_STANDARD_MAXIMUM_ELEMENT_ALIGNMENT_BYTE_MULTIPLE>(needed_size) };
+            reserve(light_buffer::non_cullable_light, needed_size, ctx);
 
-            set.non_cullable_lights((hlsl::DirectionalLightParameters* const)_buffers[light_buffer::non_cullable_light].cpu_address,
-                _buffers[light_buffer::non_cullable_light].size);
+            const u32 offset{ upload_ring_buffer.write(upload_size, frame_index, ctx, [&set, upload_size](u8* const dst)
+                {
+                    set.non_cullable_lights((hlsl::DirectionalLightParameters* const)dst, upload_size);
+                }) };
+            copy_from_ring(light_buffer::non_cullable_light, 0, offset, needed_size, ctx);
         }
 
         const u32 cullable_light_count{ set.cullable_light_count() };
-        if (cullable_light_count)
+        if (cullable_light_count && set._something_is_dirty)
         {
-            const u32 needed_light_buffer_size{ cullable_light_count * sizeof(hlsl::LightParameters) };
-            const u32 needed_culling_buffer_size{ cullable_light_count * sizeof(hlsl::LightCullingLightInfo) };
-            const u32 needed_spheres_buffer_size{ cullable_light_count * sizeof(hlsl::Sphere) };
-            const u32 current_light_buffer_size{ _buffers[light_buffer::cullable_light].size };
-
-            bool buffers_resized{ false };
-            if (current_light_buffer_size < needed_light_buffer_size)
-            {
-                resize_buffer(light_buffer::cullable_light, (needed_light_buffer_size * 3) >> 1, frame_index, ctx);
-                resize_buffer(light_buffer::culling_info, (needed_culling_buffer_size * 3) >> 1, frame_index, ctx);
-                resize_buffer(light_buffer::bounding_spheres, (needed_spheres_buffer_size * 3) >> 1, frame_index, ctx);
-                buffers_resized = true;
-            }
-
-            const u32 index_mask{ 1UL << frame_index };
-            if (buffers_resized || _current_light_set_key != light_set_key)
-            {
-                memcpy(_buffers[light_buffer::cullable_light].cpu_address, set._cullable_lights.data(), needed_light_buffer_size);
-                memcpy(_buffers[light_buffer::culling_info].cpu_address, set._culling_info.data(), needed_culling_buffer_size);
-                memcpy(_buffers[light_buffer::bounding_spheres].cpu_address, set._bounding_spheres.data(), needed_spheres_buffer_size);
-                _current_light_set_key = light_set_key;
+            reserve(light_buffer::cullable_light, cullable_light_count * sizeof(hlsl::LightParameters), ctx);
+            reserve(light_buffer::culling_info, cullable_light_count * sizeof(hlsl::LightCullingLightInfo), ctx);
+            reserve(light_buffer::bounding_spheres, cullable_light_count * sizeof(hlsl::Sphere), ctx);
 
-                for (u32 i{ 0 }; i < cullable_light_count; ++i)
+            for_each_dirty_range(set._dirty_bits.data(), cullable_light_count, dirty_bits_mask, [&](u32 first, u32 count)
                 {
-                    set._dirty_bits[i] &= ~index_mask;
-                }
-            }
-            else if (set._something_is_dirty)
-            {
-                for (u32 i{ 0 }; i < cullable_light_count; ++i)
-                {
-                    if (set._dirty_bits[i] & index_mask)
-                    {
-                        assert(i * sizeof(hlsl::LightParameters) < needed_light_buffer_size);
-                        assert(i * sizeof(hlsl::LightCullingLightInfo) < needed_culling_buffer_size);
-
-                        u8* const light_dst{ _buffers[light_buffer::cullable_light].cpu_address + (i * sizeof(hlsl::LightParameters)) };
-                        u8* const culling_dst{ _buffers[light_buffer::culling_info].cpu_address + (i * sizeof(hlsl::LightCullingLightInfo)) };
-                        u8* const bounding_dst{ _buffers[light_buffer::bounding_spheres].cpu_address + (i * sizeof(hlsl::Sphere)) };
-                        memcpy(light_dst, &set._cullable_lights[i], sizeof(hlsl::LightParameters));
-                        memcpy(culling_dst, &set._culling_info[i], sizeof(hlsl::LightCullingLightInfo));
-                        memcpy(bounding_dst, &set._bounding_spheres[i], sizeof(hlsl::Sphere));
-
-                        set._dirty_bits[i] &= ~index_mask;
-                    }
-                }
-            }
-
-            set._something_is_dirty &= ~index_mask;
-            assert(_current_light_set_key == light_set_key);
+                    upload(light_buffer::cullable_light, &set._cullable_lights[first], first, count, frame_index, ctx);
+                    upload(light_buffer::culling_info, &set._culling_info[first], first, count, frame_index, ctx);
+                    upload(light_buffer::bounding_spheres, &set._bounding_spheres[first], first, count, frame_index, ctx);
+                    memset(&set._dirty_bits[first], 0, count);
+                });
+
+            //NOTE: disabled lights may still be dirty. They'll be uploaded when they get swapped into the enabled range.
+            set._something_is_dirty = 0;
         }
     }
 
-    constexpr void release()
+    void release()
     {
         for (u32 i{ 0 }; i < light_buffer::count; ++i)
         {
-            core::release(_buffers[i].buffer);
-            core::release(_buffers[i].srv);
-            _buffers[i].cpu_address = nullptr;
+            core::deferred_release(_buffers[i].buffer);
+            core::deferred_release(_buffers[i].srv);
+            _buffers[i].size = 0;
         }
     }
 
@@ -743,7 +957,6 @@ private:
         u32							size{ 0 };
         ID3D11Buffer*				buffer{ nullptr };
         ID3D11ShaderResourceView*	srv{ nullptr };
-        u8*							cpu_address{ nullptr };
     };
 
     constexpr static u32 get_stride(light_buffer::type type)
@@ -759,27 +972,52 @@ private:
         return strides[type];
     }
 
-    void resize_buffer(light_buffer::type type, u32 size, [[maybe_unused]] u32 frame_index, ID3D11DeviceContext4* const ctx)
+    void upload(light_buffer::type type, const void* const data, u32 first, u32 count, u32 frame_index, ID3D11DeviceContext4* const ctx)
     {
-        light_buffer& buffer{ _buffers[type] };
-        core::release(buffer.srv);
-
         const u32 stride{ get_stride(type) };
+        const u32 size{ count * stride };
+        const u32 offset{ upload_ring_buffer.write(size, frame_index, ctx, [data, size](u8* const dst) { memcpy(dst, data, size); }) };
+        copy_from_ring(type, first * stride, offset, size, ctx);
+    }
+
+    void copy_from_ring(light_buffer::type type, u32 dst_offset, u32 src_offset, u32 size, ID3D11DeviceContext4* const ctx)
+    {
+        const light_buffer& buffer{ _buffers[type] };
+        assert(dst_offset + size <= buffer.size);
+        const D3D11_BOX box{ src_offset, 0, 0, src_offset + size, 1, 1 };
+        ctx->CopySubresourceRegion(buffer.buffer, 0, dst_offset, 0, 0, upload_ring_buffer.buffer(), 0, &box);
+    }
 
+    // Grows the GPU buffer to about 1.5 times the needed size. The current contents are copied over on the GPU.
+    void reserve(light_buffer::type type, u32 size, ID3D11DeviceContext4* const ctx)
+    {
         assert(type < light_buffer::count);
-        if (!size || buffer.size >= math::align_size_up<PRIMAL_D3D11_CONSTANT_BUFFER_ALIGNMENT>(size)) return;
-        //This is here because we create all buffer about 1.5 times the size they should be.
-        size = (u32)math::align_size_up(size, stride);
+        light_buffer& buffer{ _buffers[type] };
+        if (!size || buffer.size >= size) return;
+
+        const u32 stride{ get_stride(type) };
+        size = (u32)math::align_size_up((size * 3) >> 1, stride);
 
         D3D11_BUFFER_DESC desc{};
         desc.ByteWidth = size;
-        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.Usage = D3D11_USAGE_DEFAULT;
         desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
         desc.StructureByteStride = stride;
         desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-        DXCall(core::device()->CreateBuffer(&desc, nullptr, &buffer.buffer));
+        ID3D11Buffer* new_buffer{ nullptr };
+        DXCall(core::device()->CreateBuffer(&desc, nullptr, &new_buffer));
+
+        if (buffer.buffer)
+        {
+            const D3D11_BOX box{ 0, 0, 0, buffer.size, 1, 1 };
+            ctx->CopySubresourceRegion(new_buffer, 0, 0, 0, 0, buffer.buffer, 0, &box);
+        }
+
+        core::deferred_release(buffer.buffer);
+        core::deferred_release(buffer.srv);
+        buffer.buffer = new_buffer;
+        buffer.size = size;
 
         D3D11_SHADER_RESOURCE_VIEW_DESC srvdesc{};
         srvdesc.Format = DXGI_FORMAT_UNKNOWN;
@@ -787,21 +1025,16 @@ private:
         srvdesc.Buffer.FirstElement = 0;
         srvdesc.Buffer.NumElements = size / stride;
 
-        core::device()->CreateShaderResourceView(buffer.buffer, &srvdesc, &buffer.srv);
-
-        D3D11_MAPPED_SUBRESOURCE map{};
-        DXCall(ctx->Map(buffer.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map));
-        buffer.size = map.RowPitch;
-        buffer.cpu_address = (u8*)map.pData;
+        DXCall(core::device()->CreateShaderResourceView(buffer.buffer, &srvdesc, &buffer.srv));
     }
 
-
     light_buffer	_buffers[light_buffer::count]{};
-    u64				_current_light_set_key{ 0 };
 };
 
-std::unordered_map<u64, light_set>		light_sets;
-d3d11_light_buffer						light_buffers[frame_buffer_count];
+std::unordered_map<u64, light_set>				light_sets;
+std::unordered_map<u64, d3d11_light_buffer>		light_buffers;
+//The light set buffers that were updated for each frame. Shaders bind these.
+const d3d11_light_buffer*						frame_light_buffers[frame_buffer_count]{};
 
 constexpr void
 set_is_enabled(light_set& set, light_id id, const void* const data, [[maybe_unused]] u32 size)
@@ -982,10 +1215,8 @@ shutdown()
 {
     assert(light_sets.empty());
 
-    for (u32 i{ 0 }; i < frame_buffer_count; ++i)
-    {
-        light_buffers[i].release();
-    }
+    assert(light_buffers.empty());
+    upload_ring_buffer.release();
 }
 
 void
@@ -993,6 +1224,7 @@ create_light_set(u64 key)
 {
     assert(!light_sets.count(key));
     light_sets[key] = {};
+    light_buffers[key] = {};
 }
 
 void
@@ -1001,6 +1233,15 @@ remove_light_set(u64 key)
     assert(light_sets.count(key));
     assert(!light_sets[key].has_lights());
     light_sets.erase(key);
+
+    d3d11_light_buffer& light_buffer{ light_buffers[key] };
+    for (u32 i{ 0 }; i < frame_buffer_count; ++i)
+    {
+        if (frame_light_buffers[i] == &light_buffer) frame_light_buffers[i] = nullptr;
+    }
+
+    light_buffer.release();
+    light_buffers.erase(key);
 }
 
 graphics::light
@@ -1011,6 +1252,18 @@ create(light_init_info info)
     return light_sets[info.light_set_key].add(info);
 }
 
+void
+create_lights(const light_init_info* const infos, u32 count, graphics::light* const lights)
+{
+    assert(infos && count && lights);
+    const u64 light_set_key{ infos[0].light_set_key };
+    assert(light_sets.count(light_set_key));
+#ifdef _DEBUG
+    for (u32 i{ 1 }; i < count; ++i) assert(infos[i].light_set_key == light_set_key);
+#endif
+    light_sets[light_set_key].add(infos, count, lights);
+}
+
 void
 remove(light_id id, u64 light_set_key)
 {
@@ -1037,45 +1290,111 @@ get_parameter(light_id id, u64 light_set_key, light_parameter::parameter paramet
 }
 
 void
-update_light_buffers(const d3d11_frame_info& d3d11_info, ID3D11DeviceContext4* const ctx)
+set_parameters(const light_id* const ids, u32 count, u64 light_set_key, light_parameter::parameter parameter, const void* const data, u32 data_size)
+{
+    assert(ids && count && data && data_size);
+    assert(light_sets.count(light_set_key));
+    assert(parameter < light_parameter::count && set_functions[parameter] != dummy_set);
+    light_set& set{ light_sets[light_set_key] };
+
+    switch (parameter)
+    {
+    case light_parameter::intensity:
+        assert(data_size == sizeof(f32));
+        set.intensity(ids, (const f32*)data, count);
+        break;
+    case light_parameter::color:
+        assert(data_size == sizeof(math::v3));
+        set.color(ids, (const math::v3*)data, count);
+        break;
+    default:
+    {
+        const u8* values{ (const u8*)data };
+        const set_function function{ set_functions[parameter] };
+        for (u32 i{ 0 }; i < count; ++i, values += data_size)
+        {
+            function(set, ids[i], values, data_size);
+        }
+    }
+    break;
+    }
+}
+
+void
+get_parameters(const light_id* const ids, u32 count, u64 light_set_key, light_parameter::parameter parameter, void* const data, u32 data_size)
+{
+    assert(ids && count && data && data_size);
+    assert(light_sets.count(light_set_key));
+    assert(parameter < light_parameter::count);
+    const light_set& set{ light_sets[light_set_key] };
+
+    switch (parameter)
+    {
+    case light_parameter::intensity:
+        assert(data_size == sizeof(f32));
+        set.intensity(ids, (f32*)data, count);
+        break;
+    case light_parameter::color:
+        assert(data_size == sizeof(math::v3));
+        set.color(ids, (math::v3*)data, count);
+        break;
+    default:
+    {
+        u8* values{ (u8*)data };
+        const get_function function{ get_functions[parameter] };
+        for (u32 i{ 0 }; i < count; ++i, values += data_size)
+        {
+            function(set, ids[i], values, data_size);
+        }
+    }
+    break;
+    }
+}
+
+void
+update_light_buffers(u64 light_set_key, u32 frame_index, ID3D11DeviceContext4* const ctx)
 {
-    const u64 light_set_key{ d3d11_info.info->light_set_key };
     assert(light_sets.count(light_set_key));
     light_set& set{ light_sets[light_set_key] };
     if (!set.has_lights()) return;
 
     set.update_transforms();
-    const u32 frame_index{ d3d11_info.frame_index };
-    d3d11_light_buffer& light_buffer{ light_buffers[frame_index] };
-    light_buffer.update_light_buffer(set, light_set_key, frame_index, ctx);
+    light_buffers[light_set_key].update_light_buffer(set, frame_index, ctx);
+}
+
+void
+set_frame_light_set(u64 light_set_key, u32 frame_index)
+{
+    assert(light_sets.count(light_set_key));
+    frame_light_buffers[frame_index] = &light_buffers[light_set_key];
 }
 
 ID3D11ShaderResourceView* const
 non_cullable_light_buffer(u32 frame_index)
 {
-    const d3d11_light_buffer& light_buffer{ light_buffers[frame_index] };
-    return light_buffer.non_cullable_lights();
+    const d3d11_light_buffer* const light_buffer{ frame_light_buffers[frame_index] };
+    return light_buffer ? light_buffer->non_cullable_lights() : nullptr;
 }
 
 ID3D11ShaderResourceView* const
 cullable_light_buffer(u32 frame_index)
 {
-    const d3d11_light_buffer& light_buffer{ light_buffers[frame_index] };
-    return light_buffer.cullable_lights();
+    const d3d11_light_buffer* const light_buffer{ frame_light_buffers[frame_index] };
+    return light_buffer ? light_buffer->cullable_lights() : nullptr;
 }
 
 ID3D11ShaderResourceView* const
 culling_info_buffer(u32 frame_index)
 {
-    const d3d11_light_buffer& light_buffer{ light_buffers[frame_index] };
-    return light_buffer.culling_info();
+    const d3d11_light_buffer* const light_buffer{ frame_light_buffers[frame_index] };
+    return light_buffer ? light_buffer->culling_info() : nullptr;
 }
 
 ID3D11ShaderResourceView* const
 bounding_spheres_buffer(u32 frame_index)
 {
-    const d3d11_light_buffer& light_buffer{ light_buffers[frame_index] };
-    return light_buffer.bounding_spheres();
+    const d3d11_light_buffer* const light_buffer{ frame_light_buffers[frame_index] };
+    return light_buffer ? light_buffer->bounding_spheres() : nullptr;
 }
 
 u32
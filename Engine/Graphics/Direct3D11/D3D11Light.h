@@ -3,10 +3,6 @@
 
 #if PRIMAL_BUILD_D3D11
 
-namespace primal::graphics::d3d11 {
-struct d3d11_frame_info;
-}
-
 namespace primal::graphics::d3d11::light {
 bool initialize();
 void shutdown();
@@ -14,11 +10,20 @@ void shutdown();
 void create_light_set(u64 key);
 void remove_light_set(u64 key);
 graphics::light create(light_init_info info);
+//NOTE: all lights in a batch must belong to the same light set.
+void create_lights(const light_init_info* const infos, u32 count, graphics::light* const lights);
 void remove(light_id id, u64 light_set_key);
 void set_parameter(light_id id, u64 light_set_key, light_parameter::parameter parameter, const void* const data, u32 data_size);
 void get_parameter(light_id id, u64 light_set_key, light_parameter::parameter parameter, void* const data, u32 data_size);
+//NOTE: data points to count values of data_size bytes each, one per light id.
+void set_parameters(const light_id* const ids, u32 count, u64 light_set_key, light_parameter::parameter parameter, const void* const data, u32 data_size);
+void get_parameters(const light_id* const ids, u32 count, u64 light_set_key, light_parameter::parameter parameter, void* const data, u32 data_size);
 
-void update_light_buffers(const d3d11_frame_info& d3d11_info, ID3D11DeviceContext4* const ctx);
+//NOTE: uploads what changed in a light set. Call it once per frame for each light set that's rendered,
+//      however many surfaces use it.
+void update_light_buffers(u64 light_set_key, u32 frame_index, ID3D11DeviceContext4* const ctx);
+//NOTE: selects the light set the buffer getters below return, for the views recorded after this call.
+void set_frame_light_set(u64 light_set_key, u32 frame_index);
 ID3D11ShaderResourceView* const non_cullable_light_buffer(u32 frame_index);
 ID3D11ShaderResourceView* const cullable_light_buffer(u32 frame_index);
 ID3D11ShaderResourceView* const culling_info_buffer(u32 frame_index);
@@ -5,11 +5,15 @@
 #include "D3D11Light.h"
 #include "D3D11Camera.h"
 #include "D3D11GPass.h"
+#include "D3D11HiZ.h"
 
 #if PRIMAL_BUILD_D3D11
 
 namespace primal::graphics::d3d11::lightculling {
 namespace {
+//NOTE: the culling shader reads the depth range of a tile from this Hi-Z level, which covers 2^(mip + 1) pixels per texel.
+static_assert((1u << (HIZ_TILE_MIP + 1)) == light_culling_tile_size);
+
 class uav_srv_buffer
 {
 public:
@@ -291,8 +295,9 @@ void cull_lights(ID3D11DeviceContext4* const ctx,
     ID3D11ShaderResourceView* const srvs[]{ culler.frustums.srv(), light::culling_info_buffer(frame_idx),
 #if USE_BOUNDING_SPHERES
         light::bounding_spheres_buffer(frame_idx),
+        gpass::depth_buffer().srv(),
 #endif
-        gpass::depth_buffer().srv() };
+        hiz::info().srv };
 
     ID3D11UnorderedAccessView* const uavs[]{ culler.light_index_counter.uav(), culler.light_grid_opaque_buffer.uav(), nullptr,
         culler.light_index_list_opaque_buffer.uav() };
@@ -306,7 +311,7 @@ void cull_lights(ID3D11DeviceContext4* const ctx,
 
     ctx->Dispatch(params.NumThreadGroups.x, params.NumThreadGroups.y, 1);
     
-    ID3D11ShaderResourceView* const clear_srvs[]{ nullptr, nullptr, nullptr, nullptr };
+    ID3D11ShaderResourceView* const clear_srvs[]{ nullptr, nullptr, nullptr, nullptr, nullptr };
     ID3D11UnorderedAccessView* const clear_uavs[]{ nullptr, nullptr, nullptr, nullptr };
     ctx->CSSetShaderResources(0, _countof(clear_srvs), clear_srvs);
     ctx->CSSetUnorderedAccessViews(0, _countof(clear_uavs), clear_uavs, uav_counts);
@@ -30,7 +30,10 @@ engine_shader_info shaders_info[engine_shader::count]
     { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\FillColor.hlsl", "FillColorPS", shader_type::pixel, engine_shader::fill_color_ps },
     { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\PostProcess.hlsl", "PostProcessPS", shader_type::pixel, engine_shader::post_process_ps },
     { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\GridFrustums.hlsl", "GridFrustumsCS", shader_type::compute, engine_shader::grid_frustums_cs },
-    { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\CullLights.hlsl", "CullLightsCS", shader_type::compute, engine_shader::light_culling_cs }
+    { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\CullLights.hlsl", "CullLightsCS", shader_type::compute, engine_shader::light_culling_cs },
+    { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\DepthOnly.hlsl", "DepthOnlyVS", shader_type::vertex, engine_shader::depth_only_vs },
+    { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\BuildHiZ.hlsl", "BuildHiZFromDepthCS", shader_type::compute, engine_shader::hiz_from_depth_cs },
+    { L"..\\..\\Engine\\Graphics\\Direct3D11\\Shaders\\BuildHiZ.hlsl", "BuildHiZCS", shader_type::compute, engine_shader::hiz_downsample_cs }
 };
 
 void
@@ -50,6 +53,7 @@ compile_shader(const engine_shader_info& info)
     switch (shader_id)
     {
     case engine_shader::fullscreen_triangle_vs:
+    case engine_shader::depth_only_vs:
         DXCall(hr = core::device()->CreateVertexShader(shader_blob->GetBufferPointer(),
             shader_blob->GetBufferSize(), nullptr, (ID3D11VertexShader**)&engine_shaders[shader_id]));
         break;
@@ -66,6 +70,8 @@ compile_shader(const engine_shader_info& info)
             shader_blob->GetBufferSize(), nullptr, (ID3D11ComputeShader**)&engine_shaders[shader_id]));
         break;
     case engine_shader::light_culling_cs:
+    case engine_shader::hiz_from_depth_cs:
+    case engine_shader::hiz_downsample_cs:
         DXCall(hr = core::device()->CreateComputeShader(shader_blob->GetBufferPointer(),
             shader_blob->GetBufferSize(), nullptr, (ID3D11ComputeShader**)&engine_shaders[shader_id]));
         break;
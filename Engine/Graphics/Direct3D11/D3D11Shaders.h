@@ -11,6 +11,9 @@ struct engine_shader {
         post_process_ps = 2,
         grid_frustums_cs = 3,
         light_culling_cs = 4,
+        depth_only_vs = 5,
+        hiz_from_depth_cs = 6,
+        hiz_downsample_cs = 7,
         count
     };
 };
@@ -0,0 +1,52 @@
+#include "Common.hlsli"
+
+// Builds the Hi-Z pyramid from the depth prepass. Each level halves the one before, rounding up, so level n
+// has one texel per 2^(n+1) x 2^(n+1) pixels and level HIZ_TILE_MIP has one texel per light culling tile.
+// See HiZNearestDepth() and friends in CommonFunctions.hlsli for what a texel holds.
+
+cbuffer b00 : register(b0) { HiZDispatchParameters ShaderParams; };
+
+Texture2D<float>                                Depth                   :   register(t0);
+Texture2D<float2>                               Source                  :   register(t0);
+RWTexture2D<float2>                             Destination             :   register(u0);
+
+float2 EncodeDepth(float depth)
+{
+    // NOTE: nothing was drawn where depth is still the clear value. Those texels are flagged with a negative
+    //       farthest depth so they don't hide the depth of the geometry next to them.
+    return depth == 0.f ? float2(-1.f, 0.f) : float2(depth, depth);
+}
+
+float2 CombineHiZ(float2 a, float2 b)
+{
+    const float farthest = min(abs(a.x), abs(b.x));
+    return float2((a.x < 0.f || b.x < 0.f) ? -farthest : farthest, max(a.y, b.y));
+}
+
+uint2 SourceTexel(uint2 destinationTexel, uint2 offset)
+{
+    // NOTE: odd sized levels have texels at the right and bottom edges that cover only one source texel.
+    return min(destinationTexel * 2 + offset, ShaderParams.SourceSize - 1);
+}
+
+[numthreads(8, 8, 1)]
+void BuildHiZFromDepthCS(uint3 DispatchThreadID : SV_DispatchThreadID)
+{
+    const uint2 texel = DispatchThreadID.xy;
+    if (any(texel >= ShaderParams.DestinationSize)) return;
+
+    const float2 a = CombineHiZ(EncodeDepth(Depth[SourceTexel(texel, uint2(0, 0))]), EncodeDepth(Depth[SourceTexel(texel, uint2(1, 0))]));
+    const float2 b = CombineHiZ(EncodeDepth(Depth[SourceTexel(texel, uint2(0, 1))]), EncodeDepth(Depth[SourceTexel(texel, uint2(1, 1))]));
+    Destination[texel] = CombineHiZ(a, b);
+}
+
+[numthreads(8, 8, 1)]
+void BuildHiZCS(uint3 DispatchThreadID : SV_DispatchThreadID)
+{
+    const uint2 texel = DispatchThreadID.xy;
+    if (any(texel >= ShaderParams.DestinationSize)) return;
+
+    const float2 a = CombineHiZ(Source[SourceTexel(texel, uint2(0, 0))], Source[SourceTexel(texel, uint2(1, 0))]);
+    const float2 b = CombineHiZ(Source[SourceTexel(texel, uint2(0, 1))], Source[SourceTexel(texel, uint2(1, 1))]);
+    Destination[texel] = CombineHiZ(a, b);
+}
@@ -89,4 +89,36 @@ float4 ScreenToView(float4 screen, float2 invViewDimensions, float4x4 inversePro
     float4 clip = float4(float2(texCoord.x, 1.f - texCoord.y) * 2.f - 1.f, screen.z, screen.w);
     
     return ClipToView(clip, inverseProjection);
-}
\ No newline at end of file
+}
+
+// A Hi-Z texel holds the farthest (x) and nearest (y) reversed depth of the pixels it covers. When some of
+// them are empty, x is negated and holds the farthest depth of the geometry.
+float HiZNearestDepth(float2 hiz)
+{
+    return hiz.y;
+}
+
+// Conservative farthest depth for occlusion tests. Empty pixels count as the far plane.
+float HiZFarthestDepth(float2 hiz)
+{
+    return max(hiz.x, 0.f);
+}
+
+// Farthest depth of the geometry only, for fitting depth ranges like the light culling tiles.
+float HiZFarthestGeometryDepth(float2 hiz)
+{
+    return abs(hiz.x);
+}
+
+bool HiZIsEmpty(float2 hiz)
+{
+    return hiz.y == 0.f;
+}
+
+// Clip space position of a vertex. The depth prepass and the gpass both go through this, and the result is precise,
+// so the compiler can't fuse or reorder the math differently in the two shaders and both produce the same depth.
+float4 ClipSpacePosition(float4x4 worldViewProjection, float3 position)
+{
+    precise float4 clipPosition = mul(worldViewProjection, float4(position, 1.f));
+    return clipPosition;
+}
@@ -5,6 +5,7 @@
 
 #define USE_BOUNDING_SPHERES 1
 #define TILE_SIZE 32
+#define HIZ_TILE_MIP 4          // the Hi-Z level with one texel per TILE_SIZE x TILE_SIZE tile
 
 struct GlobalShaderData
 {
@@ -24,12 +25,31 @@ struct GlobalShaderData
     float       DeltaTime;
 };
 
-struct PerObjectData
+// Per draw constants. A draw is a run of instances that share geometry, pipeline state and material.
+struct PerDrawData
+{
+    uint FirstInstance;
+    uint3 _pad;
+};
+
+struct PerInstanceData
 {
     float4x4 World;
     float4x4 InvWorld;
     float4x4 WorldViewProjection;
     
+    uint MaterialIndex;
+    uint3 _pad;
+};
+
+// What the position only depth prepass reads per instance.
+struct DepthInstanceData
+{
+    float4x4 WorldViewProjection;
+};
+
+struct MaterialSurfaceData
+{
     float4 BaseColor;
     float3 Emissive;
     float EmissiveIntensity;
@@ -89,6 +109,12 @@ struct LightCullingDispatchParameters
     uint        NumLights;
 };
 
+struct HiZDispatchParameters
+{
+    uint2       SourceSize;             // texels of the level being read that cover the view
+    uint2       DestinationSize;        // texels of the level being written that cover the view
+};
+
 struct LightCullingLightInfo
 {
     float3      Position;
@@ -135,7 +161,9 @@ struct DirectionalLightParameters
 };
 
 #ifdef __cplusplus
-static_assert((sizeof(PerObjectData) % 16) == 0, "Make sure PerObjectData is formatted in 16 byte chunks without any implicit padding");
+static_assert((sizeof(PerDrawData) % 16) == 0, "Make sure PerDrawData is formatted in 16 byte chunks without any implicit padding");
+static_assert((sizeof(PerInstanceData) % 16) == 0, "Make sure PerInstanceData is formatted in 16 byte chunks without any implicit padding");
+static_assert((sizeof(MaterialSurfaceData) % 16) == 0, "Make sure MaterialSurfaceData is formatted in 16 byte chunks without any implicit padding");
 static_assert((sizeof(LightParameters) % 16) == 0, "Make sure LightParameters is formatted in 16 byte chunks without any implicit padding");
 static_assert((sizeof(LightCullingLightInfo) % 16) == 0, "Make sure LightCullingLightInfo is formatted in 16 byte chunks without any implicit padding");
 static_assert((sizeof(DirectionalLightParameters) % 16) == 0, "Make sure DirectionalLightParameters is formatted in 16 byte chunks without any implicit padding");
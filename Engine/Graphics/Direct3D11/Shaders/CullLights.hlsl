@@ -3,8 +3,6 @@
 #if USE_BOUNDING_SPHERES
 static const uint           MaxLightsPerGroup = 1024;
 
-groupshared uint                                _minDepthVS;
-groupshared uint                                _maxDepthVS;
 groupshared uint                                _lightCount;
 groupshared uint                                _lightIndexStartOffset;
 groupshared uint                                _lightIndexList[MaxLightsPerGroup];
@@ -18,6 +16,7 @@ StructuredBuffer<Frustum>                       Frustums                :
 StructuredBuffer<LightCullingLightInfo>         Lights                  :       register(t1);
 StructuredBuffer<Sphere>                        BoundingSpheres         :       register(t2);
 Texture2D                                       GPassDepth              :       register(t3);
+Texture2D<float2>                               HiZ                     :       register(t4);
 
 RWStructuredBuffer<uint>                        LightIndexCounter       :       register(u0);
 RWStructuredBuffer<uint2>                       LightGrid_Opaque        :       register(u1);
@@ -63,8 +62,6 @@ void CullLightsCS(ComputeShaderInput csIn)
     
     if (csIn.GroupIndex == 0)
     {
-        _minDepthVS = 0x7f7fffff;
-        _maxDepthVS = 0;
         _lightCount = 0;
         _opaqueLightIndex = 0;
     }
@@ -77,24 +74,16 @@ void CullLightsCS(ComputeShaderInput csIn)
     }
     
     //DEPTH MIN/MAX SECTION
-    GroupMemoryBarrierWithGroupSync();
-    
-    const float depthVS = ClipToView(float4(0.f, 0.f, depth, 1.f), GlobalData.InvProjection).z;
-    const uint z = asuint(-depthVS);
-    
-    if (depth != 0)
-    {
-        InterlockedMin(_minDepthVS, z);
-        InterlockedMax(_maxDepthVS, z);
-    }
+    const float2 tileDepth = HiZ.Load(uint3(csIn.GroupID.xy, HIZ_TILE_MIP));
+    const float minDepthVS = ClipToView(float4(0.f, 0.f, HiZNearestDepth(tileDepth), 1.f), GlobalData.InvProjection).z;
+    const float maxDepthVS = ClipToView(float4(0.f, 0.f, HiZFarthestGeometryDepth(tileDepth), 1.f), GlobalData.InvProjection).z;
+    // NOTE: no light can touch a tile where nothing was drawn.
+    const uint numLights = HiZIsEmpty(tileDepth) ? 0 : ShaderParams.NumLights;
     
     //LIGHT CULLING SECTION
     GroupMemoryBarrierWithGroupSync();
     
-    const float minDepthVS = -asfloat(_minDepthVS);
-    const float maxDepthVS = -asfloat(_maxDepthVS);
-    
-    for (i = csIn.GroupIndex; i < ShaderParams.NumLights; i += TILE_SIZE * TILE_SIZE)
+    for (i = csIn.GroupIndex; i < numLights; i += TILE_SIZE * TILE_SIZE)
     {
         Sphere sphere = BoundingSpheres[i];
         sphere.Center = mul(GlobalData.View, float4(sphere.Center, 1.f)).xyz;
@@ -173,8 +162,6 @@ void CullLightsCS(ComputeShaderInput csIn)
 
 static const uint           MaxLightsPerGroup = 1024;
 
-groupshared uint            _minDepthVS;
-groupshared uint            _maxDepthVS;
 groupshared uint            _lightCount;
 groupshared uint            _lightIndexStartOffset;
 groupshared uint            _lightIndexList[MaxLightsPerGroup];
@@ -183,7 +170,7 @@ cbuffer                                         b00                     :
 cbuffer                                         b01                     :       register(b1) { LightCullingDispatchParameters ShaderParams; }
 StructuredBuffer<Frustum>                       Frustums                :       register(t0);
 StructuredBuffer<LightCullingLightInfo>         Lights                  :       register(t1);
-Texture2D                                       GPassDepth              :       register(t2);
+Texture2D<float2>                               HiZ                     :       register(t2);
 
 RWStructuredBuffer<uint>                        LightIndexCounter       :       register(u0);
 RWStructuredBuffer<uint2>                       LightGrid_Opaque        :       register(u1);
@@ -195,36 +182,25 @@ void CullLightsCS(ComputeShaderInput csIn)
     //INITIALIZATION SECTION
     if (csIn.GroupIndex == 0)
     {
-        _minDepthVS = 0x7f7fffff;
-        _maxDepthVS = 0;
         _lightCount = 0;
     }
     
     uint i = 0, index = 0;
     
     //DEPTH MIN/MAX SECTION
-    GroupMemoryBarrierWithGroupSync();
-    
-    const float depth = GPassDepth[csIn.DispatchThreadID.xy].r;
-    
-    const float depthVS = ClipToView(float4(0.f, 0.f, depth, 1.f), GlobalData.InvProjection).z;
-    const uint z = asuint(-depthVS);
-    
-    if (depth != 0)
-    {
-        InterlockedMin(_minDepthVS, z);
-        InterlockedMax(_maxDepthVS, z);
-    }
+    const float2 tileDepth = HiZ.Load(uint3(csIn.GroupID.xy, HIZ_TILE_MIP));
+    const float minDepthVS = ClipToView(float4(0.f, 0.f, HiZNearestDepth(tileDepth), 1.f), GlobalData.InvProjection).z;
+    const float maxDepthVS = ClipToView(float4(0.f, 0.f, HiZFarthestGeometryDepth(tileDepth), 1.f), GlobalData.InvProjection).z;
+    // NOTE: no light can touch a tile where nothing was drawn.
+    const uint numLights = HiZIsEmpty(tileDepth) ? 0 : ShaderParams.NumLights;
     
     //LIGHT CULLING SECTION
     GroupMemoryBarrierWithGroupSync();
     
     const uint gridIndex = csIn.GroupID.x + (csIn.GroupID.y * ShaderParams.NumThreadGroups.x);
     const Frustum frustum = Frustums[gridIndex];
-    const float minDepthVS = -asfloat(_minDepthVS);
-    const float maxDepthVS = -asfloat(_maxDepthVS);
     
-    for (i = csIn.GroupIndex; i < ShaderParams.NumLights; i += TILE_SIZE * TILE_SIZE)
+    for (i = csIn.GroupIndex; i < numLights; i += TILE_SIZE * TILE_SIZE)
     {
         const LightCullingLightInfo light = Lights[i];
         const float3 lightPositionVS = mul(GlobalData.View, float4(light.Position, 1.f)).xyz;
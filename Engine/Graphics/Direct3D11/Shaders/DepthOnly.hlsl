@@ -0,0 +1,23 @@
+#include "Common.hlsli"
+
+// Depth prepass for materials that don't change the shape of their geometry. It only fetches positions
+// and one matrix per instance, so the same shader fills depth for all of them.
+
+cbuffer b00 : register(b0)
+{
+    GlobalShaderData GlobalData;
+};
+cbuffer b01 : register(b1)
+{
+    PerDrawData PerDraw;
+};
+
+StructuredBuffer<float3>                        VertexPositions         :   register(t0);
+StructuredBuffer<DepthInstanceData>             Instances               :   register(t2);
+
+float4 DepthOnlyVS(in uint VertexIdx : SV_VertexID, in uint InstanceIdx : SV_InstanceID) : SV_Position
+{
+    // NOTE: D3D11 doesn't add the start instance location to SV_InstanceID, so the draw's first instance comes in a constant.
+    const float4x4 worldViewProjection = Instances[PerDraw.FirstInstance + InstanceIdx].WorldViewProjection;
+    return ClipSpacePosition(worldViewProjection, VertexPositions[VertexIdx]);
+}
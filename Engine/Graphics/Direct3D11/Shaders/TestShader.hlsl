@@ -3,11 +3,12 @@
 
 struct VertexOut
 {
-    float4 HomogeneousPosition : SV_POSITION;
+    precise float4 HomogeneousPosition : SV_POSITION;
     float3 WorldPosition : POSITION;
     float3 WorldNormal : NORMAL;
     float4 WorldTangent : TANGENT;
     float2 UV : TEXTURE;
+    nointerpolation uint MaterialIndex : MATERIAL_INDEX;
 };
 
 struct PixelOut
@@ -63,11 +64,12 @@ cbuffer b00 : register(b0)
 };
 cbuffer b01 : register(b1)
 {
-    PerObjectData PerObjectBuffer;
+    PerDrawData PerDraw;
 };
 
 StructuredBuffer<float3>                        VertexPositions         :   register(t0);
 StructuredBuffer<VertexElement>                 Elements                :   register(t1);
+StructuredBuffer<PerInstanceData>               Instances               :   register(t2);
 StructuredBuffer<DirectionalLightParameters>    DirectionalLights       :   register(t3);
 StructuredBuffer<LightParameters>               CullableLights          :   register(t4);
 StructuredBuffer<uint2>                         LightGrid               :   register(t5);
@@ -77,17 +79,22 @@ Texture2D                                       BaseColorTexture        :   regi
 Texture2D                                       EmissiveColorTexture    :   register(t9);
 Texture2D                                       MetalRoughTexture       :   register(t10);
 Texture2D                                       NormalTexture           :   register(t11);
+StructuredBuffer<MaterialSurfaceData>           Materials               :   register(t12);
 
 SamplerState                                    PointSampler            :   register(s0);
 SamplerState                                    LinearSampler           :   register(s1);
 SamplerState                                    AnisotropicSampler      :   register(s2);
 
-VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID)
+VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID, in uint InstanceIdx : SV_InstanceID)
 {
     VertexOut vsOut;
 
+    // NOTE: D3D11 doesn't add the start instance location to SV_InstanceID, so the draw's first instance comes in a constant.
+    const PerInstanceData instance = Instances[PerDraw.FirstInstance + InstanceIdx];
+    vsOut.MaterialIndex = instance.MaterialIndex;
+
     float4 position = float4(VertexPositions[VertexIdx], 1.f);
-    float4 worldPosition = mul(PerObjectBuffer.World, position);
+    float4 worldPosition = mul(instance.World, position);
    
 #if ELEMENTS_TYPE == ElementsTypeStaticNormal
     VertexElement element = Elements[VertexIdx];
@@ -101,9 +108,9 @@ VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID)
     normal.y = (nrm >> 16) * InvIntervals - 1.f;
     normal.z = sqrt(saturate(1.f - dot(normal.xy, normal.xy))) * nSign;
     
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = ClipSpacePosition(instance.WorldViewProjection, VertexPositions[VertexIdx]);
     vsOut.WorldPosition = worldPosition.xyz;
-    vsOut.WorldNormal = normalize(mul(normal, (float3x3)PerObjectBuffer.InvWorld));
+    vsOut.WorldNormal = normalize(mul(normal, (float3x3)instance.InvWorld));
     vsOut.WorldTangent = 0.f;
     vsOut.UV = 0.f;
 #elif ELEMENTS_TYPE == ElementsTypeStaticNormalTexture
@@ -128,14 +135,14 @@ VertexOut TestShaderVS(in uint VertexIdx : SV_VertexID)
     
     tangent = tangent - normal * dot(normal, tangent);
 
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = ClipSpacePosition(instance.WorldViewProjection, VertexPositions[VertexIdx]);
     vsOut.WorldPosition = worldPosition.xyz;
-    vsOut.WorldNormal = normalize(mul(normal, (float3x3)PerObjectBuffer.InvWorld));
-    vsOut.WorldTangent = float4(normalize(mul(tangent, (float3x3)PerObjectBuffer.InvWorld)), -hSign);
+    vsOut.WorldNormal = normalize(mul(normal, (float3x3)instance.InvWorld));
+    vsOut.WorldTangent = float4(normalize(mul(tangent, (float3x3)instance.InvWorld)), -hSign);
     vsOut.UV = element.UV;
 #else
 #undef ELEMENTS_TYPE
-    vsOut.HomogeneousPosition = mul(PerObjectBuffer.WorldViewProjection, position);
+    vsOut.HomogeneousPosition = ClipSpacePosition(instance.WorldViewProjection, VertexPositions[VertexIdx]);
     vsOut.WorldPosition = worldPosition.xyz;
     vsOut.WorldNormal = 0.f;
     vsOut.WorldTangent = 0.f;
@@ -256,14 +263,15 @@ float3 SpotLight(Surface S, float3 worldPosition, LightParameters light)
 Surface GetSurface(VertexOut psIn, float3 V)
 {
     Surface s;
+    const MaterialSurfaceData material = Materials[psIn.MaterialIndex];
     
-    s.BaseColor = PerObjectBuffer.BaseColor.rgb;
-    s.Metallic = PerObjectBuffer.Metallic;
+    s.BaseColor = material.BaseColor.rgb;
+    s.Metallic = material.Metallic;
     s.Normal = normalize(psIn.WorldNormal);
-    s.PerceptualRoughness = max(PerObjectBuffer.Roughness, 0.045f);
-    s.EmissiveColor = PerObjectBuffer.Emissive;
-    s.EmissiveIntensity = PerObjectBuffer.EmissiveIntensity;
-    s.AmbientOcclusion = PerObjectBuffer.AmbientOcclusion;
+    s.PerceptualRoughness = max(material.Roughness, 0.045f);
+    s.EmissiveColor = material.Emissive;
+    s.EmissiveIntensity = material.EmissiveIntensity;
+    s.AmbientOcclusion = material.AmbientOcclusion;
     
 #if TEXTURED_MTL
     float2 uv = psIn.UV;
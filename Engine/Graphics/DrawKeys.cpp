@@ -0,0 +1,101 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "DrawKeys.h"
+#include "Utilities/JobSystem.h"
+
+namespace primal::graphics {
+namespace {
+
+constexpr u32 radix_bits{ 8 };
+constexpr u32 radix_size{ 1 << radix_bits };
+constexpr u32 pass_count{ 64 / radix_bits };
+// Large enough for the chunk's histogram to be cheap next to the keys it counts.
+constexpr u32 sort_chunk_size{ 16 * 1024 };
+
+[[nodiscard]] constexpr u32
+digit(u64 key, u32 pass)
+{
+    return (u32)(key >> (pass * radix_bits)) & (radix_size - 1);
+}
+
+} // anonymous namespace
+
+const u32* const
+radix_sorter::sort(const u64* const keys, u32 count)
+{
+    assert(keys || !count);
+    for (u32 i{ 0 }; i < 2; ++i)
+    {
+        _keys[i].resize(count);
+        _indices[i].resize(count);
+    }
+
+    _current = 0;
+    if (!count) return _indices[0].data();
+
+    const u32 chunks{ jobs::chunk_count(count, sort_chunk_size) };
+    _histograms.resize(chunks * radix_size);
+
+    u64* const first_keys{ _keys[0].data() };
+    u32* const first_indices{ _indices[0].data() };
+    jobs::parallel_for(count, sort_chunk_size, [keys, first_keys, first_indices](u32, u32 begin, u32 end) {
+        memcpy(&first_keys[begin], &keys[begin], (end - begin) * sizeof(u64));
+        for (u32 i{ begin }; i < end; ++i) first_indices[i] = i;
+        });
+
+    for (u32 pass{ 0 }; pass < pass_count; ++pass)
+    {
+        const u64* const src_keys{ _keys[_current].data() };
+        const u32* const src_indices{ _indices[_current].data() };
+        u64* const dst_keys{ _keys[_current ^ 1].data() };
+        u32* const dst_indices{ _indices[_current ^ 1].data() };
+        u32* const histograms{ _histograms.data() };
+
+        jobs::parallel_for(count, sort_chunk_size, [src_keys, histograms, pass](u32 chunk, u32 begin, u32 end) {
+            u32* const histogram{ &histograms[chunk * radix_size] };
+            memset(histogram, 0, radix_size * sizeof(u32));
+            for (u32 i{ begin }; i < end; ++i) ++histogram[digit(src_keys[i], pass)];
+            });
+
+        // Turn the counts into the offset each chunk writes its keys of each digit to: all keys with a
+        // smaller digit come first, then the keys with the same digit from the chunks before.
+        u32 offset{ 0 };
+        bool is_same_digit{ false };
+        for (u32 d{ 0 }; d < radix_size; ++d)
+        {
+            u32 digit_count{ 0 };
+            for (u32 chunk{ 0 }; chunk < chunks; ++chunk)
+            {
+                u32& histogram_count{ histograms[chunk * radix_size + d] };
+                const u32 chunk_count{ histogram_count };
+                histogram_count = offset;
+                offset += chunk_count;
+                digit_count += chunk_count;
+            }
+
+            if (digit_count == count)
+            {
+                is_same_digit = true;
+                break;
+            }
+        }
+
+        // All keys have the same digit in this pass, so it wouldn't change the order.
+        if (is_same_digit) continue;
+
+        jobs::parallel_for(count, sort_chunk_size, [=](u32 chunk, u32 begin, u32 end) {
+            u32* const chunk_offsets{ &histograms[chunk * radix_size] };
+            for (u32 i{ begin }; i < end; ++i)
+            {
+                const u32 index{ chunk_offsets[digit(src_keys[i], pass)]++ };
+                dst_keys[index] = src_keys[i];
+                dst_indices[index] = src_indices[i];
+            }
+            });
+
+        _current ^= 1;
+    }
+
+    return _indices[_current].data();
+}
+}
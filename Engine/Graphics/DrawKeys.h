@@ -0,0 +1,102 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+namespace primal::graphics {
+
+// 64-bit sort keys for draws. Sorting by key groups draws by pass, then pipeline state, then material,
+// then geometry, so consecutive draws share as much state as possible and draws of the same geometry with
+// the same material end up next to each other, ready to be instanced. Within that, opaque draws go front to
+// back to make the most of early depth rejection, and transparent ones back to front.
+//
+// | pass: 4 | pipeline: 16 | material: 16 | geometry: 16 | depth: 12 |
+namespace draw_key {
+
+struct pass
+{
+    enum type : u32
+    {
+        depth_prepass = 0,		// pipeline is the depth only variant, material is unused
+        opaque,
+        transparent,
+
+        count
+    };
+};
+
+constexpr u32 pass_bits{ 4 };
+constexpr u32 pipeline_bits{ 16 };
+constexpr u32 material_bits{ 16 };
+constexpr u32 geometry_bits{ 16 };
+constexpr u32 depth_bits{ 12 };
+static_assert(pass_bits + pipeline_bits + material_bits + geometry_bits + depth_bits == 64);
+static_assert(pass::count <= (1u << pass_bits));
+
+constexpr u32 depth_shift{ 0 };
+constexpr u32 geometry_shift{ depth_shift + depth_bits };
+constexpr u32 material_shift{ geometry_shift + geometry_bits };
+constexpr u32 pipeline_shift{ material_shift + material_bits };
+constexpr u32 pass_shift{ pipeline_shift + pipeline_bits };
+
+constexpr u64 depth_mask{ (1ull << depth_bits) - 1 };
+constexpr u64 geometry_mask{ (1ull << geometry_bits) - 1 };
+constexpr u64 material_mask{ (1ull << material_bits) - 1 };
+constexpr u64 pipeline_mask{ (1ull << pipeline_bits) - 1 };
+constexpr u64 pass_mask{ (1ull << pass_bits) - 1 };
+
+// Maps a view space depth to 12 bits that sort the same way. The bits of a positive float sort like
+// the float, so this keeps its exponent and the top of its mantissa: 16 steps per doubling of the
+// distance, which is plenty for front to back and doesn't need to know the far plane.
+[[nodiscard]] inline u32
+quantize_depth(f32 view_depth)
+{
+    view_depth = view_depth > 0.f ? view_depth : 0.f;
+    u32 bits;
+    memcpy(&bits, &view_depth, sizeof(u32));
+    return bits >> (31 - depth_bits);
+}
+
+// pipeline_id, material_id and geometry_id are indices. Only their low bits are kept, so in a scene with
+// more than 64K of them, some draws that differ share a key: they still draw correctly, but sort and
+// batch less well.
+[[nodiscard]] constexpr u64
+make(pass::type draw_pass, u32 pipeline_id, u32 material_id, u32 geometry_id, u32 quantized_depth)
+{
+    u64 depth{ quantized_depth & depth_mask };
+    if (draw_pass == pass::transparent) depth = depth_mask - depth;
+
+    return ((u64)(draw_pass & pass_mask) << pass_shift) | ((pipeline_id & pipeline_mask) << pipeline_shift) |
+        ((material_id & material_mask) << material_shift) | ((geometry_id & geometry_mask) << geometry_shift) |
+        (depth << depth_shift);
+}
+
+[[nodiscard]] constexpr pass::type pass_of(u64 key) { return (pass::type)((key >> pass_shift) & pass_mask); }
+[[nodiscard]] constexpr u32 pipeline_id(u64 key) { return (u32)((key >> pipeline_shift) & pipeline_mask); }
+[[nodiscard]] constexpr u32 material_id(u64 key) { return (u32)((key >> material_shift) & material_mask); }
+[[nodiscard]] constexpr u32 geometry_id(u64 key) { return (u32)((key >> geometry_shift) & geometry_mask); }
+}
+
+// Stable LSD radix sort of 64-bit keys, 8 bits per pass. Histograms and scatters run in parallel chunks
+// on the job system. Passes over bytes that are the same in all keys are skipped, which is most of them
+// for draw keys, because ids and depths rarely use all of their bits. Buffers are kept across calls, so
+// sorting every frame doesn't allocate once the item count settles.
+class radix_sorter
+{
+public:
+    radix_sorter() = default;
+    DISABLE_COPY_AND_MOVE(radix_sorter);
+
+    // Sorts count keys and returns, for each position in sorted order, the index of the key in keys.
+    // Equal keys keep their order. The result stays valid until the next call.
+    const u32* const sort(const u64* const keys, u32 count);
+    // The keys in sorted order after sort().
+    [[nodiscard]] const u64* const sorted_keys() const { return _keys[_current].data(); }
+
+private:
+    utl::vector<u64>		_keys[2];
+    utl::vector<u32>		_indices[2];
+    utl::vector<u32>		_histograms;	// 256 digit counts per chunk
+    u32						_current{ 0 };
+};
+}
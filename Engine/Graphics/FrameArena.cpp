@@ -0,0 +1,31 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "FrameArena.h"
+
+namespace primal::graphics {
+
+void
+frame_arena::reserve(u64 size)
+{
+    if (size <= _capacity) return;
+    assert(!_offset);
+
+    const u64 new_capacity{ math::align_size_up<cache_line_size>(std::max(size, _capacity + (_capacity >> 1))) };
+    // NOTE: a new vector instead of resize(), because there's nothing worth copying.
+    _buffer = utl::vector<u8>(new_capacity + cache_line_size);
+    _memory = (u8*)math::align_size_up<cache_line_size>((uintptr_t)_buffer.data());
+    _capacity = new_capacity;
+    _offset = 0;
+}
+
+void* const
+frame_arena::allocate(u64 size, u64 alignment)
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+    const u64 offset{ math::align_size_up(_offset, alignment) };
+    if (offset + size > _capacity) return nullptr;
+
+    _offset = offset + size;
+    return &_memory[offset];
+}
+}
@@ -0,0 +1,82 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include <tuple>
+
+namespace primal::graphics {
+
+// Linear allocator for data that only lives for a frame. Allocations are a pointer bump and are all
+// freed at once by reset(). The memory is kept across frames and only grows, so once the frame sizes
+// settle, nothing is allocated anymore.
+class frame_arena
+{
+public:
+    constexpr static u32 cache_line_size{ 64 };
+
+    frame_arena() = default;
+    DISABLE_COPY_AND_MOVE(frame_arena);
+
+    // Frees everything allocated since the last reset(), keeping the memory.
+    constexpr void reset() { _offset = 0; }
+    // Makes sure size bytes fit. Growing moves the memory, so it's only allowed right after reset().
+    // The capacity grows by at least half, which amortizes growth when the frame size creeps up.
+    void reserve(u64 size);
+    // Returns nullptr if the allocation doesn't fit in the reserved capacity.
+    [[nodiscard]] void* const allocate(u64 size, u64 alignment = cache_line_size);
+
+    template<typename T>
+    [[nodiscard]] T* const allocate(u32 count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Nothing in a frame arena gets destroyed");
+        return (T* const)allocate(count * sizeof(T), std::max((u64)alignof(T), (u64)cache_line_size));
+    }
+
+    [[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+    [[nodiscard]] constexpr u64 used() const { return _offset; }
+
+private:
+    utl::vector<u8>		_buffer;
+    u8*					_memory{ nullptr };		// _buffer's data, aligned to a cache line
+    u64					_capacity{ 0 };
+    u64					_offset{ 0 };
+};
+
+// Structure of arrays with one column per type, allocated from a frame arena. Each column starts on its
+// own cache line, so jobs that fill disjoint ranges of chunk_multiple elements never write to the same
+// cache line, whatever the column type.
+template<typename... T>
+class soa_array
+{
+public:
+    using columns = std::tuple<T*...>;
+    constexpr static u32 chunk_multiple{ frame_arena::cache_line_size };
+
+    soa_array() = default;
+    DISABLE_COPY_AND_MOVE(soa_array);
+
+    // Bytes needed to allocate count elements, padding included.
+    [[nodiscard]] constexpr static u64 size_in_bytes(u32 count)
+    {
+        return (... + math::align_size_up<frame_arena::cache_line_size>((u64)count * sizeof(T)));
+    }
+
+    // Allocates count elements in every column. The elements are not initialized. The columns stay
+    // valid until the arena is reset, so this is called once per frame after the arena is reserved.
+    void allocate(frame_arena& arena, u32 count)
+    {
+        _columns = columns{ arena.allocate<T>(count)... };
+        _size = count;
+        assert(std::apply([](auto*... column) { return (... && column); }, _columns));
+    }
+
+    template<u32 I>
+    [[nodiscard]] constexpr auto* const column() const { return std::get<I>(_columns); }
+    [[nodiscard]] constexpr const columns& data() const { return _columns; }
+    [[nodiscard]] constexpr u32 size() const { return _size; }
+
+private:
+    columns		_columns{};
+    u32			_size{ 0 };
+};
+}
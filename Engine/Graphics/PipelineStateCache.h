@@ -0,0 +1,212 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "Graphics/StableArray.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace primal::graphics {
+
+// Open addressing (linear probing) hash table from 64-bit keys to 32-bit ids. Lookups are lock free and
+// can run on any thread while another thread inserts. Inserts are serialized by the caller.
+// When the table grows, readers may still be probing the old one, so old tables are only freed by
+// reclaim(), which skips them while any lookup is running. Entries are never removed one by one,
+// which is what keeps the lock-free probing simple.
+class hashed_id_map
+{
+public:
+    constexpr static u64 empty_key{ ~0ull };
+
+    hashed_id_map() { grow(initial_capacity); }
+    DISABLE_COPY_AND_MOVE(hashed_id_map);
+
+    [[nodiscard]] u32 find(u64 key) const
+    {
+        assert(key != empty_key);
+        // NOTE: the reader count is raised before the table is loaded, and reclaim() publishes the new table
+        //		 before it reads the count. Both are sequentially consistent, so either reclaim() sees this
+        //		 lookup or this lookup sees the newest table, which reclaim() never frees.
+        _reader_count.fetch_add(1);
+        const table* const t{ _table.load() };
+        const u32 mask{ t->capacity - 1 };
+        u32 value{ u32_invalid_id };
+        for (u32 slot{ (u32)mix(key) & mask };; slot = (slot + 1) & mask)
+        {
+            const u64 slot_key{ t->keys[slot].load(std::memory_order_acquire) };
+            if (slot_key == key)
+            {
+                value = t->values[slot].load(std::memory_order_relaxed);
+                break;
+            }
+            if (slot_key == empty_key) break;
+        }
+
+        _reader_count.fetch_sub(1, std::memory_order_release);
+        return value;
+    }
+
+    // Writers only. The caller makes sure no other insert() or clear() runs at the same time.
+    void insert(u64 key, u32 value)
+    {
+        assert(key != empty_key && value != u32_invalid_id);
+        table* t{ _table.load(std::memory_order_relaxed) };
+        if ((t->count + 1) * 2 > t->capacity)
+        {
+            grow(t->capacity * 2);
+            t = _table.load(std::memory_order_relaxed);
+        }
+
+        if (store(*t, key, value)) ++t->count;
+    }
+
+    // Writers only. Frees the tables left behind by growth, unless a lookup is running, which may still
+    // be probing one of them. Those tables are then freed by a later call.
+    void reclaim()
+    {
+        if (_tables.size() < 2 || _reader_count.load()) return;
+        _tables.erase(_tables.begin(), _tables.end() - 1);
+    }
+
+    // No lookup or insert may be running.
+    void clear()
+    {
+        _tables.clear();
+        grow(initial_capacity);
+    }
+
+    // Writers only, since the table it reads could be reclaimed under a reader.
+    [[nodiscard]] u32 size() const { return _table.load(std::memory_order_relaxed)->count; }
+
+private:
+    constexpr static u32 initial_capacity{ 64 };
+
+    struct table
+    {
+        std::unique_ptr<std::atomic<u64>[]>		keys;
+        std::unique_ptr<std::atomic<u32>[]>		values;
+        u32										capacity;
+        u32										count;
+    };
+
+    // Hashes going in are often CRCs or ids, so scramble the bits before using the low ones as a slot index.
+    [[nodiscard]] constexpr static u64 mix(u64 key)
+    {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Returns false if the key was already there.
+    static bool store(table& t, u64 key, u32 value)
+    {
+        const u32 mask{ t.capacity - 1 };
+        for (u32 slot{ (u32)mix(key) & mask };; slot = (slot + 1) & mask)
+        {
+            const u64 slot_key{ t.keys[slot].load(std::memory_order_relaxed) };
+            if (slot_key == key)
+            {
+                t.values[slot].store(value, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (slot_key == empty_key)
+            {
+                // Publish the value before the key, so a reader that sees the key also sees the value.
+                t.values[slot].store(value, std::memory_order_relaxed);
+                t.keys[slot].store(key, std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    void grow(u32 capacity)
+    {
+        assert(capacity && !(capacity & (capacity - 1)));
+        std::unique_ptr<table> t{ std::make_unique<table>() };
+        t->keys = std::make_unique<std::atomic<u64>[]>(capacity);
+        t->values = std::make_unique<std::atomic<u32>[]>(capacity);
+        t->capacity = capacity;
+        t->count = 0;
+        for (u32 i{ 0 }; i < capacity; ++i) t->keys[i].store(empty_key, std::memory_order_relaxed);
+
+        if (!_tables.empty())
+        {
+            const table& old{ *_tables.back() };
+            for (u32 i{ 0 }; i < old.capacity; ++i)
+            {
+                const u64 key{ old.keys[i].load(std::memory_order_relaxed) };
+                if (key != empty_key && store(*t, key, old.values[i].load(std::memory_order_relaxed))) ++t->count;
+            }
+        }
+
+        _table.store(t.get());
+        _tables.emplace_back(std::move(t));
+    }
+
+    std::atomic<table*>						_table{ nullptr };
+    mutable std::atomic<u32>				_reader_count{ 0 };	// lookups that may be probing any table
+    utl::vector<std::unique_ptr<table>>		_tables;	// the last one is current, the others wait for reclaim()
+};
+
+// Deduplicated pipeline state objects (shaders, PSOs, fixed function state), keyed by a hash of what
+// they're created from. get() and find() are lock free, so the render thread can resolve states every
+// frame while loading threads create new ones with get_or_create().
+template<typename T>
+class pipeline_state_cache
+{
+public:
+    // Returns the id of the state with this key, creating it with create() if it's not in the cache yet.
+    // create() runs under the cache's writer lock and returns the new T.
+    template<typename F>
+    [[nodiscard]] u32 get_or_create(u64 key, F&& create)
+    {
+        const u32 existing{ _map.find(key) };
+        if (existing != u32_invalid_id) return existing;
+
+        std::lock_guard lock{ _mutex };
+        u32 id{ _map.find(key) };
+        if (id == u32_invalid_id)
+        {
+            id = _states.add(create());
+            _map.insert(key, id);
+        }
+
+        return id;
+    }
+
+    // Lock free. Returns u32_invalid_id if nothing was created with this key.
+    [[nodiscard]] u32 find(u64 key) const { return _map.find(key); }
+    // Lock free.
+    [[nodiscard]] const T& get(u32 id) const { return _states[id]; }
+    [[nodiscard]] const T& operator[](u32 id) const { return _states[id]; }
+    [[nodiscard]] u32 size() const { return _states.size(); }
+
+    // Frees memory left behind by growth. Safe to call at any time, but meant for once per frame,
+    // e.g. after the frame fence wait, so the old tables don't pile up while loading.
+    void reclaim()
+    {
+        std::lock_guard lock{ _mutex };
+        _map.reclaim();
+    }
+
+    // Calls release(state) for every state and empties the cache. Nothing else may use the cache meanwhile.
+    template<typename F>
+    void clear(F&& release)
+    {
+        std::lock_guard lock{ _mutex };
+        for (u32 i{ 0 }; i < _states.size(); ++i) release(_states.at(i));
+        _states.clear();
+        _map.clear();
+    }
+
+private:
+    hashed_id_map			_map;
+    stable_array<T>			_states;
+    std::mutex				_mutex{};
+};
+}
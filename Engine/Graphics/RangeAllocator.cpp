@@ -0,0 +1,201 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "RangeAllocator.h"
+
+namespace primal::graphics {
+
+void
+range_allocator::initialize(u64 capacity)
+{
+    assert(capacity);
+    _ranges.clear();
+    _free_handles.clear();
+    _free_blocks.clear();
+    _free_blocks.emplace_back(block{ 0, capacity });
+    _capacity = capacity;
+    _used = 0;
+}
+
+u32
+range_allocator::allocate(u64 size, u64 alignment)
+{
+    assert(size && alignment && !(alignment & (alignment - 1)));
+
+    // Best fit: take the smallest block that can hold the aligned range, to keep large blocks for large meshes.
+    u32 best{ u32_invalid_id };
+    u64 best_size{ ~0ull };
+    const u32 block_count{ (u32)_free_blocks.size() };
+    for (u32 i{ 0 }; i < block_count; ++i)
+    {
+        const block& b{ _free_blocks[i] };
+        const u64 padding{ math::align_size_up(b.offset, alignment) - b.offset };
+        if (b.size >= size + padding && b.size < best_size)
+        {
+            best = i;
+            best_size = b.size;
+            if (b.size == size + padding) break;
+        }
+    }
+
+    if (best == u32_invalid_id) return u32_invalid_id;
+
+    block& b{ _free_blocks[best] };
+    const u64 offset{ math::align_size_up(b.offset, alignment) };
+    const u64 padding{ offset - b.offset };
+    const u64 remainder{ b.size - size - padding };
+
+    // NOTE: alignment padding is given back as a free block of its own.
+    if (padding && remainder)
+    {
+        b.size = padding;
+        _free_blocks.insert(_free_blocks.begin() + best + 1, block{ offset + size, remainder });
+    }
+    else if (padding)
+    {
+        b.size = padding;
+    }
+    else if (remainder)
+    {
+        b.offset += size;
+        b.size = remainder;
+    }
+    else
+    {
+        _free_blocks.erase(_free_blocks.begin() + best);
+    }
+
+    u32 handle{ u32_invalid_id };
+    if (!_free_handles.empty())
+    {
+        handle = _free_handles.back();
+        _free_handles.pop_back();
+    }
+    else
+    {
+        handle = (u32)_ranges.size();
+        _ranges.emplace_back();
+    }
+
+    _ranges[handle] = range{ offset, size, alignment };
+    _used += size;
+    return handle;
+}
+
+void
+range_allocator::free(u32 handle)
+{
+    assert(is_live(handle));
+    range& r{ _ranges[handle] };
+    const u64 offset{ r.offset };
+    const u64 size{ r.size };
+    _used -= size;
+    r.size = 0;
+    _free_handles.emplace_back(handle);
+
+    // Find the first free block after the range and merge with it and/or the one before it.
+    u32 next{ 0 };
+    u32 count{ (u32)_free_blocks.size() };
+    for (u32 step{ count }; step > 0;)
+    {
+        const u32 half{ step / 2 };
+        if (_free_blocks[next + half].offset < offset)
+        {
+            next += half + 1;
+            step -= half + 1;
+        }
+        else
+        {
+            step = half;
+        }
+    }
+
+    const bool merge_prev{ next > 0 && _free_blocks[next - 1].offset + _free_blocks[next - 1].size == offset };
+    const bool merge_next{ next < count && offset + size == _free_blocks[next].offset };
+
+    if (merge_prev && merge_next)
+    {
+        _free_blocks[next - 1].size += size + _free_blocks[next].size;
+        _free_blocks.erase(_free_blocks.begin() + next);
+    }
+    else if (merge_prev)
+    {
+        _free_blocks[next - 1].size += size;
+    }
+    else if (merge_next)
+    {
+        _free_blocks[next].offset = offset;
+        _free_blocks[next].size += size;
+    }
+    else
+    {
+        _free_blocks.insert(_free_blocks.begin() + next, block{ offset, size });
+    }
+}
+
+u64
+range_allocator::largest_free_block() const
+{
+    u64 largest{ 0 };
+    for (const block& b : _free_blocks) largest = std::max(largest, b.size);
+    return largest;
+}
+
+void
+resident_range_allocator::initialize(u64 capacity)
+{
+    _allocator.initialize(capacity);
+    _gpu_offsets.clear();
+    _needs_rebuild = true;
+}
+
+u32
+resident_range_allocator::allocate(u64 size, u64 alignment)
+{
+    u32 handle{ _allocator.allocate(size, alignment) };
+    if (handle == u32_invalid_id)
+    {
+        // Pack the live ranges together, which is enough if the pool is only fragmented. Otherwise also grow it.
+        // The move callback has nothing to do, because the data isn't moved until rebuild().
+        u64 capacity{ _allocator.capacity() };
+        while (capacity - _allocator.used() < size + alignment) capacity *= 2;
+        _allocator.compact(capacity, [](u32, u64, u64, u64) {});
+        _needs_rebuild = true;
+
+        handle = _allocator.allocate(size, alignment);
+        assert(handle != u32_invalid_id);
+    }
+
+    if (handle >= _gpu_offsets.size()) _gpu_offsets.resize(handle + 1);
+    _gpu_offsets[handle] = not_resident;
+    return handle;
+}
+
+void
+resident_range_allocator::free(u32 handle)
+{
+    _gpu_offsets[handle] = not_resident;
+    _allocator.free(handle);
+}
+
+u64
+resident_range_allocator::make_resident(u32 handle)
+{
+    assert(!_needs_rebuild);
+    _gpu_offsets[handle] = _allocator.offset(handle);
+    return _gpu_offsets[handle];
+}
+
+void
+range_allocator::sort_live_handles()
+{
+    _sorted_handles.clear();
+    const u32 count{ (u32)_ranges.size() };
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        if (_ranges[i].size) _sorted_handles.emplace_back(i);
+    }
+
+    std::sort(_sorted_handles.begin(), _sorted_handles.end(),
+        [this](u32 a, u32 b) { return _ranges[a].offset < _ranges[b].offset; });
+}
+}
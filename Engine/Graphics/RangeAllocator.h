@@ -0,0 +1,128 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+namespace primal::graphics {
+
+// Suballocates ranges of a linear space (e.g. a large GPU buffer) using a free list that's kept sorted by
+// offset, so neighbouring free blocks are merged when a range is freed. Ranges are identified by handles,
+// which stay valid when compact() moves them around.
+class range_allocator
+{
+public:
+    range_allocator() = default;
+    explicit range_allocator(u64 capacity) { initialize(capacity); }
+
+    void initialize(u64 capacity);
+    // Returns a handle or u32_invalid_id if there's no free block large enough.
+    [[nodiscard]] u32 allocate(u64 size, u64 alignment = 1);
+    void free(u32 handle);
+
+    // Moves all live ranges to the front of a space of new_capacity, in ascending offset order.
+    // Calls move(handle, old_offset, new_offset, size) for every live range.
+    template<typename F>
+    void compact(u64 new_capacity, F&& move)
+    {
+        assert(new_capacity >= _used);
+        sort_live_handles();
+
+        u64 cursor{ 0 };
+        for (u32 handle : _sorted_handles)
+        {
+            range& r{ _ranges[handle] };
+            const u64 new_offset{ math::align_size_up(cursor, r.alignment) };
+            move(handle, r.offset, new_offset, r.size);
+            r.offset = new_offset;
+            cursor = new_offset + r.size;
+        }
+
+        assert(cursor <= new_capacity);
+        _capacity = new_capacity;
+        _free_blocks.clear();
+        if (cursor < new_capacity) _free_blocks.emplace_back(block{ cursor, new_capacity - cursor });
+    }
+
+    [[nodiscard]] constexpr u64 offset(u32 handle) const { assert(is_live(handle)); return _ranges[handle].offset; }
+    [[nodiscard]] constexpr u64 size(u32 handle) const { assert(is_live(handle)); return _ranges[handle].size; }
+    [[nodiscard]] constexpr bool is_live(u32 handle) const { return handle < _ranges.size() && _ranges[handle].size != 0; }
+    [[nodiscard]] constexpr u32 handle_count() const { return (u32)_ranges.size(); }
+    [[nodiscard]] constexpr u64 capacity() const { return _capacity; }
+    [[nodiscard]] constexpr u64 used() const { return _used; }
+    [[nodiscard]] constexpr u64 free_space() const { return _capacity - _used; }
+    [[nodiscard]] u64 largest_free_block() const;
+
+private:
+    struct range
+    {
+        u64		offset;
+        u64		size;		// 0 for unused handles
+        u64		alignment;
+    };
+
+    struct block
+    {
+        u64		offset;
+        u64		size;
+    };
+
+    void sort_live_handles();
+
+    utl::vector<range>		_ranges;
+    utl::vector<u32>		_free_handles;
+    utl::vector<block>		_free_blocks;		// sorted by offset, never adjacent
+    utl::vector<u32>		_sorted_handles;	// scratch for compact()
+    u64						_capacity{ 0 };
+    u64						_used{ 0 };
+};
+
+// Range allocator for a pool whose buffers are read by the GPU while loading threads allocate from it.
+// When it runs out of space, it compacts and grows right away, but only in the allocator. The data moves when
+// the pool recreates its buffers and calls rebuild(). Until then, offset() still returns where each range is
+// in the buffers that are bound for rendering. New ranges are drawn from once they're made resident.
+class resident_range_allocator
+{
+public:
+    void initialize(u64 capacity);
+    // Returns a handle to size elements. It isn't resident until make_resident() is called.
+    [[nodiscard]] u32 allocate(u64 size, u64 alignment);
+    void free(u32 handle);
+
+    // Call after the buffers were recreated with capacity() elements. Calls move(old_offset, new_offset, size)
+    // for every resident range, so the pool can copy the data from the old buffers.
+    template<typename F>
+    void rebuild(F&& move)
+    {
+        assert(_needs_rebuild);
+        _needs_rebuild = false;
+
+        const u32 handle_count{ _allocator.handle_count() };
+        for (u32 h{ 0 }; h < handle_count; ++h)
+        {
+            if (!_allocator.is_live(h) || _gpu_offsets[h] == not_resident) continue;
+
+            const u64 new_offset{ _allocator.offset(h) };
+            move(_gpu_offsets[h], new_offset, _allocator.size(h));
+            _gpu_offsets[h] = new_offset;
+        }
+    }
+
+    // Returns the offset the range's data has to be written to. Call after rebuild().
+    [[nodiscard]] u64 make_resident(u32 handle);
+
+    [[nodiscard]] constexpr bool is_resident(u32 handle) const { return handle < _gpu_offsets.size() && _gpu_offsets[handle] != not_resident; }
+    // Offset of the range in the buffers that are currently bound for rendering.
+    [[nodiscard]] constexpr u64 offset(u32 handle) const { assert(is_resident(handle)); return _gpu_offsets[handle]; }
+    [[nodiscard]] constexpr u64 size(u32 handle) const { return _allocator.size(handle); }
+    [[nodiscard]] constexpr u64 capacity() const { return _allocator.capacity(); }
+    // True when the buffers have to be (re)created with capacity() elements.
+    [[nodiscard]] constexpr bool needs_rebuild() const { return _needs_rebuild; }
+
+private:
+    constexpr static u64	not_resident{ ~0ull };
+
+    range_allocator			_allocator{};
+    utl::vector<u64>		_gpu_offsets;
+    bool					_needs_rebuild{ false };
+};
+}
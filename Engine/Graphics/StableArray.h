@@ -0,0 +1,122 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include <atomic>
+
+namespace primal::graphics {
+
+// Append-only array whose elements never move, so they can be read without locks while elements are
+// added. Storage is allocated in chunks of chunk_size elements.
+template<typename T, u32 chunk_size = 256, u32 max_chunk_count = 1024>
+class stable_array
+{
+    static_assert(chunk_size && !(chunk_size & (chunk_size - 1)));
+public:
+    stable_array() = default;
+    DISABLE_COPY_AND_MOVE(stable_array);
+    ~stable_array() { clear(); }
+
+    // Writers only. The caller makes sure no other add() or clear() runs at the same time.
+    [[nodiscard]] u32 add(const T& value)
+    {
+        const u32 index{ _size.load(std::memory_order_relaxed) };
+        const u32 chunk{ index / chunk_size };
+        assert(chunk < max_chunk_count);
+        T* elements{ _chunks[chunk].load(std::memory_order_relaxed) };
+        if (!elements)
+        {
+            elements = new T[chunk_size]{};
+            _chunks[chunk].store(elements, std::memory_order_release);
+        }
+
+        elements[index & (chunk_size - 1)] = value;
+        _size.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    // The index must have been handed out by add() and passed on to this thread with the usual
+    // synchronization (e.g. through hashed_id_map::find() or a mutex).
+    [[nodiscard]] const T& operator[](u32 index) const
+    {
+        assert(index < size());
+        return _chunks[index / chunk_size].load(std::memory_order_acquire)[index & (chunk_size - 1)];
+    }
+
+    // Writers only.
+    [[nodiscard]] T& at(u32 index)
+    {
+        assert(index < size());
+        return _chunks[index / chunk_size].load(std::memory_order_relaxed)[index & (chunk_size - 1)];
+    }
+
+    // No reader or writer may be running.
+    void clear()
+    {
+        for (auto& chunk : _chunks)
+        {
+            delete[] chunk.load(std::memory_order_relaxed);
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        _size.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] u32 size() const { return _size.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<T*>		_chunks[max_chunk_count]{};
+    std::atomic<u32>	_size{ 0 };
+};
+
+// Like utl::free_list, but elements never move, so readers can access live elements without locks while
+// a writer adds and removes others. Removed slots are reused by later adds, so readers must only use ids
+// that are still alive. Writers are serialized by the caller.
+template<typename T, u32 chunk_size = 1024, u32 max_chunk_count = 1024>
+class stable_free_list
+{
+public:
+    stable_free_list() = default;
+    DISABLE_COPY_AND_MOVE(stable_free_list);
+
+    // Writers only.
+    [[nodiscard]] u32 add(const T& value)
+    {
+        ++_count;
+        if (_free_ids.empty()) return _elements.add(value);
+
+        const u32 id{ _free_ids.back() };
+        _free_ids.pop_back();
+        _elements.at(id) = value;
+        return id;
+    }
+
+    // Writers only.
+    void remove(u32 id)
+    {
+        assert(_count);
+        _elements.at(id) = {};
+        _free_ids.emplace_back(id);
+        --_count;
+    }
+
+    [[nodiscard]] const T& operator[](u32 id) const { return _elements[id]; }
+    // Writers only.
+    [[nodiscard]] T& at(u32 id) { return _elements.at(id); }
+    [[nodiscard]] u32 size() const { return _count; }
+    [[nodiscard]] bool empty() const { return _count == 0; }
+
+    // No reader or writer may be running.
+    void clear()
+    {
+        _elements.clear();
+        _free_ids.clear();
+        _count = 0;
+    }
+
+private:
+    stable_array<T, chunk_size, max_chunk_count>	_elements;
+    utl::vector<u32>								_free_ids;
+    u32												_count{ 0 };
+};
+}
@@ -0,0 +1,101 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "TransformKernels.h"
+// NOTE: the extension headers use intrinsics that gcc only declares in immintrin.h.
+#include <immintrin.h>
+#include <DirectXMathSSE4.h>
+#include <DirectXMathFMA3.h>
+#include <DirectXMathAVX2.h>
+
+namespace primal::graphics::transform_kernels {
+namespace {
+
+struct isa_support
+{
+    bool		supported[isa::count]{};
+    isa::type	best{ isa::scalar };
+
+    isa_support()
+    {
+        // NOTE: the extension headers only check the CPU here. Their math functions are compiled for
+        //       the instruction sets they need, so this file doesn't call any of them.
+        supported[isa::scalar] = true;
+        supported[isa::sse4] = DirectX::SSE4::XMVerifySSE4Support();
+        supported[isa::fma3] = supported[isa::sse4] && DirectX::FMA3::XMVerifyFMA3Support();
+        supported[isa::avx2] = DirectX::AVX2::XMVerifyAVX2Support();
+
+        for (u32 i{ 0 }; i < isa::count; ++i)
+        {
+            if (supported[i]) best = (isa::type)i;
+        }
+    }
+};
+
+[[nodiscard]] const isa_support&
+support()
+{
+    static const isa_support s{};
+    return s;
+}
+
+} // anonymous namespace
+
+isa::type
+best_isa()
+{
+    return support().best;
+}
+
+bool
+is_supported(isa::type variant)
+{
+    return variant < isa::count && support().supported[variant];
+}
+
+void
+compute_matrices(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs)
+{
+    compute_matrices(best_isa(), transforms, view_projection, outputs);
+}
+
+void
+compute_matrices(isa::type variant, const transform_soa& transforms, const math::m4x4& view_projection,
+    const transform_outputs& outputs)
+{
+    assert(is_supported(variant));
+    assert(outputs.stride >= sizeof(math::m4x4));
+    if (!transforms.count) return;
+
+    switch (variant)
+    {
+    case isa::avx2: detail::compute_matrices_avx2(transforms, view_projection, outputs); break;
+    case isa::fma3: detail::compute_matrices_fma3(transforms, view_projection, outputs); break;
+    case isa::sse4: detail::compute_matrices_sse4(transforms, view_projection, outputs); break;
+    default: detail::compute_matrices_scalar(transforms, view_projection, outputs, 0, transforms.count); break;
+    }
+}
+
+namespace detail {
+void
+compute_matrices_scalar(const transform_soa& in, const math::m4x4& view_projection, const transform_outputs& out, u32 begin, u32 end)
+{
+    using namespace DirectX;
+    const XMMATRIX vp{ XMLoadFloat4x4(&view_projection) };
+    for (u32 i{ begin }; i < end; ++i)
+    {
+        const XMVECTOR position{ XMVectorSet(in.position_x[i], in.position_y[i], in.position_z[i], 1.f) };
+        const XMVECTOR rotation{ XMVectorSet(in.rotation_x[i], in.rotation_y[i], in.rotation_z[i], in.rotation_w[i]) };
+        const XMVECTOR scale{ XMVectorSet(in.scale_x[i], in.scale_y[i], in.scale_z[i], 1.f) };
+        const XMMATRIX world{ XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, position) };
+
+        const u64 offset{ (u64)i * out.stride };
+        if (out.world) XMStoreFloat4x4((math::m4x4*)((u8*)out.world + offset), world);
+        if (out.world_inverse_transpose)
+        {
+            XMStoreFloat4x4((math::m4x4*)((u8*)out.world_inverse_transpose + offset), XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+        }
+        if (out.world_view_projection) XMStoreFloat4x4((math::m4x4*)((u8*)out.world_view_projection + offset), XMMatrixMultiply(world, vp));
+    }
+}
+}
+}
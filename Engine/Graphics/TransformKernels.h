@@ -0,0 +1,68 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+// Batched computation of per-object matrices from positions, rotation quaternions and scales stored as
+// structure of arrays. The SIMD variants work on 4 or 8 objects at once, one object per lane, so there's
+// no shuffling until the matrices are stored. The widest variant the CPU supports is picked at runtime.
+namespace primal::graphics::transform_kernels {
+
+struct isa
+{
+    enum type : u32
+    {
+        scalar,			// one object at a time with DirectXMath, the reference path
+        sse4,			// 4 objects at a time
+        fma3,			// 4 objects at a time, fused multiply-adds
+        avx2,			// 8 objects at a time, fused multiply-adds
+
+        count
+    };
+};
+
+// One array per component, count elements each. Rotations are unit quaternions.
+struct transform_soa
+{
+    const f32*		position_x;
+    const f32*		position_y;
+    const f32*		position_z;
+    const f32*		rotation_x;
+    const f32*		rotation_y;
+    const f32*		rotation_z;
+    const f32*		rotation_w;
+    const f32*		scale_x;
+    const f32*		scale_y;
+    const f32*		scale_z;
+    u32				count;
+};
+
+// Where to write the matrices of object i: (u8*)matrix + i * stride. A null matrix pointer skips that
+// output. The stride lets the matrices go straight into per-object structs, e.g. shader constants.
+struct transform_outputs
+{
+    math::m4x4*		world;
+    math::m4x4*		world_inverse_transpose;		// for transforming normals
+    math::m4x4*		world_view_projection;
+    u32				stride{ sizeof(math::m4x4) };
+};
+
+// The widest variant this CPU supports. Checked once.
+[[nodiscard]] isa::type best_isa();
+[[nodiscard]] bool is_supported(isa::type variant);
+
+// World is scale, then rotation, then translation, in DirectXMath's row vector convention.
+void compute_matrices(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs);
+// Uses the given variant, which must be supported. For testing and benchmarks.
+void compute_matrices(isa::type variant, const transform_soa& transforms, const math::m4x4& view_projection,
+    const transform_outputs& outputs);
+
+namespace detail {
+// Objects [begin, end) one at a time. The SIMD variants use it for the objects that don't fill a vector.
+void compute_matrices_scalar(const transform_soa& transforms, const math::m4x4& view_projection,
+    const transform_outputs& outputs, u32 begin, u32 end);
+void compute_matrices_sse4(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs);
+void compute_matrices_fma3(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs);
+void compute_matrices_avx2(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs);
+}
+}
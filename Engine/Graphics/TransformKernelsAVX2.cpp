@@ -0,0 +1,55 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+// NOTE: compiled with AVX2 and FMA3 enabled. See premake5.lua.
+#include "TransformKernelsSIMD.h"
+#include <immintrin.h>
+
+namespace primal::graphics::transform_kernels::detail {
+namespace {
+
+struct avx2_ops
+{
+    using v = __m256;
+    constexpr static u32 width{ 8 };
+
+    static v load(const f32* p) { return _mm256_loadu_ps(p); }
+    static v set(f32 x) { return _mm256_set1_ps(x); }
+    static v add(v a, v b) { return _mm256_add_ps(a, b); }
+    static v sub(v a, v b) { return _mm256_sub_ps(a, b); }
+    static v mul(v a, v b) { return _mm256_mul_ps(a, b); }
+    static v mul_add(v a, v b, v c) { return _mm256_fmadd_ps(a, b, c); }
+    static v div(v a, v b) { return _mm256_div_ps(a, b); }
+
+    static void store(const v (&m)[4][4], u8* first, u32 stride)
+    {
+        for (u32 r{ 0 }; r < 4; ++r)
+        {
+            // A 4x4 transpose in each 128-bit half: the low halves give row r of objects 0-3, the high halves of objects 4-7.
+            const v t0{ _mm256_unpacklo_ps(m[r][0], m[r][1]) };
+            const v t1{ _mm256_unpackhi_ps(m[r][0], m[r][1]) };
+            const v t2{ _mm256_unpacklo_ps(m[r][2], m[r][3]) };
+            const v t3{ _mm256_unpackhi_ps(m[r][2], m[r][3]) };
+            const v rows[4]{
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)),
+            };
+
+            u8* const dst{ first + r * sizeof(f32) * 4 };
+            for (u32 j{ 0 }; j < 4; ++j)
+            {
+                _mm_storeu_ps((f32*)(dst + j * stride), _mm256_castps256_ps128(rows[j]));
+                _mm_storeu_ps((f32*)(dst + (j + 4) * stride), _mm256_extractf128_ps(rows[j], 1));
+            }
+        }
+    }
+};
+} // anonymous namespace
+
+void
+compute_matrices_avx2(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs)
+{
+    compute_matrices_lanes<avx2_ops>(transforms, view_projection, outputs);
+}
+}
@@ -0,0 +1,99 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "TransformKernels.h"
+
+// The lane-parallel kernel shared by the SIMD variants. Each variant includes this in its own translation
+// unit, which is compiled for its instruction set, and instantiates it with ops defined in an anonymous
+// namespace there. Nothing here may call inline functions that other translation units also compile
+// (DirectXMath's for instance), or the linker could pick a copy built for an instruction set the CPU lacks.
+namespace primal::graphics::transform_kernels::detail {
+
+// ops provides: a vector type v with ops::width lanes, load(const f32*), set(f32), add(), sub(), mul(),
+// mul_add(a, b, c) = a * b + c, div(), and store(const v (&m)[4][4], u8* first, u32 stride), which
+// writes the lanes of the 4x4 matrix m as consecutive matrices.
+template<typename ops>
+void
+compute_matrices_lanes(const transform_soa& in, const math::m4x4& view_projection, const transform_outputs& out)
+{
+    using v = typename ops::v;
+    constexpr u32 width{ ops::width };
+
+    v vp[4][4];
+    for (u32 r{ 0 }; r < 4; ++r)
+        for (u32 c{ 0 }; c < 4; ++c)
+            vp[r][c] = ops::set(view_projection.m[r][c]);
+
+    const v zero{ ops::set(0.f) };
+    const v one{ ops::set(1.f) };
+    const v two{ ops::set(2.f) };
+
+    const u32 simd_count{ in.count - in.count % width };
+    for (u32 i{ 0 }; i < simd_count; i += width)
+    {
+        const v px{ ops::load(&in.position_x[i]) };
+        const v py{ ops::load(&in.position_y[i]) };
+        const v pz{ ops::load(&in.position_z[i]) };
+        const v qx{ ops::load(&in.rotation_x[i]) };
+        const v qy{ ops::load(&in.rotation_y[i]) };
+        const v qz{ ops::load(&in.rotation_z[i]) };
+        const v qw{ ops::load(&in.rotation_w[i]) };
+        const v s[3]{ ops::load(&in.scale_x[i]), ops::load(&in.scale_y[i]), ops::load(&in.scale_z[i]) };
+
+        // Rotation matrix of the quaternion, same layout as XMMatrixRotationQuaternion.
+        const v x2{ ops::mul(qx, two) }, y2{ ops::mul(qy, two) }, z2{ ops::mul(qz, two) };
+        const v xx{ ops::mul(qx, x2) }, yy{ ops::mul(qy, y2) }, zz{ ops::mul(qz, z2) };
+        const v xy{ ops::mul(qx, y2) }, xz{ ops::mul(qx, z2) }, yz{ ops::mul(qy, z2) };
+        const v wx{ ops::mul(qw, x2) }, wy{ ops::mul(qw, y2) }, wz{ ops::mul(qw, z2) };
+        const v rotation[3][3]{
+            { ops::sub(one, ops::add(yy, zz)), ops::add(xy, wz), ops::sub(xz, wy) },
+            { ops::sub(xy, wz), ops::sub(one, ops::add(xx, zz)), ops::add(yz, wx) },
+            { ops::add(xz, wy), ops::sub(yz, wx), ops::sub(one, ops::add(xx, yy)) },
+        };
+
+        // World = S * R * T: the rows of R scaled by S, then the position.
+        v world[4][4];
+        for (u32 r{ 0 }; r < 3; ++r)
+        {
+            for (u32 c{ 0 }; c < 3; ++c) world[r][c] = ops::mul(rotation[r][c], s[r]);
+            world[r][3] = zero;
+        }
+        world[3][0] = px; world[3][1] = py; world[3][2] = pz; world[3][3] = one;
+
+        if (out.world) ops::store(world, (u8*)out.world + (u64)i * out.stride, out.stride);
+
+        if (out.world_inverse_transpose)
+        {
+            // The inverse transpose of S * R * T is S^-1 * R with -(S^-1 * R) * p in the last column.
+            v inverse_transpose[4][4];
+            for (u32 r{ 0 }; r < 3; ++r)
+            {
+                const v inv_s{ ops::div(one, s[r]) };
+                for (u32 c{ 0 }; c < 3; ++c) inverse_transpose[r][c] = ops::mul(rotation[r][c], inv_s);
+                const v dot{ ops::mul_add(inverse_transpose[r][2], pz,
+                    ops::mul_add(inverse_transpose[r][1], py, ops::mul(inverse_transpose[r][0], px))) };
+                inverse_transpose[r][3] = ops::sub(zero, dot);
+            }
+            inverse_transpose[3][0] = zero; inverse_transpose[3][1] = zero; inverse_transpose[3][2] = zero;
+            inverse_transpose[3][3] = one;
+
+            ops::store(inverse_transpose, (u8*)out.world_inverse_transpose + (u64)i * out.stride, out.stride);
+        }
+
+        if (out.world_view_projection)
+        {
+            // world[r][3] is 0 for the first three rows and 1 for the last, so each element takes 3 multiply-adds.
+            v wvp[4][4];
+            for (u32 r{ 0 }; r < 3; ++r)
+                for (u32 c{ 0 }; c < 4; ++c)
+                    wvp[r][c] = ops::mul_add(world[r][2], vp[2][c], ops::mul_add(world[r][1], vp[1][c], ops::mul(world[r][0], vp[0][c])));
+            for (u32 c{ 0 }; c < 4; ++c)
+                wvp[3][c] = ops::mul_add(pz, vp[2][c], ops::mul_add(py, vp[1][c], ops::mul_add(px, vp[0][c], vp[3][c])));
+
+            ops::store(wvp, (u8*)out.world_view_projection + (u64)i * out.stride, out.stride);
+        }
+    }
+
+    if (simd_count < in.count) compute_matrices_scalar(in, view_projection, out, simd_count, in.count);
+}
+}
@@ -0,0 +1,45 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+// NOTE: compiled with SSE4.1 enabled. See premake5.lua.
+#include "TransformKernelsSIMD.h"
+#include <smmintrin.h>
+
+namespace primal::graphics::transform_kernels::detail {
+namespace {
+
+struct sse4_ops
+{
+    using v = __m128;
+    constexpr static u32 width{ 4 };
+
+    static v load(const f32* p) { return _mm_loadu_ps(p); }
+    static v set(f32 x) { return _mm_set1_ps(x); }
+    static v add(v a, v b) { return _mm_add_ps(a, b); }
+    static v sub(v a, v b) { return _mm_sub_ps(a, b); }
+    static v mul(v a, v b) { return _mm_mul_ps(a, b); }
+    static v mul_add(v a, v b, v c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static v div(v a, v b) { return _mm_div_ps(a, b); }
+
+    static void store(const v (&m)[4][4], u8* first, u32 stride)
+    {
+        for (u32 r{ 0 }; r < 4; ++r)
+        {
+            // Lane j of column c is element (r, c) of object j, so a transpose gives the rows of 4 objects.
+            v row0{ m[r][0] }, row1{ m[r][1] }, row2{ m[r][2] }, row3{ m[r][3] };
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            f32* const dst{ (f32*)(first + r * sizeof(f32) * 4) };
+            _mm_storeu_ps(dst, row0);
+            _mm_storeu_ps((f32*)((u8*)dst + stride), row1);
+            _mm_storeu_ps((f32*)((u8*)dst + 2 * stride), row2);
+            _mm_storeu_ps((f32*)((u8*)dst + 3 * stride), row3);
+        }
+    }
+};
+} // anonymous namespace
+
+void
+compute_matrices_sse4(const transform_soa& transforms, const math::m4x4& view_projection, const transform_outputs& outputs)
+{
+    compute_matrices_lanes<sse4_ops>(transforms, view_projection, outputs);
+}
+}
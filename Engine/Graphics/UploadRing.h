@@ -0,0 +1,107 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+namespace primal::graphics {
+
+// Ring allocator over a persistently mapped upload (staging) buffer. Allocations made while
+// rendering a frame are released when that frame index comes around again, i.e. after the
+// backend has waited on the frame's fence. The ring itself never touches the GPU API; backends
+// give it the mapped address and copy from the returned offsets into their GPU-resident buffers.
+// Backends that have to unmap the buffer before copying from it call remap() after every map.
+template<u32 frame_count>
+class upload_ring
+{
+public:
+    constexpr void initialize(u8* const cpu_address, u32 size)
+    {
+        assert(cpu_address && size);
+        _cpu_address = cpu_address;
+        _size = size;
+        _head = 0;
+        _used = 0;
+        for (u32 i{ 0 }; i < frame_count; ++i) _frame_sizes[i] = 0;
+    }
+
+    // The mapped address may change between maps. Allocations keep their offsets.
+    constexpr void remap(u8* const cpu_address)
+    {
+        assert(cpu_address && _size);
+        _cpu_address = cpu_address;
+    }
+
+    constexpr void release()
+    {
+        _cpu_address = nullptr;
+        _size = 0;
+    }
+
+    // Call after the fence for frame_index has been waited on.
+    constexpr void begin_frame(u32 frame_index)
+    {
+        assert(frame_index < frame_count);
+        assert(_used >= _frame_sizes[frame_index]);
+        _used -= _frame_sizes[frame_index];
+        _frame_sizes[frame_index] = 0;
+        _frame_index = frame_index;
+    }
+
+    // Returns the offset of the allocation in the upload buffer or u32_invalid_id if the ring is full.
+    [[nodiscard]] constexpr u32 allocate(u32 size, u32 alignment)
+    {
+        assert(_cpu_address && size && alignment);
+        u32 offset{ (u32)math::align_size_up(_head, alignment) };
+        u32 total_size{ offset - _head + size };
+
+        if (offset + size > _size)
+        {
+            // Not enough room before the end of the buffer, so waste the remainder and wrap around.
+            offset = 0;
+            total_size = _size - _head + size;
+        }
+
+        if (_used + total_size > _size) return u32_invalid_id;
+
+        _head = offset + size;
+        if (_head == _size) _head = 0;
+        _used += total_size;
+        _frame_sizes[_frame_index] += total_size;
+        return offset;
+    }
+
+    [[nodiscard]] constexpr u8* const cpu_address(u32 offset) const { assert(offset < _size); return _cpu_address + offset; }
+    [[nodiscard]] constexpr u32 size() const { return _size; }
+    [[nodiscard]] constexpr u32 used() const { return _used; }
+
+private:
+    u8*			_cpu_address{ nullptr };
+    u32			_size{ 0 };
+    u32			_head{ 0 };
+    u32			_used{ 0 };
+    u32			_frame_index{ 0 };
+    u32			_frame_sizes[frame_count]{};
+};
+
+// Calls f(first, count) for each run of consecutive elements whose dirty bits intersect mask.
+template<typename F>
+constexpr void
+for_each_dirty_range(const u8* const dirty_bits, u32 element_count, u8 mask, F&& f)
+{
+    u32 first{ u32_invalid_id };
+    for (u32 i{ 0 }; i < element_count; ++i)
+    {
+        if (dirty_bits[i] & mask)
+        {
+            if (first == u32_invalid_id) first = i;
+        }
+        else if (first != u32_invalid_id)
+        {
+            f(first, i - first);
+            first = u32_invalid_id;
+        }
+    }
+
+    if (first != u32_invalid_id) f(first, element_count - first);
+}
+}
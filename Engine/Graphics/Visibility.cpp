@@ -0,0 +1,242 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VisibilitySIMD.h"
+#include "TransformKernels.h"
+#include "Utilities/JobSystem.h"
+#include <emmintrin.h>
+
+namespace primal::graphics::visibility {
+namespace {
+
+// NOTE: SSE2 is part of x64, so this variant needs no special compiler flags.
+struct sse_ops
+{
+    using v = __m128;
+    constexpr static u32 width{ 4 };
+
+    static v load(const f32* p) { return _mm_loadu_ps(p); }
+    static v set(f32 x) { return _mm_set1_ps(x); }
+    static v add(v a, v b) { return _mm_add_ps(a, b); }
+    static v mul(v a, v b) { return _mm_mul_ps(a, b); }
+    static v mul_add(v a, v b, v c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static v abs(v a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+    static u32 negative_mask(v a) { return (u32)_mm_movemask_ps(_mm_cmplt_ps(a, _mm_setzero_ps())); }
+};
+
+// Large enough that a chunk's job costs more than handing it out, small enough to spread 1M bounds over
+// all threads. At most max_chunks chunks, so the counts fit on the stack.
+constexpr u32 min_chunk_size{ 16 * 1024 };
+constexpr u32 max_chunks{ 256 };
+
+[[nodiscard]] math::v4
+normalize_plane(f32 x, f32 y, f32 z, f32 w)
+{
+    const f32 length{ std::sqrt(x * x + y * y + z * z) };
+    // NOTE: an infinite far plane has no normal. Keeping it as (0, 0, 0, w >= 0) makes everything inside it.
+    if (length < math::epsilon) return { 0.f, 0.f, 0.f, std::max(w, 0.f) };
+    const f32 inv_length{ 1.f / length };
+    return { x * inv_length, y * inv_length, z * inv_length, w * inv_length };
+}
+
+[[nodiscard]] f32
+plane_distance(const math::v4& plane, f32 x, f32 y, f32 z)
+{
+    return plane.x * x + plane.y * y + plane.z * z + plane.w;
+}
+
+template<typename bounds_soa>
+u32
+cull_range(isa::type variant, const frustum& frustum, const bounds_soa& bounds, u32 begin, u32 end, u32* const visible)
+{
+    switch (variant)
+    {
+    case isa::avx2: return detail::cull_avx2(frustum, bounds, begin, end, visible);
+    case isa::sse: return detail::cull_sse(frustum, bounds, begin, end, visible);
+    default: return detail::cull_scalar(frustum, bounds, begin, end, visible);
+    }
+}
+
+template<typename bounds_soa>
+u32
+cull_chunks(isa::type variant, const frustum& frustum, const bounds_soa& bounds, u32* const visible)
+{
+    assert(is_supported(variant));
+    assert(visible || !bounds.count);
+    const u32 count{ bounds.count };
+    if (!count) return 0;
+
+    const u32 chunk_size{ (u32)math::align_size_up<16>(std::max(min_chunk_size, (count + max_chunks - 1) / max_chunks)) };
+    const u32 chunk_count{ jobs::chunk_count(count, chunk_size) };
+    assert(chunk_count <= max_chunks);
+
+    // Each chunk compacts its visible indices to the start of its own range, then the ranges are moved
+    // down next to each other. Moving at most 4 bytes per bound is cheap next to testing it.
+    u32 visible_counts[max_chunks];
+    jobs::parallel_for(count, chunk_size, [&, variant, visible](u32 chunk, u32 begin, u32 end) {
+        visible_counts[chunk] = cull_range(variant, frustum, bounds, begin, end, &visible[begin]);
+        });
+
+    u32 visible_count{ visible_counts[0] };
+    for (u32 i{ 1 }; i < chunk_count; ++i)
+    {
+        memmove(&visible[visible_count], &visible[i * chunk_size], visible_counts[i] * sizeof(u32));
+        visible_count += visible_counts[i];
+    }
+
+    return visible_count;
+}
+
+template<typename bounds_soa>
+frame_info
+cull_items(const frustum& frustum, const bounds_soa& bounds, const frame_info& info, visible_set& set)
+{
+    assert(bounds.count == info.render_item_count);
+    assert(info.render_item_ids && info.thresholds);
+
+    set.indices.resize(bounds.count);
+    const u32 visible_count{ cull(frustum, bounds, set.indices.data()) };
+
+    set.render_item_ids.resize(visible_count);
+    set.thresholds.resize(visible_count);
+    for (u32 i{ 0 }; i < visible_count; ++i)
+    {
+        const u32 index{ set.indices[i] };
+        set.render_item_ids[i] = info.render_item_ids[index];
+        set.thresholds[i] = info.thresholds[index];
+    }
+
+    frame_info visible_info{ info };
+    visible_info.render_item_ids = set.render_item_ids.data();
+    visible_info.thresholds = set.thresholds.data();
+    visible_info.render_item_count = visible_count;
+    return visible_info;
+}
+
+} // anonymous namespace
+
+frustum
+make_frustum(const math::m4x4& view_projection)
+{
+    // Row vectors: clip = p * M, so each clip coordinate is the dot product of p with a column of M.
+    const auto column{ [&view_projection](u32 c) {
+        return math::v4{ view_projection.m[0][c], view_projection.m[1][c], view_projection.m[2][c], view_projection.m[3][c] };
+        } };
+    const math::v4 x{ column(0) }, y{ column(1) }, z{ column(2) }, w{ column(3) };
+
+    frustum f;
+    f.planes[0] = normalize_plane(w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w);		// -w <= x
+    f.planes[1] = normalize_plane(w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w);		// x <= w
+    f.planes[2] = normalize_plane(w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w);		// -w <= y
+    f.planes[3] = normalize_plane(w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w);		// y <= w
+    f.planes[4] = normalize_plane(z.x, z.y, z.z, z.w);								// 0 <= z
+    f.planes[5] = normalize_plane(w.x - z.x, w.y - z.y, w.z - z.z, w.w - z.w);		// z <= w
+    return f;
+}
+
+frustum
+make_frustum(const camera& camera)
+{
+    return make_frustum(camera.view_projection());
+}
+
+isa::type
+best_isa()
+{
+    return is_supported(isa::avx2) ? isa::avx2 : isa::sse;
+}
+
+bool
+is_supported(isa::type variant)
+{
+    // NOTE: the AVX2 variant uses FMA3 too, which every AVX2 CPU has.
+    if (variant == isa::avx2) return transform_kernels::is_supported(transform_kernels::isa::avx2);
+    return variant < isa::count;
+}
+
+u32
+cull(const frustum& frustum, const sphere_soa& bounds, u32* const visible)
+{
+    return cull_chunks(best_isa(), frustum, bounds, visible);
+}
+
+u32
+cull(const frustum& frustum, const aabb_soa& bounds, u32* const visible)
+{
+    return cull_chunks(best_isa(), frustum, bounds, visible);
+}
+
+u32
+cull(isa::type variant, const frustum& frustum, const sphere_soa& bounds, u32* const visible)
+{
+    return cull_chunks(variant, frustum, bounds, visible);
+}
+
+u32
+cull(isa::type variant, const frustum& frustum, const aabb_soa& bounds, u32* const visible)
+{
+    return cull_chunks(variant, frustum, bounds, visible);
+}
+
+frame_info
+cull_render_items(const frustum& frustum, const sphere_soa& bounds, const frame_info& info, visible_set& set)
+{
+    return cull_items(frustum, bounds, info, set);
+}
+
+frame_info
+cull_render_items(const frustum& frustum, const aabb_soa& bounds, const frame_info& info, visible_set& set)
+{
+    return cull_items(frustum, bounds, info, set);
+}
+
+namespace detail {
+u32
+cull_scalar(const frustum& frustum, const sphere_soa& in, u32 begin, u32 end, u32* const visible)
+{
+    u32 count{ 0 };
+    for (u32 i{ begin }; i < end; ++i)
+    {
+        bool outside{ false };
+        for (const math::v4& plane : frustum.planes)
+        {
+            outside |= plane_distance(plane, in.center_x[i], in.center_y[i], in.center_z[i]) + in.radius[i] < 0.f;
+        }
+
+        visible[count] = i;
+        count += !outside;
+    }
+    return count;
+}
+
+u32
+cull_scalar(const frustum& frustum, const aabb_soa& in, u32 begin, u32 end, u32* const visible)
+{
+    u32 count{ 0 };
+    for (u32 i{ begin }; i < end; ++i)
+    {
+        bool outside{ false };
+        for (const math::v4& plane : frustum.planes)
+        {
+            const f32 reach{ std::abs(plane.x) * in.extent_x[i] + std::abs(plane.y) * in.extent_y[i] + std::abs(plane.z) * in.extent_z[i] };
+            outside |= plane_distance(plane, in.center_x[i], in.center_y[i], in.center_z[i]) + reach < 0.f;
+        }
+
+        visible[count] = i;
+        count += !outside;
+    }
+    return count;
+}
+
+u32
+cull_sse(const frustum& frustum, const sphere_soa& bounds, u32 begin, u32 end, u32* const visible)
+{
+    return cull_lanes<sse_ops>(frustum, bounds, begin, end, visible);
+}
+
+u32
+cull_sse(const frustum& frustum, const aabb_soa& bounds, u32 begin, u32 end, u32* const visible)
+{
+    return cull_lanes<sse_ops>(frustum, bounds, begin, end, visible);
+}
+}
+}
@@ -0,0 +1,94 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+#include "Graphics/Renderer.h"
+
+// CPU frustum culling that doesn't depend on a graphics backend. Bounds are stored as structure of arrays
+// and tested 4 or 8 at a time, one bound per lane, against the six planes of a camera's frustum. The result
+// is a compacted list of the visible ones, which can go straight on to LOD selection.
+namespace primal::graphics::visibility {
+
+struct isa
+{
+    enum type : u32
+    {
+        scalar,			// one bound at a time, the reference path
+        sse,			// 4 bounds at a time
+        avx2,			// 8 bounds at a time, fused multiply-adds
+
+        count
+    };
+};
+
+// Planes are normalized and face inward: point p is inside plane (x, y, z, w) when x*p.x + y*p.y + z*p.z + w >= 0.
+struct frustum
+{
+    math::v4		planes[6];		// left, right, bottom, top, z = 0, z = w
+};
+
+// One array per component, count elements each.
+struct sphere_soa
+{
+    const f32*		center_x;
+    const f32*		center_y;
+    const f32*		center_z;
+    const f32*		radius;
+    u32				count;
+};
+
+// Axis aligned boxes as center and half extents.
+struct aabb_soa
+{
+    const f32*		center_x;
+    const f32*		center_y;
+    const f32*		center_z;
+    const f32*		extent_x;
+    const f32*		extent_y;
+    const f32*		extent_z;
+    u32				count;
+};
+
+// Storage for the render items that cull_render_items() keeps.
+struct visible_set
+{
+    utl::vector<u32>			indices;
+    utl::vector<id::id_type>	render_item_ids;
+    utl::vector<f32>			thresholds;
+};
+
+// Planes of the volume view_projection maps to the clip space of D3D, Vulkan and DirectXMath. Works for
+// reversed depth too, since both depth planes are kept.
+[[nodiscard]] frustum make_frustum(const math::m4x4& view_projection);
+[[nodiscard]] frustum make_frustum(const camera& camera);
+
+// The widest variant this CPU supports. Checked once.
+[[nodiscard]] isa::type best_isa();
+[[nodiscard]] bool is_supported(isa::type variant);
+
+// Writes the indices of the bounds that are at least partly inside the frustum to visible, in increasing
+// order, and returns how many there are. visible must have room for all bounds. Large counts are split
+// into chunks that run in parallel. Tests are conservative: bounds near a corner of the frustum may be
+// kept even though they're outside.
+u32 cull(const frustum& frustum, const sphere_soa& bounds, u32* const visible);
+u32 cull(const frustum& frustum, const aabb_soa& bounds, u32* const visible);
+// Uses the given variant, which must be supported. For testing and benchmarks.
+u32 cull(isa::type variant, const frustum& frustum, const sphere_soa& bounds, u32* const visible);
+u32 cull(isa::type variant, const frustum& frustum, const aabb_soa& bounds, u32* const visible);
+
+// bounds[i] bounds info.render_item_ids[i]. Returns a copy of info with only the visible render items and
+// their thresholds, which are stored in set, so the renderer only selects LODs for those. The count can
+// be 0, which the renderers don't accept, so check it before rendering.
+[[nodiscard]] frame_info cull_render_items(const frustum& frustum, const sphere_soa& bounds, const frame_info& info, visible_set& set);
+[[nodiscard]] frame_info cull_render_items(const frustum& frustum, const aabb_soa& bounds, const frame_info& info, visible_set& set);
+
+namespace detail {
+// Bounds [begin, end). Each writes the visible indices to visible and returns how many.
+u32 cull_scalar(const frustum& frustum, const sphere_soa& bounds, u32 begin, u32 end, u32* const visible);
+u32 cull_scalar(const frustum& frustum, const aabb_soa& bounds, u32 begin, u32 end, u32* const visible);
+u32 cull_sse(const frustum& frustum, const sphere_soa& bounds, u32 begin, u32 end, u32* const visible);
+u32 cull_sse(const frustum& frustum, const aabb_soa& bounds, u32 begin, u32 end, u32* const visible);
+u32 cull_avx2(const frustum& frustum, const sphere_soa& bounds, u32 begin, u32 end, u32* const visible);
+u32 cull_avx2(const frustum& frustum, const aabb_soa& bounds, u32 begin, u32 end, u32* const visible);
+}
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+// NOTE: compiled with AVX2 and FMA3 enabled. See premake5.lua.
+#include "VisibilitySIMD.h"
+#include <immintrin.h>
+
+namespace primal::graphics::visibility::detail {
+namespace {
+
+struct avx2_ops
+{
+    using v = __m256;
+    constexpr static u32 width{ 8 };
+
+    static v load(const f32* p) { return _mm256_loadu_ps(p); }
+    static v set(f32 x) { return _mm256_set1_ps(x); }
+    static v add(v a, v b) { return _mm256_add_ps(a, b); }
+    static v mul(v a, v b) { return _mm256_mul_ps(a, b); }
+    static v mul_add(v a, v b, v c) { return _mm256_fmadd_ps(a, b, c); }
+    static v abs(v a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+    static u32 negative_mask(v a) { return (u32)_mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LT_OQ)); }
+};
+} // anonymous namespace
+
+u32
+cull_avx2(const frustum& frustum, const sphere_soa& bounds, u32 begin, u32 end, u32* const visible)
+{
+    return cull_lanes<avx2_ops>(frustum, bounds, begin, end, visible);
+}
+
+u32
+cull_avx2(const frustum& frustum, const aabb_soa& bounds, u32 begin, u32 end, u32* const visible)
+{
+    return cull_lanes<avx2_ops>(frustum, bounds, begin, end, visible);
+}
+}
@@ -0,0 +1,115 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "Visibility.h"
+
+// The lane-parallel culling shared by the SIMD variants. Same rules as TransformKernelsSIMD.h: each variant
+// instantiates it in its own translation unit with ops from an anonymous namespace, and nothing here may
+// call inline functions that other translation units also compile.
+namespace primal::graphics::visibility::detail {
+
+// ops provides: a vector type v with ops::width lanes, load(const f32*), set(f32), add(), mul(),
+// mul_add(a, b, c) = a * b + c, abs(), and negative_mask(v), which returns bit i set when lane i is below 0.
+template<typename ops>
+struct frustum_lanes
+{
+    using v = typename ops::v;
+
+    v		x[6], y[6], z[6], w[6];
+    v		abs_x[6], abs_y[6], abs_z[6];
+
+    explicit frustum_lanes(const frustum& f)
+    {
+        for (u32 i{ 0 }; i < 6; ++i)
+        {
+            x[i] = ops::set(f.planes[i].x);
+            y[i] = ops::set(f.planes[i].y);
+            z[i] = ops::set(f.planes[i].z);
+            w[i] = ops::set(f.planes[i].w);
+            abs_x[i] = ops::abs(x[i]);
+            abs_y[i] = ops::abs(y[i]);
+            abs_z[i] = ops::abs(z[i]);
+        }
+    }
+
+    // Bit i is set when the bound of lane i is completely behind one of the planes. reach is how far the
+    // bound extends towards the plane from its center.
+    template<typename reach_function>
+    u32 outside(v cx, v cy, v cz, reach_function&& reach) const
+    {
+        u32 mask{ 0 };
+        for (u32 i{ 0 }; i < 6; ++i)
+        {
+            const v distance{ ops::mul_add(z[i], cz, ops::mul_add(y[i], cy, ops::mul_add(x[i], cx, w[i]))) };
+            mask |= ops::negative_mask(ops::add(distance, reach(i)));
+        }
+        return mask;
+    }
+};
+
+// Writes index + lane for each set bit of mask without branching on it, so it costs the same however many
+// bounds are visible. Writes up to width indices past the returned count, which visible has room for.
+template<u32 width>
+u32
+compact(u32 mask, u32 index, u32* const visible)
+{
+    u32 count{ 0 };
+    for (u32 lane{ 0 }; lane < width; ++lane)
+    {
+        visible[count] = index + lane;
+        count += (mask >> lane) & 1;
+    }
+    return count;
+}
+
+template<typename ops>
+u32
+cull_lanes(const frustum& f, const sphere_soa& in, u32 begin, u32 end, u32* const visible)
+{
+    using v = typename ops::v;
+    constexpr u32 width{ ops::width };
+    constexpr u32 lanes_mask{ (1u << width) - 1 };
+    const frustum_lanes<ops> planes{ f };
+
+    u32 count{ 0 };
+    const u32 simd_end{ end - (end - begin) % width };
+    for (u32 i{ begin }; i < simd_end; i += width)
+    {
+        const v radius{ ops::load(&in.radius[i]) };
+        const u32 outside{ planes.outside(ops::load(&in.center_x[i]), ops::load(&in.center_y[i]), ops::load(&in.center_z[i]),
+            [radius](u32) { return radius; }) };
+        count += compact<width>(~outside & lanes_mask, i, &visible[count]);
+    }
+
+    if (simd_end < end) count += cull_scalar(f, in, simd_end, end, &visible[count]);
+    return count;
+}
+
+template<typename ops>
+u32
+cull_lanes(const frustum& f, const aabb_soa& in, u32 begin, u32 end, u32* const visible)
+{
+    using v = typename ops::v;
+    constexpr u32 width{ ops::width };
+    constexpr u32 lanes_mask{ (1u << width) - 1 };
+    const frustum_lanes<ops> planes{ f };
+
+    u32 count{ 0 };
+    const u32 simd_end{ end - (end - begin) % width };
+    for (u32 i{ begin }; i < simd_end; i += width)
+    {
+        const v ex{ ops::load(&in.extent_x[i]) };
+        const v ey{ ops::load(&in.extent_y[i]) };
+        const v ez{ ops::load(&in.extent_z[i]) };
+        // The box reaches furthest towards a plane along the plane's normal: the extents projected on it.
+        const u32 outside{ planes.outside(ops::load(&in.center_x[i]), ops::load(&in.center_y[i]), ops::load(&in.center_z[i]),
+            [&planes, ex, ey, ez](u32 p) {
+                return ops::mul_add(planes.abs_z[p], ez, ops::mul_add(planes.abs_y[p], ey, ops::mul(planes.abs_x[p], ex)));
+            }) };
+        count += compact<width>(~outside & lanes_mask, i, &visible[count]);
+    }
+
+    if (simd_end < end) count += cull_scalar(f, in, simd_end, end, &visible[count]);
+    return count;
+}
+}
@@ -0,0 +1,20 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#version 450
+
+// Depth prepass vertex shader. It only fetches positions and one matrix per item, so every opaque item can
+// share the same depth only pipeline, whatever its material.
+// Compile with: glslc -O DepthOnly.vert -o DepthOnly.vert.spv
+
+layout(location = 0) in vec3 Position;
+
+// Indexed by gl_InstanceIndex, which the culling pass sets to the item's index.
+layout(std430, set = 0, binding = 0) readonly buffer InstancesBuffer
+{
+    mat4    WorldViewProjection[];  // row major on the CPU side, so it multiplies column vectors here
+};
+
+void main()
+{
+    gl_Position = WorldViewProjection[gl_InstanceIndex] * vec4(Position, 1.0);
+}
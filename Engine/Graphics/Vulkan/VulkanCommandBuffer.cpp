@@ -1,6 +1,7 @@
 // Copyright (c) Contributors of Primal+
 // Distributed under the MIT license. See the LICENSE file in the project root for more information.
 #include "VulkanCommandBuffer.h"
+#include "VulkanCore.h"
 
 namespace primal::graphics::vulkan {
 
@@ -100,10 +101,10 @@ end_cmd_buffer_single_use(VkDevice device, VkCommandPool cmd_pool, vulkan_cmd_bu
 
     // Submit command buffer to the given queue
     VkResult result{ VK_SUCCESS };
-    VkCall(result = vkQueueSubmit(queue, 1, &info, nullptr), "Failed to submit single use command buffer to queue...");
+    VkCall(result = core::queue_submit(queue, 1, &info, nullptr), "Failed to submit single use command buffer to queue...");
 
     // Wait for the queue to finish doing what it is doing
-    VkCall(result = vkQueueWaitIdle(queue), "vkQueueWaitIdle failed in end_cmd_single_use()");
+    VkCall(result = core::queue_wait_idle(queue), "vkQueueWaitIdle failed in end_cmd_single_use()");
 
     // Then free the single use command buffer
     free_cmd_buffer(device, cmd_pool, cmd_buffer);
@@ -32,6 +32,14 @@ struct vulkan_image
     u32				height;
 };
 
+struct vulkan_buffer
+{
+    VkBuffer		buffer;
+    VkDeviceMemory	memory;
+    u64				size;
+    u8*				cpu_address;	// only set for persistently mapped buffers
+};
+
 struct vulkan_renderpass
 {
     enum state : u32
@@ -0,0 +1,1129 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanContent.h"
+#include "VulkanCore.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanResources.h"
+#include "VulkanTextureStreaming.h"
+#include "Graphics/UploadRing.h"
+#include "Graphics/RangeAllocator.h"
+#include "Graphics/BlockCompression.h"
+#include "Content/ContentToEngine.h"
+#include "Utilities/IOStream.h"
+
+namespace primal::graphics::vulkan::content {
+namespace {
+
+struct submesh_view
+{
+    u32					vertex_pool_index;
+    u32					vertex_range;		// vertexOffset of the draw is the offset of this range
+    u32					index_range;		// firstIndex of the draw is the offset of this range / index size
+    VkIndexType			index_type;
+    VkPrimitiveTopology	primitive_topology;
+    u32					elements_type;
+    u32					index_count;
+    math::v4			sphere;
+};
+
+// All uploads go through a host visible staging buffer, except geometry on integrated GPUs where device
+// local memory is also host visible and the blob can be copied straight into the final buffer.
+// Images always go through the staging buffer, because their optimal tiling layout is opaque.
+class vulkan_upload_context
+{
+public:
+    bool initialize()
+    {
+        VkDevice device{ core::logical_device() };
+        VkResult result{ VK_SUCCESS };
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(core::physical_device(), &properties);
+        _is_uma = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+        if (_is_uma)
+        {
+            MESSAGE("Integrated GPU: geometry is written directly to device memory");
+        }
+
+        VkCommandPoolCreateInfo info{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+        info.queueFamilyIndex = core::graphics_family_queue_index();
+        info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VkCall(result = vkCreateCommandPool(device, &info, nullptr, &_cmd_pool), "Failed to create upload command pool...");
+        if (result != VK_SUCCESS) return false;
+
+        VkFenceCreateInfo f_info{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        VkCall(result = vkCreateFence(device, &f_info, nullptr, &_fence), "Failed to create upload fence...");
+        if (result != VK_SUCCESS) return false;
+
+        _cmd_buffer = allocate_cmd_buffer(device, _cmd_pool, true);
+        return create_staging(staging_size);
+    }
+
+    void release()
+    {
+        VkDevice device{ core::logical_device() };
+        flush();
+        _ring.release();
+        destroy_buffer(device, &_staging);
+        if (_cmd_pool)
+        {
+            free_cmd_buffer(device, _cmd_pool, _cmd_buffer);
+            vkDestroyCommandPool(device, _cmd_pool, nullptr);
+            _cmd_pool = nullptr;
+        }
+        if (_fence)
+        {
+            vkDestroyFence(device, _fence, nullptr);
+            _fence = nullptr;
+        }
+    }
+
+    // Returns the address to write size bytes to. On discrete GPUs the copy into dst is recorded right away
+    // and executed by the next flush(), so the data must be written before then.
+    [[nodiscard]] u8* const allocate(vulkan_buffer& dst, u64 dst_offset, u32 size)
+    {
+        if (_is_uma)
+        {
+            assert(dst.cpu_address);
+            return dst.cpu_address + dst_offset;
+        }
+
+        u32 offset{ 0 };
+        u8* const address{ stage(size, 16, offset) };
+        if (!address) return nullptr;
+
+        VkBufferCopy region{};
+        region.srcOffset = offset;
+        region.dstOffset = dst_offset;
+        region.size = size;
+        vkCmdCopyBuffer(command_buffer(), _staging.buffer, dst.buffer, 1, &region);
+
+        return address;
+    }
+
+    // Returns the address to write size bytes to and their offset in staging_buffer(). The caller records
+    // its own copy from there. Staging may flush pending copies, so get command_buffer() after this call.
+    [[nodiscard]] u8* const stage(u32 size, u32 alignment, u32& offset)
+    {
+        offset = _ring.allocate(size, alignment);
+        if (offset == u32_invalid_id)
+        {
+            // The ring is full: wait for the pending copies, or make room for data larger than the ring.
+            flush();
+            if (size > _ring.size())
+            {
+                VkDevice device{ core::logical_device() };
+                _ring.release();
+                destroy_buffer(device, &_staging);
+                if (!create_staging((u32)math::align_size_up<staging_size>(size))) return nullptr;
+            }
+
+            offset = _ring.allocate(size, alignment);
+            assert(offset != u32_invalid_id);
+        }
+
+        return _ring.cpu_address(offset);
+    }
+
+    [[nodiscard]] VkCommandBuffer command_buffer()
+    {
+        begin_recording();
+        return _cmd_buffer.cmd_buffer;
+    }
+
+    // Records a copy between two device buffers, e.g. to move geometry when a pool is compacted.
+    void copy(const vulkan_buffer& src, u64 src_offset, const vulkan_buffer& dst, u64 dst_offset, u64 size)
+    {
+        if (_is_uma)
+        {
+            memcpy(dst.cpu_address + dst_offset, src.cpu_address + src_offset, size);
+            return;
+        }
+
+        VkBufferCopy region{};
+        region.srcOffset = src_offset;
+        region.dstOffset = dst_offset;
+        region.size = size;
+        vkCmdCopyBuffer(command_buffer(), src.buffer, dst.buffer, 1, &region);
+    }
+
+    // Submits the recorded copies and waits for them. With wait_for_queue set, it also submits when nothing
+    // was recorded: the fence then signals once all work submitted to the queue before it is done.
+    void flush(bool wait_for_queue = false)
+    {
+        if (wait_for_queue) begin_recording();
+        if (_cmd_buffer.cmd_state != vulkan_cmd_buffer::CMD_RECORDING) return;
+
+        // Make the copies visible to every stage that may read geometry.
+        VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(_cmd_buffer.cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        end_cmd_buffer(_cmd_buffer);
+
+        VkSubmitInfo info{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+        info.commandBufferCount = 1;
+        info.pCommandBuffers = &_cmd_buffer.cmd_buffer;
+
+        VkDevice device{ core::logical_device() };
+        VkResult result{ VK_SUCCESS };
+        VkCall(result = core::queue_submit(core::graphics_queue(), 1, &info, _fence), "Failed to submit upload command buffer...");
+        update_cmd_buffer_submitted(_cmd_buffer);
+        VkCall(result = vkWaitForFences(device, 1, &_fence, true, std::numeric_limits<u64>::max()), "Failed to wait for upload fence...");
+        VkCall(result = vkResetFences(device, 1, &_fence), "Failed to reset upload fence...");
+
+        VkCall(result = vkResetCommandBuffer(_cmd_buffer.cmd_buffer, 0), "Failed to reset upload command buffer...");
+        reset_cmd_buffer(_cmd_buffer);
+
+        // The copies are done, so the whole ring can be reused.
+        _ring.begin_frame(0);
+    }
+
+    [[nodiscard]] constexpr bool is_uma() const { return _is_uma; }
+    [[nodiscard]] constexpr VkBuffer staging_buffer() const { return _staging.buffer; }
+
+private:
+    void begin_recording()
+    {
+        if (_cmd_buffer.cmd_state == vulkan_cmd_buffer::CMD_RECORDING) return;
+        begin_cmd_buffer(_cmd_buffer, true, false, false);
+    }
+
+    bool create_staging(u32 size)
+    {
+        buffer_init_info info{};
+        info.device = core::logical_device();
+        info.size = size;
+        info.usage_flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        info.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        info.map_memory = true;
+        if (!create_buffer(&info, _staging)) return false;
+
+        _ring.initialize(_staging.cpu_address, size);
+        return true;
+    }
+
+    static constexpr u32		staging_size{ 32 * 1024 * 1024 };
+
+    vulkan_buffer				_staging{};
+    upload_ring<1>				_ring{};
+    VkCommandPool				_cmd_pool{ nullptr };
+    vulkan_cmd_buffer			_cmd_buffer{};
+    VkFence						_fence{ nullptr };
+    bool						_is_uma{ false };
+};
+
+vulkan_upload_context				upload_context{};
+
+// Large buffers shared by many submeshes. A vertex pool holds the positions and elements of all submeshes with
+// the same element size, so both streams are addressed by the same vertex offset. The index pool holds the
+// 16 and 32 bit indices of all submeshes.
+class vulkan_geometry_pool
+{
+public:
+    constexpr static u32 max_stream_count{ 2 };
+
+    bool initialize(const u32* const strides, u32 stream_count, bool is_index_pool, u32 capacity)
+    {
+        assert(strides && stream_count && stream_count <= max_stream_count && capacity);
+        _stream_count = stream_count;
+        _is_index_pool = is_index_pool;
+        for (u32 i{ 0 }; i < stream_count; ++i) _strides[i] = strides[i];
+        _allocator.initialize(capacity);
+        return create_buffers(capacity, _buffers);
+    }
+
+    void release()
+    {
+        for (u32 i{ 0 }; i < _stream_count; ++i) destroy_buffer(core::logical_device(), &_buffers[i]);
+    }
+
+    // Returns a handle to count elements (vertices or index bytes), compacting or growing the pool if needed.
+    [[nodiscard]] u32 allocate(u32 count, u32 alignment)
+    {
+        u32 handle{ _allocator.allocate(count, alignment) };
+        if (handle != u32_invalid_id) return handle;
+
+        u64 capacity{ _allocator.capacity() };
+        while (capacity - _allocator.used() < (u64)count + alignment) capacity *= 2;
+
+        vulkan_buffer new_buffers[max_stream_count]{};
+        if (!create_buffers(capacity, new_buffers)) return u32_invalid_id;
+
+        // Execute the copies into the old buffers first, so the moves below read up to date data.
+        upload_context.flush();
+        _allocator.compact(capacity, [this, &new_buffers](u32, u64 old_offset, u64 new_offset, u64 size) {
+            for (u32 i{ 0 }; i < _stream_count; ++i)
+            {
+                upload_context.copy(_buffers[i], old_offset * _strides[i], new_buffers[i], new_offset * _strides[i], size * _strides[i]);
+            }
+        });
+        upload_context.flush();
+
+        // Frames in flight may still draw from the old buffers.
+        for (u32 i{ 0 }; i < _stream_count; ++i)
+        {
+            core::deferred_release(_buffers[i]);
+            _buffers[i] = new_buffers[i];
+        }
+
+        return _allocator.allocate(count, alignment);
+    }
+
+    void free(u32 handle) { _allocator.free(handle); }
+
+    // Returns where to write the data of stream for the given range.
+    [[nodiscard]] u8* const upload_address(u32 handle, u32 stream)
+    {
+        const u64 offset{ _allocator.offset(handle) * _strides[stream] };
+        return upload_context.allocate(_buffers[stream], offset, (u32)(_allocator.size(handle) * _strides[stream]));
+    }
+
+    [[nodiscard]] constexpr u32 offset(u32 handle) const { return (u32)_allocator.offset(handle); }
+    [[nodiscard]] constexpr VkBuffer buffer(u32 stream) const { return _buffers[stream].buffer; }
+    [[nodiscard]] constexpr u32 stream_count() const { return _stream_count; }
+
+private:
+    bool create_buffers(u64 capacity, vulkan_buffer* const buffers)
+    {
+        for (u32 i{ 0 }; i < _stream_count; ++i)
+        {
+            buffer_init_info info{};
+            info.device = core::logical_device();
+            info.size = capacity * _strides[i];
+            info.usage_flags = _is_index_pool ? VK_BUFFER_USAGE_INDEX_BUFFER_BIT : (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+            if (upload_context.is_uma())
+            {
+                info.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                info.map_memory = true;
+            }
+            else
+            {
+                info.usage_flags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                info.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            }
+
+            if (!create_buffer(&info, buffers[i]))
+            {
+                for (u32 j{ 0 }; j <= i; ++j) destroy_buffer(info.device, &buffers[j]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    range_allocator			_allocator{};
+    vulkan_buffer			_buffers[max_stream_count]{};
+    u32						_strides[max_stream_count]{};
+    u32						_stream_count{ 0 };
+    bool					_is_index_pool{ false };
+};
+
+// Geometry ranges of a removed submesh that frames in flight may still read. They aren't freed until those
+// frames are done, because the next upload would overwrite them: on integrated GPUs straight from the CPU.
+struct vulkan_material
+{
+    material_type::type			type;
+    utl::vector<id::id_type>	texture_ids;		// texture streaming ids
+};
+
+struct vulkan_render_item
+{
+    id::id_type					entity_id;
+    id::id_type					geometry_content_id;
+    utl::vector<id::id_type>	submesh_gpu_ids;	// one per material. Invalid for submeshes with non-opaque materials.
+    utl::vector<id::id_type>	material_ids;
+};
+
+struct pending_free
+{
+    u32					vertex_pool_index;
+    u32					vertex_range;
+    u32					index_range;
+    u64					frame_serial;		// the last frame that may read the ranges
+};
+
+struct vulkan_texture
+{
+    vulkan_image		image;
+    VkFormat			format;
+    u32					mip_levels;
+    u32					array_layers;
+    u64					size;				// bytes of device memory
+};
+
+// Texture blobs store DXGI formats, because that's what the content pipeline produces.
+struct texture_format
+{
+    u32									dxgi_format;
+    VkFormat							format;
+    u32									bytes_per_pixel;	// 0 for block compressed formats
+    block_compression::format::type		fallback;			// CPU decoder for devices that can't sample the format
+    VkFormat							fallback_format;
+};
+
+constexpr block_compression::format::type no_fallback{ block_compression::format::count };
+
+constexpr texture_format texture_formats[]{
+    {  2, VK_FORMAT_R32G32B32A32_SFLOAT,		16, no_fallback, VK_FORMAT_UNDEFINED },
+    {  6, VK_FORMAT_R32G32B32_SFLOAT,			12, no_fallback, VK_FORMAT_UNDEFINED },
+    { 10, VK_FORMAT_R16G16B16A16_SFLOAT,		 8, no_fallback, VK_FORMAT_UNDEFINED },
+    { 11, VK_FORMAT_R16G16B16A16_UNORM,			 8, no_fallback, VK_FORMAT_UNDEFINED },
+    { 16, VK_FORMAT_R32G32_SFLOAT,				 8, no_fallback, VK_FORMAT_UNDEFINED },
+    { 24, VK_FORMAT_A2B10G10R10_UNORM_PACK32,	 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 26, VK_FORMAT_B10G11R11_UFLOAT_PACK32,	 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 28, VK_FORMAT_R8G8B8A8_UNORM,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 29, VK_FORMAT_R8G8B8A8_SRGB,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 31, VK_FORMAT_R8G8B8A8_SNORM,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 34, VK_FORMAT_R16G16_SFLOAT,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 35, VK_FORMAT_R16G16_UNORM,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 41, VK_FORMAT_R32_SFLOAT,					 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 49, VK_FORMAT_R8G8_UNORM,					 2, no_fallback, VK_FORMAT_UNDEFINED },
+    { 51, VK_FORMAT_R8G8_SNORM,					 2, no_fallback, VK_FORMAT_UNDEFINED },
+    { 54, VK_FORMAT_R16_SFLOAT,					 2, no_fallback, VK_FORMAT_UNDEFINED },
+    { 56, VK_FORMAT_R16_UNORM,					 2, no_fallback, VK_FORMAT_UNDEFINED },
+    { 61, VK_FORMAT_R8_UNORM,					 1, no_fallback, VK_FORMAT_UNDEFINED },
+    { 63, VK_FORMAT_R8_SNORM,					 1, no_fallback, VK_FORMAT_UNDEFINED },
+    { 71, VK_FORMAT_BC1_RGBA_UNORM_BLOCK,		 0, block_compression::format::bc1, VK_FORMAT_R8G8B8A8_UNORM },
+    { 72, VK_FORMAT_BC1_RGBA_SRGB_BLOCK,		 0, block_compression::format::bc1, VK_FORMAT_R8G8B8A8_SRGB },
+    { 74, VK_FORMAT_BC2_UNORM_BLOCK,			 0, block_compression::format::bc2, VK_FORMAT_R8G8B8A8_UNORM },
+    { 75, VK_FORMAT_BC2_SRGB_BLOCK,				 0, block_compression::format::bc2, VK_FORMAT_R8G8B8A8_SRGB },
+    { 77, VK_FORMAT_BC3_UNORM_BLOCK,			 0, block_compression::format::bc3, VK_FORMAT_R8G8B8A8_UNORM },
+    { 78, VK_FORMAT_BC3_SRGB_BLOCK,				 0, block_compression::format::bc3, VK_FORMAT_R8G8B8A8_SRGB },
+    { 80, VK_FORMAT_BC4_UNORM_BLOCK,			 0, block_compression::format::bc4, VK_FORMAT_R8_UNORM },
+    { 81, VK_FORMAT_BC4_SNORM_BLOCK,			 0, block_compression::format::bc4_snorm, VK_FORMAT_R8_SNORM },
+    { 83, VK_FORMAT_BC5_UNORM_BLOCK,			 0, block_compression::format::bc5, VK_FORMAT_R8G8_UNORM },
+    { 84, VK_FORMAT_BC5_SNORM_BLOCK,			 0, block_compression::format::bc5_snorm, VK_FORMAT_R8G8_SNORM },
+    { 87, VK_FORMAT_B8G8R8A8_UNORM,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 91, VK_FORMAT_B8G8R8A8_SRGB,				 4, no_fallback, VK_FORMAT_UNDEFINED },
+    { 95, VK_FORMAT_BC6H_UFLOAT_BLOCK,			 0, block_compression::format::bc6h, VK_FORMAT_R16G16B16A16_SFLOAT },
+    { 96, VK_FORMAT_BC6H_SFLOAT_BLOCK,			 0, block_compression::format::bc6h_sf, VK_FORMAT_R16G16B16A16_SFLOAT },
+    { 98, VK_FORMAT_BC7_UNORM_BLOCK,			 0, block_compression::format::bc7, VK_FORMAT_R8G8B8A8_UNORM },
+    { 99, VK_FORMAT_BC7_SRGB_BLOCK,				 0, block_compression::format::bc7, VK_FORMAT_R8G8B8A8_SRGB },
+};
+
+utl::free_list<submesh_view>		submesh_views{};
+utl::vector<vulkan_geometry_pool>	vertex_pools;
+utl::vector<u32>					vertex_pool_element_sizes;
+vulkan_geometry_pool				index_pool{};
+bool								is_upload_context_ready{ false };
+utl::free_list<vulkan_texture>		textures{};
+utl::vector<vulkan_image>			deferred_texture_releases;
+utl::vector<pending_free>			pending_frees;
+utl::free_list<vulkan_material>		materials{};
+utl::free_list<vulkan_render_item>	render_items{};
+utl::vector<id::id_type>			frame_geometry_ids;
+utl::vector<primal::content::lod_offset>	frame_lod_offsets;
+std::mutex							content_mutex{};
+
+thread_local submesh::load_stats	thread_stats{};
+
+// Centered on the bounding box, with the distance to the farthest vertex as radius. Not the tightest
+// sphere, but cheap to find and good enough for culling.
+math::v4
+calculate_bounding_sphere(const math::v3* const positions, u32 vertex_count)
+{
+    using namespace DirectX;
+    if (!vertex_count) return {};
+
+    XMVECTOR min{ XMLoadFloat3(&positions[0]) };
+    XMVECTOR max{ min };
+    for (u32 i{ 1 }; i < vertex_count; ++i)
+    {
+        const XMVECTOR p{ XMLoadFloat3(&positions[i]) };
+        min = XMVectorMin(min, p);
+        max = XMVectorMax(max, p);
+    }
+
+    const XMVECTOR center{ XMVectorScale(XMVectorAdd(min, max), 0.5f) };
+    XMVECTOR radius_sq{ XMVectorZero() };
+    for (u32 i{ 0 }; i < vertex_count; ++i)
+    {
+        radius_sq = XMVectorMax(radius_sq, XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&positions[i]), center)));
+    }
+
+    math::v4 sphere;
+    XMStoreFloat4(&sphere, XMVectorSelect(center, XMVectorSqrt(radius_sq), g_XMSelect0001));
+    return sphere;
+}
+
+VkPrimitiveTopology
+get_vulkan_primitive_topology(primitive_topology::type type)
+{
+    assert(type < primitive_topology::count);
+
+    switch (type)
+    {
+    case primitive_topology::point_list: return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    case primitive_topology::line_list: return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+    case primitive_topology::line_strip: return VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+    case primitive_topology::triangle_list: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    case primitive_topology::triangle_strip: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    }
+
+    return VK_PRIMITIVE_TOPOLOGY_MAX_ENUM;
+}
+
+u32
+get_vertex_pool(u32 element_size)
+{
+    const u32 count{ (u32)vertex_pool_element_sizes.size() };
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        if (vertex_pool_element_sizes[i] == element_size) return i;
+    }
+
+    constexpr u32 initial_vertex_capacity{ 64 * 1024 };
+    const u32 strides[]{ sizeof(math::v3), element_size };
+    vertex_pools.emplace_back();
+    if (!vertex_pools.back().initialize(&strides[0], element_size ? 2 : 1, false, initial_vertex_capacity))
+    {
+        vertex_pools.pop_back();
+        return u32_invalid_id;
+    }
+
+    vertex_pool_element_sizes.emplace_back(element_size);
+    return count;
+}
+
+bool
+initialize_upload_context()
+{
+    if (is_upload_context_ready) return true;
+
+    constexpr u32 initial_index_capacity{ 4 * 1024 * 1024 };
+    const u32 index_stride{ 1 };
+    if (!upload_context.initialize() || !index_pool.initialize(&index_stride, 1, true, initial_index_capacity)) return false;
+    is_upload_context_ready = true;
+    return true;
+}
+
+void
+free_pending_ranges(u64 completed_frame_serial)
+{
+    for (u32 i{ (u32)pending_frees.size() }; i > 0; --i)
+    {
+        const pending_free& pending{ pending_frees[i - 1] };
+        if (pending.frame_serial > completed_frame_serial) continue;
+        vertex_pools[pending.vertex_pool_index].free(pending.vertex_range);
+        index_pool.free(pending.index_range);
+        utl::erase_unordered(pending_frees, i - 1);
+    }
+}
+
+const texture_format* const
+get_texture_format(u32 dxgi_format)
+{
+    for (const texture_format& f : texture_formats)
+    {
+        if (f.dxgi_format == dxgi_format) return &f;
+    }
+
+    return nullptr;
+}
+
+bool
+has_format_features(VkFormat format, VkFormatFeatureFlags features)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(core::physical_device(), format, &properties);
+    return (properties.optimalTilingFeatures & features) == features;
+}
+
+void
+transition_image(VkCommandBuffer cmd, VkImage image, u32 base_mip, u32 mip_count, u32 layer_count,
+    VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
+    VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+    VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, base_mip, mip_count, 0, layer_count };
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Each mip is a linear downsample of the one above it. Expects every mip in TRANSFER_DST layout and
+// leaves all of them in TRANSFER_SRC layout.
+void
+generate_mips(const vulkan_texture& texture, u32 width, u32 height, u32 depth)
+{
+    const VkImage image{ texture.image.image };
+    for (u32 mip{ 1 }; mip < texture.mip_levels; ++mip)
+    {
+        VkCommandBuffer cmd{ upload_context.command_buffer() };
+        transition_image(cmd, image, mip - 1, 1, texture.array_layers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        const u32 mip_width{ std::max(width >> 1, 1u) };
+        const u32 mip_height{ std::max(height >> 1, 1u) };
+        const u32 mip_depth{ std::max(depth >> 1, 1u) };
+
+        VkImageBlit blit{};
+        blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, texture.array_layers };
+        blit.srcOffsets[1] = { (s32)width, (s32)height, (s32)depth };
+        blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, texture.array_layers };
+        blit.dstOffsets[1] = { (s32)mip_width, (s32)mip_height, (s32)mip_depth };
+        vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        width = mip_width;
+        height = mip_height;
+        depth = mip_depth;
+    }
+
+    transition_image(upload_context.command_buffer(), image, texture.mip_levels - 1, 1, texture.array_layers,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+}
+
+// Stages one subresource and records its copy. Block compressed data the device can't sample is decoded
+// straight into the staging buffer.
+// Copies mip_count mips of all layers from one texture to another of the same format. Both have to be in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL respectively, and the
+// source is back in the former afterwards. width, height and depth are the extent of the first copied mip.
+void
+copy_mips(const vulkan_texture& source, u32 source_mip, const vulkan_texture& texture, u32 mip, u32 mip_count,
+    u32 width, u32 height, u32 depth)
+{
+    VkCommandBuffer cmd{ upload_context.command_buffer() };
+    // NOTE: frames submitted earlier may still sample the source, so the transition waits for their shaders.
+    transition_image(cmd, source.image.image, source_mip, mip_count, source.array_layers,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkImageCopy regions[16];
+    assert(mip_count <= _countof(regions));
+    for (u32 i{ 0 }; i < mip_count; ++i)
+    {
+        regions[i] = {};
+        regions[i].srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, source_mip + i, 0, source.array_layers };
+        regions[i].dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip + i, 0, texture.array_layers };
+        regions[i].extent = { std::max(width >> i, 1u), std::max(height >> i, 1u), std::max(depth >> i, 1u) };
+    }
+
+    vkCmdCopyImage(cmd, source.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_count, &regions[0]);
+
+    transition_image(cmd, source.image.image, source_mip, mip_count, source.array_layers,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+bool
+upload_subresource(const vulkan_texture& texture, const texture_format& format, bool decode, const u8* const data,
+    u32 row_pitch, u32 slice_pitch, u32 mip, u32 layer, u32 width, u32 height, u32 depth)
+{
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, layer, 1 };
+    region.imageExtent = { width, height, depth };
+
+    u32 offset{ 0 };
+    if (decode)
+    {
+        const u32 pixel_size{ block_compression::pixel_size(format.fallback) };
+        const u32 decoded_slice_size{ width * height * pixel_size };
+        u8* const pixels{ upload_context.stage(decoded_slice_size * depth, 16, offset) };
+        if (!pixels) return false;
+
+        for (u32 z{ 0 }; z < depth; ++z)
+        {
+            block_compression::decode(format.fallback, data + (u64)z * slice_pitch, row_pitch, width, height, pixels + (u64)z * decoded_slice_size);
+        }
+    }
+    else
+    {
+        u8* const address{ upload_context.stage(slice_pitch * depth, 16, offset) };
+        if (!address) return false;
+        memcpy(address, data, (u64)slice_pitch * depth);
+
+        // Pitches are in bytes in the blob and in texels in Vulkan. Compressed rows are rows of 4x4 blocks.
+        if (format.bytes_per_pixel)
+        {
+            region.bufferRowLength = row_pitch / format.bytes_per_pixel;
+            region.bufferImageHeight = slice_pitch / row_pitch;
+        }
+        else
+        {
+            region.bufferRowLength = row_pitch / block_compression::block_size(format.fallback) * 4;
+            region.bufferImageHeight = slice_pitch / row_pitch * 4;
+        }
+    }
+
+    region.bufferOffset = offset;
+    vkCmdCopyBufferToImage(upload_context.command_buffer(), upload_context.staging_buffer(), texture.image.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    return true;
+}
+
+submesh::draw_info
+get_view_draw_info(const submesh_view& view)
+{
+    submesh::draw_info info{};
+    info.index_count = view.index_count;
+    info.first_index = index_pool.offset(view.index_range) / (u32)(view.index_type == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32));
+    info.vertex_offset = (s32)vertex_pools[view.vertex_pool_index].offset(view.vertex_range);
+    info.vertex_pool = view.vertex_pool_index;
+    info.index_type = view.index_type;
+    info.sphere = view.sphere;
+    return info;
+}
+
+} // anonymous namespace
+
+void
+shutdown()
+{
+    std::lock_guard lock{ content_mutex };
+    if (is_upload_context_ready)
+    {
+        assert(submesh_views.empty() && textures.empty() && render_items.empty() && materials.empty());
+        upload_context.flush(true);
+        free_pending_ranges(std::numeric_limits<u64>::max());
+        for (auto& image : deferred_texture_releases) destroy_image(core::logical_device(), &image);
+        deferred_texture_releases.clear();
+        for (auto& pool : vertex_pools) pool.release();
+        vertex_pools.clear();
+        vertex_pool_element_sizes.clear();
+        index_pool.release();
+        frame_geometry_ids.clear();
+        frame_lod_offsets.clear();
+
+        upload_context.release();
+        is_upload_context_ready = false;
+    }
+}
+
+void
+flush_uploads()
+{
+    std::lock_guard lock{ content_mutex };
+    if (!is_upload_context_ready) return;
+
+    free_pending_ranges(core::completed_frame_serial());
+
+    // Removed textures may still be used by frames in flight. Waiting for the upload fence also waits for
+    // those frames, since they were submitted to the same queue earlier.
+    upload_context.flush(!deferred_texture_releases.empty());
+    for (auto& image : deferred_texture_releases) destroy_image(core::logical_device(), &image);
+    deferred_texture_releases.clear();
+}
+
+namespace submesh {
+// NOTE: the blob is read in place. Every byte is written once, either into the staging ring or, on
+//		 integrated GPUs, straight into the mapped geometry pools. There are no intermediate copies.
+id::id_type
+add(const u8*& data)
+{
+    const auto start{ std::chrono::steady_clock::now() };
+    utl::blob_stream_reader blob{ (const u8*)data };
+
+    const u32 element_size{ blob.read<u32>() };
+    const u32 vertex_count{ blob.read<u32>() };
+    const u32 index_count{ blob.read<u32>() };
+    const u32 elements_type{ blob.read<u32>() };
+    const u32 primitive_topology{ blob.read<u32>() };
+    const u32 index_size{ (vertex_count < (1 << 16)) ? sizeof(u16) : sizeof(u32) };
+
+    // NOTE: the geometry blob pads the position and element streams to 4 bytes.
+    constexpr u32 alignment{ 4 };
+    const u32 position_buffer_size{ sizeof(math::v3) * vertex_count };
+    const u32 element_buffer_size{ element_size * vertex_count };
+    const u32 index_buffer_size{ index_size * index_count };
+
+    submesh_view view{};
+    view.index_type = (index_size == sizeof(u16)) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    view.primitive_topology = get_vulkan_primitive_topology((primitive_topology::type)primitive_topology);
+    view.elements_type = elements_type;
+    view.index_count = index_count;
+    view.sphere = calculate_bounding_sphere((const math::v3*)blob.position(), vertex_count);
+
+    std::lock_guard lock{ content_mutex };
+    if (!initialize_upload_context()) return id::invalid_id;
+
+    view.vertex_pool_index = get_vertex_pool(element_size);
+    if (view.vertex_pool_index == u32_invalid_id) return id::invalid_id;
+
+    vulkan_geometry_pool& pool{ vertex_pools[view.vertex_pool_index] };
+    view.vertex_range = pool.allocate(vertex_count, 1);
+    // NOTE: index ranges are aligned to 4 bytes, so their offset divides evenly by the size of both index types.
+    view.index_range = index_pool.allocate(index_buffer_size, sizeof(u32));
+    if (view.vertex_range == u32_invalid_id || view.index_range == u32_invalid_id)
+    {
+        if (view.vertex_range != u32_invalid_id) pool.free(view.vertex_range);
+        if (view.index_range != u32_invalid_id) index_pool.free(view.index_range);
+        return id::invalid_id;
+    }
+
+    u8* const positions{ pool.upload_address(view.vertex_range, 0) };
+    memcpy(positions, blob.position(), position_buffer_size);
+    blob.skip((u32)math::align_size_up<alignment>(position_buffer_size));
+
+    if (element_size)
+    {
+        u8* const elements{ pool.upload_address(view.vertex_range, 1) };
+        memcpy(elements, blob.position(), element_buffer_size);
+    }
+    blob.skip((u32)math::align_size_up<alignment>(element_buffer_size));
+
+    u8* const indices{ index_pool.upload_address(view.index_range, 0) };
+    memcpy(indices, blob.position(), index_buffer_size);
+    blob.skip(index_buffer_size);
+
+    const id::id_type id{ submesh_views.add(view) };
+
+    const u32 total_buffer_size{ position_buffer_size + element_buffer_size + index_buffer_size };
+    thread_stats.bytes_uploaded += total_buffer_size;
+    thread_stats.bytes_copied += total_buffer_size;
+    thread_stats.load_time_ms += std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++thread_stats.submesh_count;
+    return id;
+}
+
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    const submesh_view& view{ submesh_views[id] };
+    pending_frees.emplace_back(pending_free{ view.vertex_pool_index, view.vertex_range, view.index_range, core::current_frame_serial() });
+    submesh_views.remove(id);
+}
+
+draw_info
+get_draw_info(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    return get_view_draw_info(submesh_views[id]);
+}
+
+VkBuffer
+vertex_buffer(u32 vertex_pool, u32 stream)
+{
+    std::lock_guard lock{ content_mutex };
+    assert(vertex_pool < vertex_pools.size() && stream < vertex_pools[vertex_pool].stream_count());
+    return vertex_pools[vertex_pool].buffer(stream);
+}
+
+VkBuffer
+index_buffer()
+{
+    std::lock_guard lock{ content_mutex };
+    return index_pool.buffer(0);
+}
+
+const load_stats&
+thread_load_stats()
+{
+    return thread_stats;
+}
+}//namespace submesh
+
+namespace texture {
+id::id_type
+add(const u8* const data)
+{
+    return add(data, 0, id::invalid_id);
+}
+
+id::id_type
+add(const u8* const data, u32 first_mip, id::id_type source_id)
+{
+    assert(data);
+    utl::blob_stream_reader blob{ data };
+    const u32 source_width{ blob.read<u32>() };
+    const u32 source_height{ blob.read<u32>() };
+    u32 array_size{ blob.read<u32>() };
+    const u32 flags{ blob.read<u32>() };
+    const u32 stored_mip_levels{ blob.read<u32>() };
+    const u32 dxgi_format{ blob.read<u32>() };
+    const bool is_3d{ (flags & primal::content::texture_flags::is_volume_map) != 0 };
+    const bool is_cube_map{ (flags & primal::content::texture_flags::is_cube_map) != 0 };
+
+    // NOTE: volume maps store their depth in the array size.
+    u32 source_depth{ 1 };
+    if (is_3d)
+    {
+        source_depth = array_size;
+        array_size = 1;
+    }
+
+    // The mips above first_mip are left out of the image. Mip first_mip becomes mip 0.
+    assert(stored_mip_levels);
+    first_mip = std::min(first_mip, stored_mip_levels - 1);
+    const u32 width{ std::max(source_width >> first_mip, 1u) };
+    const u32 height{ std::max(source_height >> first_mip, 1u) };
+    const u32 depth{ std::max(source_depth >> first_mip, 1u) };
+
+    const texture_format* const format{ get_texture_format(dxgi_format) };
+    if (!format)
+    {
+        ERROR_MSSG("Unsupported texture format...");
+        return id::invalid_id;
+    }
+
+    vulkan_texture texture{};
+    texture.format = format->format;
+    texture.array_layers = array_size;
+    texture.mip_levels = stored_mip_levels - first_mip;
+
+    bool decode{ false };
+    if (!has_format_features(format->format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        if (format->fallback == no_fallback)
+        {
+            ERROR_MSSG("The device can't sample this texture format and there's no CPU decoder for it...");
+            return id::invalid_id;
+        }
+
+        MESSAGE("Texture format not supported by the device: decoding on the CPU");
+        texture.format = format->fallback_format;
+        decode = true;
+    }
+
+    // Textures that come without mips get a full chain, as long as the format can be blitted and filtered.
+    const bool is_compressed{ !format->bytes_per_pixel && !decode };
+    const bool generate{ stored_mip_levels == 1 && !is_compressed && (width > 1 || height > 1) &&
+        has_format_features(texture.format, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) };
+    if (generate)
+    {
+        u32 size{ std::max(std::max(width, height), depth) };
+        texture.mip_levels = 1;
+        while (size >>= 1) ++texture.mip_levels;
+    }
+
+    image_init_info info{};
+    info.device = core::logical_device();
+    info.image_type = is_3d ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+    info.width = width;
+    info.height = height;
+    info.depth = depth;
+    info.mip_levels = texture.mip_levels;
+    info.array_layers = array_size;
+    info.flags = is_cube_map ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+    info.format = texture.format;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // NOTE: textures are also a transfer source, so their mips can be copied when they're replaced by another
+    //		 texture made from the same blob.
+    info.usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    info.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    info.create_view = true;
+    info.view_aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT;
+    if (is_3d) info.view_type = VK_IMAGE_VIEW_TYPE_3D;
+    else if (is_cube_map) info.view_type = array_size > 6 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+    else info.view_type = array_size > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    assert(!is_cube_map || array_size % 6 == 0);
+
+    if (!create_image(&info, texture.image))
+    {
+        destroy_image(info.device, &texture.image);
+        return id::invalid_id;
+    }
+
+    VkMemoryRequirements memory_reqs;
+    vkGetImageMemoryRequirements(info.device, texture.image.image, &memory_reqs);
+    texture.size = memory_reqs.size;
+
+    std::lock_guard lock{ content_mutex };
+    if (!initialize_upload_context())
+    {
+        destroy_image(info.device, &texture.image);
+        return id::invalid_id;
+    }
+
+    transition_image(upload_context.command_buffer(), texture.image.image, 0, texture.mip_levels, array_size,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    // Mips from copy_first_mip on are already in the source texture, which holds the last mips of the blob.
+    u32 copy_first_mip{ stored_mip_levels };
+    u32 source_first_mip{ 0 };
+    if (id::is_valid(source_id) && !generate)
+    {
+        const vulkan_texture& source{ textures[source_id] };
+        if (source.format == texture.format && source.array_layers == array_size && source.mip_levels <= stored_mip_levels)
+        {
+            source_first_mip = stored_mip_levels - source.mip_levels;
+            copy_first_mip = std::max(first_mip, source_first_mip);
+        }
+    }
+
+    for (u32 layer{ 0 }; layer < array_size; ++layer)
+    {
+        for (u32 mip{ 0 }; mip < stored_mip_levels; ++mip)
+        {
+            const u32 row_pitch{ blob.read<u32>() };
+            const u32 slice_pitch{ blob.read<u32>() };
+            const u32 mip_width{ std::max(source_width >> mip, 1u) };
+            const u32 mip_height{ std::max(source_height >> mip, 1u) };
+            const u32 mip_depth{ std::max(source_depth >> mip, 1u) };
+
+            if (mip >= first_mip && mip < copy_first_mip &&
+                !upload_subresource(texture, *format, decode, blob.position(), row_pitch, slice_pitch, mip - first_mip, layer, mip_width, mip_height, mip_depth))
+            {
+                // NOTE: the image may already be referenced by recorded copies, so it can't be destroyed right away.
+                deferred_texture_releases.emplace_back(texture.image);
+                return id::invalid_id;
+            }
+
+            blob.skip(slice_pitch * mip_depth);
+        }
+    }
+
+    if (copy_first_mip < stored_mip_levels)
+    {
+        copy_mips(textures[source_id], copy_first_mip - source_first_mip, texture, copy_first_mip - first_mip, stored_mip_levels - copy_first_mip,
+            std::max(source_width >> copy_first_mip, 1u), std::max(source_height >> copy_first_mip, 1u), std::max(source_depth >> copy_first_mip, 1u));
+    }
+
+    VkImageLayout layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    VkAccessFlags access{ VK_ACCESS_TRANSFER_WRITE_BIT };
+    if (generate)
+    {
+        generate_mips(texture, width, height, depth);
+        layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        access = VK_ACCESS_TRANSFER_READ_BIT;
+    }
+
+    transition_image(upload_context.command_buffer(), texture.image.image, 0, texture.mip_levels, array_size,
+        layout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, access, VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    return textures.add(texture);
+}
+
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    deferred_texture_releases.emplace_back(textures[id].image);
+    textures.remove(id);
+}
+
+VkImageView
+image_view(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    return textures[id].image.view;
+}
+
+u64
+size(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    return textures[id].size;
+}
+}//namespace texture
+
+namespace material {
+id::id_type
+add(material_init_info info)
+{
+    vulkan_material material{};
+    material.type = info.type;
+    material.texture_ids.resize(info.texture_count);
+    if (info.texture_count) memcpy(material.texture_ids.data(), info.texture_ids, info.texture_count * sizeof(id::id_type));
+
+    std::lock_guard lock{ content_mutex };
+    return materials.add(std::move(material));
+}
+
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    materials.remove(id);
+}
+
+void
+get_texture_ids(id::id_type id, utl::vector<id::id_type>& texture_ids)
+{
+    std::lock_guard lock{ content_mutex };
+    const utl::vector<id::id_type>& ids{ materials[id].texture_ids };
+    texture_ids.resize(ids.size());
+    if (!ids.empty()) memcpy(texture_ids.data(), ids.data(), ids.size() * sizeof(id::id_type));
+}
+
+void
+get_texture_views(id::id_type id, utl::vector<VkImageView>& views)
+{
+    std::lock_guard lock{ content_mutex };
+    const utl::vector<id::id_type>& ids{ materials[id].texture_ids };
+    views.resize(ids.size());
+    for (u32 i{ 0 }; i < ids.size(); ++i) views[i] = texture_streaming::image_view(ids[i]);
+}
+}//namespace material
+
+namespace render_item {
+id::id_type
+add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids)
+{
+    assert(id::is_valid(entity_id) && id::is_valid(geometry_content_id));
+    assert(material_count && material_ids);
+
+    vulkan_render_item item{};
+    item.entity_id = entity_id;
+    item.geometry_content_id = geometry_content_id;
+    item.submesh_gpu_ids.resize(material_count);
+    item.material_ids.resize(material_count);
+    primal::content::get_submesh_gpu_ids(geometry_content_id, material_count, item.submesh_gpu_ids.data());
+    memcpy(item.material_ids.data(), material_ids, material_count * sizeof(id::id_type));
+
+    std::lock_guard lock{ content_mutex };
+    for (u32 i{ 0 }; i < material_count; ++i)
+    {
+        assert(id::is_valid(item.submesh_gpu_ids[i]) && id::is_valid(material_ids[i]));
+        if (materials[material_ids[i]].type != material_type::opaque) item.submesh_gpu_ids[i] = id::invalid_id;
+    }
+
+    return render_items.add(std::move(item));
+}
+
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ content_mutex };
+    render_items.remove(id);
+}
+
+void
+get_frame_items(const frame_info& info, utl::vector<frame_item>& items)
+{
+    assert(info.render_item_ids && info.thresholds && info.render_item_count);
+    items.clear();
+
+    const u32 count{ info.render_item_count };
+    frame_geometry_ids.resize(count);
+    frame_lod_offsets.clear();
+
+    std::lock_guard lock{ content_mutex };
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        frame_geometry_ids[i] = render_items[info.render_item_ids[i]].geometry_content_id;
+    }
+
+    primal::content::get_lod_offsets(frame_geometry_ids.data(), info.thresholds, count, frame_lod_offsets);
+    assert(frame_lod_offsets.size() == count);
+
+    for (u32 i{ 0 }; i < count; ++i)
+    {
+        const vulkan_render_item& item{ render_items[info.render_item_ids[i]] };
+        const primal::content::lod_offset& lod_offset{ frame_lod_offsets[i] };
+        for (u32 j{ lod_offset.offset }; j < (u32)lod_offset.offset + lod_offset.count; ++j)
+        {
+            const id::id_type gpu_id{ item.submesh_gpu_ids[j] };
+            if (!id::is_valid(gpu_id)) continue;
+
+            items.emplace_back(frame_item{ item.entity_id, item.material_ids[j], get_view_draw_info(submesh_views[gpu_id]) });
+        }
+    }
+}
+}//namespace render_item
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace primal::graphics::vulkan::content {
+
+void shutdown();
+// Submits the copies recorded since the last flush and waits for them to finish.
+void flush_uploads();
+
+namespace submesh {
+struct load_stats
+{
+    u64		bytes_uploaded;		// bytes read from the geometry blobs
+    u64		bytes_copied;		// bytes the CPU wrote on their way to the GPU (one copy per byte at most)
+    f32		load_time_ms;
+    u32		submesh_count;
+};
+
+// Arguments of an indexed draw of the submesh. Submeshes can only share an indirect draw call if they have
+// the same vertex pool and index type, since those decide the buffers to bind.
+struct draw_info
+{
+    u32				index_count;
+    u32				first_index;
+    s32				vertex_offset;
+    u32				vertex_pool;
+    VkIndexType		index_type;
+    math::v4		sphere;			// bounding sphere in model space: center and radius
+};
+
+id::id_type add(const u8*& data);
+void remove(id::id_type id);
+[[nodiscard]] draw_info get_draw_info(id::id_type id);
+// Buffers to bind for drawing submeshes. They change when a pool grows, so get them every frame.
+[[nodiscard]] VkBuffer vertex_buffer(u32 vertex_pool, u32 stream);
+[[nodiscard]] VkBuffer index_buffer();
+// Stats of the submeshes added on the calling thread since it started.
+[[nodiscard]] const load_stats& thread_load_stats();
+}//namespace submesh
+
+namespace texture {
+id::id_type add(const u8* const data);
+// Leaves out the mips above first_mip. Used for streaming in and evicting the detailed mips. The mips that
+// source_id, a texture made from the same blob, already has are copied from it instead of being uploaded.
+id::id_type add(const u8* const data, u32 first_mip, id::id_type source_id);
+void remove(id::id_type id);
+[[nodiscard]] VkImageView image_view(id::id_type id);
+// Device memory used by the texture in bytes.
+[[nodiscard]] u64 size(id::id_type id);
+}//namespace texture
+
+namespace material {
+// NOTE: there are no material pipelines in this backend yet. Materials keep their type, which decides the
+//		 render items that take part in the culling and depth passes, and their textures.
+id::id_type add(material_init_info info);
+void remove(id::id_type id);
+// Texture streaming ids of the material's textures.
+void get_texture_ids(id::id_type id, utl::vector<id::id_type>& texture_ids);
+// Views to bind for the material's textures. They change as mips are streamed in and evicted, so get them every frame.
+void get_texture_views(id::id_type id, utl::vector<VkImageView>& views);
+}//namespace material
+
+namespace render_item {
+struct frame_item
+{
+    id::id_type				entity_id;
+    id::id_type				material_id;
+    submesh::draw_info		draw;
+};
+
+id::id_type add(id::id_type entity_id, id::id_type geometry_content_id, u32 material_count, const id::id_type* const material_ids);
+void remove(id::id_type id);
+// Submeshes of the opaque render items in info at the LODs picked by info.thresholds, in the order of info.render_item_ids.
+void get_frame_items(const frame_info& info, utl::vector<frame_item>& items);
+}//namespace render_item
+}
@@ -7,12 +7,54 @@
 #include "VulkanCommandBuffer.h"
 #include "VulkanResources.h"
 #include "VulkanHelpers.h"
+#include "VulkanContent.h"
+#include "VulkanTextureStreaming.h"
+#include "VulkanGpuCulling.h"
+#include "VulkanDepthPrepass.h"
+#include "VulkanGPass.h"
+#include "VulkanShaders.h"
 #include <set>
+#include <mutex>
+#include <atomic>
 
 namespace primal::graphics::vulkan::core {
 
 namespace {
-    
+
+struct deferred_buffer
+{
+    vulkan_buffer	buffer;
+    u64				frame_serial;	// the last frame that may use the buffer
+};
+
+struct deferred_image
+{
+    vulkan_image	image;
+    u64				frame_serial;	// the last frame that may use the image
+};
+
+utl::vector<deferred_buffer>	deferred_buffers;
+utl::vector<deferred_image>		deferred_images;
+std::mutex						deferred_releases_mutex{};
+
+void
+process_deferred_releases(u64 completed_frame_serial)
+{
+    std::lock_guard lock{ deferred_releases_mutex };
+    for (u32 i{ (u32)deferred_buffers.size() }; i > 0; --i)
+    {
+        if (deferred_buffers[i - 1].frame_serial > completed_frame_serial) continue;
+        destroy_buffer(core::logical_device(), &deferred_buffers[i - 1].buffer);
+        utl::erase_unordered(deferred_buffers, i - 1);
+    }
+    for (u32 i{ (u32)deferred_images.size() }; i > 0; --i)
+    {
+        if (deferred_images[i - 1].frame_serial > completed_frame_serial) continue;
+        destroy_image(core::logical_device(), &deferred_images[i - 1].image);
+        utl::erase_unordered(deferred_images, i - 1);
+    }
+}
+
 class vulkan_command
 {
 public:
@@ -49,6 +91,7 @@ public:
             _image_available.resize(_swapchain_image_count);
             _render_finished.resize(_swapchain_image_count);
             _draw_fences.resize(_swapchain_image_count);
+            _frame_serials.resize(_swapchain_image_count);
             VkSemaphoreCreateInfo s_info{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 
             // NOTE: fences here are created in an already signaled state, which indicates to Vulkan API that the frame
@@ -84,7 +127,7 @@ public:
         // Are we currently recreating the swapchain?
         if (surface->is_recreating())
         {
-            VkResult result{ vkDeviceWaitIdle(core::logical_device()) };
+            VkResult result{ core::device_wait_idle() };
             if (!vulkan_success(result))
             {
                 MESSAGE("begin_frame() [1] vkDeviceWaitIdle failed...");
@@ -97,7 +140,7 @@ public:
         // Did the window resize?
         if (surface->is_resized())
         {
-            VkResult result{ vkDeviceWaitIdle(core::logical_device()) };
+            VkResult result{ core::device_wait_idle() };
             if (!vulkan_success(result))
             {
                 MESSAGE("begin_frame() [2] vkDeviceWaitIdle failed...");
@@ -120,6 +163,10 @@ public:
             return false;
         }
 
+        // The frame that signaled this fence is done, and so is everything submitted before it.
+        if (_frame_serials[frame] > _completed_serial) _completed_serial = _frame_serials[frame];
+        process_deferred_releases(_completed_serial);
+
         // Get next swapchain image
         if (!surface->next_image_index(_image_available[frame], nullptr, std::numeric_limits<u64>::max()))
             return false;
@@ -146,11 +193,16 @@ public:
         vkCmdSetViewport(cmd_buffer.cmd_buffer, 0, 1, &viewport);
         vkCmdSetScissor(cmd_buffer.cmd_buffer, 0, 1, &scissor);
 
+        return true;
+    }
+
+    // Passes that can't run in a render pass, like the culling compute pass, are recorded between begin_frame() and this.
+    void begin_renderpass(vulkan_surface* surface)
+    {
+        vulkan_cmd_buffer& cmd_buffer{ _cmd_buffers[surface->current_frame()] };
         surface->set_renderpass_render_area({ 0, 0, surface->width(), surface->height() });
         surface->set_renderpass_clear_color({ 0.0f, 0.0f, 0.0f, 0.0f });
         renderpass::begin_renderpass(cmd_buffer.cmd_buffer, cmd_buffer.cmd_state, surface->renderpass(), surface->current_framebuffer());
-
-        return true;
     }
 
     bool end_frame(vulkan_surface* surface)
@@ -182,8 +234,9 @@ public:
         info.pWaitDstStageMask = flags;
 
         VkResult result{ VK_SUCCESS };
-        VkCall(result = vkQueueSubmit(_graphics_queue, 1, &info, _draw_fences[frame].fence), "Failed to submit queue...");
+        VkCall(result = core::queue_submit(_graphics_queue, 1, &info, _draw_fences[frame].fence), "Failed to submit queue...");
         if (result != VK_SUCCESS) return false;
+        _frame_serials[frame] = ++_submitted_serial;
 
         update_cmd_buffer_submitted(cmd_buffer);
 
@@ -194,7 +247,7 @@ public:
 
     void release()
     {
-        vkDeviceWaitIdle(core::logical_device());
+        core::device_wait_idle();
 
         for (u32 i{ 0 }; i < (_swapchain_image_count); ++i)
         {
@@ -211,6 +264,10 @@ public:
     }
 
     [[nodiscard]] constexpr VkCommandPool const command_pool() const { return _cmd_pool; }
+    [[nodiscard]] constexpr VkQueue const graphics_queue() const { return _graphics_queue; }
+    [[nodiscard]] vulkan_cmd_buffer& cmd_buffer(const vulkan_surface* surface) { return _cmd_buffers[surface->current_frame()]; }
+    [[nodiscard]] u64 submitted_serial() const { return _submitted_serial; }
+    [[nodiscard]] u64 completed_serial() const { return _completed_serial; }
 
 private:
     void create_command_buffers(VkDevice device, [[maybe_unused]] u32 queue_family_idx)
@@ -299,6 +356,9 @@ private:
     VkQueue							_presentation_queue{ nullptr };
     utl::vector<vulkan_cmd_buffer>	_cmd_buffers;
     utl::vector<vulkan_fence>		_draw_fences;
+    utl::vector<u64>				_frame_serials;			// the frame each draw fence signals for
+    std::atomic<u64>				_submitted_serial{ 0 };
+    std::atomic<u64>				_completed_serial{ 0 };
     vulkan_fence**					_fences_in_flight;
     utl::vector<VkSemaphore>		_image_available;
     utl::vector<VkSemaphore>		_render_finished;
@@ -324,11 +384,14 @@ struct device_group
 using surface_collection = utl::free_list<vulkan_surface>;
 
 const utl::vector<const char*>	device_extensions{ 1, VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+bool							has_memory_budget_ext{ false };
+device_capabilities				device_caps{};
 VkInstance						instance{ nullptr };
 VkFormat						device_depth_format{ VK_FORMAT_UNDEFINED };
 vulkan_command					gfx_command;
 VkDebugUtilsMessengerEXT		debug_messenger{ 0 };
 surface_collection				surfaces;
+std::mutex						queue_mutex{};
 
 bool
 check_instance_ext_support(utl::vector<const char*>* check_ext)
@@ -441,6 +504,22 @@ check_device_extension_support(VkPhysicalDevice device)
     return true;
 }
 
+bool
+is_device_extension_available(VkPhysicalDevice device, const char* const name)
+{
+    u32 extension_count{ 0 };
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+    utl::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, extensions.data());
+
+    for (const auto& extension : extensions)
+    {
+        if (strcmp(name, extension.extensionName) == 0) return true;
+    }
+
+    return false;
+}
+
 bool
 check_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
@@ -528,11 +607,42 @@ create_logical_device()
     VkDeviceCreateInfo info{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
     info.queueCreateInfoCount = (u32)infos.size();		// number of queue create infos
     info.pQueueCreateInfos = infos.data();				// List of queue create infos so device can create required queues
-    info.enabledExtensionCount = (u32)device_extensions.size();	// NUmber of enabled logical device extensions
-    info.ppEnabledExtensionNames = device_extensions.data();		// List of enabled logical device extensions
+    // Optional extensions are enabled when the device has them
+    utl::vector<const char*> extensions{ device_extensions };
+    has_memory_budget_ext = is_device_extension_available(device_group.physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (has_memory_budget_ext) extensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    info.enabledExtensionCount = (u32)extensions.size();	// NUmber of enabled logical device extensions
+    info.ppEnabledExtensionNames = extensions.data();		// List of enabled logical device extensions
 
     // Physical device features the logical device will be using
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device_group.physical_device, &properties);
+    const bool is_vulkan_1_2{ properties.apiVersion >= VK_API_VERSION_1_2 };
+
+    VkPhysicalDeviceVulkan12Features supported_features_12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 supported_features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    if (is_vulkan_1_2)
+    {
+        supported_features.pNext = &supported_features_12;
+        vkGetPhysicalDeviceFeatures2(device_group.physical_device, &supported_features);
+    }
+    else
+    {
+        vkGetPhysicalDeviceFeatures(device_group.physical_device, &supported_features.features);
+    }
+
+    // Used by GPU driven rendering, which falls back to fixed draw counts without draw indirect count.
     VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = supported_features.features.multiDrawIndirect;
+    device_features.drawIndirectFirstInstance = supported_features.features.drawIndirectFirstInstance;
+    VkPhysicalDeviceVulkan12Features device_features_12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    device_features_12.drawIndirectCount = supported_features_12.drawIndirectCount;
+    if (is_vulkan_1_2) info.pNext = &device_features_12;
+
+    device_caps.draw_indirect_count = device_features_12.drawIndirectCount;
+    device_caps.multi_draw_indirect = device_features.multiDrawIndirect;
+    device_caps.draw_indirect_first_instance = device_features.drawIndirectFirstInstance;
 
     info.pEnabledFeatures = &device_features;					// Physical device features logical device will use
 
@@ -652,7 +762,13 @@ initialize()
 void
 shutdown()
 {
+    depth_prepass::shutdown();
+    gpu_culling::shutdown();
+    shaders::shutdown();
+    texture_streaming::shutdown();
+    content::shutdown();
     gfx_command.release();
+    process_deferred_releases(std::numeric_limits<u64>::max());
     vkDestroyDevice(device_group.logical_device, nullptr);
 
     if (enable_validation_layers)
@@ -729,6 +845,42 @@ find_memory_index(u32 type, u32 flags)
     return -1;
 }
 
+memory_budget
+device_local_memory_budget()
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+    VkPhysicalDeviceMemoryProperties2 properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+    if (has_memory_budget_ext) properties.pNext = &budget_properties;
+    vkGetPhysicalDeviceMemoryProperties2(device_group.physical_device, &properties);
+
+    memory_budget budget{};
+    budget.is_reported_by_driver = has_memory_budget_ext;
+    const VkPhysicalDeviceMemoryProperties& memory{ properties.memoryProperties };
+    for (u32 i{ 0 }; i < memory.memoryHeapCount; ++i)
+    {
+        if (!(memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+
+        budget.heap_size += memory.memoryHeaps[i].size;
+        if (has_memory_budget_ext)
+        {
+            budget.budget += budget_properties.heapBudget[i];
+            budget.usage += budget_properties.heapUsage[i];
+        }
+    }
+
+    // NOTE: without the extension there's no way to know what the OS and other processes use, so
+    //       assume a conservative share of the heaps and leave usage for the caller to track.
+    if (!has_memory_budget_ext) budget.budget = budget.heap_size / 10 * 8;
+
+    return budget;
+}
+
+const device_capabilities&
+capabilities()
+{
+    return device_caps;
+}
+
 u32
 graphics_family_queue_index()
 {
@@ -765,6 +917,71 @@ depth_format()
     return device_depth_format;
 }
 
+VkQueue
+graphics_queue()
+{
+    return gfx_command.graphics_queue();
+}
+
+VkResult
+queue_submit(VkQueue queue, u32 submit_count, const VkSubmitInfo* const infos, VkFence fence)
+{
+    std::lock_guard lock{ queue_mutex };
+    return vkQueueSubmit(queue, submit_count, infos, fence);
+}
+
+VkResult
+queue_present(VkQueue queue, const VkPresentInfoKHR& info)
+{
+    std::lock_guard lock{ queue_mutex };
+    return vkQueuePresentKHR(queue, &info);
+}
+
+VkResult
+queue_wait_idle(VkQueue queue)
+{
+    std::lock_guard lock{ queue_mutex };
+    return vkQueueWaitIdle(queue);
+}
+
+VkResult
+device_wait_idle()
+{
+    std::lock_guard lock{ queue_mutex };
+    return vkDeviceWaitIdle(device_group.logical_device);
+}
+
+u64
+current_frame_serial()
+{
+    // NOTE: a frame may be recording while other threads release resources, so count it as well.
+    return gfx_command.submitted_serial() + 1;
+}
+
+u64
+completed_frame_serial()
+{
+    return gfx_command.completed_serial();
+}
+
+void
+deferred_release(vulkan_buffer& buffer)
+{
+    if (!buffer.buffer && !buffer.memory) return;
+    std::lock_guard lock{ deferred_releases_mutex };
+    deferred_buffers.emplace_back(deferred_buffer{ buffer, current_frame_serial() });
+    buffer = {};
+}
+
+void
+deferred_release(vulkan_image& image)
+{
+    if (!image.image && !image.memory && !image.view) return;
+    std::lock_guard lock{ deferred_releases_mutex };
+    deferred_images.emplace_back(deferred_image{ image, current_frame_serial() });
+    image = {};
+}
+
 surface
 create_surface(platform::window window)
 {
@@ -798,15 +1015,27 @@ surface_height(surface_id id)
 }
 
 void
-render_surface(surface_id id, [[maybe_unused]] frame_info info)
+render_surface(surface_id id, frame_info info)
 {
-    if (gfx_command.begin_frame(&surfaces[id]))
+    // Copies recorded by content loading and texture streaming have to land before anything reads the new resources.
+    texture_streaming::update();
+    content::flush_uploads();
+
+    vulkan_surface& surface{ surfaces[id] };
+    if (gfx_command.begin_frame(&surface))
     {
-        //
-        // ....
-        //
+        vulkan_cmd_buffer& cmd_buffer{ gfx_command.cmd_buffer(&surface) };
+        gpass::cull(cmd_buffer, info, surface.current_frame(), surface.height());
+
+        gfx_command.begin_renderpass(&surface);
+        gpass::render_depth_prepass(cmd_buffer, surface.renderpass().render_pass);
+        vkCmdNextSubpass(cmd_buffer.cmd_buffer, VK_SUBPASS_CONTENTS_INLINE);
+
+        // NOTE: the main subpass draws nothing yet. The backend has no material pipelines, so the culled
+        //		 buckets only feed the depth prepass. Once there are, each bucket binds its pipeline here and
+        //		 draws with gpu_culling::draw(), like the prepass does.
 
-        gfx_command.end_frame(&surfaces[id]);
+        gfx_command.end_frame(&surface);
     }
 }
 
@@ -5,6 +5,22 @@
 #include "VulkanCommonHeaders.h"
 
 namespace primal::graphics::vulkan::core {
+
+struct memory_budget
+{
+    u64		heap_size;				// total size of the device local heaps
+    u64		budget;					// how much of them this process can use before it starts paging
+    u64		usage;					// how much of them this process uses. Only set if is_reported_by_driver.
+    bool	is_reported_by_driver;	// true if VK_EXT_memory_budget is supported
+};
+
+// Optional device features that are enabled when the device supports them.
+struct device_capabilities
+{
+    bool	draw_indirect_count;			// vkCmdDrawIndexedIndirectCount (Vulkan 1.2)
+    bool	multi_draw_indirect;			// indirect calls with more than one draw
+    bool	draw_indirect_first_instance;	// indirect draws with a first instance other than 0
+};
 	
 bool initialize();
 void shutdown();
@@ -13,10 +29,26 @@ bool create_device(VkSurfaceKHR surface);
 bool create_graphics_command(u32 swapchain_framebuffer_size);
 bool detect_depth_format(VkPhysicalDevice physical_device);
 s32 find_memory_index(u32 type, u32 flags);
+memory_budget device_local_memory_budget();
+const device_capabilities& capabilities();
 
 u32 graphics_family_queue_index();
 u32 presentation_family_queue_index();
 VkFormat depth_format();
+VkQueue graphics_queue();
+// NOTE: queues must be externally synchronized and loader threads submit uploads while the render thread
+//       submits frames, so all queue work goes through these. They share one lock, since the graphics and
+//       presentation queues may be the same queue.
+VkResult queue_submit(VkQueue queue, u32 submit_count, const VkSubmitInfo* const infos, VkFence fence);
+VkResult queue_present(VkQueue queue, const VkPresentInfoKHR& info);
+VkResult queue_wait_idle(VkQueue queue);
+VkResult device_wait_idle();
+// Frames are numbered in submission order. A resource that's released now may still be used by every frame
+// up to current_frame_serial(), and can be destroyed once completed_frame_serial() reaches that number.
+u64 current_frame_serial();
+u64 completed_frame_serial();
+void deferred_release(vulkan_buffer& buffer);
+void deferred_release(vulkan_image& image);
 VkPhysicalDevice physical_device();
 VkDevice logical_device();
 VkInstance get_instance();
@@ -0,0 +1,297 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanDepthPrepass.h"
+#include "VulkanCore.h"
+#include "VulkanContent.h"
+#include "VulkanGpuCulling.h"
+#include "VulkanResources.h"
+#include "VulkanShaders.h"
+
+namespace primal::graphics::vulkan::depth_prepass {
+namespace {
+
+constexpr u32 max_frame_count{ 8 };
+
+// Pipelines are only compatible with the render passes they're created for, so there's one per render pass.
+struct render_pass_pipeline
+{
+    VkRenderPass	render_pass;
+    VkPipeline		pipeline;
+};
+
+// The CPU writes the matrices of a frame while the GPU may still draw the previous frames,
+// so every frame in flight has its own upload buffer and descriptor set.
+struct frame_resources
+{
+    vulkan_buffer		upload;
+    VkDescriptorSet		descriptor_set;
+    u32					item_capacity;
+};
+
+VkDescriptorSetLayout					descriptor_set_layout{ nullptr };
+VkDescriptorPool						descriptor_pool{ nullptr };
+VkPipelineLayout						pipeline_layout{ nullptr };
+utl::vector<render_pass_pipeline>		pipelines;
+frame_resources							frames[max_frame_count]{};
+bool									is_initialized{ false };
+
+bool
+create_layouts()
+{
+    VkDevice device{ core::logical_device() };
+    VkResult result{ VK_SUCCESS };
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorCount = 1;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layout_info.bindingCount = 1;
+    layout_info.pBindings = &binding;
+    VkCall(result = vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout), "Failed to create depth prepass descriptor set layout...");
+    if (result != VK_SUCCESS) return false;
+
+    const VkDescriptorPoolSize pool_size{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, max_frame_count };
+    VkDescriptorPoolCreateInfo pool_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    pool_info.maxSets = max_frame_count;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    VkCall(result = vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool), "Failed to create depth prepass descriptor pool...");
+    if (result != VK_SUCCESS) return false;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+    VkCall(result = vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout), "Failed to create depth prepass pipeline layout...");
+    return result == VK_SUCCESS;
+}
+
+void
+release_layouts()
+{
+    VkDevice device{ core::logical_device() };
+    for (const render_pass_pipeline& p : pipelines) vkDestroyPipeline(device, p.pipeline, nullptr);
+    pipelines.clear();
+    if (pipeline_layout) vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+    // NOTE: destroying the pool frees the descriptor sets allocated from it.
+    if (descriptor_pool) vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    if (descriptor_set_layout) vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+    pipeline_layout = nullptr;
+    descriptor_pool = nullptr;
+    descriptor_set_layout = nullptr;
+}
+
+VkPipeline
+create_pipeline(VkRenderPass render_pass)
+{
+    VkShaderModule shader{ shaders::get_engine_shader(shaders::engine_shader::depth_only_vs) };
+    assert(shader);
+
+    VkPipelineShaderStageCreateInfo stage{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+    stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage.module = shader;
+    stage.pName = "main";
+
+    // NOTE: stream 0 of the vertex pools holds the positions, tightly packed.
+    const VkVertexInputBindingDescription vertex_binding{ 0, sizeof(math::v3), VK_VERTEX_INPUT_RATE_VERTEX };
+    const VkVertexInputAttributeDescription position_attribute{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 };
+    VkPipelineVertexInputStateCreateInfo vertex_input{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    vertex_input.vertexBindingDescriptionCount = 1;
+    vertex_input.pVertexBindingDescriptions = &vertex_binding;
+    vertex_input.vertexAttributeDescriptionCount = 1;
+    vertex_input.pVertexAttributeDescriptions = &position_attribute;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{ VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewport{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+    viewport.viewportCount = 1;
+    viewport.scissorCount = 1;
+
+    // NOTE: the Vulkan backend doesn't settle on a winding order yet (its viewports aren't flipped like the
+    //		 projection expects), so nothing is culled. Back faces of closed meshes lose the depth test anyway.
+    VkPipelineRasterizationStateCreateInfo rasterization{ VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterization.lineWidth = 1.f;
+
+    VkPipelineMultisampleStateCreateInfo multisample{ VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // NOTE: we use reversed depth everywhere, so nearer is greater.
+    VkPipelineDepthStencilStateCreateInfo depth_stencil{ VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    depth_stencil.depthTestEnable = VK_TRUE;
+    depth_stencil.depthWriteEnable = VK_TRUE;
+    depth_stencil.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    VkPipelineColorBlendStateCreateInfo color_blend{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+
+    const VkDynamicState dynamic_states[]{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamic_state{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    dynamic_state.dynamicStateCount = _countof(dynamic_states);
+    dynamic_state.pDynamicStates = &dynamic_states[0];
+
+    // NOTE: no fragment shader. Depth is all the prepass writes.
+    VkGraphicsPipelineCreateInfo pipeline_info{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    pipeline_info.stageCount = 1;
+    pipeline_info.pStages = &stage;
+    pipeline_info.pVertexInputState = &vertex_input;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport;
+    pipeline_info.pRasterizationState = &rasterization;
+    pipeline_info.pMultisampleState = &multisample;
+    pipeline_info.pDepthStencilState = &depth_stencil;
+    pipeline_info.pColorBlendState = &color_blend;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = pipeline_layout;
+    pipeline_info.renderPass = render_pass;
+    pipeline_info.subpass = 0;
+
+    VkPipeline pipeline{ nullptr };
+    VkResult result{ VK_SUCCESS };
+    VkCall(result = vkCreateGraphicsPipelines(core::logical_device(), nullptr, 1, &pipeline_info, nullptr, &pipeline), "Failed to create depth only pipeline...");
+    return result == VK_SUCCESS ? pipeline : nullptr;
+}
+
+[[nodiscard]] VkPipeline
+get_pipeline(VkRenderPass render_pass)
+{
+    for (const render_pass_pipeline& p : pipelines)
+    {
+        if (p.render_pass == render_pass) return p.pipeline;
+    }
+
+    VkPipeline pipeline{ create_pipeline(render_pass) };
+    if (pipeline) pipelines.emplace_back(render_pass_pipeline{ render_pass, pipeline });
+    return pipeline;
+}
+
+bool
+reserve_frame_resources(frame_resources& frame, u32 item_count)
+{
+    VkDevice device{ core::logical_device() };
+    if (!frame.descriptor_set)
+    {
+        VkDescriptorSetAllocateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        info.descriptorPool = descriptor_pool;
+        info.descriptorSetCount = 1;
+        info.pSetLayouts = &descriptor_set_layout;
+        VkResult result{ VK_SUCCESS };
+        VkCall(result = vkAllocateDescriptorSets(device, &info, &frame.descriptor_set), "Failed to allocate depth prepass descriptor set...");
+        if (result != VK_SUCCESS) return false;
+    }
+
+    if (frame.upload.buffer && item_count <= frame.item_capacity) return true;
+
+    // NOTE: the descriptor set can be rewritten, since the frame's previous submission is done by the time its
+    //		 index comes around again. The buffer goes through the deferred release queue like every other
+    //		 resource that's replaced while frames are in flight.
+    core::deferred_release(frame.upload);
+    frame.item_capacity = std::max(item_count + item_count / 2, 1024u);
+
+    buffer_init_info info{};
+    info.device = device;
+    info.size = (u64)frame.item_capacity * sizeof(math::m4x4);
+    info.usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    info.map_memory = true;
+    if (!create_buffer(&info, frame.upload)) return false;
+
+    const VkDescriptorBufferInfo buffer_info{ frame.upload.buffer, 0, VK_WHOLE_SIZE };
+    VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+    write.dstSet = frame.descriptor_set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &buffer_info;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    return true;
+}
+
+} // anonymous namespace
+
+bool
+initialize()
+{
+    if (is_initialized) return is_supported();
+    is_initialized = true;
+
+    shaders::initialize();
+    if (!shaders::get_engine_shader(shaders::engine_shader::depth_only_vs) || !create_layouts())
+    {
+        release_layouts();
+        return false;
+    }
+
+    MESSAGE("Depth prepass initialized");
+    return true;
+}
+
+void
+shutdown()
+{
+    if (!is_initialized) return;
+
+    VkDevice device{ core::logical_device() };
+    core::device_wait_idle();
+    for (auto& frame : frames)
+    {
+        destroy_buffer(device, &frame.upload);
+        frame = {};
+    }
+    release_layouts();
+    is_initialized = false;
+}
+
+bool
+is_supported()
+{
+    return pipeline_layout != nullptr;
+}
+
+void
+render(vulkan_cmd_buffer& cmd_buffer, VkRenderPass render_pass, const prepass_info& info)
+{
+    assert(is_supported() && cmd_buffer.cmd_state == vulkan_cmd_buffer::CMD_IN_RENDER_PASS);
+    assert(info.frame_index < max_frame_count && (info.world_view_projections || !info.item_count));
+    if (!info.item_count) return;
+
+    frame_resources& frame{ frames[info.frame_index] };
+    VkPipeline pipeline{ get_pipeline(render_pass) };
+    if (!pipeline || !reserve_frame_resources(frame, info.item_count)) return;
+
+    memcpy(frame.upload.cpu_address, info.world_view_projections, info.item_count * sizeof(math::m4x4));
+
+    VkCommandBuffer cmd{ cmd_buffer.cmd_buffer };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &frame.descriptor_set, 0, nullptr);
+
+    // NOTE: all buckets share the pipeline. Only the vertex pool and the index type can differ between them.
+    u32 bound_vertex_pool{ u32_invalid_id };
+    VkIndexType bound_index_type{ VK_INDEX_TYPE_MAX_ENUM };
+    const VkBuffer index_buffer{ content::submesh::index_buffer() };
+    for (u32 bucket{ 0 }; bucket < info.bucket_count; ++bucket)
+    {
+        if (bound_vertex_pool != info.bucket_vertex_pools[bucket])
+        {
+            bound_vertex_pool = info.bucket_vertex_pools[bucket];
+            const VkBuffer positions{ content::submesh::vertex_buffer(bound_vertex_pool, 0) };
+            const VkDeviceSize offset{ 0 };
+            vkCmdBindVertexBuffers(cmd, 0, 1, &positions, &offset);
+        }
+
+        if (bound_index_type != info.bucket_index_types[bucket])
+        {
+            bound_index_type = info.bucket_index_types[bucket];
+            vkCmdBindIndexBuffer(cmd, index_buffer, 0, bound_index_type);
+        }
+
+        gpu_culling::draw(cmd_buffer, bucket);
+    }
+}
+
+}
@@ -0,0 +1,30 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+// Depth prepass with depth only pipelines. They fetch nothing but the position stream and have no fragment
+// shader, so they don't depend on materials: the whole prepass binds one pipeline and only switches vertex
+// and index buffers between the buckets of the culling pass.
+namespace primal::graphics::vulkan::depth_prepass {
+
+struct prepass_info
+{
+    const math::m4x4*		world_view_projections;	// one per item, in the order of gpu_culling::cull_info::items
+    const u32*				bucket_vertex_pools;	// vertex pool of the items in each bucket
+    const VkIndexType*		bucket_index_types;		// index type of the items in each bucket
+    u32						item_count;
+    u32						bucket_count;
+    u32						frame_index;			// frame in flight whose upload buffer can be overwritten
+};
+
+bool initialize();
+void shutdown();
+// False if the depth only shader couldn't be loaded.
+[[nodiscard]] bool is_supported();
+
+// Records the depth only draws of the items the last gpu_culling::cull() kept. Must be recorded in render_pass,
+// whose subpass has a depth attachment and no color attachments, after the viewport and scissor are set.
+void render(vulkan_cmd_buffer& cmd_buffer, VkRenderPass render_pass, const prepass_info& info);
+
+}
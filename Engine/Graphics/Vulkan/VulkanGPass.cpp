@@ -0,0 +1,214 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanGPass.h"
+#include "VulkanContent.h"
+#include "VulkanCamera.h"
+#include "VulkanGpuCulling.h"
+#include "VulkanDepthPrepass.h"
+#include "VulkanTextureStreaming.h"
+#include "Components/Entity.h"
+#include "Components/Transform.h"
+
+namespace primal::graphics::vulkan::gpass {
+namespace {
+
+// NOTE: items can share an indirect draw if they have the same vertex pool and index type, so each
+//		 combination of the two is a bucket: two buckets per vertex pool, 16 bit indices first.
+constexpr u32 index_type_count{ 2 };
+
+struct gpass_cache
+{
+    utl::vector<content::render_item::frame_item>	frame_items;
+    utl::vector<gpu_culling::cull_item>			cull_items;			// grouped by bucket
+    utl::vector<math::m4x4>						world_view_projections;	// one per cull item
+    utl::vector<u32>							bucket_item_counts;
+    utl::vector<u32>							bucket_offsets;		// next free slot of each bucket while sorting
+    utl::vector<u32>							bucket_vertex_pools;
+    utl::vector<VkIndexType>					bucket_index_types;
+    utl::vector<f32>							material_screen_sizes;	// largest screen size of each material's items
+    utl::vector<id::id_type>					texture_ids;
+    u32											frame_index;
+};
+
+// NOTE: an item the camera is inside of can cover the whole view at any texel density, so its textures
+//		 are requested at full detail instead of by screen size.
+constexpr f32 camera_inside_item{ std::numeric_limits<f32>::max() };
+
+gpass_cache	frame_cache;
+
+constexpr u32
+get_bucket(const content::submesh::draw_info& draw)
+{
+    return draw.vertex_pool * index_type_count + (draw.index_type == VK_INDEX_TYPE_UINT32 ? 1 : 0);
+}
+
+// Size in pixels of the item's bounding sphere on screen.
+f32
+get_screen_size(const camera::vulkan_camera& camera, DirectX::FXMVECTOR center, f32 radius, u32 viewport_height)
+{
+    using namespace DirectX;
+    if (camera.projection_type() == graphics::camera::orthographic)
+    {
+        return 2.f * radius / camera.view_height() * (f32)viewport_height;
+    }
+
+    const f32 distance{ XMVectorGetX(XMVector3Length(XMVectorSubtract(center, camera.position()))) };
+    if (distance <= radius) return camera_inside_item;
+    return texture_streaming::screen_size(2.f * radius, distance, camera.field_of_view() * XM_PI, viewport_height);
+}
+
+// Counting sort of the frame items by bucket, with their world space bounds and world view projection matrices.
+// Also finds how large the items of each material appear on screen.
+void
+fill_cull_items(const camera::vulkan_camera& camera, u32 viewport_height)
+{
+    gpass_cache& cache{ frame_cache };
+    const u32 item_count{ (u32)cache.frame_items.size() };
+
+    u32 bucket_count{ 0 };
+    for (const auto& item : cache.frame_items) bucket_count = std::max(bucket_count, get_bucket(item.draw) + 1);
+
+    cache.bucket_item_counts.resize(bucket_count);
+    cache.bucket_offsets.resize(bucket_count);
+    cache.bucket_vertex_pools.resize(bucket_count);
+    cache.bucket_index_types.resize(bucket_count);
+    for (u32 i{ 0 }; i < bucket_count; ++i)
+    {
+        cache.bucket_item_counts[i] = 0;
+        cache.bucket_vertex_pools[i] = i / index_type_count;
+        cache.bucket_index_types[i] = (i % index_type_count) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    }
+    for (const auto& item : cache.frame_items) ++cache.bucket_item_counts[get_bucket(item.draw)];
+
+    u32 offset{ 0 };
+    for (u32 i{ 0 }; i < bucket_count; ++i)
+    {
+        cache.bucket_offsets[i] = offset;
+        offset += cache.bucket_item_counts[i];
+    }
+
+    cache.cull_items.resize(item_count);
+    cache.world_view_projections.resize(item_count);
+
+    u32 material_count{ 0 };
+    for (const auto& item : cache.frame_items) material_count = std::max(material_count, item.material_id + 1);
+    cache.material_screen_sizes.resize(material_count);
+    for (u32 i{ 0 }; i < material_count; ++i) cache.material_screen_sizes[i] = 0.f;
+
+    using namespace DirectX;
+    const XMMATRIX view_projection{ camera.view_projection() };
+    id::id_type current_entity_id{ id::invalid_id };
+    XMMATRIX world{};
+    f32 max_scale{ 0.f };
+
+    for (const auto& item : cache.frame_items)
+    {
+        // NOTE: the submeshes of an entity are next to each other, so its transform is only read once.
+        if (item.entity_id != current_entity_id)
+        {
+            current_entity_id = item.entity_id;
+            math::m4x4 world_matrix, inv_world_matrix;
+            transform::get_transform_matrices(game_entity::entity_id{ current_entity_id }, world_matrix, inv_world_matrix);
+            world = XMLoadFloat4x4(&world_matrix);
+
+            // The bounding sphere has to contain the scaled submesh, so it grows with the largest axis scale.
+            const XMVECTOR scale_sq{ XMVectorMax(XMVector3LengthSq(world.r[0]), XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2]))) };
+            max_scale = XMVectorGetX(XMVectorSqrt(scale_sq));
+        }
+
+        const u32 bucket{ get_bucket(item.draw) };
+        const u32 index{ cache.bucket_offsets[bucket]++ };
+        XMStoreFloat4x4(&cache.world_view_projections[index], XMMatrixMultiply(world, view_projection));
+
+        gpu_culling::cull_item& cull_item{ cache.cull_items[index] };
+        const XMVECTOR center{ XMVector3TransformCoord(XMLoadFloat4(&item.draw.sphere), world) };
+        const f32 radius{ item.draw.sphere.w * max_scale };
+        XMStoreFloat4(&cull_item.sphere, XMVectorSetW(center, radius));
+        cull_item.index_count = item.draw.index_count;
+        cull_item.first_index = item.draw.first_index;
+        cull_item.vertex_offset = item.draw.vertex_offset;
+        cull_item.bucket = bucket;
+
+        f32& material_screen_size{ cache.material_screen_sizes[item.material_id] };
+        material_screen_size = std::max(material_screen_size, get_screen_size(camera, center, radius, viewport_height));
+    }
+}
+
+// The texture streaming requests of the frame. They're made for all gathered items, culled or not, because
+// the culling results stay on the GPU. Items just outside the view keep their textures that way too.
+void
+request_textures()
+{
+    gpass_cache& cache{ frame_cache };
+    for (u32 material_id{ 0 }; material_id < cache.material_screen_sizes.size(); ++material_id)
+    {
+        const f32 screen_size{ cache.material_screen_sizes[material_id] };
+        if (screen_size <= 0.f) continue;
+
+        content::material::get_texture_ids(material_id, cache.texture_ids);
+        for (id::id_type texture_id : cache.texture_ids)
+        {
+            if (screen_size == camera_inside_item) texture_streaming::request_mip(texture_id, 0);
+            else texture_streaming::request(texture_id, screen_size);
+        }
+    }
+}
+
+} // anonymous namespace
+
+void
+cull(vulkan_cmd_buffer& cmd_buffer, const frame_info& info, u32 frame_index, u32 viewport_height)
+{
+    gpass_cache& cache{ frame_cache };
+    cache.frame_items.clear();
+    cache.cull_items.clear();
+    cache.bucket_item_counts.clear();
+
+    if (!info.render_item_count) return;
+
+    content::render_item::get_frame_items(info, cache.frame_items);
+    if (cache.frame_items.empty()) return;
+
+    camera::vulkan_camera& camera{ camera::get(info.camera_id) };
+    camera.update();
+    fill_cull_items(camera, viewport_height);
+    request_textures();
+
+    // NOTE: without GPU culling nothing draws the items yet. An empty list of cull items skips the prepass.
+    if (!gpu_culling::initialize())
+    {
+        cache.cull_items.clear();
+        return;
+    }
+
+    gpu_culling::cull_info cull_info{};
+    cull_info.items = cache.cull_items.data();
+    cull_info.bucket_item_counts = cache.bucket_item_counts.data();
+    cull_info.item_count = (u32)cache.cull_items.size();
+    cull_info.bucket_count = (u32)cache.bucket_item_counts.size();
+    DirectX::XMStoreFloat4x4(&cull_info.view_projection, camera.view_projection());
+    // NOTE: nothing builds a depth pyramid from the prepass yet, so occlusion culling is off and only the
+    //		 camera frustum culls.
+    cull_info.hiz = {};
+    cull_info.frame_index = frame_index;
+    gpu_culling::cull(cmd_buffer, cull_info);
+    cache.frame_index = frame_index;
+}
+
+void
+render_depth_prepass(vulkan_cmd_buffer& cmd_buffer, VkRenderPass render_pass)
+{
+    const gpass_cache& cache{ frame_cache };
+    if (cache.cull_items.empty() || !depth_prepass::initialize()) return;
+
+    depth_prepass::prepass_info info{};
+    info.world_view_projections = cache.world_view_projections.data();
+    info.bucket_vertex_pools = cache.bucket_vertex_pools.data();
+    info.bucket_index_types = cache.bucket_index_types.data();
+    info.item_count = (u32)cache.cull_items.size();
+    info.bucket_count = (u32)cache.bucket_item_counts.size();
+    info.frame_index = cache.frame_index;
+    depth_prepass::render(cmd_buffer, render_pass, info);
+}
+
+}
\ No newline at end of file
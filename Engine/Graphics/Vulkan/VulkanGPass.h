@@ -0,0 +1,20 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+// Geometry pass of the frame. The render items are gathered and grouped into the buckets of the GPU culling
+// pass, which keeps the items that are in the camera's view and writes their draws.
+// NOTE: the depth prepass is the only consumer of the culled draws so far, and only the camera frustum
+//		 culls: there's no depth pyramid to enable occlusion culling with.
+namespace primal::graphics::vulkan::gpass {
+
+// Gathers the items of the frame, records their culling pass and requests the mips of their textures that
+// the next texture streaming update brings in. Must be recorded outside of a render pass, after the frame
+// in flight at frame_index is done with its upload buffers.
+void cull(vulkan_cmd_buffer& cmd_buffer, const frame_info& info, u32 frame_index, u32 viewport_height);
+// Records the depth only draws of the items the last cull() kept. Must be recorded in the depth prepass
+// subpass of render_pass, which is the first one.
+void render_depth_prepass(vulkan_cmd_buffer& cmd_buffer, VkRenderPass render_pass);
+
+}
\ No newline at end of file
@@ -0,0 +1,468 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanGpuCulling.h"
+#include "VulkanCore.h"
+#include "VulkanResources.h"
+#include "VulkanShaders.h"
+
+namespace primal::graphics::vulkan::gpu_culling {
+namespace {
+
+// Must match the flags and local size in Shaders/CullItems.comp.
+constexpr u32 cull_flags_hiz{ 0x01 };
+constexpr u32 cull_flags_compact{ 0x02 };
+constexpr u32 thread_group_size{ 64 };
+
+constexpr u32 max_frame_count{ 8 };
+// NOTE: no device requires more than 256 bytes of alignment for uniform or storage buffer offsets.
+constexpr u32 buffer_offset_alignment{ 256 };
+
+// Matches CullingConstants in Shaders/CullItems.comp (std140).
+struct culling_constants
+{
+    math::m4x4	view_projection;
+    math::v4	frustum_planes[6];
+    math::v2	hiz_size;
+    f32			hiz_mip_count;
+    u32			item_count;
+    u32			flags;
+};
+static_assert(sizeof(culling_constants) <= buffer_offset_alignment);
+
+namespace binding {
+enum : u32 {
+    constants = 0,
+    items,
+    buckets,
+    commands,
+    counts,
+    hiz,
+
+    count
+};
+} // namespace binding
+
+struct bucket_range
+{
+    u32		first_command;
+    u32		item_count;
+};
+
+// The CPU writes the constants and items of a frame while the GPU may still cull the previous frames,
+// so every frame in flight has its own upload buffer and descriptor set.
+struct frame_resources
+{
+    vulkan_buffer		upload;		// constants, then items, then the first command of each bucket
+    VkDescriptorSet		descriptor_set;
+    u32					item_capacity;
+    u32					bucket_capacity;
+};
+
+VkDescriptorSetLayout		descriptor_set_layout{ nullptr };
+VkDescriptorPool			descriptor_pool{ nullptr };
+VkPipelineLayout			pipeline_layout{ nullptr };
+VkPipeline					pipeline{ nullptr };
+VkSampler					hiz_sampler{ nullptr };
+vulkan_image				dummy_hiz{};		// bound when occlusion culling is off, since the binding has to be valid
+bool						is_dummy_hiz_cleared{ false };
+frame_resources				frames[max_frame_count]{};
+// Written by the compute pass and read by the indirect draws. The GPU finishes the draws of a frame
+// before it culls the next one, so all frames share these.
+vulkan_buffer				commands{};
+vulkan_buffer				counts{};
+utl::vector<bucket_range>	buckets;			// of the last cull()
+bool						use_draw_count{ false };
+bool						is_initialized{ false };
+
+[[nodiscard]] constexpr u32
+items_offset()
+{
+    return buffer_offset_alignment;
+}
+
+[[nodiscard]] u32
+buckets_offset(u32 item_capacity)
+{
+    return (u32)math::align_size_up<buffer_offset_alignment>(items_offset() + item_capacity * sizeof(cull_item));
+}
+
+bool
+create_pipeline()
+{
+    VkDevice device{ core::logical_device() };
+    VkResult result{ VK_SUCCESS };
+
+    VkShaderModule shader{ shaders::get_engine_shader(shaders::engine_shader::cull_items_cs) };
+    if (!shader) return false;
+
+    VkDescriptorSetLayoutBinding bindings[binding::count]{};
+    for (u32 i{ 0 }; i < binding::count; ++i)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[binding::constants].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[binding::hiz].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layout_info.bindingCount = binding::count;
+    layout_info.pBindings = &bindings[0];
+    VkCall(result = vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &descriptor_set_layout), "Failed to create culling descriptor set layout...");
+    if (result != VK_SUCCESS) return false;
+
+    VkDescriptorPoolSize pool_sizes[]{
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, max_frame_count },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, max_frame_count * 4 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, max_frame_count },
+    };
+
+    VkDescriptorPoolCreateInfo pool_info{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    pool_info.maxSets = max_frame_count;
+    pool_info.poolSizeCount = _countof(pool_sizes);
+    pool_info.pPoolSizes = &pool_sizes[0];
+    VkCall(result = vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool), "Failed to create culling descriptor pool...");
+    if (result != VK_SUCCESS) return false;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
+    VkCall(result = vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout), "Failed to create culling pipeline layout...");
+    if (result != VK_SUCCESS) return false;
+
+    VkComputePipelineCreateInfo pipeline_info{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = shader;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = pipeline_layout;
+    VkCall(result = vkCreateComputePipelines(device, nullptr, 1, &pipeline_info, nullptr, &pipeline), "Failed to create culling pipeline...");
+    if (result != VK_SUCCESS) return false;
+
+    // NOTE: the Hi-Z pyramid is sampled with nearest filtering, since blending the depths of
+    //		 neighbouring texels wouldn't be conservative.
+    VkSamplerCreateInfo sampler_info{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+    VkCall(result = vkCreateSampler(device, &sampler_info, nullptr, &hiz_sampler), "Failed to create Hi-Z sampler...");
+    if (result != VK_SUCCESS) return false;
+
+    image_init_info image_info{};
+    image_info.device = device;
+    image_info.image_type = VK_IMAGE_TYPE_2D;
+    image_info.width = 1;
+    image_info.height = 1;
+    image_info.format = VK_FORMAT_R32_SFLOAT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    image_info.create_view = true;
+    image_info.view_aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT;
+    is_dummy_hiz_cleared = false;
+    return create_image(&image_info, dummy_hiz);
+}
+
+void
+release_pipeline()
+{
+    VkDevice device{ core::logical_device() };
+    destroy_image(device, &dummy_hiz);
+    if (hiz_sampler) vkDestroySampler(device, hiz_sampler, nullptr);
+    if (pipeline) vkDestroyPipeline(device, pipeline, nullptr);
+    if (pipeline_layout) vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+    // NOTE: destroying the pool frees the descriptor sets allocated from it.
+    if (descriptor_pool) vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    if (descriptor_set_layout) vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+
+    hiz_sampler = nullptr;
+    pipeline = nullptr;
+    pipeline_layout = nullptr;
+    descriptor_pool = nullptr;
+    descriptor_set_layout = nullptr;
+}
+
+bool
+create_frame_resources(frame_resources& frame, u32 item_count, u32 bucket_count)
+{
+    VkDevice device{ core::logical_device() };
+    if (!frame.descriptor_set)
+    {
+        VkDescriptorSetAllocateInfo info{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        info.descriptorPool = descriptor_pool;
+        info.descriptorSetCount = 1;
+        info.pSetLayouts = &descriptor_set_layout;
+        VkResult result{ VK_SUCCESS };
+        VkCall(result = vkAllocateDescriptorSets(device, &info, &frame.descriptor_set), "Failed to allocate culling descriptor set...");
+        if (result != VK_SUCCESS) return false;
+    }
+
+    if (frame.upload.buffer && item_count <= frame.item_capacity && bucket_count <= frame.bucket_capacity) return true;
+
+    // NOTE: the frame's previous submission is done by the time its index comes around again,
+    //		 so the old buffer can go right away.
+    destroy_buffer(device, &frame.upload);
+    frame.item_capacity = std::max(item_count + item_count / 2, 1024u);
+    frame.bucket_capacity = std::max(bucket_count + bucket_count / 2, 64u);
+
+    buffer_init_info info{};
+    info.device = device;
+    info.size = buckets_offset(frame.item_capacity) + frame.bucket_capacity * sizeof(u32);
+    info.usage_flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    info.map_memory = true;
+    return create_buffer(&info, frame.upload);
+}
+
+bool
+reserve_draw_buffers(u32 item_count, u32 bucket_count)
+{
+    const u64 commands_size{ (u64)item_count * sizeof(VkDrawIndexedIndirectCommand) };
+    const u64 counts_size{ (u64)bucket_count * sizeof(u32) };
+    if (commands.buffer && commands_size <= commands.size && counts_size <= counts.size) return true;
+
+    // Frames in flight may still draw with the old buffers, so they're released once those frames are done.
+    core::deferred_release(commands);
+    core::deferred_release(counts);
+
+    buffer_init_info info{};
+    info.device = core::logical_device();
+    info.memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    info.size = std::max(commands_size + commands_size / 2, (u64)1024 * sizeof(VkDrawIndexedIndirectCommand));
+    info.usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    if (!create_buffer(&info, commands)) return false;
+
+    info.size = std::max(counts_size + counts_size / 2, (u64)64 * sizeof(u32));
+    info.usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    return create_buffer(&info, counts);
+}
+
+void
+extract_frustum_planes(const math::m4x4& view_projection, math::v4* const planes)
+{
+    using namespace DirectX;
+    // NOTE: we use row vectors, so clip space coordinates are dot products with the columns of the matrix.
+    const XMMATRIX m{ XMMatrixTranspose(XMLoadFloat4x4(&view_projection)) };
+    const XMVECTOR clip_planes[6]{
+        m.r[3] + m.r[0], m.r[3] - m.r[0],	// left, right
+        m.r[3] + m.r[1], m.r[3] - m.r[1],	// bottom, top
+        m.r[2], m.r[3] - m.r[2],			// z >= 0 (far with reversed depth), z <= w (near)
+    };
+
+    for (u32 i{ 0 }; i < 6; ++i)
+    {
+        const f32 length{ XMVectorGetX(XMVector3Length(clip_planes[i])) };
+        // An infinite far plane has no normal. Make it a plane nothing is outside of.
+        if (length < 1e-6f) planes[i] = { 0.f, 0.f, 0.f, 1.f };
+        else XMStoreFloat4(&planes[i], clip_planes[i] / length);
+    }
+}
+
+void
+clear_dummy_hiz(VkCommandBuffer cmd_buffer)
+{
+    VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dummy_hiz.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    const VkClearColorValue zero{};
+    vkCmdClearColorImage(cmd_buffer, dummy_hiz.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zero, 1, &barrier.subresourceRange);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    is_dummy_hiz_cleared = true;
+}
+
+void
+write_descriptor_set(const frame_resources& frame, VkImageView hiz_view)
+{
+    const VkDescriptorBufferInfo buffer_infos[binding::hiz]{
+        { frame.upload.buffer, 0, sizeof(culling_constants) },
+        { frame.upload.buffer, items_offset(), frame.item_capacity * sizeof(cull_item) },
+        { frame.upload.buffer, buckets_offset(frame.item_capacity), frame.bucket_capacity * sizeof(u32) },
+        { commands.buffer, 0, VK_WHOLE_SIZE },
+        { counts.buffer, 0, VK_WHOLE_SIZE },
+    };
+
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = hiz_sampler;
+    image_info.imageView = hiz_view;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet writes[binding::count]{};
+    for (u32 i{ 0 }; i < binding::count; ++i)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = frame.descriptor_set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        if (i < binding::hiz) writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    writes[binding::constants].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[binding::hiz].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[binding::hiz].pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(core::logical_device(), binding::count, &writes[0], 0, nullptr);
+}
+
+} // anonymous namespace
+
+bool
+initialize()
+{
+    if (is_initialized) return is_supported();
+    is_initialized = true;
+
+    const core::device_capabilities& caps{ core::capabilities() };
+    if (!caps.multi_draw_indirect || !caps.draw_indirect_first_instance)
+    {
+        MESSAGE("GPU culling needs multiDrawIndirect and drawIndirectFirstInstance...");
+        return false;
+    }
+
+    // NOTE: without vkCmdDrawIndexedIndirectCount, the culling pass doesn't compact the draws.
+    //		 Every item keeps its slot and culled items are drawn with no instances instead.
+    use_draw_count = caps.draw_indirect_count;
+
+    // NOTE: create_pipeline() checks for the culling shader, so other engine shaders failing to load don't matter here.
+    shaders::initialize();
+    if (!create_pipeline())
+    {
+        release_pipeline();
+        return false;
+    }
+
+    MESSAGE("GPU culling initialized");
+    return true;
+}
+
+void
+shutdown()
+{
+    if (!is_initialized) return;
+
+    VkDevice device{ core::logical_device() };
+    core::device_wait_idle();
+    for (auto& frame : frames)
+    {
+        destroy_buffer(device, &frame.upload);
+        frame = {};
+    }
+    destroy_buffer(device, &commands);
+    destroy_buffer(device, &counts);
+    release_pipeline();
+    buckets.clear();
+    is_initialized = false;
+}
+
+bool
+is_supported()
+{
+    return pipeline != nullptr;
+}
+
+void
+cull(vulkan_cmd_buffer& cmd_buffer, const cull_info& info)
+{
+    assert(is_supported() && cmd_buffer.cmd_state == vulkan_cmd_buffer::CMD_RECORDING);
+    assert(info.frame_index < max_frame_count && (info.items || !info.item_count));
+
+    buckets.resize(info.bucket_count);
+    u32 first_command{ 0 };
+    for (u32 i{ 0 }; i < info.bucket_count; ++i)
+    {
+        buckets[i] = { first_command, info.bucket_item_counts[i] };
+        first_command += info.bucket_item_counts[i];
+    }
+    assert(first_command == info.item_count);
+    if (!info.item_count) return;
+
+    frame_resources& frame{ frames[info.frame_index] };
+    if (!reserve_draw_buffers(info.item_count, info.bucket_count) ||
+        !create_frame_resources(frame, info.item_count, info.bucket_count))
+    {
+        // Nothing gets drawn this frame, rather than drawing stale arguments.
+        for (auto& bucket : buckets) bucket.item_count = 0;
+        return;
+    }
+
+    const bool use_hiz{ info.hiz.view != nullptr };
+    culling_constants* const constants{ (culling_constants*)frame.upload.cpu_address };
+    constants->view_projection = info.view_projection;
+    extract_frustum_planes(info.view_projection, &constants->frustum_planes[0]);
+    constants->hiz_size = { (f32)info.hiz.width, (f32)info.hiz.height };
+    constants->hiz_mip_count = (f32)info.hiz.mip_count;
+    constants->item_count = info.item_count;
+    constants->flags = (use_hiz ? cull_flags_hiz : 0) | (use_draw_count ? cull_flags_compact : 0);
+
+    memcpy(frame.upload.cpu_address + items_offset(), info.items, info.item_count * sizeof(cull_item));
+    u32* const bucket_first_commands{ (u32*)(frame.upload.cpu_address + buckets_offset(frame.item_capacity)) };
+    for (u32 i{ 0 }; i < info.bucket_count; ++i) bucket_first_commands[i] = buckets[i].first_command;
+
+#ifdef _DEBUG
+    for (u32 i{ 1 }; i < info.item_count; ++i) assert(info.items[i - 1].bucket <= info.items[i].bucket);
+#endif
+
+    VkCommandBuffer cmd{ cmd_buffer.cmd_buffer };
+    if (!use_hiz && !is_dummy_hiz_cleared) clear_dummy_hiz(cmd);
+    write_descriptor_set(frame, use_hiz ? info.hiz.view : dummy_hiz.view);
+
+    // The previous frame's indirect draws have to be done with the arguments before they're overwritten.
+    VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (use_draw_count)
+    {
+        vkCmdFillBuffer(cmd, counts.buffer, 0, info.bucket_count * sizeof(u32), 0);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &frame.descriptor_set, 0, nullptr);
+    vkCmdDispatch(cmd, (info.item_count + thread_group_size - 1) / thread_group_size, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void
+draw(vulkan_cmd_buffer& cmd_buffer, u32 bucket)
+{
+    assert(cmd_buffer.cmd_state == vulkan_cmd_buffer::CMD_IN_RENDER_PASS && bucket < buckets.size());
+    const bucket_range& range{ buckets[bucket] };
+    if (!range.item_count) return;
+
+    constexpr u32 stride{ sizeof(VkDrawIndexedIndirectCommand) };
+    const VkDeviceSize offset{ (VkDeviceSize)range.first_command * stride };
+    if (use_draw_count)
+    {
+        vkCmdDrawIndexedIndirectCount(cmd_buffer.cmd_buffer, commands.buffer, offset, counts.buffer, bucket * sizeof(u32), range.item_count, stride);
+    }
+    else
+    {
+        vkCmdDrawIndexedIndirect(cmd_buffer.cmd_buffer, commands.buffer, offset, range.item_count, stride);
+    }
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+// GPU driven culling and draw submission. A compute pass tests the bounds of every item against the camera
+// frustum and, optionally, a Hi-Z depth pyramid, and writes the draws of the visible items to an indirect
+// argument buffer. Each pipeline bucket is then drawn with a single indirect call, so the CPU cost of
+// submission depends on the number of buckets instead of the number of items.
+namespace primal::graphics::vulkan::gpu_culling {
+
+// Matches CullItem in Shaders/CullItems.comp.
+struct cull_item
+{
+    math::v4	sphere;				// world space center and radius
+    u32			index_count;
+    u32			first_index;
+    s32			vertex_offset;
+    u32			bucket;
+};
+
+struct hiz_info
+{
+    VkImageView		view;			// nullptr disables occlusion culling. Must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    u32				width;
+    u32				height;
+    u32				mip_count;
+};
+
+struct cull_info
+{
+    const cull_item*	items;				// grouped by bucket, in bucket order
+    const u32*			bucket_item_counts;	// number of items in each bucket
+    u32					item_count;
+    u32					bucket_count;
+    math::m4x4			view_projection;
+    hiz_info			hiz;
+    u32					frame_index;		// frame in flight whose upload buffers can be overwritten
+};
+
+bool initialize();
+void shutdown();
+// False if the device lacks the indirect draw features or the culling shader couldn't be loaded.
+[[nodiscard]] bool is_supported();
+
+// Records the culling pass, once per frame. Must be recorded outside of a render pass, before any draw() of the frame.
+void cull(vulkan_cmd_buffer& cmd_buffer, const cull_info& info);
+// Records the draws of the visible items of a bucket. The caller binds the bucket's pipeline, vertex and
+// index buffers first. The vertex shader finds each item's data with gl_InstanceIndex, which is the item's
+// index in cull_info::items.
+void draw(vulkan_cmd_buffer& cmd_buffer, u32 bucket);
+
+}
@@ -2,6 +2,9 @@
 // Distributed under the MIT license. See the LICENSE file in the project root for more information.
 #include "VulkanInterface.h"
 #include "VulkanCore.h"
+#include "VulkanContent.h"
+#include "VulkanCamera.h"
+#include "VulkanTextureStreaming.h"
 #include "Graphics/GraphicsPlatformInterface.h"
 #include "CommonHeaders.h"
 
@@ -24,17 +27,19 @@ get_platform_interface(platform_interface& pi)
     // pi.light.set_paramter = light::set_paramter;
     // pi.light.get_paramter = light::get_paramter;
 
-    // pi.camera.create = camera::create;
-    // pi.camera.remove = camera::remove;
-    // pi.camera.set_paramter = camera::set_paramter;
-    // pi.camera.get_paramter = camera::get_paramter;
+    pi.camera.create = camera::create;
+    pi.camera.remove = camera::remove;
+    pi.camera.set_parameter = camera::set_parameter;
+    pi.camera.get_parameter = camera::get_parameter;
 
-    // pi.resources.add_submesh = content::submesh::add;
-    // pi.resources.remove_submesh = content::submesh::remove;
-    // pi.resources.add_material = content::material::add;
-    // pi.resources.remove_material = content::material::remove;
-    // pi.resources.add_render_item = content::render_item::add;
-    // pi.resources.remove_render_item = content::render_item::remove;
+    pi.resources.add_submesh = content::submesh::add;
+    pi.resources.remove_submesh = content::submesh::remove;
+    pi.resources.add_texture = texture_streaming::add;
+    pi.resources.remove_texture = texture_streaming::remove;
+    pi.resources.add_material = content::material::add;
+    pi.resources.remove_material = content::material::remove;
+    pi.resources.add_render_item = content::render_item::add;
+    pi.resources.remove_render_item = content::render_item::remove;
 
     pi.platform = graphics_platform::vulkan_1;
 }
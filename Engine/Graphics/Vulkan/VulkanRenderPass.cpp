@@ -6,8 +6,13 @@ namespace primal::graphics::vulkan::renderpass {
 vulkan_renderpass
 create_renderpass(VkDevice device, VkFormat swapchain_image_format, VkFormat depth_format, math::u32v4 render_area, math::v4 clear_color, f32 depth, u32 stencil)
 {
-    // Create the main subpass
-    VkSubpassDescription subpass{};
+    // NOTE: subpass 0 is the depth prepass, which only writes depth. Subpass 1 is the main subpass, which
+    //		 draws color and tests against the depth the prepass laid down.
+    constexpr u32 subpass_count{ 2 };
+    VkSubpassDescription subpasses[subpass_count]{};
+    VkSubpassDescription& depth_subpass{ subpasses[0] };
+    VkSubpassDescription& subpass{ subpasses[1] };
+    depth_subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
     // Attachments
@@ -61,7 +66,8 @@ create_renderpass(VkDevice device, VkFormat swapchain_image_format, VkFormat dep
     depth_attach_ref.attachment = 1;	// attachment_desc[1] is depth attachment
     depth_attach_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-    // Let subpass know about the depth attachment
+    // Let subpasses know about the depth attachment
+    depth_subpass.pDepthStencilAttachment = &depth_attach_ref;
     subpass.pDepthStencilAttachment = &depth_attach_ref;
 
     // TODO: there are othere possible attachment types needed to configure here;
@@ -79,23 +85,42 @@ create_renderpass(VkDevice device, VkFormat swapchain_image_format, VkFormat dep
 
     // Render pass dependencies.
     // TODO: this need to be configurable
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dependencyFlags = 0;
+    // NOTE: the depth buffer is shared by the frames in flight, so the prepass waits for the depth tests of the
+    //		 previous frame. Color is first written in the main subpass, after the swapchain image is acquired.
+    constexpr u32 dependency_count{ 3 };
+    VkSubpassDependency dependencies[dependency_count]{};
+    constexpr VkPipelineStageFlags depth_stages{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT };
+    constexpr VkAccessFlags depth_access{ VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = depth_stages;
+    dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = depth_stages;
+    dependencies[0].dstAccessMask = depth_access;
+
+    dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstSubpass = 1;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = 0;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    dependencies[2].srcSubpass = 0;
+    dependencies[2].dstSubpass = 1;
+    dependencies[2].srcStageMask = depth_stages;
+    dependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[2].dstStageMask = depth_stages;
+    dependencies[2].dstAccessMask = depth_access;
+    dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
     // TODO: Several of these fields are hard coded, and should be configurable in the future
     VkRenderPassCreateInfo info{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
     info.attachmentCount = attachment_desc_count;
     info.pAttachments = attachment_desc;
-    info.subpassCount = 1;
-    info.pSubpasses = &subpass;
-    info.dependencyCount = 1;
-    info.pDependencies = &dependency;
+    info.subpassCount = subpass_count;
+    info.pSubpasses = subpasses;
+    info.dependencyCount = dependency_count;
+    info.pDependencies = dependencies;
     info.pNext = 0;
     info.flags = 0;
 
@@ -18,12 +18,15 @@ create_image(const image_init_info* const init_info, vulkan_image& image)
     // Create image
     {
         VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
-        info.imageType = VK_IMAGE_TYPE_2D;					// TODO: This should be configurable
+        assert(init_info->mip_levels && init_info->array_layers && init_info->depth);
+        assert(init_info->image_type == VK_IMAGE_TYPE_3D || init_info->depth == 1);
+        info.flags = init_info->flags;
+        info.imageType = init_info->image_type;
         info.extent.width = init_info->width;
         info.extent.height = init_info->height;
-        info.extent.depth = 1;								// TODO: should be configurable and supported
-        info.mipLevels = 1;									// TODO: should be configurable, and need to support mip maps
-        info.arrayLayers = 1;								// TODO: should be configurable and offer image layer support
+        info.extent.depth = init_info->depth;
+        info.mipLevels = init_info->mip_levels;
+        info.arrayLayers = init_info->array_layers;
         info.format = init_info->format;
         info.tiling = init_info->tiling;
         info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -62,24 +65,26 @@ create_image(const image_init_info* const init_info, vulkan_image& image)
     if (init_info->create_view)
     {
         image.view = nullptr;
-        if (!create_image_view(init_info->device, init_info->format, &image, init_info->view_aspect_flags)) return false;
+        if (!create_image_view(init_info->device, init_info->format, &image, init_info->view_aspect_flags,
+            init_info->view_type, init_info->mip_levels, init_info->array_layers)) return false;
     }
 
     return true;
 }
 
 bool
-create_image_view(VkDevice device, VkFormat format, vulkan_image* image, VkImageAspectFlags view_aspect_flags)
+create_image_view(VkDevice device, VkFormat format, vulkan_image* image, VkImageAspectFlags view_aspect_flags,
+    VkImageViewType view_type, u32 mip_levels, u32 array_layers)
 {
     VkImageViewCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
     info.image = image->image;
-    info.viewType = VK_IMAGE_VIEW_TYPE_2D;								// TODO: This should be configurable
+    info.viewType = view_type;
     info.format = format;
     info.subresourceRange.aspectMask = view_aspect_flags;
-    info.subresourceRange.baseMipLevel = 0;								// TODO: This should be configurable
-    info.subresourceRange.levelCount = 1;								// TODO: This should be configurable
-    info.subresourceRange.baseArrayLayer = 0;							// TODO: This should be configurable
-    info.subresourceRange.layerCount = 1;								// TODO: This should be configurable
+    info.subresourceRange.baseMipLevel = 0;
+    info.subresourceRange.levelCount = mip_levels;
+    info.subresourceRange.baseArrayLayer = 0;
+    info.subresourceRange.layerCount = array_layers;
 
     VkResult result{ VK_SUCCESS };
     VkCall(result = vkCreateImageView(device, &info, nullptr, &image->view), "Failed to create image view...");
@@ -108,6 +113,79 @@ destroy_image(VkDevice device, vulkan_image* image)
     }
 }
 
+bool
+create_buffer(const buffer_init_info* const init_info, vulkan_buffer& buffer)
+{
+    assert(init_info->size);
+    VkResult result{ VK_SUCCESS };
+    buffer.size = init_info->size;
+
+    {
+        VkBufferCreateInfo info{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+        info.size = init_info->size;
+        info.usage = init_info->usage_flags;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkCall(result = vkCreateBuffer(init_info->device, &info, nullptr, &buffer.buffer), "Failed to create buffer...");
+        if (result != VK_SUCCESS) return false;
+    }
+
+    VkMemoryRequirements memory_reqs;
+    vkGetBufferMemoryRequirements(init_info->device, buffer.buffer, &memory_reqs);
+
+    s32 index{ core::find_memory_index(memory_reqs.memoryTypeBits, init_info->memory_flags) };
+    if (index == -1)
+    {
+        ERROR_MSSG("The required memory type was not found...");
+        return false;
+    }
+
+    {
+        VkMemoryAllocateInfo info{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+        info.allocationSize = memory_reqs.size;
+        info.memoryTypeIndex = index;
+
+        VkCall(result = vkAllocateMemory(init_info->device, &info, nullptr, &buffer.memory), "Failed to allocate memory for buffer...");
+        if (result != VK_SUCCESS) return false;
+    }
+
+    VkCall(result = vkBindBufferMemory(init_info->device, buffer.buffer, buffer.memory, 0), "Failed to bind buffer memory...");
+    if (result != VK_SUCCESS) return false;
+
+    buffer.cpu_address = nullptr;
+    if (init_info->map_memory)
+    {
+        assert(init_info->memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        void* cpu_address{ nullptr };
+        VkCall(result = vkMapMemory(init_info->device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &cpu_address), "Failed to map buffer memory...");
+        if (result != VK_SUCCESS) return false;
+        buffer.cpu_address = (u8*)cpu_address;
+    }
+
+    return true;
+}
+
+void
+destroy_buffer(VkDevice device, vulkan_buffer* buffer)
+{
+    if (buffer->cpu_address)
+    {
+        vkUnmapMemory(device, buffer->memory);
+        buffer->cpu_address = nullptr;
+    }
+    if (buffer->buffer)
+    {
+        vkDestroyBuffer(device, buffer->buffer, nullptr);
+        buffer->buffer = nullptr;
+    }
+    if (buffer->memory)
+    {
+        vkFreeMemory(device, buffer->memory, nullptr);
+        buffer->memory = nullptr;
+    }
+    buffer->size = 0;
+}
+
 bool
 create_framebuffer(VkDevice device, vulkan_renderpass& renderpass, u32 width, u32 height, u32 attach_count, VkImageView* attachments, vulkan_framebuffer& framebuffer)
 {
@@ -11,18 +11,36 @@ struct image_init_info
     VkImageType             image_type;
     u32                     width;
     u32                     height;
+    u32                     depth{ 1 };             // 3D images only
+    u32                     mip_levels{ 1 };
+    u32                     array_layers{ 1 };      // 6 per cube map
+    VkImageCreateFlags      flags;                  // e.g. VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
     VkFormat                format;
     VkImageTiling           tiling;
     VkImageUsageFlags       usage_flags;
     VkMemoryPropertyFlags   memory_flags;
     bool                    create_view;
     VkImageAspectFlags      view_aspect_flags;
+    VkImageViewType         view_type{ VK_IMAGE_VIEW_TYPE_2D };
 };
 
 bool create_image(const image_init_info* const init_info, vulkan_image& image);
-bool create_image_view(VkDevice device, VkFormat format, vulkan_image* image, VkImageAspectFlags view_aspect_flags);
+bool create_image_view(VkDevice device, VkFormat format, vulkan_image* image, VkImageAspectFlags view_aspect_flags,
+    VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D, u32 mip_levels = 1, u32 array_layers = 1);
 void destroy_image(VkDevice device, vulkan_image* image);
 
+struct buffer_init_info
+{
+    VkDevice                device;
+    u64                     size;
+    VkBufferUsageFlags      usage_flags;
+    VkMemoryPropertyFlags   memory_flags;
+    bool                    map_memory;     // keep the buffer mapped for its whole lifetime (host visible memory only)
+};
+
+bool create_buffer(const buffer_init_info* const init_info, vulkan_buffer& buffer);
+void destroy_buffer(VkDevice device, vulkan_buffer* buffer);
+
 bool create_framebuffer(VkDevice device, vulkan_renderpass& renderpass, u32 width, u32 height, u32 attach_count, VkImageView* attachments, vulkan_framebuffer& framebuffer);
 void destroy_framebuffer(VkDevice device, vulkan_framebuffer& framebuffer);
 
@@ -0,0 +1,85 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanShaders.h"
+#include "VulkanCore.h"
+#include "Content/MappedFile.h"
+
+namespace primal::graphics::vulkan::shaders {
+namespace {
+
+struct engine_shader_info
+{
+    const char*				path;
+    engine_shader::id		engine_id;
+};
+
+constexpr engine_shader_info shaders_info[engine_shader::count]
+{
+    { "../../Engine/Graphics/Vulkan/Shaders/CullItems.comp.spv", engine_shader::cull_items_cs },
+    { "../../Engine/Graphics/Vulkan/Shaders/DepthOnly.vert.spv", engine_shader::depth_only_vs },
+};
+
+VkShaderModule	engine_shaders[engine_shader::count]{};
+bool			is_initialized{ false };
+
+VkShaderModule
+load_shader(const engine_shader_info& info)
+{
+    content::mapped_file file{ info.path };
+    // NOTE: SPIR-V is a stream of 32-bit words, so anything else isn't a compiled shader.
+    if (!file.is_open() || !file.size() || (file.size() & 3))
+    {
+        MESSAGE("Failed to load engine shader...");
+        MESSAGE(info.path);
+        return nullptr;
+    }
+
+    VkShaderModuleCreateInfo create_info{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+    create_info.codeSize = file.size();
+    create_info.pCode = (const u32*)file.data();
+
+    VkShaderModule shader_module{ nullptr };
+    VkResult result{ VK_SUCCESS };
+    VkCall(result = vkCreateShaderModule(core::logical_device(), &create_info, nullptr, &shader_module), "Failed to create shader module...");
+    return result == VK_SUCCESS ? shader_module : nullptr;
+}
+
+} // anonymous namespace
+
+bool
+initialize()
+{
+    if (is_initialized) return true;
+
+    bool result{ true };
+    for (u32 i{ 0 }; i < engine_shader::count; ++i)
+    {
+        assert(shaders_info[i].engine_id == i);
+        engine_shaders[i] = load_shader(shaders_info[i]);
+        result &= engine_shaders[i] != nullptr;
+    }
+
+    is_initialized = true;
+    return result;
+}
+
+void
+shutdown()
+{
+    for (auto& shader : engine_shaders)
+    {
+        if (shader) vkDestroyShaderModule(core::logical_device(), shader, nullptr);
+        shader = nullptr;
+    }
+
+    is_initialized = false;
+}
+
+VkShaderModule
+get_engine_shader(engine_shader::id id)
+{
+    assert(id < engine_shader::count);
+    return engine_shaders[id];
+}
+
+}
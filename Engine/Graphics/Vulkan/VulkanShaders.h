@@ -0,0 +1,25 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+namespace primal::graphics::vulkan::shaders {
+
+struct engine_shader
+{
+    enum id : u32
+    {
+        cull_items_cs = 0,
+        depth_only_vs,
+        count
+    };
+};
+
+// Loads the SPIR-V of the engine shaders. Vulkan has no runtime compiler, so the GLSL sources in
+// Vulkan/Shaders have to be compiled to .spv files next to them with glslc from the Vulkan SDK.
+bool initialize();
+void shutdown();
+// Returns nullptr if the shader's SPIR-V couldn't be loaded.
+[[nodiscard]] VkShaderModule get_engine_shader(engine_shader::id id);
+
+}
@@ -112,7 +112,7 @@ vulkan_surface::present([[maybe_unused]] VkSemaphore image_available, VkSemaphor
     info.pSwapchains = &_swapchain.swapchain;
     info.pImageIndices = &_image_index;
     VkResult result{ VK_SUCCESS };
-    result = vkQueuePresentKHR(presentation_queue, &info);
+    result = core::queue_present(presentation_queue, info);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR /*|| _framebuffer_resized*/)
     {
         /*_framebuffer_resized = false;*/
@@ -135,7 +135,7 @@ vulkan_surface::resize()
 void
 vulkan_surface::release()
 {
-    vkDeviceWaitIdle(core::logical_device());
+    core::device_wait_idle();
     for (u32 i{ 0 }; i < _swapchain.images.size(); ++i)
     {
         destroy_framebuffer(core::logical_device(), _framebuffers[i]);
@@ -286,14 +286,14 @@ void
 vulkan_surface::create_render_pass()
 {
     _renderpass = renderpass::create_renderpass(core::logical_device(), _swapchain.image_format, core::depth_format(),
-                                                { 0, 0, _window.width(), _window.height() }, { 0.0f, 0.0f, 0.0f, 0.0f }, 1.0f, 0);
+                                                { 0, 0, _window.width(), _window.height() }, { 0.0f, 0.0f, 0.0f, 0.0f }, 0.0f, 0);
 
 }
 
 bool
 vulkan_surface::recreate_swapchain()
 {
-    vkDeviceWaitIdle(core::logical_device());
+    core::device_wait_idle();
 
     _is_recreating = true;
 
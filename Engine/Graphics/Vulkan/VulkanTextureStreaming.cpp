@@ -0,0 +1,463 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "VulkanTextureStreaming.h"
+#include "VulkanCore.h"
+#include "VulkanContent.h"
+#include "Content/ContentToEngine.h"
+#include "Utilities/IOStream.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+namespace primal::graphics::vulkan::texture_streaming {
+namespace {
+
+constexpr u32 max_mips{ 16 };
+
+struct streamed_texture
+{
+    utl::vector<u8>		blob;
+    u64					chain_bytes[max_mips];		// blob bytes of the mips from this one to the last
+    id::id_type			texture_id;
+    u64					size;						// device memory of the resident mips
+    u32					width;
+    u32					height;
+    u32					mip_count;
+    u32					tail_mip;					// this mip and the smaller ones are always resident
+    u32					resident_mip;				// most detailed resident mip
+    u32					requested_mip;				// most detailed mip requested this frame
+    u32					desired_mip;
+    u32					target_mip;
+    u32					last_request;				// update count of the last request
+    f32					screen_size;				// largest screen size of the last update that had requests
+    f32					requested_screen_size;		// largest screen size requested since the last update
+    bool				is_valid;
+};
+
+init_info										settings{};
+utl::vector<streamed_texture>					streamed_textures;
+utl::vector<id::id_type>						free_ids;
+utl::vector<u32>								candidates;
+std::unique_ptr<std::atomic<VkImageView>[]>		views;
+stats											streaming_stats{};
+u32												update_count{ 0 };
+bool											is_initialized{ false };
+std::mutex										streaming_mutex{};
+
+// Device memory needed to have mips from mip to the last resident. Scales the size of the resident mips
+// by the ratio of blob bytes, which accounts for alignment and CPU decoded formats.
+u64
+estimate_size(const streamed_texture& texture, u32 mip)
+{
+    const u64 resident_bytes{ texture.chain_bytes[texture.resident_mip] };
+    if (!resident_bytes) return 0;
+    return (u64)((f32)texture.size * ((f32)texture.chain_bytes[mip] / (f32)resident_bytes));
+}
+
+// Texture blobs don't store their size, so this walks the mips to find where the blob ends.
+u64
+get_blob_size(const u8* const data)
+{
+    utl::blob_stream_reader blob{ data };
+    blob.skip(sizeof(u32) * 2); // width, height
+    u32 array_size{ blob.read<u32>() };
+    const u32 flags{ blob.read<u32>() };
+    const u32 mip_count{ blob.read<u32>() };
+    blob.skip(sizeof(u32)); // format
+
+    u32 depth{ 1 };
+    if (flags & primal::content::texture_flags::is_volume_map)
+    {
+        depth = array_size;
+        array_size = 1;
+    }
+
+    for (u32 layer{ 0 }; layer < array_size; ++layer)
+    {
+        for (u32 mip{ 0 }; mip < mip_count; ++mip)
+        {
+            blob.skip(sizeof(u32)); // row pitch
+            const u32 slice_pitch{ blob.read<u32>() };
+            blob.skip((u64)slice_pitch * std::max(depth >> mip, 1u));
+        }
+    }
+
+    return (u64)(blob.position() - data);
+}
+
+bool
+parse_blob(streamed_texture& texture)
+{
+    utl::blob_stream_reader blob{ texture.blob.data() };
+    texture.width = blob.read<u32>();
+    texture.height = blob.read<u32>();
+    u32 array_size{ blob.read<u32>() };
+    const u32 flags{ blob.read<u32>() };
+    texture.mip_count = blob.read<u32>();
+    blob.skip(sizeof(u32)); // format
+
+    if (!texture.mip_count || texture.mip_count > max_mips) return false;
+
+    u32 depth{ 1 };
+    if (flags & primal::content::texture_flags::is_volume_map)
+    {
+        depth = array_size;
+        array_size = 1;
+    }
+
+    u64 mip_bytes[max_mips]{};
+    for (u32 layer{ 0 }; layer < array_size; ++layer)
+    {
+        for (u32 mip{ 0 }; mip < texture.mip_count; ++mip)
+        {
+            blob.skip(sizeof(u32)); // row pitch
+            const u32 slice_pitch{ blob.read<u32>() };
+            const u64 size{ (u64)slice_pitch * std::max(depth >> mip, 1u) };
+            mip_bytes[mip] += size;
+            blob.skip(size);
+        }
+    }
+
+    if ((u64)(blob.position() - texture.blob.data()) > texture.blob.size()) return false;
+
+    u64 chain_bytes{ 0 };
+    for (u32 mip{ texture.mip_count }; mip > 0; --mip)
+    {
+        chain_bytes += mip_bytes[mip - 1];
+        texture.chain_bytes[mip - 1] = chain_bytes;
+    }
+
+    texture.tail_mip = texture.mip_count - 1;
+    while (texture.tail_mip > 0 &&
+        std::max(texture.width >> (texture.tail_mip - 1), texture.height >> (texture.tail_mip - 1)) <= settings.resident_tail_size)
+    {
+        --texture.tail_mip;
+    }
+
+    return true;
+}
+
+// Replaces the texture by one that starts at mip. Only the mips the old texture doesn't have are uploaded,
+// the rest are copied from it on the GPU. The renderer picks up the new view on its next load and the old
+// texture is released once the GPU is done with it.
+bool
+make_resident(id::id_type id, u32 mip)
+{
+    streamed_texture& texture{ streamed_textures[id] };
+    const id::id_type texture_id{ content::texture::add(texture.blob.data(), mip, texture.texture_id) };
+    if (!id::is_valid(texture_id)) return false;
+
+    views[id].store(content::texture::image_view(texture_id), std::memory_order_release);
+    content::texture::remove(texture.texture_id);
+
+    if (mip < texture.resident_mip)
+    {
+        streaming_stats.streamed_in_bytes += texture.chain_bytes[mip] - texture.chain_bytes[texture.resident_mip];
+        ++streaming_stats.stream_in_count;
+    }
+    else
+    {
+        streaming_stats.evicted_bytes += texture.chain_bytes[texture.resident_mip] - texture.chain_bytes[mip];
+        ++streaming_stats.eviction_count;
+    }
+
+    texture.texture_id = texture_id;
+    texture.size = content::texture::size(texture_id);
+    texture.resident_mip = mip;
+    return true;
+}
+
+u64
+calculate_budget(u64 resident_bytes)
+{
+    const core::memory_budget device_budget{ core::device_local_memory_budget() };
+    streaming_stats.device_budget = device_budget.budget;
+    streaming_stats.device_usage = device_budget.usage;
+    streaming_stats.is_budget_reported_by_driver = device_budget.is_reported_by_driver;
+
+    if (settings.budget) return settings.budget;
+
+    // The reported usage includes the streamed textures, which are the part we're trying to fit.
+    const u64 other_usage{ device_budget.usage > resident_bytes ? device_budget.usage - resident_bytes : 0 };
+    const u64 available{ device_budget.budget > other_usage ? device_budget.budget - other_usage : 0 };
+    return (u64)((f32)available * settings.budget_share);
+}
+
+void
+initialize_streaming(const init_info& info)
+{
+    assert(!is_initialized && info.max_texture_count && info.budget_share > 0.f && info.budget_share <= 1.f);
+    settings = info;
+    views = std::make_unique<std::atomic<VkImageView>[]>(info.max_texture_count);
+    for (u32 i{ 0 }; i < info.max_texture_count; ++i) views[i].store(nullptr, std::memory_order_relaxed);
+    streaming_stats = {};
+    update_count = 0;
+    is_initialized = true;
+}
+
+} // anonymous namespace
+
+bool
+initialize(const init_info& info)
+{
+    std::lock_guard lock{ streaming_mutex };
+    initialize_streaming(info);
+    return true;
+}
+
+void
+shutdown()
+{
+    std::lock_guard lock{ streaming_mutex };
+    if (!is_initialized) return;
+
+    for (auto& texture : streamed_textures)
+    {
+        if (texture.is_valid) content::texture::remove(texture.texture_id);
+    }
+
+    streamed_textures.clear();
+    free_ids.clear();
+    candidates.clear();
+    views.reset();
+    is_initialized = false;
+}
+
+id::id_type
+add(const u8* const data)
+{
+    assert(data);
+    return add(data, get_blob_size(data));
+}
+
+id::id_type
+add(const u8* const data, u64 size)
+{
+    assert(data && size);
+    streamed_texture texture{};
+    texture.blob.resize(size);
+    memcpy(texture.blob.data(), data, size);
+
+    std::lock_guard lock{ streaming_mutex };
+    if (!is_initialized) initialize_streaming(init_info{});
+    if (!parse_blob(texture))
+    {
+        ERROR_MSSG("Invalid texture blob...");
+        return id::invalid_id;
+    }
+
+    // Start with the tail mips only. Detailed mips come in as the texture gets requested.
+    texture.texture_id = content::texture::add(texture.blob.data(), texture.tail_mip, id::invalid_id);
+    if (!id::is_valid(texture.texture_id)) return id::invalid_id;
+
+    texture.size = content::texture::size(texture.texture_id);
+    texture.resident_mip = texture.tail_mip;
+    texture.requested_mip = u32_invalid_id;
+    texture.desired_mip = texture.tail_mip;
+    texture.target_mip = texture.tail_mip;
+    texture.last_request = update_count;
+    texture.is_valid = true;
+    const VkImageView view{ content::texture::image_view(texture.texture_id) };
+
+    id::id_type id{ id::invalid_id };
+    if (!free_ids.empty())
+    {
+        id = free_ids.back();
+        free_ids.pop_back();
+        streamed_textures[id] = std::move(texture);
+    }
+    else
+    {
+        if (streamed_textures.size() == settings.max_texture_count)
+        {
+            ERROR_MSSG("Too many streamed textures. Increase max_texture_count...");
+            content::texture::remove(texture.texture_id);
+            return id::invalid_id;
+        }
+
+        id = (id::id_type)streamed_textures.size();
+        streamed_textures.emplace_back(std::move(texture));
+    }
+
+    views[id].store(view, std::memory_order_release);
+    return id;
+}
+
+void
+remove(id::id_type id)
+{
+    std::lock_guard lock{ streaming_mutex };
+    assert(id < streamed_textures.size() && streamed_textures[id].is_valid);
+    streamed_texture& texture{ streamed_textures[id] };
+    content::texture::remove(texture.texture_id);
+    views[id].store(nullptr, std::memory_order_release);
+    texture.blob = utl::vector<u8>{};
+    texture.is_valid = false;
+    free_ids.emplace_back(id);
+}
+
+void
+request(id::id_type id, f32 screen_size)
+{
+    std::lock_guard lock{ streaming_mutex };
+    assert(id < streamed_textures.size() && streamed_textures[id].is_valid);
+    streamed_texture& texture{ streamed_textures[id] };
+    const u32 mip{ mip_for_screen_size(texture.width, texture.height, texture.mip_count, screen_size) };
+    texture.requested_mip = std::min(texture.requested_mip, mip);
+    texture.requested_screen_size = std::max(texture.requested_screen_size, screen_size);
+}
+
+void
+request_mip(id::id_type id, u32 mip)
+{
+    std::lock_guard lock{ streaming_mutex };
+    assert(id < streamed_textures.size() && streamed_textures[id].is_valid);
+    streamed_texture& texture{ streamed_textures[id] };
+    texture.requested_mip = std::min(texture.requested_mip, mip);
+    texture.requested_screen_size = std::max(texture.requested_screen_size, (f32)std::max(texture.width >> mip, texture.height >> mip));
+}
+
+void
+update()
+{
+    std::lock_guard lock{ streaming_mutex };
+    if (!is_initialized) return;
+    ++update_count;
+
+    // Desired mips from this frame's requests. Textures nobody asked for in a while fall back to their tails.
+    u64 resident_bytes{ 0 };
+    u64 requested_bytes{ 0 };
+    candidates.clear();
+    for (u32 i{ 0 }; i < streamed_textures.size(); ++i)
+    {
+        streamed_texture& texture{ streamed_textures[i] };
+        if (!texture.is_valid) continue;
+
+        // NOTE: the screen size only comes from the requests since the last update, so a texture that was
+        //		 once seen up close doesn't keep its priority after it moved away.
+        if (texture.requested_mip != u32_invalid_id)
+        {
+            texture.desired_mip = std::min(texture.requested_mip, texture.tail_mip);
+            texture.screen_size = texture.requested_screen_size;
+            texture.last_request = update_count;
+        }
+        else if (update_count - texture.last_request > settings.request_timeout)
+        {
+            texture.desired_mip = texture.tail_mip;
+            texture.screen_size = 0.f;
+        }
+
+        texture.requested_mip = u32_invalid_id;
+        texture.requested_screen_size = 0.f;
+        texture.target_mip = texture.desired_mip;
+        resident_bytes += texture.size;
+        requested_bytes += estimate_size(texture, texture.target_mip);
+        candidates.emplace_back(i);
+    }
+
+    const u64 budget{ calculate_budget(resident_bytes) };
+
+    // Over budget: drop one mip at a time from the textures that appear smallest on screen first.
+    std::sort(candidates.begin(), candidates.end(), [](u32 a, u32 b) {
+        return streamed_textures[a].screen_size < streamed_textures[b].screen_size;
+        });
+
+    u64 target_bytes{ requested_bytes };
+    bool has_dropped_mips{ true };
+    while (target_bytes > budget && has_dropped_mips)
+    {
+        has_dropped_mips = false;
+        for (u32 i : candidates)
+        {
+            streamed_texture& texture{ streamed_textures[i] };
+            if (texture.target_mip >= texture.tail_mip) continue;
+
+            target_bytes -= estimate_size(texture, texture.target_mip) - estimate_size(texture, texture.target_mip + 1);
+            ++texture.target_mip;
+            has_dropped_mips = true;
+            if (target_bytes <= budget) break;
+        }
+    }
+
+    // Evict first, then stream in the textures that appear largest on screen, as the upload budget permits.
+    // NOTE: a replaced texture stays in memory until the frames that sample it are done, so both versions
+    //		 exist for a while. Streaming in only goes ahead if that peak fits in the budget.
+    u64 peak_bytes{ resident_bytes };
+    u32 budget_limited_count{ 0 };
+    for (u32 i : candidates)
+    {
+        streamed_texture& texture{ streamed_textures[i] };
+        if (texture.target_mip > texture.desired_mip) ++budget_limited_count;
+        if (texture.target_mip > texture.resident_mip && make_resident(i, texture.target_mip)) peak_bytes += texture.size;
+    }
+
+    u64 upload_bytes{ 0 };
+    u32 pending_count{ 0 };
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+    {
+        streamed_texture& texture{ streamed_textures[*it] };
+        if (texture.target_mip >= texture.resident_mip) continue;
+
+        const u64 bytes{ texture.chain_bytes[texture.target_mip] - texture.chain_bytes[texture.resident_mip] };
+        if ((upload_bytes && upload_bytes + bytes > settings.upload_budget) ||
+            peak_bytes + estimate_size(texture, texture.target_mip) > budget)
+        {
+            ++pending_count;
+            continue;
+        }
+
+        if (make_resident(*it, texture.target_mip))
+        {
+            upload_bytes += bytes;
+            peak_bytes += texture.size;
+        }
+    }
+
+    resident_bytes = 0;
+    for (u32 i : candidates) resident_bytes += streamed_textures[i].size;
+
+    streaming_stats.budget = budget;
+    streaming_stats.resident_bytes = resident_bytes;
+    streaming_stats.requested_bytes = requested_bytes;
+    streaming_stats.texture_count = (u32)candidates.size();
+    streaming_stats.pending_count = pending_count;
+    streaming_stats.budget_limited_count = budget_limited_count;
+}
+
+VkImageView
+image_view(id::id_type id)
+{
+    assert(id < settings.max_texture_count);
+    return views[id].load(std::memory_order_acquire);
+}
+
+stats
+get_stats()
+{
+    std::lock_guard lock{ streaming_mutex };
+    return streaming_stats;
+}
+
+u32
+mip_for_screen_size(u32 width, u32 height, u32 mip_count, f32 screen_size)
+{
+    assert(mip_count);
+    const f32 texture_size{ (f32)std::max(width, height) };
+    if (screen_size >= texture_size) return 0;
+    if (screen_size <= 1.f) return mip_count - 1;
+
+    // Each mip halves the size, so the mip whose size is closest to the screen size from above.
+    const u32 mip{ (u32)std::floor(std::log2(texture_size / screen_size)) };
+    return std::min(mip, mip_count - 1);
+}
+
+f32
+screen_size(f32 world_size, f32 distance, f32 vertical_fov, u32 viewport_height)
+{
+    assert(vertical_fov > 0.f && viewport_height);
+    if (distance <= world_size) return (f32)viewport_height;
+    return world_size / (2.f * distance * std::tan(vertical_fov * 0.5f)) * (f32)viewport_height;
+}
+}
@@ -0,0 +1,64 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "VulkanCommonHeaders.h"
+
+// Keeps only the mips that are worth sampling in device memory. Each frame, the renderer reports how large
+// the streamed textures appear on screen. update() then streams in the detailed mips of the textures that
+// need them and evicts the ones that don't, while keeping the total under the memory budget.
+namespace primal::graphics::vulkan::texture_streaming {
+
+struct init_info
+{
+    u64		budget{ 0 };						// bytes of device memory textures may use. 0 derives it from the device budget.
+    f32		budget_share{ 0.8f };				// share of the device budget left by everything else that textures may use
+    u64		upload_budget{ 32 * 1024 * 1024 };	// bytes streamed in per update
+    u32		max_texture_count{ 16 * 1024 };
+    u32		resident_tail_size{ 64 };			// mips this size or smaller are always resident
+    u32		request_timeout{ 60 };				// updates without requests before a texture drops to its tail mips
+};
+
+struct stats
+{
+    u64		budget;
+    u64		resident_bytes;
+    u64		requested_bytes;		// what all textures at their requested mips would use
+    u64		device_budget;			// device local memory this process can use, from VK_EXT_memory_budget if supported
+    u64		device_usage;			// device local memory this process uses. 0 if not reported by the driver.
+    u64		streamed_in_bytes;		// totals since initialize()
+    u64		evicted_bytes;
+    u32		stream_in_count;
+    u32		eviction_count;
+    u32		texture_count;
+    u32		pending_count;			// textures waiting for upload budget, or for room for their old and new mips at once
+    u32		budget_limited_count;	// textures held below their requested mip by the memory budget
+    bool	is_budget_reported_by_driver;
+};
+
+// Calling initialize() is optional. The first add() initializes with default settings otherwise.
+bool initialize(const init_info& info);
+void shutdown();
+
+// Makes a copy of the texture blob, so evicted mips can be streamed back in later without going to disk.
+[[nodiscard]] id::id_type add(const u8* const data, u64 size);
+// For blobs that come without their size, like the textures added through the platform interface.
+[[nodiscard]] id::id_type add(const u8* const data);
+void remove(id::id_type id);
+
+// Reports the size of the texture on screen in pixels. The largest request of the frame wins.
+void request(id::id_type id, f32 screen_size);
+// Reports the most detailed mip to stream in directly. The most detailed request of the frame wins.
+void request_mip(id::id_type id, u32 mip);
+
+// Call once per frame on the render thread, before recording anything that samples streamed textures.
+void update();
+
+// Lock free. The view changes when mips are streamed in or evicted, so get it every frame.
+[[nodiscard]] VkImageView image_view(id::id_type id);
+[[nodiscard]] stats get_stats();
+
+// Most detailed mip worth sampling for a texture covering screen_size pixels along its larger axis.
+[[nodiscard]] u32 mip_for_screen_size(u32 width, u32 height, u32 mip_count, f32 screen_size);
+// Approximate size in pixels of an object of world_size at distance from the camera.
+[[nodiscard]] f32 screen_size(f32 world_size, f32 distance, f32 vertical_fov, u32 viewport_height);
+}
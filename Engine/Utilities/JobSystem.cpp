@@ -0,0 +1,159 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#include "JobSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace primal::jobs {
+namespace {
+
+struct batch
+{
+    detail::chunk_function		function;
+    void*						context;
+    u32							chunk_count;
+    std::atomic<u32>			next_chunk{ 0 };
+    std::atomic<u32>			completed_chunks{ 0 };
+    u32							worker_count{ 0 };	// workers using the batch. Protected by batch_mutex.
+};
+
+utl::vector<std::thread>		workers;
+utl::deque<batch*>				batches;		// batches that still have chunks nobody picked up
+std::mutex						batch_mutex{};
+std::condition_variable			batch_cv{};		// signaled when a batch is queued or on shutdown
+std::condition_variable			done_cv{};		// signaled when a batch completes
+bool							is_running{ false };
+std::once_flag					default_initialization{};
+
+// Runs chunks of b until there are none left to pick up.
+void
+work_on(batch& b)
+{
+    for (u32 chunk{ b.next_chunk.fetch_add(1) }; chunk < b.chunk_count; chunk = b.next_chunk.fetch_add(1))
+    {
+        b.function(b.context, chunk);
+        b.completed_chunks.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void
+worker()
+{
+    while (true)
+    {
+        batch* b{ nullptr };
+        {
+            std::unique_lock lock{ batch_mutex };
+            batch_cv.wait(lock, [] { return !batches.empty() || !is_running; });
+            if (!is_running) return;
+
+            // NOTE: the batch leaves the queue once all of its chunks are picked up. The caller keeps it
+            //       alive until no worker uses it anymore.
+            b = batches.front();
+            ++b->worker_count;
+            if (b->next_chunk.load() + 1 >= b->chunk_count) batches.pop_front();
+        }
+
+        work_on(*b);
+
+        std::lock_guard lock{ batch_mutex };
+        --b->worker_count;
+        done_cv.notify_all();
+    }
+}
+
+void
+shutdown_workers()
+{
+    {
+        std::lock_guard lock{ batch_mutex };
+        if (!is_running) return;
+        is_running = false;
+        batch_cv.notify_all();
+    }
+
+    for (auto& thread : workers) thread.join();
+    workers.clear();
+    assert(batches.empty());
+}
+
+// Workers must be joined before the thread objects are destroyed, so shut down at exit at the latest.
+// Declared last, so it's destroyed before everything above.
+struct exit_guard
+{
+    ~exit_guard() { shutdown_workers(); }
+} guard;
+
+} // anonymous namespace
+
+void
+initialize(u32 thread_count)
+{
+    std::lock_guard lock{ batch_mutex };
+    if (is_running) return;
+
+    if (!thread_count)
+    {
+        const u32 hardware_threads{ std::thread::hardware_concurrency() };
+        thread_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+
+    is_running = true;
+    for (u32 i{ 0 }; i < thread_count; ++i) workers.emplace_back(worker);
+}
+
+void
+shutdown()
+{
+    shutdown_workers();
+}
+
+u32
+concurrency()
+{
+    std::lock_guard lock{ batch_mutex };
+    return (u32)workers.size() + 1;
+}
+
+namespace detail {
+void
+run(u32 chunk_count, chunk_function function, void* const context)
+{
+    std::call_once(default_initialization, [] { initialize(); });
+
+    batch b{};
+    b.function = function;
+    b.context = context;
+    b.chunk_count = chunk_count;
+
+    bool has_workers{ false };
+    {
+        std::lock_guard lock{ batch_mutex };
+        if (is_running && !workers.empty())
+        {
+            batches.emplace_back(&b);
+            has_workers = true;
+            batch_cv.notify_all();
+        }
+    }
+
+    work_on(b);
+    if (!has_workers) return;
+
+    std::unique_lock lock{ batch_mutex };
+    // Workers may not have picked up the batch at all, in which case it's still queued.
+    for (auto it = batches.begin(); it != batches.end(); ++it)
+    {
+        if (*it == &b)
+        {
+            batches.erase(it);
+            break;
+        }
+    }
+
+    done_cv.wait(lock, [&b] { return b.worker_count == 0 && b.completed_chunks.load(std::memory_order_acquire) == b.chunk_count; });
+}
+}
+}
@@ -0,0 +1,56 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+#pragma once
+#include "CommonHeaders.h"
+
+// Minimal fork-join job system for splitting per-frame work across cores. Worker threads pick up
+// chunks of a parallel_for and the calling thread works on its own batch too, so a call returns only
+// when all chunks are done. Several threads may run parallel_for at the same time.
+namespace primal::jobs {
+
+// thread_count is the number of worker threads. 0 uses one per hardware thread, minus the caller's.
+// Calling initialize() is optional: the first parallel_for initializes with the default.
+void initialize(u32 thread_count = 0);
+void shutdown();
+// Threads that can work on a parallel_for at once, including the calling thread.
+[[nodiscard]] u32 concurrency();
+
+namespace detail {
+using chunk_function = void(*)(void* const context, u32 chunk_index);
+void run(u32 chunk_count, chunk_function function, void* const context);
+}
+
+[[nodiscard]] constexpr u32
+chunk_count(u32 count, u32 chunk_size)
+{
+    assert(chunk_size);
+    return (count + chunk_size - 1) / chunk_size;
+}
+
+// Calls f(chunk_index, begin, end) for each chunk_size range of [0, count), in parallel.
+template<typename F>
+void
+parallel_for(u32 count, u32 chunk_size, F&& f)
+{
+    struct context
+    {
+        F&		f;
+        u32		count;
+        u32		chunk_size;
+    } ctx{ f, count, chunk_size };
+
+    const u32 chunks{ chunk_count(count, chunk_size) };
+    if (chunks == 0) return;
+    if (chunks == 1)
+    {
+        f(0u, 0u, count);
+        return;
+    }
+
+    detail::run(chunks, [](void* const data, u32 chunk_index) {
+        context& c{ *(context*)data };
+        const u32 begin{ chunk_index * c.chunk_size };
+        c.f(chunk_index, begin, std::min(begin + c.chunk_size, c.count));
+        }, &ctx);
+}
+}
@@ -11,6 +11,8 @@
 #include "TestRendererLinux.h"
 #elif TEST_RENDERER_DX11
 #include "TestDX11.h"
+#elif TEST_BENCHMARKS
+#include "TestBenchmarks.h"
 #else
 #error One of the tests must be enabled
 #endif
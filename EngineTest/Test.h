@@ -8,6 +8,7 @@
 #define TEST_WINDOW 0
 #define TEST_RENDERER 1
 #define TEST_RENDERER_DX11 0
+#define TEST_BENCHMARKS 0
 
 class test
 {
@@ -0,0 +1,921 @@
+#pragma once
+#include "Test.h"
+#include "Components/Entity.h"
+#include "Components/Transform.h"
+#include "Graphics/Renderer.h"
+#include "Graphics/Direct3D11/D3D11Light.h"
+#include "Graphics/StableArray.h"
+#include "Graphics/RangeAllocator.h"
+#include "Graphics/DrawKeys.h"
+#include "Graphics/TransformKernels.h"
+#include "Graphics/Visibility.h"
+#include "Graphics/BoundingVolumeHierarchy.h"
+#include "Graphics/BlockCompression.h"
+#include "Content/MappedFile.h"
+#include "Content/PackFile.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN64
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif // _WIN64
+
+#ifdef __linux__
+#include "Platform/LinuxWindowManager.h"
+#include <unistd.h>
+#endif // __linux__
+
+using namespace primal;
+
+namespace {
+using bench_clock = std::chrono::steady_clock;
+
+// Prints the value measured over count items, e.g. a time in ms or, for counters, how many of them matched.
+void
+print_result(const char* name, u32 count, f32 value, const char* unit = "ms")
+{
+#ifdef _WIN64
+    OutputDebugStringA(name);
+    OutputDebugStringA((" (" + std::to_string(count) + "): ").c_str());
+    OutputDebugStringA(std::to_string(value).c_str());
+    OutputDebugStringA((" " + std::string{ unit } + "\n").c_str());
+#else
+    std::cout << name << " (" << count << "): " << value << " " << unit << std::endl;
+#endif // _WIN64
+}
+
+f32
+elapsed_ms(bench_clock::time_point start)
+{
+    return std::chrono::duration<f32, std::milli>(bench_clock::now() - start).count();
+}
+
+#if PRIMAL_BUILD_D3D11
+void
+benchmark_light_creation()
+{
+    using namespace graphics::d3d11;
+    constexpr u32 light_count{ 100'000 };
+    constexpr u64 light_set_key{ 0xbe1c };
+
+    transform::init_info transform_info{};
+    game_entity::entity_info entity_info{ &transform_info };
+    game_entity::entity entity{ game_entity::create(entity_info) };
+    assert(entity.is_valid());
+
+    utl::vector<graphics::light_init_info> infos(light_count);
+    utl::vector<graphics::light> lights(light_count);
+    for (u32 i{ 0 }; i < light_count; ++i)
+    {
+        graphics::light_init_info& info{ infos[i] };
+        info.light_set_key = light_set_key;
+        info.entity_id = entity.get_id();
+        info.color = { 1.f, 1.f, 1.f };
+        info.intensity = 1.f;
+        info.is_enabled = (i & 1) != 0;
+        info.type = (i % 3) ? graphics::light::point : graphics::light::spot;
+        if (info.type == graphics::light::point)
+        {
+            info.point_params.attenuation = { 1.f, 1.f, 1.f };
+            info.point_params.range = 5.f;
+        }
+        else
+        {
+            info.spot_params.attenuation = { 1.f, 1.f, 1.f };
+            info.spot_params.range = 5.f;
+            info.spot_params.umbra = 0.5f * math::pi;
+            info.spot_params.penumbra = 0.7f * math::pi;
+        }
+    }
+
+    light::create_light_set(light_set_key);
+
+    auto start{ bench_clock::now() };
+    for (u32 i{ 0 }; i < light_count; ++i) lights[i] = light::create(infos[i]);
+    print_result("light::create", light_count, elapsed_ms(start));
+
+    // Remove every other light, then refill the holes. This used to be a linear scan per light.
+    start = bench_clock::now();
+    for (u32 i{ 0 }; i < light_count; i += 2) light::remove(lights[i].get_id(), light_set_key);
+    for (u32 i{ 0 }; i < light_count; i += 2) lights[i] = light::create(infos[i]);
+    print_result("light::remove + create (interleaved)", light_count, elapsed_ms(start));
+
+    start = bench_clock::now();
+    for (u32 i{ 0 }; i < light_count; ++i) light::remove(lights[i].get_id(), light_set_key);
+    print_result("light::remove", light_count, elapsed_ms(start));
+
+    start = bench_clock::now();
+    light::create_lights(infos.data(), light_count, lights.data());
+    print_result("light::create_lights", light_count, elapsed_ms(start));
+
+    for (u32 i{ 0 }; i < light_count; ++i) light::remove(lights[i].get_id(), light_set_key);
+    light::remove_light_set(light_set_key);
+    game_entity::remove(entity.get_id());
+}
+#endif // PRIMAL_BUILD_D3D11
+
+struct memory_usage
+{
+    u64 resident;		// everything in the working set, including mapped file pages
+    u64 private_bytes;	// memory that belongs to this process only, i.e. heap copies
+};
+
+memory_usage
+get_memory_usage()
+{
+#ifdef _WIN64
+    PROCESS_MEMORY_COUNTERS_EX counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+    return { counters.WorkingSetSize, counters.PrivateUsage };
+#else
+    // statm: total, resident and shared (file backed) pages.
+    u64 total{ 0 }, resident{ 0 }, shared{ 0 };
+    std::ifstream statm{ "/proc/self/statm" };
+    statm >> total >> resident >> shared;
+    const u64 page_size{ (u64)sysconf(_SC_PAGESIZE) };
+    return { resident * page_size, (resident - shared) * page_size };
+#endif // _WIN64
+}
+
+void
+print_memory(const char* name, const memory_usage& before, const memory_usage& after)
+{
+    const u64 resident{ after.resident > before.resident ? after.resident - before.resident : 0 };
+    const u64 private_bytes{ after.private_bytes > before.private_bytes ? after.private_bytes - before.private_bytes : 0 };
+    const std::string message{ std::string{ name } + ": +" + std::to_string(resident >> 20) + " MB resident, +" +
+        std::to_string(private_bytes >> 20) + " MB private" };
+#ifdef _WIN64
+    OutputDebugStringA((message + "\n").c_str());
+#else
+    std::cout << message << std::endl;
+#endif // _WIN64
+}
+
+// Compares the old way of loading assets (copy the whole file into a heap buffer) with parsing them
+// from a mapped file. The file was just written, so both read from a warm page cache.
+void
+benchmark_file_reading()
+{
+    constexpr u64 file_size{ 128 * 1024 * 1024 };
+    const std::filesystem::path path{ std::filesystem::temp_directory_path() / "primal_file_benchmark.bin" };
+    {
+        utl::vector<u8> data(1024 * 1024);
+        for (u32 i{ 0 }; i < data.size(); ++i) data[i] = (u8)(i * 31);
+        std::ofstream file{ path, std::ios::out | std::ios::binary };
+        for (u64 i{ 0 }; i < file_size; i += data.size()) file.write((const char*)data.data(), data.size());
+    }
+
+    // The checksum stands in for parsing the asset, so the compiler can't skip the reads.
+    auto checksum = [](const u8* const data, u64 size)
+    {
+        u64 sum{ 0 };
+        for (u64 i{ 0 }; i < size; i += 64) sum += data[i];
+        return sum;
+    };
+
+    u64 sum_copy{ 0 };
+    {
+        const memory_usage before{ get_memory_usage() };
+        auto start{ bench_clock::now() };
+        std::unique_ptr<u8[]> data{ std::make_unique<u8[]>(file_size) };
+        std::ifstream file{ path, std::ios::in | std::ios::binary };
+        file.read((char*)data.get(), file_size);
+        sum_copy = checksum(data.get(), file_size);
+        print_result("ifstream read + parse (MB)", (u32)(file_size >> 20), elapsed_ms(start));
+        print_memory("ifstream read", before, get_memory_usage());
+    }
+
+    u64 sum_mapped{ 0 };
+    {
+        const memory_usage before{ get_memory_usage() };
+        auto start{ bench_clock::now() };
+        content::mapped_file file{ path };
+        sum_mapped = checksum(file.data(), file.size());
+        print_result("mapped_file parse (MB)", (u32)(file_size >> 20), elapsed_ms(start));
+        print_memory("mapped_file", before, get_memory_usage());
+
+        file.release(0, file.size());
+        print_memory("mapped_file after release", before, get_memory_usage());
+    }
+
+    assert(sum_copy == sum_mapped);
+    std::filesystem::remove(path);
+}
+
+// Startup cost of reading many small assets: one open and map per loose file vs. one for the whole pack.
+void
+benchmark_pack_loading()
+{
+    constexpr u32 asset_count{ 500 };
+    constexpr u32 asset_size{ 32 * 1024 };
+    const std::filesystem::path directory{ std::filesystem::temp_directory_path() / "primal_pack_benchmark" };
+    const std::filesystem::path pack_path{ directory / "assets.pack" };
+    std::filesystem::create_directories(directory);
+
+    utl::vector<utl::vector<u8>> contents(asset_count);
+    utl::vector<std::string> names(asset_count);
+    utl::vector<content::pack::source> sources(asset_count);
+    for (u32 i{ 0 }; i < asset_count; ++i)
+    {
+        contents[i].resize(asset_size);
+        for (u32 j{ 0 }; j < asset_size; ++j) contents[i][j] = (u8)(i + j * 7);
+        names[i] = "asset_" + std::to_string(i) + ".model";
+        std::ofstream file{ directory / names[i], std::ios::out | std::ios::binary };
+        file.write((const char*)contents[i].data(), asset_size);
+
+        sources[i].name = names[i];
+        sources[i].type = content::asset_type::mesh;
+        sources[i].data = contents[i].data();
+        sources[i].size = asset_size;
+    }
+
+    [[maybe_unused]] const bool result{ content::pack::write(pack_path, sources.data(), asset_count) };
+    assert(result);
+
+    u64 sum_loose{ 0 };
+    auto start{ bench_clock::now() };
+    for (u32 i{ 0 }; i < asset_count; ++i)
+    {
+        content::mapped_file file{ directory / names[i] };
+        for (u64 j{ 0 }; j < file.size(); j += 64) sum_loose += file.data()[j];
+    }
+    print_result("loose files: open + map + read", asset_count, elapsed_ms(start));
+
+    u64 sum_pack{ 0 };
+    start = bench_clock::now();
+    {
+        content::pack_file pack{ pack_path };
+        std::unique_ptr<u8[]> scratch{};
+        for (u32 i{ 0 }; i < asset_count; ++i)
+        {
+            const u32 index{ pack.find(names[i]) };
+            const u8* const entry_data{ pack.data(index, scratch) };
+            for (u64 j{ 0 }; j < pack.entry(index).size; j += 64) sum_pack += entry_data[j];
+        }
+    }
+    print_result("pack: open + map once + find + read", asset_count, elapsed_ms(start));
+
+    assert(sum_loose == sum_pack);
+    std::filesystem::remove_all(directory);
+}
+
+// Per-frame render item gather with a loader thread adding and removing items meanwhile: a mutex around a
+// free list (how render items used to be stored) vs. lock-free reads of a stable free list.
+void
+benchmark_render_item_gather()
+{
+    struct render_item
+    {
+        id::id_type		entity_id;
+        id::id_type		submesh_gpu_id;
+        id::id_type		material_id;
+        id::id_type		pso_id;
+    };
+
+    constexpr u32 item_count{ 100'000 };
+    constexpr u32 frame_count{ 200 };
+
+    utl::vector<id::id_type> frame_ids(item_count);
+    utl::vector<render_item> gathered(item_count);
+    std::atomic<bool> is_loading{ false };
+
+    // Keeps adding and removing a few items, like a level streaming in the background.
+    const auto loader{ [&is_loading](auto&& add, auto&& remove) {
+        utl::vector<id::id_type> ids;
+        while (is_loading.load(std::memory_order_relaxed))
+        {
+            for (u32 i{ 0 }; i < 64; ++i) ids.emplace_back(add(render_item{ i, i, i, i }));
+            for (id::id_type id : ids) remove(id);
+            ids.clear();
+            std::this_thread::yield();
+        }
+        } };
+
+    u64 checksum_locked{ 0 };
+    {
+        utl::free_list<render_item> items;
+        std::mutex mutex;
+        for (u32 i{ 0 }; i < item_count; ++i) frame_ids[i] = items.add(render_item{ i, i, i, i });
+
+        is_loading = true;
+        std::thread thread{ loader,
+            [&](const render_item& item) { std::lock_guard lock{ mutex }; return items.add(item); },
+            [&](id::id_type id) { std::lock_guard lock{ mutex }; items.remove(id); } };
+
+        f32 total_ms{ 0.f };
+        f32 worst_ms{ 0.f };
+        for (u32 frame{ 0 }; frame < frame_count; ++frame)
+        {
+            const auto start{ bench_clock::now() };
+            {
+                std::lock_guard lock{ mutex };
+                for (u32 i{ 0 }; i < item_count; ++i) gathered[i] = items[frame_ids[i]];
+            }
+            const f32 ms{ elapsed_ms(start) };
+            total_ms += ms;
+            worst_ms = std::max(worst_ms, ms);
+            checksum_locked += gathered[frame % item_count].entity_id;
+        }
+        print_result("render item gather, mutex + free_list: average frame", frame_count, total_ms / frame_count);
+        print_result("render item gather, mutex + free_list: worst frame", frame_count, worst_ms);
+
+        is_loading = false;
+        thread.join();
+    }
+
+    u64 checksum_lock_free{ 0 };
+    {
+        graphics::stable_free_list<render_item> items;
+        std::mutex mutex;
+        for (u32 i{ 0 }; i < item_count; ++i) frame_ids[i] = items.add(render_item{ i, i, i, i });
+
+        is_loading = true;
+        std::thread thread{ loader,
+            [&](const render_item& item) { std::lock_guard lock{ mutex }; return items.add(item); },
+            [&](id::id_type id) { std::lock_guard lock{ mutex }; items.remove(id); } };
+
+        f32 total_ms{ 0.f };
+        f32 worst_ms{ 0.f };
+        for (u32 frame{ 0 }; frame < frame_count; ++frame)
+        {
+            const auto start{ bench_clock::now() };
+            for (u32 i{ 0 }; i < item_count; ++i) gathered[i] = items[frame_ids[i]];
+            const f32 ms{ elapsed_ms(start) };
+            total_ms += ms;
+            worst_ms = std::max(worst_ms, ms);
+            checksum_lock_free += gathered[frame % item_count].entity_id;
+        }
+        print_result("render item gather, lock-free stable_free_list: average frame", frame_count, total_ms / frame_count);
+        print_result("render item gather, lock-free stable_free_list: worst frame", frame_count, worst_ms);
+
+        is_loading = false;
+        thread.join();
+    }
+
+    assert(checksum_locked == checksum_lock_free);
+}
+
+// Geometry pool compaction with live submeshes: a loading thread runs out of space, so the pool compacts and grows,
+// and the render thread moves the data when it recreates the buffers. Draws before that have to use the old ranges
+// and draws after it the new ones. The pool's buffer is simulated in system memory, with one byte per element
+// that says which submesh it belongs to.
+void
+test_geometry_pool_compaction()
+{
+    constexpr u32 submesh_count{ 64 };
+    constexpr u64 initial_capacity{ 8 * 1024 };
+    constexpr u64 large_submesh_size{ 6000 };	// fits neither in a hole nor in the pool after compacting it
+
+    graphics::resident_range_allocator ranges;
+    ranges.initialize(initial_capacity);
+    utl::vector<u8> buffer;
+
+    // What d3d11_geometry_pool::update() does when a frame starts.
+    const auto update{ [&ranges, &buffer]() {
+        if (!ranges.needs_rebuild()) return;
+        utl::vector<u8> new_buffer(ranges.capacity());
+        ranges.rebuild([&](u64 old_offset, u64 new_offset, u64 size) { memcpy(&new_buffer[new_offset], &buffer[old_offset], size); });
+        buffer = std::move(new_buffer);
+        } };
+
+    const auto upload{ [&ranges, &buffer](u32 handle, u8 tag) {
+        memset(&buffer[ranges.make_resident(handle)], tag, ranges.size(handle));
+        } };
+
+    // Checks that a draw of the submesh reads only its own data.
+    const auto is_drawn_correctly{ [&ranges, &buffer](u32 handle, u8 tag) {
+        if (!ranges.is_resident(handle)) return false;
+        const u64 offset{ ranges.offset(handle) };
+        const u64 size{ ranges.size(handle) };
+        if (offset + size > buffer.size()) return false;
+        for (u64 i{ 0 }; i < size; ++i) if (buffer[offset + i] != tag) return false;
+        return true;
+        } };
+
+    u32 handles[submesh_count]{};
+    for (u32 i{ 0 }; i < submesh_count; ++i)
+    {
+        //NOTE: odd submeshes are aligned to 4 elements, like index ranges.
+        handles[i] = ranges.allocate(32 + (i % 7) * 16, (i & 1) ? 4 : 1);
+    }
+
+    update();
+    for (u32 i{ 0 }; i < submesh_count; ++i) upload(handles[i], (u8)(i + 1));
+
+    // Leave holes that are too small for the large submesh.
+    for (u32 i{ 0 }; i < submesh_count; i += 2)
+    {
+        ranges.free(handles[i]);
+        handles[i] = u32_invalid_id;
+    }
+
+    const auto start{ bench_clock::now() };
+    const u32 large_handle{ ranges.allocate(large_submesh_size, 4) };
+    assert(ranges.needs_rebuild() && ranges.capacity() > initial_capacity);
+
+    // Frames until the next update still draw from the old buffer, at the old offsets.
+    for (u32 i{ 1 }; i < submesh_count; i += 2) assert(is_drawn_correctly(handles[i], (u8)(i + 1)));
+    assert(!ranges.is_resident(large_handle));
+
+    update();
+    upload(large_handle, 0xff);
+    print_result("geometry pool compaction, compact, grow and move live submeshes", submesh_count / 2, elapsed_ms(start));
+
+    //NOTE: the large submesh is written last, so it would have overwritten any live submesh it overlaps.
+    for (u32 i{ 1 }; i < submesh_count; i += 2)
+    {
+        assert(is_drawn_correctly(handles[i], (u8)(i + 1)));
+        assert(!(ranges.offset(handles[i]) & 3));
+    }
+    assert(is_drawn_correctly(large_handle, 0xff));
+}
+
+// Per-frame draw sorting: state changes in gather order vs. draw key order, the draws left after instancing,
+// and the time to sort the keys with std::sort vs. the parallel radix sort.
+void
+benchmark_draw_sorting()
+{
+    constexpr u32 item_count{ 100'000 };
+    constexpr u32 pso_count{ 32 };
+    constexpr u32 material_count{ 512 };
+    constexpr u32 geometry_count{ 64 };
+    constexpr u32 frame_count{ 50 };
+
+    struct item
+    {
+        u32		pso_id;
+        u32		material_id;
+        u32		geometry_id;
+        f32		depth;
+    };
+
+    // Items are gathered in entity order, which has nothing to do with their state.
+    utl::vector<item> items(item_count);
+    utl::vector<u64> keys(item_count);
+    srand(17);
+    for (u32 i{ 0 }; i < item_count; ++i)
+    {
+        const u32 material_id{ (u32)rand() % material_count };
+        items[i] = { material_id % pso_count, material_id, (u32)rand() % geometry_count, (f32)rand() / RAND_MAX * 1000.f };
+        keys[i] = graphics::draw_key::make(graphics::draw_key::pass::opaque, items[i].pso_id, items[i].material_id,
+            items[i].geometry_id, graphics::draw_key::quantize_depth(items[i].depth));
+    }
+
+    const auto count_state_changes{ [&items](auto&& item_index) {
+        u32 changes{ 0 };
+        u32 pso_id{ u32_invalid_id };
+        u32 material_id{ u32_invalid_id };
+        for (u32 i{ 0 }; i < item_count; ++i)
+        {
+            const item& it{ items[item_index(i)] };
+            if (it.pso_id != pso_id) ++changes;
+            if (it.material_id != material_id) ++changes;
+            pso_id = it.pso_id;
+            material_id = it.material_id;
+        }
+        return changes;
+        } };
+
+    graphics::radix_sorter sorter;
+    const u32* order{ nullptr };
+    auto start{ bench_clock::now() };
+    for (u32 frame{ 0 }; frame < frame_count; ++frame) order = sorter.sort(keys.data(), item_count);
+    const f32 radix_ms{ elapsed_ms(start) / frame_count };
+
+    utl::vector<std::pair<u64, u32>> pairs(item_count);
+    start = bench_clock::now();
+    for (u32 frame{ 0 }; frame < frame_count; ++frame)
+    {
+        for (u32 i{ 0 }; i < item_count; ++i) pairs[i] = { keys[i], i };
+        std::sort(pairs.begin(), pairs.end());
+    }
+    const f32 std_sort_ms{ elapsed_ms(start) / frame_count };
+
+    for (u32 i{ 0 }; i < item_count; ++i) assert(pairs[i].first == keys[order[i]]);
+
+    print_result("draw sorting, state changes in gather order", item_count, (f32)count_state_changes([](u32 i) { return i; }), "changes");
+    print_result("draw sorting, state changes in draw key order", item_count, (f32)count_state_changes([order](u32 i) { return order[i]; }), "changes");
+
+    // Runs of the same pipeline state, material and geometry are drawn as one instanced draw.
+    u32 instanced_draws{ 0 };
+    for (u32 i{ 0 }; i < item_count; ++i)
+    {
+        const item& it{ items[order[i]] };
+        const item* const prev{ i ? &items[order[i - 1]] : nullptr };
+        if (!prev || it.pso_id != prev->pso_id || it.material_id != prev->material_id || it.geometry_id != prev->geometry_id)
+            ++instanced_draws;
+    }
+
+    print_result("draw sorting, instanced draws in draw key order", item_count, (f32)instanced_draws, "draws");
+    print_result("draw sorting, std::sort per frame", item_count, std_sort_ms);
+    print_result("draw sorting, parallel radix sort per frame", item_count, radix_ms);
+}
+
+void
+benchmark_transform_kernels()
+{
+    using namespace graphics::transform_kernels;
+    constexpr u32 object_count{ 100'003 };		// not a multiple of 8, so the tails get used too
+    constexpr u32 frame_count{ 50 };
+
+    // Written the way the gpass writes its per-instance data: all three matrices of an object together.
+    struct instance_matrices
+    {
+        math::m4x4		world;
+        math::m4x4		world_inverse_transpose;
+        math::m4x4		world_view_projection;
+    };
+
+    utl::vector<f32> columns[10];
+    for (auto& column : columns) column.resize(object_count);
+    srand(29);
+    const auto random{ [](f32 min, f32 max) { return min + (f32)rand() / RAND_MAX * (max - min); } };
+    for (u32 i{ 0 }; i < object_count; ++i)
+    {
+        using namespace DirectX;
+        math::v4 q;
+        XMStoreFloat4(&q, XMQuaternionNormalize(XMVectorSet(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f))));
+        columns[0][i] = random(-100.f, 100.f); columns[1][i] = random(-100.f, 100.f); columns[2][i] = random(-100.f, 100.f);
+        columns[3][i] = q.x; columns[4][i] = q.y; columns[5][i] = q.z; columns[6][i] = q.w;
+        columns[7][i] = random(.1f, 4.f); columns[8][i] = random(.1f, 4.f); columns[9][i] = random(.1f, 4.f);
+    }
+
+    const transform_soa transforms{ columns[0].data(), columns[1].data(), columns[2].data(), columns[3].data(), columns[4].data(),
+        columns[5].data(), columns[6].data(), columns[7].data(), columns[8].data(), columns[9].data(), object_count };
+    math::m4x4 view_projection;
+    DirectX::XMStoreFloat4x4(&view_projection, DirectX::XMMatrixMultiply(
+        DirectX::XMMatrixLookAtRH(DirectX::XMVectorSet(0.f, 50.f, 200.f, 1.f), DirectX::XMVectorZero(), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)),
+        DirectX::XMMatrixPerspectiveFovRH(0.75f, 16.f / 9.f, 0.1f, 1000.f)));
+
+    utl::vector<instance_matrices> reference(object_count);
+    utl::vector<instance_matrices> results(object_count);
+    const auto outputs_for{ [](utl::vector<instance_matrices>& matrices) {
+        return transform_outputs{ &matrices[0].world, &matrices[0].world_inverse_transpose, &matrices[0].world_view_projection,
+            sizeof(instance_matrices) };
+        } };
+
+    constexpr const char* names[isa::count]{
+        "transform kernels, scalar per object", "transform kernels, SSE4", "transform kernels, FMA3", "transform kernels, AVX2" };
+
+    for (u32 variant{ 0 }; variant < isa::count; ++variant)
+    {
+        if (!is_supported((isa::type)variant)) continue;
+        utl::vector<instance_matrices>& matrices{ variant == isa::scalar ? reference : results };
+        const transform_outputs outputs{ outputs_for(matrices) };
+
+        const auto start{ bench_clock::now() };
+        for (u32 frame{ 0 }; frame < frame_count; ++frame) compute_matrices((isa::type)variant, transforms, view_projection, outputs);
+        print_result(names[variant], object_count, elapsed_ms(start) / frame_count);
+
+        if (variant == isa::scalar) continue;
+        // Different operation order, so not bit exact. Relative to the largest element of each matrix.
+        for (u32 i{ 0 }; i < object_count; ++i)
+        {
+            const math::m4x4* const a{ &reference[i].world };
+            const math::m4x4* const b{ &results[i].world };
+            for (u32 m{ 0 }; m < 3; ++m)
+            {
+                f32 largest{ 1.f };
+                for (u32 e{ 0 }; e < 16; ++e) largest = std::max(largest, std::abs(a[m].m[e >> 2][e & 3]));
+                for (u32 e{ 0 }; e < 16; ++e) assert(std::abs(a[m].m[e >> 2][e & 3] - b[m].m[e >> 2][e & 3]) <= 1e-3f * largest);
+            }
+        }
+    }
+}
+
+void
+benchmark_visibility()
+{
+    using namespace graphics::visibility;
+    constexpr u32 bounds_count{ 1'000'003 };	// not a multiple of 8, so the tails get used too
+    constexpr u32 frame_count{ 20 };
+
+    // Centers spread around the camera, so roughly a sixth of them are in view.
+    utl::vector<f32> columns[7];
+    for (auto& column : columns) column.resize(bounds_count);
+    srand(31);
+    const auto random{ [](f32 min, f32 max) { return min + (f32)rand() / RAND_MAX * (max - min); } };
+    for (u32 i{ 0 }; i < bounds_count; ++i)
+    {
+        columns[0][i] = random(-1000.f, 1000.f); columns[1][i] = random(-100.f, 100.f); columns[2][i] = random(-1000.f, 1000.f);
+        columns[3][i] = random(.1f, 10.f); columns[4][i] = random(.1f, 10.f); columns[5][i] = random(.1f, 10.f); columns[6][i] = random(.1f, 10.f);
+    }
+
+    const sphere_soa spheres{ columns[0].data(), columns[1].data(), columns[2].data(), columns[3].data(), bounds_count };
+    const aabb_soa boxes{ columns[0].data(), columns[1].data(), columns[2].data(), columns[4].data(), columns[5].data(), columns[6].data(),
+        bounds_count };
+    math::m4x4 view_projection;
+    DirectX::XMStoreFloat4x4(&view_projection, DirectX::XMMatrixMultiply(
+        DirectX::XMMatrixLookToRH(DirectX::XMVectorSet(0.f, 10.f, 0.f, 1.f), DirectX::XMVectorSet(0.f, 0.f, -1.f, 0.f), DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)),
+        DirectX::XMMatrixPerspectiveFovRH(0.75f, 16.f / 9.f, 1000.f, 0.1f)));		// reversed depth, like the renderers
+    const frustum view_frustum{ make_frustum(view_projection) };
+
+    utl::vector<u32> reference(bounds_count);
+    utl::vector<u32> results(bounds_count);
+
+    // How far bound i is from touching the closest plane, given how far it reaches towards plane p.
+    const auto gap{ [&view_frustum, &columns](u32 i, auto&& reach) {
+        f32 smallest{ std::numeric_limits<f32>::max() };
+        for (u32 p{ 0 }; p < 6; ++p)
+        {
+            const math::v4& plane{ view_frustum.planes[p] };
+            const f32 distance{ plane.x * columns[0][i] + plane.y * columns[1][i] + plane.z * columns[2][i] + plane.w };
+            smallest = std::min(smallest, std::abs(distance + reach(plane, i)));
+        }
+        return smallest;
+        } };
+    const auto sphere_gap{ [&](u32 i) { return gap(i, [&columns](const math::v4&, u32 i) { return columns[3][i]; }); } };
+    const auto box_gap{ [&](u32 i) {
+        return gap(i, [&columns](const math::v4& plane, u32 i) {
+            return std::abs(plane.x) * columns[4][i] + std::abs(plane.y) * columns[5][i] + std::abs(plane.z) * columns[6][i];
+            });
+        } };
+
+    const auto run{ [&](const char* const (&names)[isa::count], auto&& bounds, auto&& bounds_gap) {
+        u32 reference_count{ 0 };
+        for (u32 variant{ 0 }; variant < isa::count; ++variant)
+        {
+            if (!is_supported((isa::type)variant)) continue;
+            utl::vector<u32>& visible{ variant == isa::scalar ? reference : results };
+
+            u32 visible_count{ 0 };
+            const auto start{ bench_clock::now() };
+            for (u32 frame{ 0 }; frame < frame_count; ++frame) visible_count = cull((isa::type)variant, view_frustum, bounds, visible.data());
+            print_result(names[variant], bounds_count, elapsed_ms(start) / frame_count);
+
+            if (variant == isa::scalar)
+            {
+                reference_count = visible_count;
+                print_result("visibility, visible bounds", bounds_count, (f32)visible_count, "bounds");
+                continue;
+            }
+            // Fused multiply-adds round differently, so the lists may only differ in bounds that touch a plane.
+            u32 r{ 0 }, v{ 0 };
+            while (r < reference_count || v < visible_count)
+            {
+                if (r < reference_count && v < visible_count && reference[r] == results[v]) { ++r; ++v; continue; }
+                const bool only_in_reference{ v == visible_count || (r < reference_count && reference[r] < results[v]) };
+                [[maybe_unused]] const u32 index{ only_in_reference ? reference[r++] : results[v++] };
+                assert(bounds_gap(index) < 1e-3f);
+            }
+        }
+        } };
+
+    constexpr const char* sphere_names[isa::count]{ "visibility, spheres, scalar", "visibility, spheres, SSE", "visibility, spheres, AVX2" };
+    constexpr const char* box_names[isa::count]{ "visibility, boxes, scalar", "visibility, boxes, SSE", "visibility, boxes, AVX2" };
+    run(sphere_names, spheres, sphere_gap);
+    run(box_names, boxes, box_gap);
+}
+void
+benchmark_bvh()
+{
+    using namespace DirectX;
+    constexpr u32 view_count{ 4 };
+    constexpr u32 frame_count{ 20 };
+    constexpr u32 ray_count{ 1000 };
+
+    math::m4x4 projection;
+    XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovRH(0.75f, 16.f / 9.f, 300.f, 0.1f));		// reversed depth
+    BoundingFrustum frustums[view_count];
+    math::m4x4 view_projections[view_count];
+    for (u32 i{ 0 }; i < view_count; ++i)
+    {
+        math::m4x4 view;
+        const XMVECTOR direction{ i & 1 ? XMVectorSet(1.f, 0.f, 0.f, 0.f) : XMVectorSet(0.f, 0.f, -1.f, 0.f) };
+        XMStoreFloat4x4(&view, XMMatrixLookToRH(XMVectorSet(i * 20.f, 0.f, 0.f, 1.f), direction, XMVectorSet(0.f, 1.f, 0.f, 0.f)));
+        XMStoreFloat4x4(&view_projections[i], XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+        frustums[i] = graphics::make_bounding_frustum(view, projection);
+    }
+
+    // The same density of items at every count, so about as many are visible each time, and the query
+    // times show how the traversal scales with the size of the tree.
+    srand(37);
+    const auto random{ [](f32 min, f32 max) { return min + (f32)rand() / RAND_MAX * (max - min); } };
+    for (u32 item_count : { 10'000u, 100'000u, 1'000'000u })
+    {
+        const f32 half_size{ 1000.f * std::cbrt(item_count / 100'000.f) };
+        utl::vector<BoundingBox> boxes(item_count);
+        utl::vector<u32> ids(item_count);
+        graphics::bounding_volume_hierarchy bvh{};
+        for (u32 i{ 0 }; i < item_count; ++i)
+        {
+            boxes[i] = BoundingBox{ XMFLOAT3{ random(-half_size, half_size), random(-half_size, half_size), random(-half_size, half_size) },
+                XMFLOAT3{ random(.1f, 3.f), random(.1f, 3.f), random(.1f, 3.f) } };
+            ids[i] = bvh.add(boxes[i], i);
+        }
+
+        auto start{ bench_clock::now() };
+        bvh.commit();
+        print_result("bvh, build", item_count, elapsed_ms(start));
+
+        utl::vector<id::id_type> visible[view_count];
+        start = bench_clock::now();
+        for (u32 frame{ 0 }; frame < frame_count; ++frame)
+        {
+            for (auto& list : visible) list.clear();
+            bvh.query(&frustums[0], view_count, &visible[0]);
+        }
+        print_result("bvh, query 4 views at once", item_count, elapsed_ms(start) / frame_count);
+
+        start = bench_clock::now();
+        for (u32 frame{ 0 }; frame < frame_count; ++frame)
+        {
+            for (u32 i{ 0 }; i < view_count; ++i)
+            {
+                visible[i].clear();
+                bvh.query(frustums[i], visible[i]);
+            }
+        }
+        print_result("bvh, query 4 views one by one", item_count, elapsed_ms(start) / frame_count);
+        print_result("bvh, visible items in view 0", item_count, (f32)visible[0].size(), "items");
+
+        // The same views culled without the tree, which has to test every item.
+        {
+            utl::vector<f32> columns[6];
+            for (auto& column : columns) column.resize(item_count);
+            for (u32 i{ 0 }; i < item_count; ++i)
+            {
+                columns[0][i] = boxes[i].Center.x; columns[1][i] = boxes[i].Center.y; columns[2][i] = boxes[i].Center.z;
+                columns[3][i] = boxes[i].Extents.x; columns[4][i] = boxes[i].Extents.y; columns[5][i] = boxes[i].Extents.z;
+            }
+            const graphics::visibility::aabb_soa bounds{ columns[0].data(), columns[1].data(), columns[2].data(),
+                columns[3].data(), columns[4].data(), columns[5].data(), item_count };
+            utl::vector<u32> results(item_count);
+            start = bench_clock::now();
+            for (u32 frame{ 0 }; frame < frame_count; ++frame)
+            {
+                for (u32 i{ 0 }; i < view_count; ++i) graphics::visibility::cull(graphics::visibility::make_frustum(view_projections[i]), bounds, results.data());
+            }
+            print_result("bvh, 4 views culled without the tree", item_count, elapsed_ms(start) / frame_count);
+        }
+
+        if (item_count == 10'000)
+        {
+            // The tree must return exactly what testing every box against the same planes does.
+            for (u32 v{ 0 }; v < view_count; ++v)
+            {
+                XMVECTOR planes[6];
+                frustums[v].GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+                utl::vector<id::id_type> expected;
+                for (u32 i{ 0 }; i < item_count; ++i)
+                {
+                    if (boxes[i].ContainedBy(planes[0], planes[1], planes[2], planes[3], planes[4], planes[5]) != DISJOINT) expected.emplace_back(i);
+                }
+                std::sort(visible[v].begin(), visible[v].end());
+                assert(visible[v].size() == expected.size() && std::equal(expected.begin(), expected.end(), visible[v].begin()));
+            }
+        }
+
+        // Move a tenth of the items a little, which only needs a refit.
+        for (u32 i{ 0 }; i < item_count / 10; ++i)
+        {
+            const u32 index{ (u32)rand() % item_count };
+            boxes[index].Center.x += random(-5.f, 5.f);
+            bvh.update(ids[index], boxes[index]);
+        }
+        start = bench_clock::now();
+        bvh.commit();
+        print_result("bvh, refit after moving 10% of the items", item_count, elapsed_ms(start));
+
+        u32 hit_count{ 0 };
+        start = bench_clock::now();
+        for (u32 i{ 0 }; i < ray_count; ++i)
+        {
+            const XMVECTOR origin{ XMVectorSet(random(-half_size, half_size), random(-half_size, half_size), random(-half_size, half_size), 1.f) };
+            const XMVECTOR direction{ XMVector3Normalize(XMVectorSet(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), 0.f)) };
+            graphics::bounding_volume_hierarchy::ray_hit hit;
+            if (bvh.raycast(origin, direction, 500.f, hit)) ++hit_count;
+        }
+        print_result("bvh, 1000 raycasts", item_count, elapsed_ms(start));
+        print_result("bvh, raycast hits", 1000, (f32)hit_count, "hits");
+    }
+}
+void
+benchmark_block_compression()
+{
+    using namespace graphics::block_compression;
+
+    // Known blocks and the texels a reference decoder produced for them.
+    struct known_block
+    {
+        format::type	type;
+        u8				block[16];
+        u8				texels[16 * 4];
+    };
+
+    constexpr known_block known_blocks[]
+    {
+        { format::bc1, { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0x1b, 0x50, 0xfa }, // opaque
+          { 0xff, 0x00, 0x00, 0xff, 0x00, 0x00, 0xff, 0xff, 0xaa, 0x00, 0x55, 0xff, 0x55, 0x00, 0xaa, 0xff,
+            0x55, 0x00, 0xaa, 0xff, 0xaa, 0x00, 0x55, 0xff, 0x00, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff,
+            0xff, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+            0xaa, 0x00, 0x55, 0xff, 0xaa, 0x00, 0x55, 0xff, 0x55, 0x00, 0xaa, 0xff, 0x55, 0x00, 0xaa, 0xff } },
+        { format::bc1, { 0xe0, 0x07, 0xe0, 0xff, 0xe4, 0x1b, 0x50, 0xfa }, // 1-bit alpha
+          { 0x00, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0x7f, 0xff, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x7f, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff,
+            0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0xff,
+            0x7f, 0xff, 0x00, 0xff, 0x7f, 0xff, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+        { format::bc2, { 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x1f, 0x00, 0xe0, 0x07, 0x1b, 0x1b, 0x1b, 0x1b },
+          { 0x00, 0xaa, 0x55, 0x00, 0x00, 0x55, 0xaa, 0x11, 0x00, 0xff, 0x00, 0x22, 0x00, 0x00, 0xff, 0x33,
+            0x00, 0xaa, 0x55, 0x44, 0x00, 0x55, 0xaa, 0x55, 0x00, 0xff, 0x00, 0x66, 0x00, 0x00, 0xff, 0x77,
+            0x00, 0xaa, 0x55, 0x88, 0x00, 0x55, 0xaa, 0x99, 0x00, 0xff, 0x00, 0xaa, 0x00, 0x00, 0xff, 0xbb,
+            0x00, 0xaa, 0x55, 0xcc, 0x00, 0x55, 0xaa, 0xdd, 0x00, 0xff, 0x00, 0xee, 0x00, 0x00, 0xff, 0xff } },
+        { format::bc3, { 0xf0, 0x10, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0xff, 0xff, 0x00, 0x00, 0xe4, 0xe4, 0xe4, 0xe4 },
+          { 0xff, 0xff, 0xff, 0xf0, 0x00, 0x00, 0x00, 0x10, 0xaa, 0xaa, 0xaa, 0xd0, 0x55, 0x55, 0x55, 0xb0,
+            0xff, 0xff, 0xff, 0x90, 0x00, 0x00, 0x00, 0x70, 0xaa, 0xaa, 0xaa, 0x50, 0x55, 0x55, 0x55, 0x30,
+            0xff, 0xff, 0xff, 0xf0, 0x00, 0x00, 0x00, 0x10, 0xaa, 0xaa, 0xaa, 0xd0, 0x55, 0x55, 0x55, 0xb0,
+            0xff, 0xff, 0xff, 0x90, 0x00, 0x00, 0x00, 0x70, 0xaa, 0xaa, 0xaa, 0x50, 0x55, 0x55, 0x55, 0x30 } },
+        { format::bc3, { 0x10, 0xf0, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0x10, 0x84, 0x1f, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4 }, // 6 interpolated alpha values
+          { 0x84, 0x82, 0x84, 0x10, 0xff, 0x00, 0xff, 0xf0, 0xad, 0x56, 0xad, 0x3c, 0xd6, 0x2b, 0xd6, 0x69,
+            0x84, 0x82, 0x84, 0x96, 0xff, 0x00, 0xff, 0xc3, 0xad, 0x56, 0xad, 0x00, 0xd6, 0x2b, 0xd6, 0xff,
+            0x84, 0x82, 0x84, 0x10, 0xff, 0x00, 0xff, 0xf0, 0xad, 0x56, 0xad, 0x3c, 0xd6, 0x2b, 0xd6, 0x69,
+            0x84, 0x82, 0x84, 0x96, 0xff, 0x00, 0xff, 0xc3, 0xad, 0x56, 0xad, 0x00, 0xd6, 0x2b, 0xd6, 0xff } },
+        { format::bc4, { 0xc8, 0x28, 0x77, 0x39, 0x05, 0x77, 0x39, 0x05 },
+          { 0x3e, 0x55, 0x6c, 0x83, 0x9a, 0xb1, 0x28, 0xc8, 0x3e, 0x55, 0x6c, 0x83, 0x9a, 0xb1, 0x28, 0xc8 } },
+        { format::bc5, { 0xff, 0x00, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0x1e, 0xdc, 0x40, 0x22, 0x6d, 0x64, 0x6b, 0xff },
+          { 0xff, 0x1e, 0x00, 0x1e, 0xda, 0xdc, 0xb6, 0xdc, 0x91, 0x44, 0x6d, 0x44, 0x48, 0x6a, 0x24, 0x6a,
+            0xff, 0x90, 0x00, 0x90, 0xda, 0xb6, 0xb6, 0xb6, 0x91, 0x00, 0x6d, 0x00, 0x48, 0xff, 0x24, 0xff } },
+        { format::bc7, { 0xaa, 0x43, 0xae, 0x4e, 0x92, 0xdd, 0x81, 0x1f, 0x8c, 0xbb, 0x31, 0xba, 0x04, 0x05, 0x31, 0xfd }, // mode 1, two subsets
+          { 0x0e, 0x4a, 0x7e, 0xff, 0x6a, 0x87, 0x9b, 0xff, 0xa9, 0x74, 0xe1, 0xff, 0x66, 0x7d, 0xc4, 0xff,
+            0x6a, 0x87, 0x9b, 0xff, 0x2d, 0x5e, 0x88, 0xff, 0x9c, 0x76, 0xdb, 0xff, 0x0e, 0x4a, 0x7e, 0xff,
+            0xaa, 0xb2, 0xb0, 0xff, 0xa9, 0x74, 0xe1, 0xff, 0x8b, 0x9e, 0xa6, 0xff, 0x0e, 0x4a, 0x7e, 0xff,
+            0x82, 0x79, 0xd0, 0xff, 0x8f, 0x78, 0xd6, 0xff, 0xe7, 0xdb, 0xc3, 0xff, 0xe7, 0xdb, 0xc3, 0xff } },
+        { format::bc7, { 0xb0, 0x0c, 0xae, 0xfe, 0x1a, 0x0b, 0x78, 0xa6, 0x28, 0x50, 0xae, 0x54, 0x25, 0xf4, 0xb8, 0x2a }, // mode 4, rotated channels
+          { 0xb2, 0x99, 0x74, 0x71, 0x00, 0xc5, 0x70, 0x7b, 0x00, 0x84, 0x77, 0x6c, 0xb2, 0x84, 0x77, 0x6c,
+            0x00, 0xc5, 0x70, 0x7b, 0xb2, 0x84, 0x77, 0x6c, 0x78, 0x6f, 0x79, 0x68, 0x78, 0x6f, 0x79, 0x68,
+            0xb2, 0xb0, 0x72, 0x76, 0x78, 0xda, 0x6d, 0x7f, 0x78, 0x99, 0x74, 0x71, 0xb2, 0xb0, 0x72, 0x76,
+            0xb2, 0x99, 0x74, 0x71, 0x3a, 0xc5, 0x70, 0x7b, 0x3a, 0x84, 0x77, 0x6c, 0xb2, 0x6f, 0x79, 0x68 } },
+        { format::bc7, { 0xc0, 0x52, 0x27, 0x42, 0xe1, 0xfd, 0xa5, 0xca, 0xc7, 0x12, 0x87, 0xe9, 0x17, 0x3a, 0xac, 0xf2 }, // mode 6
+          { 0x48, 0x24, 0x94, 0xa2, 0x3e, 0x28, 0xe4, 0x98, 0x49, 0x24, 0x8c, 0xa3, 0x4a, 0x23, 0x81, 0xa4,
+            0x44, 0x26, 0xb8, 0x9e, 0x43, 0x26, 0xc0, 0x9d, 0x42, 0x27, 0xc9, 0x9c, 0x3c, 0x29, 0xf7, 0x96,
+            0x44, 0x26, 0xb8, 0x9e, 0x4a, 0x23, 0x81, 0xa4, 0x40, 0x27, 0xd3, 0x9a, 0x48, 0x24, 0x94, 0xa2,
+            0x3e, 0x28, 0xe4, 0x98, 0x40, 0x27, 0xd3, 0x9a, 0x49, 0x24, 0x8c, 0xa3, 0x3b, 0x29, 0xff, 0x95 } },
+        { format::bc5_snorm, { 0x7f, 0x81, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0x40, 0xc0, 0x40, 0x22, 0x6d, 0x64, 0x6b, 0xff },
+          { 0x7f, 0x40, 0x81, 0x40, 0x5a, 0xc0, 0x36, 0xc0, 0x12, 0x2d, 0xee, 0x2d, 0xca, 0x1b, 0xa6, 0x1b,
+            0x7f, 0x09, 0x81, 0x09, 0x5a, 0xf7, 0x36, 0xf7, 0x12, 0xe5, 0xee, 0xe5, 0xca, 0xd3, 0xa6, 0xd3 } },
+    };
+
+    u32 mismatch_count{ 0 };
+    for (const known_block& known : known_blocks)
+    {
+        u8 texels[16 * 4];
+        decode(known.type, known.block, block_size(known.type), 4, 4, texels);
+        for (u32 i{ 0 }; i < 16 * pixel_size(known.type); ++i)
+        {
+            if (texels[i] != known.texels[i]) ++mismatch_count;
+        }
+    }
+    assert(!mismatch_count);
+    print_result("block compression, mismatched texels", (u32)std::size(known_blocks) * 16, (f32)mismatch_count, "texels");
+
+    constexpr u32 size{ 2048 };
+    constexpr u32 blocks_per_row{ size / 4 };
+    utl::vector<u8> blocks(blocks_per_row * blocks_per_row * 16);
+    utl::vector<u8> pixels(size * size * 4);
+    srand(35);
+    for (u8& byte : blocks) byte = (u8)rand();
+
+    const auto start_bc1{ bench_clock::now() };
+    decode(format::bc1, blocks.data(), blocks_per_row * block_size(format::bc1), size, size, pixels.data());
+    print_result("block compression, decode 2048x2048 BC1", blocks_per_row * blocks_per_row, elapsed_ms(start_bc1));
+
+    const auto start_bc7{ bench_clock::now() };
+    decode(format::bc7, blocks.data(), blocks_per_row * block_size(format::bc7), size, size, pixels.data());
+    print_result("block compression, decode 2048x2048 BC7", blocks_per_row * blocks_per_row, elapsed_ms(start_bc7));
+}
+}//anonymous namespace
+
+class engine_test : public test
+{
+public:
+    bool initialize() override
+    {
+#if PRIMAL_BUILD_D3D11
+        benchmark_light_creation();
+#endif // PRIMAL_BUILD_D3D11
+        benchmark_file_reading();
+        benchmark_pack_loading();
+        benchmark_render_item_gather();
+        test_geometry_pool_compaction();
+        benchmark_draw_sorting();
+        benchmark_transform_kernels();
+        benchmark_visibility();
+        benchmark_bvh();
+        benchmark_block_compression();
+        return true;
+    }
+
+    void run() override
+    {
+        // All benchmarks run once during initialize().
+#ifdef _WIN64
+        PostQuitMessage(0);
+#else
+        platform::send_quit_event();
+#endif // _WIN64
+    }
+
+    void shutdown() override {}
+};
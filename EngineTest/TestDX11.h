@@ -5,6 +5,7 @@
 #include "Components/Geometry.h"
 #include "Content/ContentToEngine.h"
 #include "Content/ContentLoader.h"
+#include "Content/ContentStreaming.h"
 #include "EngineAPI/GameEntity.h"
 #include "EngineAPI/Light.h"
 #include "EngineAPI/ScriptComponent.h"
@@ -14,6 +15,7 @@
 #include "Platform/Platform.h"
 #include "Input/Input.h"
 #include "Utilities/IOStream.h"
+#include "Graphics/Direct3D11/D3D11Content.h"
 
 #include "../ContentTools/Geometry.h"
 
@@ -36,7 +38,6 @@ bool resized{ false };
 
 game_entity::entity create_one_game_entity(math::v3 position, math::v3 rotation, geometry::init_info* geometry, const char* script_name);
 void remove_game_entity(game_entity::entity_id id);
-bool read_file(std::filesystem::path, std::unique_ptr<u8[]>&, u64&);
 void generate_lights();
 void remove_lights();
 void test_lights(f32 dt);
@@ -81,28 +82,20 @@ constexpr u32 num_items{ 10 };
 
 std::unordered_map<id::id_type, game_entity::entity_id> render_item_entity_map;
 
-_NODISCARD id::id_type
-load_asset(const char* path, content::asset_type::type type)
-{
-    std::unique_ptr<u8[]> buffer;
-    u64 size{ 0 };
-    read_file(path, buffer, size);
-
-    const id::id_type asset_id{ content::create_resource(buffer.get(), type) };
-    assert(id::is_valid(asset_id));
-    return asset_id;
-}
-
-_NODISCARD id::id_type
-load_model(const char* path)
+void
+request_asset(const char* path, content::asset_type::type type, content::streaming::priority::type priority, id::id_type* const asset_id)
 {
-    return load_asset(path, content::asset_type::mesh);
-}
+    content::streaming::request_info info{};
+    info.path = path;
+    info.type = type;
+    info.priority = priority;
+    info.on_completed = [asset_id](id::id_type, id::id_type id, [[maybe_unused]] content::streaming::status::type status)
+    {
+        assert(status == content::streaming::status::completed && id::is_valid(id));
+        *asset_id = id;
+    };
 
-_NODISCARD id::id_type
-load_texture(const char* path)
-{
-    return load_asset(path, content::asset_type::texture);
+    [[maybe_unused]] const id::id_type request_id{ content::streaming::request(std::move(info)) };
 }
 
 void
@@ -537,21 +530,39 @@ public:
 
             memset(&texture_ids[0], 0xff, sizeof(id::id_type) * _countof(texture_ids));
 
-            std::thread threads[]{
-                std::thread{ [] { texture_ids[texture_usage::ambient_occlusion] = load_texture("..\\..\\x64\\ao.texture"); }},
-                std::thread{ [] { texture_ids[texture_usage::base_color] = load_texture("..\\..\\x64\\albedo.texture"); }},
-                std::thread{ [] { texture_ids[texture_usage::emissive] = load_texture("..\\..\\x64\\emissive.texture"); }},
-                std::thread{ [] { texture_ids[texture_usage::metal_rough] = load_texture("..\\..\\x64\\metalrough.texture"); }},
-                std::thread{ [] { texture_ids[texture_usage::normal] = load_texture("..\\..\\x64\\normal.texture"); }},
-
-                std::thread{ [] { house_model_id = load_model("..\\..\\x64\\house_model.model"); } },
-                std::thread{ [] { plane_model_id = load_model("..\\..\\x64\\wood_model.model"); } },
-                std::thread{ [] { robot_model_id = load_model("..\\..\\x64\\robot_model.model"); } },
-                std::thread{ [] { sphere_model_id = load_model("..\\..\\x64\\sphere_model.model"); } },
-                std::thread{ [] { load_shaders(); } },
-            };
-
-            for (auto& t : threads) t.join();
+            content::streaming::init_info streaming_info{};
+            content::streaming::initialize(streaming_info);
+
+            // Geometry is needed before the scene can be put together, textures may arrive a little later.
+            using content::streaming::priority;
+            using content::asset_type;
+            request_asset("..\\..\\x64\\house_model.model", asset_type::mesh, priority::immediate, &house_model_id);
+            request_asset("..\\..\\x64\\wood_model.model", asset_type::mesh, priority::immediate, &plane_model_id);
+            request_asset("..\\..\\x64\\robot_model.model", asset_type::mesh, priority::immediate, &robot_model_id);
+            request_asset("..\\..\\x64\\sphere_model.model", asset_type::mesh, priority::immediate, &sphere_model_id);
+
+            request_asset("..\\..\\x64\\albedo.texture", asset_type::texture, priority::high, &texture_ids[texture_usage::base_color]);
+            request_asset("..\\..\\x64\\normal.texture", asset_type::texture, priority::high, &texture_ids[texture_usage::normal]);
+            request_asset("..\\..\\x64\\metalrough.texture", asset_type::texture, priority::normal, &texture_ids[texture_usage::metal_rough]);
+            request_asset("..\\..\\x64\\ao.texture", asset_type::texture, priority::normal, &texture_ids[texture_usage::ambient_occlusion]);
+            request_asset("..\\..\\x64\\emissive.texture", asset_type::texture, priority::background, &texture_ids[texture_usage::emissive]);
+
+            // Shaders are compiled while the assets stream in.
+            std::thread shader_thread{ [] { load_shaders(); } };
+
+            using submesh_stats = graphics::d3d11::content::submesh::load_stats;
+            const submesh_stats before{ graphics::d3d11::content::submesh::thread_load_stats() };
+            content::streaming::flush();
+            const submesh_stats& after{ graphics::d3d11::content::submesh::thread_load_stats() };
+            shader_thread.join();
+
+            // Assets are created by streaming::update() on this thread, so the stats cover all models.
+            const content::streaming::stats stream_stats{ content::streaming::get_stats() };
+            char message[256];
+            sprintf_s(message, "models: %u submeshes, %llu bytes uploaded, %llu bytes copied, %.3f ms, %llu bytes peak in flight\n",
+                after.submesh_count - before.submesh_count, after.bytes_uploaded - before.bytes_uploaded,
+                after.bytes_copied - before.bytes_copied, after.load_time_ms - before.load_time_ms, stream_stats.peak_bytes_in_flight);
+            OutputDebugStringA(message);
 
             create_material();
             id::id_type materials[]{ default_mtl_id };
@@ -600,6 +611,7 @@ public:
         std::this_thread::sleep_for(std::chrono::milliseconds(5));
         const f32 dt_avg{ timer.dt_avg() };
         script::update(dt_avg);
+        content::streaming::update();
         //test_lights(dt_avg);
 
         for (u32 i{ 0 }; i < _countof(_surfaces); ++i)
@@ -625,6 +637,7 @@ public:
 
     void shutdown() override
     {
+        content::streaming::shutdown();
         destroy_render_items();
         remove_lights();
 
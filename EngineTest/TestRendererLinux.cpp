@@ -1,12 +1,12 @@
 #ifdef __linux__
 
 #include <filesystem>
-#include <fstream>
 #include "TestRendererLinux.h"
 #include "Platform/PlatformTypes.h"
 #include "Platform/Platform.h"
 #include "Graphics/Renderer.h"
 #include "Content/ContentToEngine.h"
+#include "Content/MappedFile.h"
 //#include "ShaderCompilation.h"
 
 #if TEST_RENDERER
@@ -105,25 +105,15 @@ win_proc(const platform::event* const ev)
 	}
 }
 
-bool
-read_file(std::filesystem::path path, std::unique_ptr<u8[]>& data, u64& size)
+// Assets are parsed straight from the mapped file, so they're never copied into a heap buffer first.
+id::id_type
+load_asset(std::filesystem::path path, content::asset_type::type type)
 {
-	if (!std::filesystem::exists(path)) return false;
-
-	size = std::filesystem::file_size(path);
-	assert(size);
-	if (!size) return false;
-
-	data = std::make_unique<u8[]>(size);
-	std::ifstream file{ path, std::ios::in | std::ios::binary };
-	if (!file || !file.read((char*)data.get(), size))
-	{
-		file.close();
-		return false;
-	}
+	content::mapped_file file{ path };
+	assert(file.is_open());
+	if (!file.is_open()) return id::invalid_id;
 
-	file.close();
-	return true;
+	return content::create_resource(file.data(), type);
 }
 
 void
@@ -0,0 +1,103 @@
+// Copyright (c) Contributors of Primal+
+// Distributed under the MIT license. See the LICENSE file in the project root for more information.
+
+// Packs loose asset files into a single asset pack that the engine maps at startup.
+//
+//   PackTool <output.pack> [--lz4] <file or directory>...
+//
+// Directories are added recursively and entries are named by their path relative to the directory,
+// with '/' as separator. Files given directly are named by their file name.
+#include "Content/ContentToEngine.h"
+#include "Content/MappedFile.h"
+#include "Content/PackFormat.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace primal;
+
+namespace {
+
+struct input_file
+{
+    std::filesystem::path	path;
+    std::string				name;
+};
+
+content::asset_type::type
+asset_type_from_extension(const std::filesystem::path& path)
+{
+    using content::asset_type;
+    const std::string extension{ path.extension().string() };
+    if (extension == ".model") return asset_type::mesh;
+    if (extension == ".texture") return asset_type::texture;
+    if (extension == ".material") return asset_type::material;
+    return asset_type::unknown;
+}
+
+void
+add_input(const std::filesystem::path& path, utl::vector<input_file>& inputs)
+{
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto& item : std::filesystem::recursive_directory_iterator{ path })
+        {
+            if (!item.is_regular_file()) continue;
+            inputs.emplace_back(input_file{ item.path(), std::filesystem::relative(item.path(), path).generic_string() });
+        }
+    }
+    else
+    {
+        inputs.emplace_back(input_file{ path, path.filename().generic_string() });
+    }
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: PackTool <output.pack> [--lz4] <file or directory>...\n");
+        return 1;
+    }
+
+    content::pack::compression::type compression{ content::pack::compression::none };
+    utl::vector<input_file> inputs;
+    for (s32 i{ 2 }; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--lz4")) compression = content::pack::compression::lz4;
+        else add_input(argv[i], inputs);
+    }
+
+    utl::vector<content::mapped_file> files(inputs.size());
+    utl::vector<content::pack::source> sources(inputs.size());
+    u64 total_size{ 0 };
+    for (u32 i{ 0 }; i < inputs.size(); ++i)
+    {
+        if (!files[i].open(inputs[i].path))
+        {
+            printf("Failed to open %s\n", inputs[i].path.string().c_str());
+            return 1;
+        }
+
+        content::pack::source& source{ sources[i] };
+        source.name = inputs[i].name;
+        source.type = asset_type_from_extension(inputs[i].path);
+        source.data = files[i].data();
+        source.size = files[i].size();
+        source.compression = compression;
+        total_size += source.size;
+    }
+
+    const std::filesystem::path output{ argv[1] };
+    if (!content::pack::write(output, sources.data(), (u32)sources.size()))
+    {
+        printf("Failed to write %s. Check for duplicate entry names.\n", output.string().c_str());
+        return 1;
+    }
+
+    printf("Packed %u files (%llu bytes) into %s (%llu bytes)\n", (u32)sources.size(), (unsigned long long)total_size,
+        output.string().c_str(), (unsigned long long)std::filesystem::file_size(output));
+    return 0;
+}
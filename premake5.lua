@@ -78,15 +78,15 @@ project "Engine"
     language "C++"
     cppdialect "C++17"
     staticruntime "Off"
-    files { "%{prj.name}/**.h", "%{prj.name}/**.cpp" }
+    files { "%{prj.name}/**.h", "%{prj.name}/**.cpp", "%{prj.name}/Graphics/Vulkan/Shaders/**.comp", "%{prj.name}/Graphics/Vulkan/Shaders/**.vert" }
     if _TARGET_OS == "windows" then
         targetname "$(ProjectName)"
-        includedirs { "$(SolutionDir)Engine", "$(SolutionDir)Engine/Common", "$(VULKAN_SDK)/Include" }
+        includedirs { "$(SolutionDir)Engine", "$(SolutionDir)Engine/Common", "$(VULKAN_SDK)/Include", "$(SolutionDir)DirectXMath/Extensions" }
         systemversion "latest"
         defines "_LIB"
     else
         targetname "%{prj.name}"
-        includedirs { "%{wks.location}/Engine", "%{wks.location}/Engine/Common" }
+        includedirs { "%{wks.location}/Engine", "%{wks.location}/Engine/Common", "%{wks.location}/DirectXMath/Extensions" }
         removefiles { "%{prj.name}/Graphics/Direct3D12/**.cpp" }
         buildoptions { "-Wno-switch -Wno-missing-field-initializers -Wno-unused-parameter -Wno-ignored-qualifiers -Wno-unknown-pragmas -Wno-class-memaccess -Wno-reorder" }
         links { "X11" }
@@ -110,6 +110,29 @@ project "Engine"
         end)
     end
 
+    -- The transform kernel variants are each compiled for their own instruction set. Only the one the
+    -- CPU supports gets called, so the rest of the engine keeps the default target.
+    filter "files:Engine/Graphics/TransformKernelsSSE4.cpp"
+        if _TARGET_OS == "linux" then buildoptions { "-msse4.1" } end
+    filter "files:Engine/Graphics/TransformKernelsFMA3.cpp"
+        vectorextensions "AVX"
+        if _TARGET_OS == "linux" then buildoptions { "-mfma" } end
+    filter "files:Engine/Graphics/TransformKernelsAVX2.cpp or Engine/Graphics/VisibilityAVX2.cpp"
+        vectorextensions "AVX2"
+        if _TARGET_OS == "linux" then buildoptions { "-mfma" } end
+
+    -- The Vulkan backend loads its shaders as SPIR-V from next to their sources, so they're compiled
+    -- with glslc from the Vulkan SDK whenever the sources change.
+    filter "files:Engine/Graphics/Vulkan/Shaders/**"
+        buildmessage "Compiling %{file.name} to SPIR-V"
+        if _TARGET_OS == "windows" then
+            buildcommands { '"$(VULKAN_SDK)/Bin/glslc.exe" "%{file.abspath}" -o "%{file.abspath}.spv"' }
+        else
+            buildcommands { 'glslc "%{file.abspath}" -o "%{file.abspath}.spv"' }
+        end
+        buildoutputs { "%{file.abspath}.spv" }
+    filter {}
+
 -- This should only build in DebugEditor and ReleaseEditor configurations, and therefore only build in
 -- the Windows environment
 if _TARGET_OS == "windows" then
@@ -175,6 +198,37 @@ project "EngineTest"
                           "xcopy /Y /D $(SolutionDir)packages\\DirectXShaderCompiler\\bin\\x64\\dxil.dll $(OutDir)" }
         prebuildmessage "If packages\\DirectXShaderCompiler\\ folder doesn't exist or is empty then download the latest release of DXC"
 
+-- Command line tool that packs loose asset files into an asset pack
+project "PackTool"
+    location "PackTool"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    staticruntime "Off"
+    if _TARGET_OS == "windows" then
+        targetname "$(ProjectName)"
+        includedirs { "$(SolutionDir)Engine", "$(SolutionDir)Engine/Common" }
+        libdirs "$(OutDir)"
+        systemversion "latest"
+        defines "_CONSOLE"
+    else
+        targetname "%{prj.name}"
+        includedirs { "%{wks.location}/Engine", "%{wks.location}/Engine/Common" }
+        buildoptions { "-Wno-switch -Wno-missing-field-initializers -Wno-unused-parameter -Wno-ignored-qualifiers -Wno-unknown-pragmas -Wno-class-memaccess -Wno-reorder" }
+        libdirs (outputdir)
+    end
+    links { "Engine" }
+    targetdir (outputdir)
+    objdir (intermediatesdir)
+    files { "%{prj.name}/**.h", "%{prj.name}/**.cpp" }
+    rtti "Off"
+    floatingpoint "Fast"
+    conformancemode "On"
+    exceptionhandling "Off"
+    warnings "Extra"
+    dependson "Engine"
+    removeconfigurations { "ReleaseEditor", "DebugEditor" }
+
 -- This should only build in DebugEditor and ReleaseEditor configurations, and therefore only build in
 -- the Windows environment
 if _TARGET_OS == "windows" then